@@ -0,0 +1,139 @@
+#include "JobSystem.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using Orasis::JobCounter;
+using Orasis::JobSystem;
+
+/*
+    Times parallelFor and a fan-out job graph with 1..N workers (plus the calling thread), N is
+    the first argument or hardware_concurrency - 1. Median of a few runs, in milliseconds, next
+    to the single threaded loop for parallelFor. Build in Release.
+*/
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    template<typename Work>
+    double medianMs(int runs, const Work& work)
+    {
+        std::vector<double> times;
+
+        for (int i = 0; i < runs; i++)
+        {
+            auto start = Clock::now();
+            work();
+            times.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        }
+
+        std::sort(times.begin(), times.end());
+        return times[times.size() / 2];
+    }
+
+    // Enough math per element that the split matters, not the memory bandwidth
+    float element(size_t i)
+    {
+        float x = static_cast<float>(i) * 0.001f;
+        return std::sin(x) * std::cos(x * 0.5f) + std::sqrt(x + 1.0f);
+    }
+
+    // root -> fanOut jobs -> fanOut jobs each, the second level started through runAfter per branch
+    void fanOut(JobSystem& jobs, uint32_t fanOut, uint32_t work, std::atomic<uint64_t>& sink)
+    {
+        JobCounter all;
+        std::vector<JobCounter> branches(fanOut);
+
+        for (uint32_t b = 0; b < fanOut; b++)
+        {
+            jobs.run([&, b] {
+                float sum = 0.0f;
+                for (uint32_t i = 0; i < work; i++)
+                    sum += element(b * work + i);
+                sink.fetch_add(static_cast<uint64_t>(sum), std::memory_order_relaxed);
+            }, &branches[b]);
+
+            for (uint32_t l = 0; l < fanOut; l++)
+                jobs.runAfter(branches[b], [&, b, l] {
+                    float sum = 0.0f;
+                    for (uint32_t i = 0; i < work; i++)
+                        sum += element((b * fanOut + l) * work + i);
+                    sink.fetch_add(static_cast<uint64_t>(sum), std::memory_order_relaxed);
+                }, &all);
+        }
+
+        // The leaves are only counted once their branch finished
+        for (JobCounter& branch : branches)
+            jobs.wait(branch);
+
+        jobs.wait(all);
+    }
+
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t maxWorkers = std::max(2u, std::thread::hardware_concurrency()) - 1;
+    if (argc > 1)
+        maxWorkers = std::max(1, std::atoi(argv[1]));
+
+    const size_t count = 4'000'000;
+    const int runs = 7;
+
+    std::vector<float> out(count);
+
+    double serial = medianMs(runs, [&] {
+        for (size_t i = 0; i < count; i++)
+            out[i] = element(i);
+    });
+
+    std::printf("parallelFor over %zu elements, serial %.2f ms\n", count, serial);
+    std::printf("%8s %12s %12s %10s\n", "workers", "grain", "ms", "speedup");
+
+    for (uint32_t workers = 1; workers <= maxWorkers; workers++)
+    {
+        JobSystem jobs{workers, false};
+
+        for (size_t grain : {size_t(256), size_t(4096), size_t(65536)})
+        {
+            double ms = medianMs(runs, [&] {
+                jobs.parallelFor(0, count, grain, [&](size_t begin, size_t end) {
+                    for (size_t i = begin; i < end; i++)
+                        out[i] = element(i);
+                });
+            });
+
+            std::printf("%8u %12zu %12.2f %9.2fx\n", workers, grain, ms, serial / ms);
+        }
+    }
+
+    std::printf("\nfan-out graph, 64 branches x 64 leaves\n");
+    std::printf("%8s %12s %12s\n", "workers", "work/job", "ms");
+
+    std::atomic<uint64_t> sink{0};
+
+    for (uint32_t workers = 1; workers <= maxWorkers; workers++)
+    {
+        JobSystem jobs{workers, false};
+
+        // Tiny jobs measure the scheduler itself, larger ones the scaling
+        for (uint32_t work : {16u, 1024u})
+        {
+            double ms = medianMs(runs, [&] { fanOut(jobs, 64, work, sink); });
+            std::printf("%8u %12u %12.3f\n", workers, work, ms);
+        }
+    }
+
+    // Keeps the work from being optimised away
+    std::printf("\n(checksum %llu %f)\n", static_cast<unsigned long long>(sink.load()), static_cast<double>(out[count / 3]));
+
+    return 0;
+}
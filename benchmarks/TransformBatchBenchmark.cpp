@@ -0,0 +1,98 @@
+#include "TransformBatch.hpp"
+#include "GameObject.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace Orasis;
+
+/*
+    ns per object for composeTransforms at every level the CPU supports, next to a loop over
+    TransformComponent::mat4() (what the engine did per object before the batch). Object count
+    is the first argument, 100000 by default. Build in Release.
+*/
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    template<typename Work>
+    double medianNs(int runs, const Work& work)
+    {
+        std::vector<double> times;
+
+        for (int i = 0; i < runs; i++)
+        {
+            auto start = Clock::now();
+            work();
+            times.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+        }
+
+        std::sort(times.begin(), times.end());
+        return times[times.size() / 2];
+    }
+
+}
+
+int main(int argc, char** argv)
+{
+    size_t count = 100000;
+    if (argc > 1)
+        count = std::max(1, std::atoi(argv[1]));
+
+    const int runs = 21;
+
+    std::mt19937 rng{42};
+    std::uniform_real_distribution<float> position{-100.f, 100.f};
+    std::uniform_real_distribution<float> angle{-3.2f, 3.2f};
+    std::uniform_real_distribution<float> magnitude{0.5f, 2.f};
+
+    std::vector<TransformComponent> transforms(count);
+    TransformSoA soa;
+
+    for (TransformComponent& t : transforms)
+    {
+        t.translation = {position(rng), position(rng), position(rng)};
+        t.rotation = {angle(rng), angle(rng), angle(rng)};
+        t.scale = {magnitude(rng), magnitude(rng), magnitude(rng)};
+        soa.push(t.translation, t.rotation, t.scale);
+    }
+
+    std::vector<glm::mat4> models(count);
+    std::vector<glm::mat3> normals(count);
+
+    double perObject = medianNs(runs, [&] {
+        for (size_t i = 0; i < count; i++)
+            models[i] = transforms[i].mat4();
+    }) / count;
+
+    std::printf("%zu objects, detected %s\n", count, simdLevelName(detectSimdLevel()));
+    std::printf("%-24s %10s %10s\n", "", "ns/object", "speedup");
+    std::printf("%-24s %10.2f %9.2fx\n", "mat4() loop", perObject, 1.0);
+
+    std::vector<SimdLevel> levels{SimdLevel::Scalar};
+    if (detectSimdLevel() >= SimdLevel::SSE2) levels.push_back(SimdLevel::SSE2);
+    if (detectSimdLevel() >= SimdLevel::AVX2) levels.push_back(SimdLevel::AVX2);
+
+    for (SimdLevel level : levels)
+    {
+        double model = medianNs(runs, [&] { composeTransforms(soa, models.data(), nullptr, level); }) / count;
+        double both = medianNs(runs, [&] { composeTransforms(soa, models.data(), normals.data(), level); }) / count;
+
+        char name[32];
+        std::snprintf(name, sizeof(name), "%s", simdLevelName(level));
+        std::printf("%-24s %10.2f %9.2fx\n", name, model, perObject / model);
+
+        std::snprintf(name, sizeof(name), "%s + normals", simdLevelName(level));
+        std::printf("%-24s %10.2f %9.2fx\n", name, both, perObject / both);
+    }
+
+    // Keeps the stores from being optimised away
+    std::printf("\n(checksum %f %f)\n", static_cast<double>(models[count / 2][3][0]), static_cast<double>(normals[count / 3][1][1]));
+
+    return 0;
+}
@@ -5,6 +5,28 @@
 namespace Orasis {
 
 
+    // Filled from the command line by main
+    struct AppOptions {
+        uint32_t benchmarkLights{0};                            // --light-benchmark <count>, small point lights over the floor
+        LightingPath lightingPath{LightingPath::Subpass};       // --compute-lighting
+        bool occlusionCulling{true};                            // --no-occlusion-culling
+        DynamicResolutionSettings resolution{};                 // --dynamic-resolution <gpu ms> [--resolution-bounds <min> <max>]
+        bool ambientOcclusion{true};                            // --no-ssao
+        DepthPrepassSettings depthPrepass{};                    // --depth-prepass <auto|on|off>
+        std::string renderGraphDump{};                          // --dump-render-graph <file>, Graphviz
+
+        // Pacing, see FramePacer. FIFO for tear free kiosk output, IMMEDIATE/MAILBOX for latency
+        VkPresentModeKHR presentMode{VK_PRESENT_MODE_IMMEDIATE_KHR};    // --present-mode <fifo|mailbox|immediate>
+        double fpsLimit{0.0};                                   // --fps-limit <fps>, 0 = unlimited
+        bool lowLatency{false};                                 // --low-latency
+
+        // Benchmarks / CI without a display, software implementations (lavapipe) included
+        bool headless{false};                                   // --headless, renders into offscreen images, no window
+        uint32_t frameLimit{0};                                 // --frames <count>, 0 = no limit
+        float durationLimit{0.f};                               // --duration <seconds>, 0 = no limit
+        std::string frameDumpDirectory{};                       // --dump-frames <dir>, a PPM per frame (headless only)
+    };
+
 
     class App {
 
@@ -13,12 +35,50 @@ namespace Orasis {
         static constexpr int WIDTH = 1000;
         static constexpr int HEIGHT = 800;
 
-        Window ors_Window{WIDTH, HEIGHT, "Orasis Engine"};
+        Window ors_Window;
         Device ors_Device{ors_Window};
-        Render ors_Render{ors_Window, ors_Device};
+
+        // Created on the main thread (it becomes worker 0), outlives everything that submits jobs
+        JobSystem jobSystem{};
+
+        Render ors_Render{ors_Window, ors_Device, jobSystem};
+        AssetLoader assets{ors_Device, jobSystem};
         std::unique_ptr<UI> ui;
 
         GameObject::uMap gameObjects;
+        DynamicAABBTree sceneTree{};
+        TransformHierarchy transforms{};
+
+        // Owns camera and body transforms, the loop below only ever sees its snapshots
+        Simulation simulation{60.0};
+        KmbMovementController cameraController{};
+
+        // Stops run() after whichever is reached first, 0 = no limit. Headless without either runs until killed.
+        uint32_t frameLimit;
+        float durationLimit;
+
+        // Reused every frame so culling doesn't allocate
+        std::vector<const GameObject*> visibleObjects{};
+
+        // Objects with a PointLightComponent, lights aren't culled here (they reach past their own bounds)
+        std::vector<const GameObject*> lightObjects{};
+
+        // Shadow slot of every light in lightObjects, -1 for the unshadowed ones
+        std::vector<int32_t> lightShadowSlots{};
+
+        // Warm, low sun. Shadows are only re-rendered for what changed, see ShadowPlanner
+        DirectionalLight sun{glm::normalize(glm::vec3{0.4f, 1.f, 0.3f}), glm::vec3{1.f, 0.95f, 0.85f}, 0.6f};
+
+        // By shadow slot, the light's versions get bumped when something moves in its range
+        std::array<PointShadow, ShadowConfig::POINT_LIGHTS> pointShadows{};
+        std::array<const GameObject*, ShadowConfig::POINT_LIGHTS> shadowedLights{};
+
+        // Old and new bounds of everything updateTransforms moved this frame
+        std::vector<AABB> movedBounds{};
+
+        // Reused every frame, shadow views per object id
+        std::unordered_map<GameObject::uint, uint32_t> casterViews{};
+        std::vector<std::pair<GameObject::uint, uint32_t>> casters{};
         
 
         // -------- -------- -------- -------- //
@@ -28,14 +88,39 @@ namespace Orasis {
 
             // -------- CONSTRUCTOR etc -------- //
 
-            App()
+            App(const AppOptions& options = {})
+            :ors_Window{WIDTH, HEIGHT, "Orasis Engine", options.headless},
+             ors_Render{ors_Window, ors_Device, jobSystem, GBufferLayout::Packed, options.lightingPath, options.occlusionCulling, options.resolution, options.ambientOcclusion, options.depthPrepass},
+             frameLimit{options.frameLimit}, durationLimit{options.durationLimit}
             {
-                
+                // Before the first frame, the swap chain is only rebuilt if the mode differs from the default
+                ors_Render.setPresentMode(options.presentMode);
+                ors_Render.setTargetFps(options.fpsLimit);
+                ors_Render.setLowLatency(options.lowLatency);
+
+                transforms.setJobSystem(&jobSystem);
              
                 loadGameObjects();
 
+                if (options.benchmarkLights > 0)
+                    loadLightBenchmark(options.benchmarkLights);
+
+                collectLights();
+
                 ui = std::make_unique<UI>(ors_Device, ors_Window, ors_Render.getSwapChainDefferedRenderPass());
 
+                if (!options.renderGraphDump.empty())
+                {
+                    std::ofstream file(options.renderGraphDump);
+                    if (!file)
+                        throw std::runtime_error("failed to open " + options.renderGraphDump);
+
+                    ors_Render.dumpRenderGraph(file);
+                }
+
+                if (!options.frameDumpDirectory.empty())
+                    ors_Render.dumpFrames(options.frameDumpDirectory);
+
 
             }
 
@@ -63,103 +148,403 @@ namespace Orasis {
                 // ComputeSystem computeSys        {ors_Device, ors_Render.getSwapChainRenderPass(), globalDiscrSetLayout->getDescriptorSetLayout()};
 
                 Camera camera{};
-                KmbMovementController cameraController{};
-                GameObject cameraObj = GameObject::createGameObject();
-                cameraObj.transform.translation = {0.f, -1.f, 0.f};
+
+                startSimulation();
 
                 auto currTime = std::chrono::high_resolution_clock::now();
+                auto startTime = currTime;
+                uint32_t frames = 0;
 
                 // ui->init();
 
                 
-                while(!ors_Window.shouldClose())
+                while(!ors_Window.shouldClose() && !limitReached(frames, startTime))
                 {
-                    glfwPollEvents();
+                    // Limiter / low latency wait has to happen before input is sampled
+                    ors_Render.waitForNextFrame();
+
+                    // Headless there's no input, the camera stays where the simulation starts it
+                    if (!ors_Window.isHeadless())
+                    {
+                        glfwPollEvents();
+                        simulation.setInput(cameraController.sampleActions(ors_Window.getWindow()));
+                    }
                     
-                    // Time step
+                    // Frame time, the simulation runs on its own fixed step
                     auto newTime = std::chrono::high_resolution_clock::now();
                     float dt = std::chrono::duration<float, std::chrono::seconds::period>(newTime - currTime).count();
                     currTime = newTime;
                     
                     // ui->newFrame();
                     // printf("%f \n", 1/dt);
+
+                    const SimulationState& view = simulation.interpolate();
                     
                     float aspect = ors_Render.getAspectRatio();
-                    cameraController.moveInPlaneXZ(ors_Window.getWindow(), cameraObj, dt);
-                    camera.setViewYXZ(cameraObj.transform.translation, cameraObj.transform.rotation);
-                    camera.setCameraPos(cameraObj.transform.translation);
+                    camera.setViewYXZ(view.camera.translation, view.camera.rotation);
+                    camera.setCameraPos(view.camera.translation);
                     camera.setPrespectiveProjection(glm::radians(60.f), aspect, 0.1f, 100.f);
+
+                    applySimulation(view);
+                    updateTransforms();
                     
-                    if (VkCommandBuffer cmndBuffer = ors_Render.beginFrame())
+                    // Only blocks while the backend is still more than a frame behind
+                    RenderFrame& frame = ors_Render.beginFrame();
+                    frame.camera = camera;
+                    frame.dt = dt;
+
+                    updatePointShadows();
+                    const ShadowFrame& shadows = ors_Render.updateShadows(frame, sun, pointShadows);
+
+                    submitDraws(camera);
+                    submitShadowCasters(shadows);
+
+                    ors_Render.endFrame();
+
+                    FrameStats stats = ors_Render.getFrameStats();
+                    OcclusionStats occlusion = ors_Render.getOcclusionStats();
+                    ui->updateInfo({(dt*1000.f), stats.cpuMs, stats.gpuMs, stats.latencyMs, SwapChain::presentModeName(ors_Render.getPresentMode()),
+                        occlusion.candidates, occlusion.firstPhase, occlusion.secondPhase, occlusion.triangles, ors_Render.getRenderScale(),
+                        ors_Render.getOverdraw(), ors_Render.usesDepthPrepass()});
+
+                    frames++;
+                }
+
+                simulation.stop();
+                ors_Render.waitIdle();
+
+                if (ors_Window.isHeadless())
+                    printRunSummary(frames, startTime);
+
+            }
+
+        private:
+
+            bool limitReached(uint32_t frames, std::chrono::high_resolution_clock::time_point startTime) const
+            {
+                if (frameLimit > 0 && frames >= frameLimit)
+                    return true;
+
+                if (durationLimit > 0.f)
+                {
+                    float elapsed = std::chrono::duration<float, std::chrono::seconds::period>(std::chrono::high_resolution_clock::now() - startTime).count();
+                    return elapsed >= durationLimit;
+                }
+
+                return false;
+            }
+
+            // One line per value, for the regression runs to parse
+            void printRunSummary(uint32_t frames, std::chrono::high_resolution_clock::time_point startTime)
+            {
+                float seconds = std::chrono::duration<float, std::chrono::seconds::period>(std::chrono::high_resolution_clock::now() - startTime).count();
+                FrameStats stats = ors_Render.getFrameStats();
+
+                std::cout << "frames: " << frames << '\n'
+                          << "seconds: " << seconds << '\n'
+                          << "fps: " << (seconds > 0.f ? frames / seconds : 0.f) << '\n'
+                          << "cpu ms: " << stats.cpuMs << '\n'
+                          << "gpu ms: " << stats.gpuMs << std::endl;
+            }
+
+            // Culls against the scene tree and turns what's left into draw packets, spread over the job system
+            void submitDraws(const Camera& camera)
+            {
+                const glm::mat4& view = camera.getViewMatrix();
+                Frustum frustum{camera.getProjection() * view};
+
+                visibleObjects.clear();
+                sceneTree.queryFrustum(frustum, [&](int32_t, uint32_t objectId) {
+                    visibleObjects.push_back(&gameObjects.at(objectId));
+                });
+
+                // Every worker submits into its own queue, nothing shared
+                jobSystem.parallelFor(0, visibleObjects.size(), 256, [&](size_t begin, size_t end) {
+                    for (size_t i = begin; i < end; i++)
                     {
-                        int frameIndex = ors_Render.getFrameIndex();
-
-                        // Updating Frame Info
-                        FrameInfo frameInfo {
-                            cmndBuffer,
-                            camera,
-                            gameObjects,
-                            frameIndex,
-                            dt
-                        };
-
-                        if(frameIndex%2);
-                            ui->updateInfo({(dt*1000.f)});
-
-                        // Update UBO
-                        UBO_struct ubo_s{};
-                        ubo_s.projection = camera.getProjection();
-                        ubo_s.view = camera.getViewMatrix();
-                        ubo_s.cameraPos = camera.getCameraPos();
-
-                        ors_Render.updateBuffer(ubo_s);
-
-                        
-                        ors_Render.startSwapChainRenderPass(cmndBuffer);
-                        
-                        // Render
-                        ors_Render.render(frameInfo);
-                        // ui->render(cmndBuffer);
-
-                        ors_Render.endSwapChainRenderPass(cmndBuffer);
-                        ors_Render.endFrame();
+                        const GameObject& obj = *visibleObjects[i];
+                        if (obj.model == nullptr) continue;
+
+                        ors_Render.submit(
+                            obj.model->getSortId(),
+                            obj.transform.worldMatrix,
+                            drawSortKey(obj, view),
+                            obj.getID(),
+                            obj.isStatic() ? uint32_t(DrawPacket::Static) : 0u
+                        );
+                    }
+                });
 
+                // Culled per cluster on the GPU
+                jobSystem.parallelFor(0, lightObjects.size(), 1024, [&](size_t begin, size_t end) {
+                    for (size_t i = begin; i < end; i++)
+                    {
+                        const GameObject& obj = *lightObjects[i];
+
+                        ors_Render.submitLight(PointLight::make(
+                            glm::vec3{obj.transform.worldMatrix[3]},
+                            obj.color,
+                            obj.pointLight->intensity,
+                            lightShadowSlots[i]
+                        ));
                     }
-                    
+                });
+            }
+
+            // Culls every object against the shadow views that get rendered this frame. Static objects only
+            // go into the views whose cache is stale, point lights never shadow their own model.
+            void submitShadowCasters(const ShadowFrame& shadows)
+            {
+                casterViews.clear();
+
+                if (shadows.hasSun())
+                    for (uint32_t c = 0; c < ShadowConfig::CASCADES; c++)
+                    {
+                        bool staticDirty = (shadows.staticDirty & (1u << c)) != 0;
+
+                        sceneTree.queryFrustum(Frustum{shadows.cascades[c].viewProj}, [&](int32_t, uint32_t objectId) {
+                            if (staticDirty || !gameObjects.at(objectId).isStatic())
+                                casterViews[objectId] |= ShadowCaster::cascadeBit(c);
+                        });
+                    }
+
+                for (uint32_t s = 0; s < ShadowConfig::POINT_LIGHTS; s++)
+                {
+                    if ((shadows.pointDirty & (1u << s)) == 0) continue;
+
+                    const PointShadow& point = shadows.points[s];
+                    GameObject::uint owner = shadowedLights[s]->getID();
+
+                    sceneTree.querySphere(Sphere{point.position, point.range}, [&](int32_t, uint32_t objectId) {
+                        if (objectId != owner)
+                            casterViews[objectId] |= ShadowCaster::pointBit(s);
+                        return true;
+                    });
                 }
 
-                vkDeviceWaitIdle(ors_Device.device());
+                casters.assign(casterViews.begin(), casterViews.end());
 
+                jobSystem.parallelFor(0, casters.size(), 256, [&](size_t begin, size_t end) {
+                    for (size_t i = begin; i < end; i++)
+                    {
+                        const GameObject& obj = gameObjects.at(casters[i].first);
+
+                        ors_Render.submitShadowCaster(
+                            obj.model->getSortId(),
+                            obj.transform.worldMatrix,
+                            casters[i].second,
+                            obj.isStatic() ? uint32_t(DrawPacket::Static) : 0u
+                        );
+                    }
+                });
             }
 
-        private:
+            // A slot's shadow is re-rendered when its light moved, its range changed or something moved in range
+            void updatePointShadows()
+            {
+                for (uint32_t s = 0; s < ShadowConfig::POINT_LIGHTS; s++)
+                {
+                    PointShadow& shadow = pointShadows[s];
+                    const GameObject* light = shadowedLights[s];
+
+                    if (light == nullptr)
+                    {
+                        shadow = {};
+                        continue;
+                    }
+
+                    glm::vec3 position{light->transform.worldMatrix[3]};
+                    float range = PointLight::rangeFor(light->pointLight->intensity);
+
+                    bool changed = !shadow.isActive() || shadow.position != position || shadow.range != range;
+
+                    Sphere reach{position, range};
+                    for (size_t i = 0; !changed && i < movedBounds.size(); i++)
+                        changed = reach.overlaps(movedBounds[i]);
+
+                    if (!changed) continue;
+
+                    shadow.position = position;
+                    shadow.range = range;
+                    shadow.version++;
+                }
+            }
+
+            // gameObjects doesn't change while running, the pointers stay valid.
+            // The first ShadowConfig::POINT_LIGHTS lights that cast shadows get a slot
+            void collectLights()
+            {
+                lightObjects.clear();
+                lightShadowSlots.clear();
+                shadowedLights.fill(nullptr);
+
+                uint32_t shadowSlots = 0;
+
+                for (const auto& kv : gameObjects)
+                {
+                    if (!kv.second.pointLight) continue;
+
+                    int32_t slot = -1;
+
+                    if (kv.second.pointLight->castsShadows && shadowSlots < ShadowConfig::POINT_LIGHTS)
+                    {
+                        shadowedLights[shadowSlots] = &kv.second;
+                        slot = static_cast<int32_t>(shadowSlots++);
+                    }
+
+                    lightObjects.push_back(&kv.second);
+                    lightShadowSlots.push_back(slot);
+                }
+            }
+
+            static uint64_t drawSortKey(const GameObject& obj, const glm::mat4& view)
+            {
+                float viewDepth = (view * glm::vec4{obj.worldBounds().center(), 1.f}).z;
+
+                return SortKey::make(
+                    SortKey::GBuffer,
+                    obj.pipelineId,
+                    0,                                  // no materials yet
+                    obj.model->getSortId(),
+                    SortKey::quantizeDepth(viewDepth)
+                );
+            }
+
+            // Dynamic objects and the camera move on the simulation thread from here on
+            void startSimulation()
+            {
+                SimulationState initial{};
+                initial.camera.translation = {0.f, -1.f, 0.f};
+
+                for (const auto& kv : gameObjects)
+                    if (!kv.second.isStatic())
+                        initial.bodies.push_back({kv.first, kv.second.transform});
+
+                simulation.start(std::move(initial), [controller = cameraController](SimulationState& state, uint32_t actions, float dt) {
+                    controller.moveInPlaneXZ(actions, state.camera, dt);
+                });
+            }
+
+            // Copies the interpolated body transforms over, only the ones that moved get marked dirty
+            void applySimulation(const SimulationState& view)
+            {
+                for (const SimulationState::Body& body : view.bodies)
+                {
+                    auto it = gameObjects.find(body.id);
+                    if (it == gameObjects.end()) continue;
+
+                    TransformComponent& transform = it->second.transform;
+
+                    if (transform.translation == body.transform.translation &&
+                        transform.rotation == body.transform.rotation &&
+                        transform.scale == body.transform.scale)
+                        continue;
+
+                    transform.translation = body.transform.translation;
+                    transform.rotation = body.transform.rotation;
+                    transform.scale = body.transform.scale;
+                    transforms.markDirty(body.id);
+                }
+            }
+
+            // Only objects marked dirty (and their children) get recomputed and moved in the tree
+            void updateTransforms()
+            {
+                bool staticChanged = false;
+                movedBounds.clear();
+
+                for (const auto& change : transforms.update())
+                {
+                    GameObject& obj = gameObjects.at(change.id);
+                    obj.updateProxy(sceneTree, change.displacement);
+                    staticChanged |= obj.isStatic();
+
+                    // Where it was is approximated by moving it back, good enough for invalidating shadows
+                    AABB bounds = obj.worldBounds();
+                    movedBounds.push_back(AABB::merge(bounds, AABB{bounds.min - change.displacement, bounds.max - change.displacement}));
+                }
+
+                // Static draws have their model matrices baked into cached command buffers
+                if (staticChanged)
+                    ors_Render.invalidateStaticDraws();
+            }
 
             void loadGameObjects()
             {
-                std::shared_ptr<Model> model = Model::createModelFromFile(ors_Device, "C:/Users/thedarkchoco/Desktop/vs_code/Orasis_Engine/models/colored_cube.obj");
+                // All of them read, parse and upload at the same time
+                std::vector<Task<std::shared_ptr<Model>>> loads;
+                loads.push_back(assets.loadModel("C:/Users/thedarkchoco/Desktop/vs_code/Orasis_Engine/models/colored_cube.obj"));
+                loads.push_back(assets.loadModel("C:/Users/thedarkchoco/Desktop/vs_code/Orasis_Engine/models/cube.obj"));
+                loads.push_back(assets.loadModel("C:/Users/thedarkchoco/Desktop/vs_code/Orasis_Engine/models/quad.obj"));
+
+                std::vector<std::shared_ptr<Model>> models = syncWait(whenAll(std::move(loads)));
+
+                std::shared_ptr<Model> model = models[0];
                 GameObject cube = GameObject::createGameObject();
                 cube.model = model;
                 // cube.color = glm::vec3(1.f, 0.f, 0.f);
                 cube.transform.translation = {0.f, 0.5f, 4.f};
                 cube.transform.scale = glm::vec3(0.5f);
+                cube.mobility = GameObject::Mobility::Static;
                 gameObjects.emplace(cube.getID(), std::move(cube));
                 
-                model = Model::createModelFromFile(ors_Device, "C:/Users/thedarkchoco/Desktop/vs_code/Orasis_Engine/models/cube.obj");
+                model = models[1];
                 GameObject lightCube = GameObject::createGameObject();
                 lightCube.model = model;
                 lightCube.transform.translation = {1.f, -3.5, -1.f};
                 lightCube.transform.scale = glm::vec3(0.05f);
+                lightCube.color = glm::vec3(1.f);
+                lightCube.pointLight = std::make_unique<PointLightComponent>();
+                lightCube.pointLight->intensity = 1.f;
+                lightCube.pointLight->castsShadows = true;
                 gameObjects.emplace(lightCube.getID(), std::move(lightCube));
                 
-                model = Model::createModelFromFile(ors_Device, "C:/Users/thedarkchoco/Desktop/vs_code/Orasis_Engine/models/quad.obj");
+                model = models[2];
                 GameObject quad = GameObject::createGameObject();
                 quad.model = model;
                 quad.transform.translation = {1.f, 1.f, -1.f};
                 quad.transform.scale = glm::vec3(10);
+                quad.mobility = GameObject::Mobility::Static;
                 gameObjects.emplace(quad.getID(), std::move(quad));
+
+                for (auto& kv : gameObjects)
+                {
+                    transforms.add(kv.second);
+
+                    if (kv.second.model)
+                        ors_Render.registerModel(kv.second.model);
+                }
+
+                updateTransforms();
                 
             }
 
+            // Stress scene for the clustered lighting, lights scattered just above the floor quad
+            void loadLightBenchmark(uint32_t count)
+            {
+                // Fixed seed, every run measures the same scene
+                std::mt19937 rng{1337};
+                std::uniform_real_distribution<float> spreadXZ{-9.f, 9.f};
+                std::uniform_real_distribution<float> height{0.3f, 0.9f};
+                std::uniform_real_distribution<float> channel{0.f, 1.f};
+                std::uniform_real_distribution<float> intensity{0.004f, 0.01f};
+
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    GameObject light = GameObject::makePointLight(intensity(rng), 0.1f, glm::vec3{channel(rng), channel(rng), channel(rng)});
+                    light.transform.translation = {1.f + spreadXZ(rng), height(rng), -1.f + spreadXZ(rng)};
+
+                    // Keeps them out of the simulation's bodies
+                    light.mobility = GameObject::Mobility::Static;
+
+                    // The hierarchy keeps a pointer, add the one in the map
+                    auto [it, inserted] = gameObjects.emplace(light.getID(), std::move(light));
+                    transforms.add(it->second);
+                }
+
+                updateTransforms();
+            }
+
 
 
     };
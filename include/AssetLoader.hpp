@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Device.hpp"
+#include "JobSystem.hpp"
+#include "Model.hpp"
+#include "Task.hpp"
+#include "Texture.hpp"
+#include "TimelineWatcher.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Orasis {
+
+
+    /*
+        Coroutine based loading. Reading and decoding run as background jobs, uploads are
+        submitted without waiting and the staging memory is held in the coroutine until the
+        timeline says the copy ran, no thread blocks on either. Run many at once with whenAll,
+        finish them with syncWait or spawn them.
+
+        Has to outlive every task it handed out.
+    */
+    class AssetLoader {
+
+        // -------- MEMBER VARIABLES -------- //
+
+        Device& m_device;
+        JobSystem& m_jobs;
+
+        TimelineWatcher m_gpu;
+
+        // -------- -------- -------- -------- //
+
+        public:
+
+        AssetLoader(Device& device, JobSystem& jobs)
+        : m_device{device}, m_jobs{jobs}, m_gpu{device, jobs}
+        {}
+
+        AssetLoader(const AssetLoader&) = delete;
+        AssetLoader &operator=(const AssetLoader&) = delete;
+
+        // Whole file, resumes the awaiter on a background worker
+        Task<std::vector<char>> readFile(std::string filepath);
+
+        // Ready to draw once the task completed
+        Task<std::shared_ptr<Model>> loadModel(std::string filepath);
+        Task<std::shared_ptr<Texture>> loadTexture(VmaAllocator allocator, std::string filepath);
+
+        // co_await gpuComplete(value), for anyone with their own submissions
+        TimelineWatcher::Awaiter gpuComplete(uint64_t timelineValue) { return m_gpu.wait(timelineValue); }
+    };
+
+}
@@ -0,0 +1,178 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <array>
+#include <limits>
+#include <algorithm>
+
+namespace Orasis {
+
+
+    struct AABB {
+
+        glm::vec3 min{ std::numeric_limits<float>::max()};
+        glm::vec3 max{-std::numeric_limits<float>::max()};
+
+        AABB() = default;
+
+        AABB(glm::vec3 o_min, glm::vec3 o_max)
+        :min{o_min}, max{o_max}
+        {}
+
+        bool isValid() const            { return min.x <= max.x && min.y <= max.y && min.z <= max.z; }
+        glm::vec3 center() const        { return (min + max) * 0.5f; }
+        glm::vec3 extents() const       { return (max - min) * 0.5f; }
+
+        // Half of the surface area, enough for comparing insertion costs
+        float perimeter() const
+        {
+            glm::vec3 d = max - min;
+            return d.x * d.y + d.y * d.z + d.z * d.x;
+        }
+
+        void expand(glm::vec3 point)
+        {
+            min = glm::min(min, point);
+            max = glm::max(max, point);
+        }
+
+        bool contains(const AABB& other) const
+        {
+            return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z &&
+                   max.x >= other.max.x && max.y >= other.max.y && max.z >= other.max.z;
+        }
+
+        bool overlaps(const AABB& other) const
+        {
+            return min.x <= other.max.x && max.x >= other.min.x &&
+                   min.y <= other.max.y && max.y >= other.min.y &&
+                   min.z <= other.max.z && max.z >= other.min.z;
+        }
+
+        static AABB merge(const AABB& a, const AABB& b)
+        {
+            return AABB{glm::min(a.min, b.min), glm::max(a.max, b.max)};
+        }
+
+        // Arvo's method, transforms the box and returns the box that encloses the result
+        AABB transformed(const glm::mat4& m) const
+        {
+            glm::vec3 newMin{m[3]};
+            glm::vec3 newMax{m[3]};
+
+            for (int col = 0; col < 3; col++)
+                for (int row = 0; row < 3; row++)
+                {
+                    float a = m[col][row] * min[col];
+                    float b = m[col][row] * max[col];
+                    newMin[row] += std::min(a, b);
+                    newMax[row] += std::max(a, b);
+                }
+
+            return AABB{newMin, newMax};
+        }
+    };
+
+
+    struct Sphere {
+        glm::vec3 center{0.f};
+        float radius{0.f};
+
+        bool overlaps(const AABB& box) const
+        {
+            glm::vec3 closest = glm::clamp(center, box.min, box.max);
+            glm::vec3 d = closest - center;
+            return glm::dot(d, d) <= radius * radius;
+        }
+    };
+
+
+    struct Ray {
+        glm::vec3 origin{0.f};
+        glm::vec3 direction{0.f, 0.f, 1.f};
+
+        // Slab test, returns the entry distance or a negative value when the box is missed before maxT
+        float intersect(const AABB& box, float maxT) const
+        {
+            glm::vec3 invDir = 1.f / direction;
+            glm::vec3 t0 = (box.min - origin) * invDir;
+            glm::vec3 t1 = (box.max - origin) * invDir;
+            glm::vec3 tNear = glm::min(t0, t1);
+            glm::vec3 tFar  = glm::max(t0, t1);
+
+            float tEnter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.f));
+            float tExit  = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxT));
+
+            return tEnter <= tExit ? tEnter : -1.f;
+        }
+    };
+
+
+    class Frustum {
+
+        // xyz -> inward facing normal, w -> distance
+        std::array<glm::vec4, 6> m_planes{};
+
+        public:
+
+            enum class Result {
+                Outside,
+                Intersects,
+                Inside
+            };
+
+            Frustum() = default;
+
+            // Gribb/Hartmann plane extraction, expects a [0, 1] depth range projection
+            explicit Frustum(const glm::mat4& viewProj)
+            {
+                glm::vec4 row0{viewProj[0][0], viewProj[1][0], viewProj[2][0], viewProj[3][0]};
+                glm::vec4 row1{viewProj[0][1], viewProj[1][1], viewProj[2][1], viewProj[3][1]};
+                glm::vec4 row2{viewProj[0][2], viewProj[1][2], viewProj[2][2], viewProj[3][2]};
+                glm::vec4 row3{viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]};
+
+                m_planes[0] = row3 + row0;  // left
+                m_planes[1] = row3 - row0;  // right
+                m_planes[2] = row3 + row1;  // bottom
+                m_planes[3] = row3 - row1;  // top
+                m_planes[4] = row2;         // near
+                m_planes[5] = row3 - row2;  // far
+
+                for (auto& plane : m_planes)
+                    plane /= glm::length(glm::vec3(plane));
+            }
+
+            Result classify(const AABB& box) const
+            {
+                glm::vec3 center = box.center();
+                glm::vec3 extents = box.extents();
+                Result result = Result::Inside;
+
+                for (const auto& plane : m_planes)
+                {
+                    glm::vec3 normal{plane};
+                    float distance = glm::dot(normal, center) + plane.w;
+                    float radius = glm::dot(extents, glm::abs(normal));
+
+                    if (distance < -radius)
+                        return Result::Outside;
+
+                    if (distance < radius)
+                        result = Result::Intersects;
+                }
+
+                return result;
+            }
+
+            bool overlaps(const AABB& box) const
+            {
+                return classify(box) != Result::Outside;
+            }
+
+            const std::array<glm::vec4, 6>& planes() const { return m_planes; }
+    };
+
+}
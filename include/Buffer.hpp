@@ -1,6 +1,10 @@
 #pragma once
  
 #include "Device.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
  
 namespace  Orasis {
  
@@ -61,5 +65,20 @@ namespace  Orasis {
             VkBufferUsageFlags usageFlags;
             VkMemoryPropertyFlags memoryPropertyFlags;
             };
+
+
+    // Staging buffers of copies that were submitted without waiting. Keep it alive until the
+    // GPU is past timelineValue (Device::waitForTimeline or co_await on a TimelineWatcher).
+    struct PendingUpload {
+
+        std::vector<std::unique_ptr<Buffer>> staging{};
+        uint64_t timelineValue{0};
+
+        void add(std::unique_ptr<Buffer> stagingBuffer, uint64_t value)
+        {
+            staging.push_back(std::move(stagingBuffer));
+            timelineValue = std::max(timelineValue, value);
+        }
+    };
     
 }  
\ No newline at end of file
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Orasis {
+
+
+    /*
+        Holds on to resources the GPU may still be reading until the device timeline passes the
+        last submission that could have used them. Anything retired while a frame is being
+        recorded waits for that frame's value, anything retired outside a frame waits for the
+        latest submission.
+
+        The Device reports every submit, the renderer marks frames and calls collect() with the
+        completed timeline value. Before the first submit nothing can be in flight, so retired
+        resources die right away.
+    */
+    class DeletionQueue {
+
+        struct Entry {
+            uint64_t value;
+            std::function<void()> destroy;
+        };
+
+        // -------- MEMBER VARIABLES -------- //
+
+        // Ordered by value, submissions only go up
+        std::deque<Entry> m_entries{};
+
+        // Retired during the frame being recorded, its value is only known once it's submitted
+        std::vector<std::function<void()>> m_frame{};
+
+        uint64_t m_lastSubmitted{0};
+        bool m_recording{false};
+
+        std::mutex m_mutex;
+
+        // -------- -------- -------- -------- //
+
+        public:
+
+        DeletionQueue() = default;
+        ~DeletionQueue() { flush(); }
+
+        DeletionQueue(const DeletionQueue&) = delete;
+        DeletionQueue &operator=(const DeletionQueue&) = delete;
+
+        void push(std::function<void()> destroy)
+        {
+            std::unique_lock<std::mutex> lock{m_mutex};
+
+            if (m_recording)
+                m_frame.push_back(std::move(destroy));
+            else if (m_lastSubmitted != 0)
+                m_entries.push_back({m_lastSubmitted, std::move(destroy)});
+            else
+            {
+                lock.unlock();
+                destroy();
+            }
+        }
+
+        // Ownership moves into the queue, the object's own destructor runs later
+        template<typename T>
+        void retire(std::unique_ptr<T> object)
+        {
+            if (object == nullptr) return;
+            push([object = std::shared_ptr<T>(std::move(object))]() mutable { object.reset(); });
+        }
+
+        template<typename T>
+        void retire(std::shared_ptr<T> object)
+        {
+            if (object == nullptr) return;
+            push([object = std::move(object)]() mutable { object.reset(); });
+        }
+
+        // Called by the Device for every submission
+        void submitted(uint64_t value)
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_lastSubmitted = value;
+        }
+
+        void beginFrame()
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_recording = true;
+        }
+
+        // frameValue is what the frame's submission signals
+        void endFrame(uint64_t frameValue)
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+
+            for (std::function<void()>& destroy : m_frame)
+                m_entries.push_back({frameValue, std::move(destroy)});
+
+            m_frame.clear();
+            m_recording = false;
+        }
+
+        // Non-blocking, destroys everything the GPU finished with
+        void collect(uint64_t completedValue)
+        {
+            std::vector<std::function<void()>> expired;
+
+            {
+                std::lock_guard<std::mutex> lock{m_mutex};
+
+                while (!m_entries.empty() && m_entries.front().value <= completedValue)
+                {
+                    expired.push_back(std::move(m_entries.front().destroy));
+                    m_entries.pop_front();
+                }
+            }
+
+            // In retire order, outside the lock so destructors may retire more
+            for (std::function<void()>& destroy : expired)
+                destroy();
+        }
+
+        // Only when the device is idle (shutdown)
+        void flush()
+        {
+            std::vector<std::function<void()>> pending;
+
+            {
+                std::lock_guard<std::mutex> lock{m_mutex};
+
+                for (Entry& entry : m_entries)
+                    pending.push_back(std::move(entry.destroy));
+                for (std::function<void()>& destroy : m_frame)
+                    pending.push_back(std::move(destroy));
+
+                m_entries.clear();
+                m_frame.clear();
+            }
+
+            for (std::function<void()>& destroy : pending)
+                destroy();
+        }
+    };
+
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Orasis {
+
+
+    enum class DepthPrepassMode {
+        Auto,       // follows the measured overdraw (OverdrawCounter), off where it can't be measured
+        On,
+        Off
+    };
+
+    struct DepthPrepassSettings {
+        DepthPrepassMode mode{DepthPrepassMode::Auto};
+        float enableAbove{2.5f};        // samples per pixel the G-buffer would write
+        float disableBelow{1.75f};
+    };
+
+
+    /*
+        Decides whether the geometry subpass starts with a depth only pass. It pays off once the
+        G-buffer is written several times per pixel: the pre-pass costs a second vertex pass of
+        positions only, in exchange every pixel gets its G-buffer written once.
+
+        The overdraw is measured the same with and without the pre-pass, so the decision follows
+        whatever scene is loaded. It's smoothed and has some hysteresis, a camera turning doesn't
+        flip it back and forth.
+    */
+    class DepthPrepass {
+
+        public:
+
+            static constexpr float SMOOTHING = 0.1f;
+
+        private:
+
+            // -------- MEMBER VARIABLES -------- //
+
+            DepthPrepassSettings m_settings;
+
+            bool m_enabled;
+            float m_smoothedOverdraw{0.f};
+
+            // -------- -------- -------- -------- //
+
+        public:
+
+            // -------- CONSTRUCTOR etc -------- //
+
+            DepthPrepass(const DepthPrepassSettings& settings = {})
+            :m_settings{settings}, m_enabled{settings.mode == DepthPrepassMode::On}
+            {}
+
+            // -------- -------- -------- -------- //
+
+
+
+
+            // -------- FUNCTIONS -------- //
+
+            bool isEnabled() const { return m_enabled; }
+
+            // Only Auto ever changes its mind
+            bool isAutomatic() const { return m_settings.mode == DepthPrepassMode::Auto; }
+
+            float getOverdraw() const { return m_smoothedOverdraw; }
+
+            // Feeds one frame's samples per pixel, returns true if the pre-pass got switched
+            bool update(float overdraw)
+            {
+                if (overdraw < 0.f) return false;
+
+                m_smoothedOverdraw = m_smoothedOverdraw == 0.f ? overdraw : m_smoothedOverdraw + (overdraw - m_smoothedOverdraw) * SMOOTHING;
+
+                if (!isAutomatic()) return false;
+
+                bool enabled = m_enabled ? m_smoothedOverdraw >= m_settings.disableBelow : m_smoothedOverdraw > m_settings.enableAbove;
+
+                if (enabled == m_enabled) return false;
+
+                m_enabled = enabled;
+                return true;
+            }
+    };
+
+}
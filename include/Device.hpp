@@ -1,10 +1,15 @@
 #pragma once
 
 #include "Window.hpp"
+#include "PipelineManifest.hpp"
+#include "DeletionQueue.hpp"
 
 
 // std lib headers
+#include <atomic>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace Orasis {
@@ -41,10 +46,31 @@ namespace Orasis {
       
       VkPhysicalDevice physicalDevice_ = VK_NULL_HANDLE;
       VkDevice device_;
-      VkSurfaceKHR surface_;
+      VkSurfaceKHR surface_ = VK_NULL_HANDLE;     // none when the window is headless
       VkQueue graphicsQueue_;
       VkQueue presentQueue_;
 
+      // Persistent across runs, see createPipelineCache/savePipelineCache
+      VkPipelineCache pipelineCache_ = VK_NULL_HANDLE;
+      PipelineManifest pipelineManifest_{};
+      std::mutex pipelineManifestMutex_;
+
+      // SPIR-V is read and turned into a module once per path, pipelines share them
+      std::unordered_map<std::string, VkShaderModule> shaderModules_;
+      std::mutex shaderModulesMutex_;
+
+      // Every graphics submission signals the next value, see submitGraphics
+      VkSemaphore timeline_ = VK_NULL_HANDLE;
+      std::atomic<uint64_t> timelineSubmitted_{0};
+      std::mutex submitMutex_;
+
+      // Resources released while the GPU may still use them, freed as the timeline advances
+      DeletionQueue deletionQueue_;
+
+      // commandPool is shared by every thread that uploads, held from begin to submit of
+      // single time commands (recording touches the pool too)
+      std::mutex commandPoolMutex_;
+
       const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
       const std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
       
@@ -64,8 +90,38 @@ namespace Orasis {
       VkDevice device() { return device_; }
       VkPhysicalDevice physicalDevice() { return physicalDevice_; }
       VkSurfaceKHR surface() { return surface_; }
+      bool isHeadless() const { return window.isHeadless(); }
       VkQueue graphicsQueue() { return graphicsQueue_; }
       VkQueue presentQueue() { return presentQueue_; }
+      VkPipelineCache pipelineCache() { return pipelineCache_; }
+      DeletionQueue &deletionQueue() { return deletionQueue_; }
+
+      // Global GPU timeline. Submits to the graphics queue and also signals the next timeline
+      // value, which is returned. Safe to call from any thread.
+      uint64_t submitGraphics(const VkSubmitInfo &submitInfo);
+
+      // The present queue may be the graphics queue, so presents take the same lock as submits.
+      // Headless the present queue is the graphics queue and nothing is presented.
+      VkResult queuePresent(const VkPresentInfoKHR &presentInfo);
+      VkSemaphore timelineSemaphore() { return timeline_; }
+      uint64_t lastSubmittedTimelineValue() const { return timelineSubmitted_.load(std::memory_order_acquire); }
+      uint64_t completedTimelineValue();
+      bool isTimelineComplete(uint64_t value) { return completedTimelineValue() >= value; }
+      // false if the timeout (ns) ran out first
+      bool waitForTimeline(uint64_t value, uint64_t timeout = UINT64_MAX);
+
+      // Owned by the device, valid until it's destroyed
+      VkShaderModule getShaderModule(const std::string &filePath);
+
+      // Remembers the pipeline so the next launch can compile it in the background, see PipelineManifest.
+      // Any thread
+      void recordPipeline(const PipelineRecord &record);
+
+      // What this and earlier runs recorded
+      std::vector<PipelineRecord> recordedPipelines();
+
+      // Writes the pipeline cache and manifest now instead of only at shutdown
+      void savePipelineCache();
 
       SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice_); }
       uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
@@ -81,10 +137,18 @@ namespace Orasis {
         VkDeviceMemory &bufferMemory
       );
           
+      // Any thread. Blocks other uploaders until the matching end / submit call.
       VkCommandBuffer beginSingleTimeCommands();
       void endSingleTimeCommands(VkCommandBuffer commandBuffer);
+
+      // Doesn't wait, returns the timeline value the commands are done at. The sources have to
+      // stay alive until then (see PendingUpload), the command buffer is freed on its own.
+      uint64_t submitSingleTimeCommands(VkCommandBuffer commandBuffer);
+
       void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
       void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
+      uint64_t copyBufferAsync(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+      uint64_t copyBufferToImageAsync(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
 
       void createImageWithInfo(
           const VkImageCreateInfo &imageInfo,
@@ -94,6 +158,9 @@ namespace Orasis {
 
       VkPhysicalDeviceProperties properties;
 
+      // Optional features that were supported and got enabled, on top of the required ones
+      VkPhysicalDeviceFeatures enabledFeatures{};
+
     private:
 
       void createInstance();
@@ -102,6 +169,8 @@ namespace Orasis {
       void pickPhysicalDevice();
       void createLogicalDevice();
       void createCommandPool();
+      void createTimeline();
+      void createPipelineCache();
 
       // helper functions
       bool isDeviceSuitable(VkPhysicalDevice device);
@@ -112,6 +181,11 @@ namespace Orasis {
       void hasGflwRequiredInstanceExtensions();
       bool checkDeviceExtensionSupport(VkPhysicalDevice device);
       SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
+      bool isPipelineCacheCompatible(const std::vector<char> &data);
+      static std::vector<char> readBinaryFile(const std::string &filePath);
+
+      static constexpr const char *pipelineCachePath = "pipeline_cache.bin";
+      static constexpr const char *pipelineManifestPath = "pipeline_manifest.txt";
 
   };
 
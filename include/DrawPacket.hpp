@@ -0,0 +1,63 @@
+#pragma once
+
+#include "DrawSort.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+namespace Orasis {
+
+
+    /*
+        One draw as the render frontend hands it to the backend. Plain data only, no pointers,
+        so it can be produced on any thread and outlive whatever built it.
+
+        model is Model::getSortId() of a model registered with RenderFrontend::registerModel,
+        transform indexes the submitting thread's transforms of the same frame.
+    */
+    struct DrawPacket {
+
+        enum Flags : uint32_t {
+            Static = 1u << 0,       // recorded into the cached static secondaries
+        };
+
+        uint64_t sortKey;           // SortKey::make, the pipeline variant is taken from it
+        uint32_t model;
+        uint32_t transform;
+        uint32_t material;
+        uint32_t id;                // stable across frames (GameObject id), keys the static cache
+        uint32_t flags;
+
+        bool isStatic() const { return (flags & Static) != 0; }
+    };
+
+    static_assert(std::is_trivially_copyable_v<DrawPacket>, "DrawPacket has to stay plain data");
+    static_assert(sizeof(DrawPacket) <= 32, "DrawPacket should fit half a cache line");
+
+
+    // A point light as the frontend submits it, laid out like the shaders' PointLight (std430)
+    struct PointLight {
+
+        // Below 1/256 of its intensity a light can't change an 8 bit channel anymore
+        static constexpr float CUTOFF = 1.f / 256.f;
+
+        glm::vec4 positionRange;    // world space, xyz position w range
+        glm::vec4 colorIntensity;
+        glm::ivec4 shadow;          // x slot in ShadowSystem's point atlas, -1 unshadowed
+
+        static float rangeFor(float intensity) { return std::sqrt(intensity / CUTOFF); }
+
+        // Inverse square falloff, the range is where it drops below CUTOFF (the shader fades it out there)
+        static PointLight make(const glm::vec3& position, const glm::vec3& color, float intensity, int32_t shadowSlot = -1)
+        {
+            return {glm::vec4{position, rangeFor(intensity)}, glm::vec4{color, intensity}, glm::ivec4{shadowSlot, 0, 0, 0}};
+        }
+    };
+
+    static_assert(std::is_trivially_copyable_v<PointLight>, "PointLight is copied straight into a storage buffer");
+    static_assert(sizeof(PointLight) == 48, "PointLight has to match the shaders' std430 layout");
+
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace Orasis {
+
+
+    /*
+        64 bit draw sort key, most significant field first:
+
+            | pass 4 | pipeline 8 | material 12 | model 16 | depth 24 |
+
+        Sorting ascending groups draws by state (fewest binds) and goes front to back inside
+        a group so early-Z can reject as much as possible.
+    */
+    namespace SortKey {
+
+        constexpr uint32_t depthBits    = 24;
+        constexpr uint32_t modelBits    = 16;
+        constexpr uint32_t materialBits = 12;
+        constexpr uint32_t pipelineBits = 8;
+        constexpr uint32_t passBits     = 4;
+
+        constexpr uint32_t modelShift    = depthBits;
+        constexpr uint32_t materialShift = modelShift + modelBits;
+        constexpr uint32_t pipelineShift = materialShift + materialBits;
+        constexpr uint32_t passShift     = pipelineShift + pipelineBits;
+
+        static_assert(passShift + passBits == 64, "Sort key fields must fill 64 bits");
+
+        enum Pass : uint32_t {
+            GBuffer = 0,
+            Lighting = 1,
+        };
+
+        inline uint64_t field(uint32_t value, uint32_t bits, uint32_t shift)
+        {
+            return (static_cast<uint64_t>(value) & ((uint64_t{1} << bits) - 1)) << shift;
+        }
+
+        // Positive floats keep their order when compared as integers, so the top 24 bits of the
+        // pattern are a monotonic quantization without knowing near/far. Behind the camera -> 0.
+        inline uint32_t quantizeDepth(float viewDepth)
+        {
+            if (!(viewDepth > 0.f)) return 0;
+
+            uint32_t bits;
+            std::memcpy(&bits, &viewDepth, sizeof(bits));
+
+            return bits >> (31 - depthBits);
+        }
+
+        inline uint64_t make(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t model, uint32_t depth)
+        {
+            return field(pass, passBits, passShift)
+                 | field(pipeline, pipelineBits, pipelineShift)
+                 | field(material, materialBits, materialShift)
+                 | field(model, modelBits, modelShift)
+                 | field(depth, depthBits, 0);
+        }
+
+        inline uint32_t model(uint64_t key) { return static_cast<uint32_t>((key >> modelShift) & ((1u << modelBits) - 1)); }
+        inline uint32_t pipeline(uint64_t key) { return static_cast<uint32_t>((key >> pipelineShift) & ((1u << pipelineBits) - 1)); }
+    }
+
+
+    // index points into whatever list is being sorted (e.g. a frame's DrawPackets)
+    struct DrawItem {
+        uint64_t key;
+        uint32_t index;
+    };
+
+
+    // Stable LSD radix sort on DrawItem::key, 8 bits per pass. Passes where every key shares
+    // the same byte are skipped, so unused key fields cost nothing. scratch is resized as needed
+    // and should be kept around between frames.
+    void radixSort(std::vector<DrawItem>& items, std::vector<DrawItem>& scratch);
+
+}
@@ -0,0 +1,244 @@
+#pragma once
+
+#include "Bounds.hpp"
+
+#include <cstdint>
+#include <vector>
+#include <cassert>
+
+namespace Orasis {
+
+
+    /*
+        Incrementally updated bounding volume hierarchy.
+
+        Every leaf holds a "fat" AABB (the real bounds grown by a margin) so objects that move
+        a little stay inside their leaf and don't touch the tree. Internal nodes are kept
+        balanced with AVL style rotations while walking back up after an insert or remove.
+    */
+    class DynamicAABBTree {
+
+        public:
+
+            static constexpr int32_t nullNode = -1;
+
+            struct Node {
+
+                AABB        box{};
+                int32_t     parent{nullNode};   // doubles as the next free node when unused
+                int32_t     child1{nullNode};
+                int32_t     child2{nullNode};
+                int32_t     height{-1};         // 0 -> leaf, -1 -> free
+                uint32_t    userData{};
+
+                bool isLeaf() const { return child1 == nullNode; }
+            };
+
+        private:
+
+            // Small stack used by the traversals, avoids a heap allocation for any sane tree height
+            struct TraversalStack {
+
+                int32_t inlineData[128];
+                std::vector<int32_t> heapData{};
+                int32_t* data = inlineData;
+                int32_t capacity = 128;
+                int32_t count = 0;
+
+                void push(int32_t value)
+                {
+                    if (count == capacity)
+                    {
+                        // Only the first spill copies out of the inline array, after that resize keeps the contents
+                        bool spilling = data == inlineData;
+
+                        heapData.resize(capacity * 2);
+                        if (spilling)
+                            std::copy(inlineData, inlineData + count, heapData.begin());
+
+                        data = heapData.data();
+                        capacity *= 2;
+                    }
+                    data[count++] = value;
+                }
+
+                int32_t pop()       { return data[--count]; }
+                bool empty() const  { return count == 0; }
+            };
+
+            std::vector<Node> m_nodes{};
+            int32_t m_root{nullNode};
+            int32_t m_freeList{nullNode};
+            uint32_t m_proxyCount{0};
+
+            float m_margin;
+            float m_displacementMultiplier;
+
+        public:
+
+            DynamicAABBTree(float margin = 0.1f, float displacementMultiplier = 2.f);
+
+            DynamicAABBTree(const DynamicAABBTree&) = delete;
+            DynamicAABBTree &operator=(const DynamicAABBTree&) = delete;
+
+            // Returns the proxy id that has to be passed to moveProxy/destroyProxy
+            int32_t createProxy(const AABB& box, uint32_t userData);
+            void destroyProxy(int32_t proxyId);
+
+            // Returns true only when the proxy left its fat AABB and got reinserted
+            bool moveProxy(int32_t proxyId, const AABB& box, glm::vec3 displacement = glm::vec3{0.f});
+
+            uint32_t getUserData(int32_t proxyId) const     { return m_nodes[proxyId].userData; }
+            const AABB& getFatAABB(int32_t proxyId) const   { return m_nodes[proxyId].box; }
+            uint32_t proxyCount() const                     { return m_proxyCount; }
+            int32_t height() const                          { return m_root == nullNode ? 0 : m_nodes[m_root].height; }
+
+            // Rebuilds nothing, only checks the invariants. Meant for debug builds
+            void validate() const;
+
+
+            // -------- QUERIES -------- //
+            //
+            // Callbacks receive (int32_t proxyId, uint32_t userData). Returning false from
+            // the AABB/sphere callbacks stops the traversal early.
+
+            template<typename Callback>
+            void queryAABB(const AABB& box, Callback&& callback) const
+            {
+                queryOverlap([&](const AABB& nodeBox) { return nodeBox.overlaps(box); }, callback);
+            }
+
+            template<typename Callback>
+            void querySphere(const Sphere& sphere, Callback&& callback) const
+            {
+                queryOverlap([&](const AABB& nodeBox) { return sphere.overlaps(nodeBox); }, callback);
+            }
+
+            // Hierarchical culling, once a node is fully inside the frustum its whole subtree is
+            // emitted without testing any more planes
+            template<typename Callback>
+            void queryFrustum(const Frustum& frustum, Callback&& callback) const
+            {
+                if (m_root == nullNode) return;
+
+                TraversalStack stack;
+                stack.push(m_root);
+
+                while (!stack.empty())
+                {
+                    const Node& node = m_nodes[stack.pop()];
+
+                    Frustum::Result result = frustum.classify(node.box);
+
+                    if (result == Frustum::Result::Outside)
+                        continue;
+
+                    if (result == Frustum::Result::Inside)
+                    {
+                        emitSubtree(node, callback);
+                        continue;
+                    }
+
+                    if (node.isLeaf())
+                        callback(static_cast<int32_t>(&node - m_nodes.data()), node.userData);
+                    else
+                    {
+                        stack.push(node.child1);
+                        stack.push(node.child2);
+                    }
+                }
+            }
+
+            // Callback receives (proxyId, userData, const Ray&, float maxT) and returns the new maxT.
+            // Return maxT to keep going unchanged, a smaller value to clip the ray, 0 to stop.
+            template<typename Callback>
+            void rayCast(const Ray& ray, float maxT, Callback&& callback) const
+            {
+                if (m_root == nullNode) return;
+
+                TraversalStack stack;
+                stack.push(m_root);
+
+                while (!stack.empty())
+                {
+                    const Node& node = m_nodes[stack.pop()];
+
+                    if (ray.intersect(node.box, maxT) < 0.f)
+                        continue;
+
+                    if (node.isLeaf())
+                    {
+                        maxT = callback(static_cast<int32_t>(&node - m_nodes.data()), node.userData, ray, maxT);
+                        if (maxT <= 0.f) return;
+                    }
+                    else
+                    {
+                        stack.push(node.child1);
+                        stack.push(node.child2);
+                    }
+                }
+            }
+
+        private:
+
+            template<typename Test, typename Callback>
+            void queryOverlap(Test&& test, Callback& callback) const
+            {
+                if (m_root == nullNode) return;
+
+                TraversalStack stack;
+                stack.push(m_root);
+
+                while (!stack.empty())
+                {
+                    const Node& node = m_nodes[stack.pop()];
+
+                    if (!test(node.box))
+                        continue;
+
+                    if (node.isLeaf())
+                    {
+                        if (!callback(static_cast<int32_t>(&node - m_nodes.data()), node.userData))
+                            return;
+                    }
+                    else
+                    {
+                        stack.push(node.child1);
+                        stack.push(node.child2);
+                    }
+                }
+            }
+
+            template<typename Callback>
+            void emitSubtree(const Node& subtreeRoot, Callback& callback) const
+            {
+                TraversalStack stack;
+                stack.push(static_cast<int32_t>(&subtreeRoot - m_nodes.data()));
+
+                while (!stack.empty())
+                {
+                    int32_t index = stack.pop();
+                    const Node& node = m_nodes[index];
+
+                    if (node.isLeaf())
+                        callback(index, node.userData);
+                    else
+                    {
+                        stack.push(node.child1);
+                        stack.push(node.child2);
+                    }
+                }
+            }
+
+            int32_t allocateNode();
+            void freeNode(int32_t nodeId);
+
+            void insertLeaf(int32_t leaf);
+            void removeLeaf(int32_t leaf);
+            void refitAncestors(int32_t index);
+            int32_t balance(int32_t index);
+
+            int32_t validateStructure(int32_t index) const;
+    };
+
+}
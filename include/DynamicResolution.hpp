@@ -0,0 +1,115 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace Orasis {
+
+
+    struct DynamicResolutionSettings {
+        float targetMs{0.f};            // GPU time per frame to stay under, 0 keeps full resolution
+        float minScale{0.5f};           // of the swap chain's width and height
+        float maxScale{1.f};
+
+        bool isEnabled() const { return targetMs > 0.f; }
+    };
+
+
+    /*
+        Picks the fraction of the swap chain extent the G-buffer and lighting render at from
+        measured GPU frame times. The cost is taken as proportional to the pixel count, so the
+        scale moves by the square root of how far the frame is off the target.
+
+        A change only lands once the frames rendered at the previous scale have been measured,
+        and scales are quantized, so it settles instead of oscillating: it drops as soon as the
+        budget is overrun and only climbs back with some headroom left.
+    */
+    class DynamicResolution {
+
+        public:
+
+            static constexpr float SCALE_STEP = 1.f / 32.f;
+            static constexpr float HEADROOM = 0.85f;            // climbs while under this fraction of the target
+            static constexpr float SMOOTHING = 0.2f;
+
+        private:
+
+            // -------- MEMBER VARIABLES -------- //
+
+            DynamicResolutionSettings m_settings;
+            uint32_t m_framesInFlight;
+
+            float m_scale{1.f};
+            float m_smoothedMs{0.f};
+            uint32_t m_settleFrames{0};         // measurements to skip, they still include the old scale
+
+            // -------- -------- -------- -------- //
+
+        public:
+
+            // -------- CONSTRUCTOR etc -------- //
+
+            DynamicResolution(const DynamicResolutionSettings& settings = {}, uint32_t framesInFlight = 2)
+            :m_settings{settings}, m_framesInFlight{framesInFlight}
+            {
+                m_settings.minScale = std::clamp(m_settings.minScale, SCALE_STEP, 1.f);
+                m_settings.maxScale = std::clamp(m_settings.maxScale, m_settings.minScale, 1.f);
+                m_scale = m_settings.maxScale;
+            }
+
+            // -------- -------- -------- -------- //
+
+
+
+
+            // -------- FUNCTIONS -------- //
+
+            bool isEnabled() const { return m_settings.isEnabled(); }
+
+            float getScale() const { return m_scale; }
+
+            // Feeds one frame's GPU time, returns true if the scale changed
+            bool update(float gpuMs)
+            {
+                if (!isEnabled() || gpuMs <= 0.f) return false;
+
+                if (m_settleFrames > 0)
+                {
+                    m_settleFrames--;
+                    return false;
+                }
+
+                m_smoothedMs = m_smoothedMs == 0.f ? gpuMs : m_smoothedMs + (gpuMs - m_smoothedMs) * SMOOTHING;
+
+                // Overruns react to the latest frame, climbing waits for the smoothed time
+                float target = m_settings.targetMs;
+                float measured = gpuMs > target ? std::max(gpuMs, m_smoothedMs) : m_smoothedMs;
+
+                if (measured <= target && measured >= target * HEADROOM) return false;
+
+                float desired = m_scale * std::sqrt(target * (1.f + HEADROOM) * 0.5f / measured);
+                desired = std::clamp(std::round(desired / SCALE_STEP) * SCALE_STEP, m_settings.minScale, m_settings.maxScale);
+
+                if (desired == m_scale) return false;
+
+                m_scale = desired;
+                m_smoothedMs = 0.f;
+                m_settleFrames = m_framesInFlight;
+
+                return true;
+            }
+
+            // Never zero, never past the full extent
+            VkExtent2D renderExtent(VkExtent2D full) const
+            {
+                return {
+                    std::clamp(static_cast<uint32_t>(std::lround(full.width * m_scale)), 1u, full.width),
+                    std::clamp(static_cast<uint32_t>(std::lround(full.height * m_scale)), 1u, full.height)
+                };
+            }
+    };
+
+}
@@ -0,0 +1,231 @@
+#pragma once
+
+#include "Device.hpp"
+#include "SwapChain.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace Orasis {
+
+
+    /*
+        Writes finished frames to disk as binary PPM, frame_000042.ppm and so on. The copy out of
+        the swap chain image is recorded at the end of the frame into a host visible buffer per
+        frame slot, the file is written when the slot comes around again (FrameScheduler::beginFrame
+        has waited for it by then), so dumping never stalls the GPU. flush() writes what's left.
+
+        Needs the images to be transfer sources, only the offscreen (headless) swap chain's are.
+        Backend thread only.
+    */
+    class FrameDump {
+
+        struct Slot {
+            VkBuffer buffer{VK_NULL_HANDLE};
+            VkDeviceMemory memory{VK_NULL_HANDLE};
+            void* mapped{nullptr};
+            VkDeviceSize size{0};
+
+            // What the pending copy holds
+            bool pending{false};
+            uint64_t frame{0};
+            VkExtent2D extent{};
+            bool bgra{false};
+        };
+
+        // -------- MEMBER VARIABLES -------- //
+
+        Device& m_device;
+        std::filesystem::path m_directory;
+
+        std::array<Slot, SwapChain::MAX_FRAMES_IN_FLIGHT> m_slots{};
+        uint64_t m_recorded{0};
+
+        // The RGB a file is written from, reused
+        std::vector<uint8_t> m_pixels{};
+
+        // -------- -------- -------- -------- //
+
+        public:
+
+        // -------- CONSTRUCTOR etc -------- //
+
+        FrameDump(Device& device, const std::string& directory)
+        :m_device{device}, m_directory{directory}
+        {
+            std::error_code error;
+            std::filesystem::create_directories(m_directory, error);
+
+            if (error)
+                throw std::runtime_error("failed to create frame dump directory " + directory);
+        }
+
+        // The GPU has to be done with the copies
+        ~FrameDump()
+        {
+            for (Slot& slot : m_slots)
+                destroyBuffer(slot);
+        }
+
+        FrameDump(const FrameDump&) = delete;
+        FrameDump &operator=(const FrameDump&) = delete;
+
+        // -------- -------- -------- -------- //
+
+
+
+
+        // -------- FUNCTIONS -------- //
+
+        uint64_t framesRecorded() const { return m_recorded; }
+
+        // After FrameScheduler::beginFrame, writes the frame the slot copied last
+        void collect(int frameIndex)
+        {
+            Slot& slot = m_slots[frameIndex];
+
+            if (slot.pending)
+                write(slot);
+        }
+
+        /*
+            Last thing in the frame's command buffer. image is the frame's swap chain image in
+            PRESENT_SRC, it's left there. Only 8 bit RGBA / BGRA formats are written.
+        */
+        void record(VkCommandBuffer commandBuffer, int frameIndex, VkImage image, VkFormat format, VkExtent2D extent)
+        {
+            Slot& slot = m_slots[frameIndex];
+
+            reserve(slot, static_cast<VkDeviceSize>(extent.width) * extent.height * 4);
+
+            VkImageSubresourceRange range{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+            // Written by the lighting subpass, or blitted by the tiled lighting / upscaler
+            VkImageMemoryBarrier toTransfer{};
+            toTransfer.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            toTransfer.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+            toTransfer.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            toTransfer.oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+            toTransfer.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            toTransfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            toTransfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            toTransfer.image = image;
+            toTransfer.subresourceRange = range;
+
+            vkCmdPipelineBarrier(commandBuffer,
+                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                0, 0, nullptr, 0, nullptr, 1, &toTransfer);
+
+            VkBufferImageCopy region{};
+            region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+            region.imageExtent = {extent.width, extent.height, 1};
+
+            vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.buffer, 1, &region);
+
+            // Back to what the next frame's passes expect, after the copy read it
+            VkImageMemoryBarrier toPresent = toTransfer;
+            toPresent.srcAccessMask = 0;
+            toPresent.dstAccessMask = 0;
+            toPresent.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            toPresent.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+            VkBufferMemoryBarrier toHost{};
+            toHost.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            toHost.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            toHost.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+            toHost.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            toHost.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            toHost.buffer = slot.buffer;
+            toHost.size = VK_WHOLE_SIZE;
+
+            vkCmdPipelineBarrier(commandBuffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                0, 0, nullptr, 1, &toHost, 1, &toPresent);
+
+            slot.pending = true;
+            slot.frame = m_recorded++;
+            slot.extent = extent;
+            slot.bgra = format == VK_FORMAT_B8G8R8A8_SRGB || format == VK_FORMAT_B8G8R8A8_UNORM;
+        }
+
+        // GPU idle, writes every copy that's still pending
+        void flush()
+        {
+            for (Slot& slot : m_slots)
+                if (slot.pending)
+                    write(slot);
+        }
+
+        private:
+
+        // The slot's last copy is written by now, a smaller buffer can go right away
+        void reserve(Slot& slot, VkDeviceSize size)
+        {
+            if (slot.size >= size) return;
+
+            destroyBuffer(slot);
+
+            m_device.createBuffer(
+                size,
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                slot.buffer,
+                slot.memory
+            );
+
+            if (vkMapMemory(m_device.device(), slot.memory, 0, size, 0, &slot.mapped) != VK_SUCCESS)
+                throw std::runtime_error("failed to map frame dump buffer");
+
+            slot.size = size;
+        }
+
+        void destroyBuffer(Slot& slot)
+        {
+            if (slot.buffer == VK_NULL_HANDLE) return;
+
+            vkUnmapMemory(m_device.device(), slot.memory);
+            vkDestroyBuffer(m_device.device(), slot.buffer, nullptr);
+            vkFreeMemory(m_device.device(), slot.memory, nullptr);
+
+            slot = {};
+        }
+
+        void write(Slot& slot)
+        {
+            slot.pending = false;
+
+            char name[32];
+            std::snprintf(name, sizeof(name), "frame_%06llu.ppm", static_cast<unsigned long long>(slot.frame));
+
+            std::filesystem::path path = m_directory / name;
+            std::ofstream file{path, std::ios::binary | std::ios::trunc};
+            if (!file)
+                throw std::runtime_error("failed to open " + path.string());
+
+            // PPM is RGB, the values stay sRGB encoded like the image's
+            size_t pixelCount = static_cast<size_t>(slot.extent.width) * slot.extent.height;
+            m_pixels.resize(pixelCount * 3);
+
+            const uint8_t* src = static_cast<const uint8_t*>(slot.mapped);
+            int r = slot.bgra ? 2 : 0;
+            int b = slot.bgra ? 0 : 2;
+
+            for (size_t i = 0; i < pixelCount; i++)
+            {
+                m_pixels[3 * i + 0] = src[4 * i + r];
+                m_pixels[3 * i + 1] = src[4 * i + 1];
+                m_pixels[3 * i + 2] = src[4 * i + b];
+            }
+
+            file << "P6\n" << slot.extent.width << ' ' << slot.extent.height << "\n255\n";
+            file.write(reinterpret_cast<const char*>(m_pixels.data()), static_cast<std::streamsize>(m_pixels.size()));
+        }
+    };
+
+}
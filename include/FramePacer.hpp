@@ -0,0 +1,104 @@
+#pragma once
+
+#include "Device.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+namespace Orasis {
+
+
+    // Smoothed timings of the last frames, all in milliseconds
+    struct FrameStats {
+        float cpuMs{0.f};           // input sampled -> submitted
+        float gpuMs{0.f};           // GPU busy time per frame
+        float latencyMs{0.f};       // input sampled -> frame finished on the GPU (ready to present)
+        float frameMs{0.f};         // start to start
+    };
+
+
+    /*
+        Decides when the next frame may start sampling input.
+
+        - Limiter: frames start on a fixed period. The wait sleeps in 1ms steps while the
+          remaining time is larger than what a sleep has been measured to take, then spins
+          the rest, so it's accurate without burning a core for the whole frame.
+        - Low latency: input sampling is pushed back to (predicted moment the GPU gets to this
+          frame) - (predicted CPU time of the frame), so the frame doesn't sit in the queue
+          with stale input. Both predictions come from the device timeline.
+
+        Latency is measured up to the moment the frame's timeline value completed, the image
+        is presentable then. With FIFO the display can add up to one more refresh.
+
+        waitForFrameStart runs on the frontend thread, frameSubmitted on the render backend.
+    */
+    class FramePacer {
+
+        using Clock = std::chrono::steady_clock;
+
+        struct PendingFrame {
+            uint64_t value;
+            Clock::time_point inputTime;
+            Clock::time_point submitTime;
+        };
+
+        // -------- MEMBER VARIABLES -------- //
+
+        Device& m_device;
+
+        double m_targetFps{0.0};
+        bool m_lowLatency{false};
+
+        Clock::time_point m_nextDeadline{};
+        Clock::time_point m_frameStart{};
+
+        // Shared with the backend thread
+        mutable std::mutex m_mutex;
+        Clock::time_point m_lastCompletion{};
+        std::deque<PendingFrame> m_pending{};
+
+        // Running estimate of how long a 1ms sleep really takes, in seconds
+        double m_sleepMean{1e-3};
+        double m_sleepVariance{0.0};
+
+        FrameStats m_stats{};           // frameMs is frontend only, the rest is under m_mutex
+
+        // -------- -------- -------- -------- //
+
+        public:
+
+        explicit FramePacer(Device& device) : m_device{device} {}
+
+        // 0 disables the limiter
+        void setTargetFps(double fps);
+        void setLowLatency(bool enabled) { m_lowLatency = enabled; }
+
+        double targetFps() const { return m_targetFps; }
+        bool isLowLatency() const { return m_lowLatency; }
+
+        // Call right before sampling input, returns once the frame should start (with that moment)
+        Clock::time_point waitForFrameStart();
+
+        // timelineValue is what the frame's submission signals, frameStart what waitForFrameStart returned for it
+        void frameSubmitted(uint64_t timelineValue, Clock::time_point frameStart);
+
+        FrameStats stats() const
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            return m_stats;
+        }
+
+        private:
+
+        void pollCompletions();
+        void pollCompletionsLocked();
+        Clock::time_point predictGpuIdle() const;
+        void preciseWaitUntil(Clock::time_point deadline);
+
+        static float toMs(Clock::duration duration);
+        static void smooth(float& average, float sample);
+    };
+
+}
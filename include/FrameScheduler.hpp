@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Device.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace Orasis {
+
+
+    /*
+        Paces frames on the device timeline instead of per frame fences. Each frame's submission
+        signals a timeline value, a frame slot can be reused once the value its previous frame
+        signaled has completed, and a swap chain image once the last frame that rendered to it has.
+
+        Only the binary semaphores the swap chain needs (acquire/present) are kept per slot, a
+        headless device has none. Sized for maxFramesInFlight, how many are actually used can change at runtime.
+    */
+    class FrameScheduler {
+
+        // -------- MEMBER VARIABLES -------- //
+
+        Device& m_device;
+
+        uint32_t m_maxFramesInFlight;
+        uint32_t m_framesInFlight;
+        uint32_t m_currentFrame{0};
+
+        std::vector<VkSemaphore> m_imageAvailable{};
+        std::vector<VkSemaphore> m_renderFinished{};
+
+        // Timeline value signaled by the last submission of each frame slot / swap chain image
+        std::vector<uint64_t> m_frameValues{};
+        std::vector<uint64_t> m_imageValues{};
+
+        // -------- -------- -------- -------- //
+
+        public:
+
+        FrameScheduler(Device& device, uint32_t maxFramesInFlight, uint32_t framesInFlight);
+        ~FrameScheduler();
+
+        FrameScheduler(const FrameScheduler&) = delete;
+        FrameScheduler &operator=(const FrameScheduler&) = delete;
+
+        // Blocks until the current slot's previous frame is done, returns the slot index
+        uint32_t beginFrame();
+
+        // Usually already complete, only waits if the image's last frame is still running
+        void waitForImage(uint32_t imageIndex);
+
+        // Waits on imageAvailable, signals renderFinished (both only when presenting) and the timeline. Returns the frame's value.
+        uint64_t submit(const VkCommandBuffer* commandBuffers, uint32_t count, uint32_t imageIndex);
+
+        void advance() { m_currentFrame = (m_currentFrame + 1) % m_framesInFlight; }
+
+        // Waits for everything in flight, only call between frames
+        void setFramesInFlight(uint32_t count);
+
+        // The new swap chain's images haven't been used by any frame yet
+        void resetImages(size_t imageCount) { m_imageValues.assign(imageCount, 0); }
+
+        // VK_NULL_HANDLE when headless
+        VkSemaphore imageAvailable() const { return m_imageAvailable.empty() ? VK_NULL_HANDLE : m_imageAvailable[m_currentFrame]; }
+        VkSemaphore renderFinished() const { return m_renderFinished.empty() ? VK_NULL_HANDLE : m_renderFinished[m_currentFrame]; }
+
+        uint32_t currentFrame() const { return m_currentFrame; }
+        uint32_t framesInFlight() const { return m_framesInFlight; }
+        uint32_t maxFramesInFlight() const { return m_maxFramesInFlight; }
+    };
+
+}
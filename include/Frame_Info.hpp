@@ -2,6 +2,7 @@
 
 #include "Camera.hpp"
 #include "GameObject.hpp"
+#include "DynamicAABBTree.hpp"
 
 // #include "third_party/include/vulkan/vulkan.h"
 
@@ -14,12 +15,32 @@ namespace Orasis {
         alignas(16) glm::vec3 lightPos = {1.f, -3.5f, -1.f};
         alignas(16) glm::vec3 lightColor = {1.f, 1.f, 1.f};
         alignas(16) glm::vec3 cameraPos{};
+
+        // Lighting reconstructs world positions from the depth attachment with it
+        alignas(16) glm::mat4 inverseViewProjection{1.f};
     };
 
     struct UI_Info {
 
         float dt;
 
+        // Smoothed, see FramePacer
+        float cpuMs{0.f};
+        float gpuMs{0.f};
+        float latencyMs{0.f};
+        const char* presentMode{""};
+
+        // Occlusion culling, see OcclusionStats
+        uint32_t drawCandidates{0};
+        uint32_t drawsFirstPhase{0};
+        uint32_t drawsSecondPhase{0};
+        uint32_t triangles{0};
+
+        float renderScale{1.f};             // dynamic resolution
+
+        float overdraw{0.f};                // samples per pixel of the geometry, 0 if not measured
+        bool depthPrepass{false};
+
     };
 
     struct Attachment {
@@ -47,11 +68,28 @@ namespace Orasis {
     };
 
 
+    // What the geometry subpass writes, picks the Manager's attachments and the deffered shaders
+    enum class GBufferLayout {
+        Packed,     // octahedral RG16 normals + albedo, position reconstructed from depth (8 bytes per pixel)
+        Full        // explicit RGBA16F positions and normals + albedo (20 bytes per pixel)
+    };
+
+    // Where the lights get applied
+    enum class LightingPath {
+        Subpass,    // full screen draw in the deffered pass' second subpass
+        Compute     // TiledLighting after the pass, skips tiles without geometry (needs GBufferLayout::Packed)
+    };
+
     struct ManagerInfo {
         VkFormat swapChainFormat;
         VkFormat depthFormat;
-        VkSwapchainKHR swapChain;
+        std::vector<VkImage> swapChainImages;     // OutColor, swap chain or offscreen (headless) images
         VkExtent2D extent;
+        GBufferLayout gBufferLayout{GBufferLayout::Packed};
+        LightingPath lightingPath{LightingPath::Subpass};
+        bool occlusionCulling{false};       // two phase geometry (OcclusionCulling), adds the GeometryOnly / Resume passes
+        bool dynamicResolution{false};      // renders to part of the attachments, the Upscaler writes the swap chain image
+        bool ambientOcclusion{false};       // depth and normals are sampled between the geometry and the lighting (AmbientOcclusion)
     };
 
     struct FrameInfo {
@@ -63,13 +101,15 @@ namespace Orasis {
             VkDescriptorSet globalDescriptorSet;
             VkDescriptorSet secondaryDescriptorSet;
             GameObject::uMap& gameObjects;
+            DynamicAABBTree& sceneTree;
             int frameIndex;
             float dt;
 
-            FrameInfo (VkCommandBuffer o_cmdBuffer,  Camera o_camera, GameObject::uMap& o_gameObjects, int o_frameIndex, float o_dt)
+            FrameInfo (VkCommandBuffer o_cmdBuffer,  Camera o_camera, GameObject::uMap& o_gameObjects, DynamicAABBTree& o_sceneTree, int o_frameIndex, float o_dt)
             :cmdBuffer{o_cmdBuffer},
              camera{o_camera},
              gameObjects{o_gameObjects},
+             sceneTree{o_sceneTree},
              frameIndex{o_frameIndex},
              dt{o_dt}
             {}
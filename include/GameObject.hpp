@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Model.hpp"
+#include "DynamicAABBTree.hpp"
 
 #include <glm/gtc/matrix_transform.hpp>
 
@@ -14,9 +15,13 @@ namespace Orasis {
     {
         glm::vec3 translation{};
         glm::vec3 scale{1.f};
-        glm::vec3 rotation;
+        glm::vec3 rotation{};
 
-        glm::mat4 mat4() {
+        // Cached parent * local, only refreshed by TransformHierarchy::update for dirty objects
+        glm::mat4 worldMatrix{1.f};
+
+        // Local matrix from translation, rotation (YXZ) and scale
+        glm::mat4 mat4() const {
             
             const float c3 = glm::cos(rotation.z);
             const float s3 = glm::sin(rotation.z);
@@ -50,6 +55,7 @@ namespace Orasis {
     
     struct PointLightComponent {
        float intensity = 1.f; 
+       bool castsShadows = false;       // takes one of the ShadowConfig::POINT_LIGHTS shadow slots
     };
 
     
@@ -67,6 +73,19 @@ namespace Orasis {
             TransformComponent transform{};
 
             std::unique_ptr<PointLightComponent> pointLight = nullptr;
+
+            // Leaf in the scene DynamicAABBTree, only objects with a model get one
+            int32_t proxyId = DynamicAABBTree::nullNode;
+
+            // Static objects are recorded once into cached secondary command buffers,
+            // changing one means invalidating that cache (Render::invalidateStaticDraws)
+            enum class Mobility { Static, Dynamic };
+            Mobility mobility{Mobility::Dynamic};
+
+            bool isStatic() const { return mobility == Mobility::Static; }
+
+            // G-buffer pipeline variant, see DefferedSystem::addGeometryVariant. 0 is the default one
+            uint32_t pipelineId{0};
         
         
         private:
@@ -98,6 +117,36 @@ namespace Orasis {
                 return id;
             }
 
+            AABB worldBounds() const
+            {
+                if (model == nullptr)
+                {
+                    glm::vec3 position{transform.worldMatrix[3]};
+                    return AABB{position, position};
+                }
+
+                return model->getBoundingBox().transformed(transform.worldMatrix);
+            }
+
+            // Inserts or moves the object's leaf, cheap when the object stays inside its fat AABB
+            void updateProxy(DynamicAABBTree& tree, glm::vec3 displacement = glm::vec3{0.f})
+            {
+                if (model == nullptr) return;
+
+                if (proxyId == DynamicAABBTree::nullNode)
+                    proxyId = tree.createProxy(worldBounds(), id);
+                else
+                    tree.moveProxy(proxyId, worldBounds(), displacement);
+            }
+
+            void removeProxy(DynamicAABBTree& tree)
+            {
+                if (proxyId == DynamicAABBTree::nullNode) return;
+
+                tree.destroyProxy(proxyId);
+                proxyId = DynamicAABBTree::nullNode;
+            }
+
             static GameObject makePointLight(float intensity = 10.f, float radius = 0.1f, glm::vec3 color = glm::vec3(1.f))
             {
                 GameObject gameObj = GameObject::createGameObject();
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "Device.hpp"
+#include "SwapChain.hpp"
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+
+namespace Orasis {
+
+
+    /*
+        GPU time of whole frames from timestamp queries, two per frame in flight. A frame's
+        result is read back when its slot comes around again, FrameScheduler::beginFrame has
+        waited for it by then, so reading never stalls.
+
+        Backend thread only.
+    */
+    class GpuTimer {
+
+        // -------- MEMBER VARIABLES -------- //
+
+        Device& m_device;
+
+        VkQueryPool m_queryPool{VK_NULL_HANDLE};
+        float m_nsPerTick{1.f};
+
+        // The slot's queries were written by a submitted frame and not read yet
+        std::array<bool, SwapChain::MAX_FRAMES_IN_FLIGHT> m_pending{};
+
+        // -------- -------- -------- -------- //
+
+        public:
+
+        // -------- CONSTRUCTOR etc -------- //
+
+        GpuTimer(Device& device)
+        :m_device{device}
+        {
+            m_nsPerTick = m_device.properties.limits.timestampPeriod;
+
+            // Without it isSupported() is false and begin / end do nothing
+            if (!m_device.properties.limits.timestampComputeAndGraphics) return;
+
+            VkQueryPoolCreateInfo poolInfo{};
+            poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+            poolInfo.queryCount = 2 * SwapChain::MAX_FRAMES_IN_FLIGHT;
+
+            if (vkCreateQueryPool(m_device.device(), &poolInfo, nullptr, &m_queryPool) != VK_SUCCESS)
+                throw std::runtime_error("failed to create timestamp query pool");
+        }
+
+        ~GpuTimer()
+        {
+            if (m_queryPool != VK_NULL_HANDLE)
+                vkDestroyQueryPool(m_device.device(), m_queryPool, nullptr);
+        }
+
+        GpuTimer(const GpuTimer&) = delete;
+        GpuTimer &operator=(const GpuTimer&) = delete;
+
+        // -------- -------- -------- -------- //
+
+
+
+
+        // -------- FUNCTIONS -------- //
+
+        bool isSupported() const { return m_queryPool != VK_NULL_HANDLE; }
+
+        /*
+            First thing in the frame's command buffer. Returns the GPU time in ms of the previous
+            frame recorded into this slot, or a negative value if there's none to report.
+        */
+        float begin(VkCommandBuffer commandBuffer, int frameIndex)
+        {
+            if (!isSupported()) return -1.f;
+
+            float elapsedMs = -1.f;
+            uint32_t first = 2 * static_cast<uint32_t>(frameIndex);
+
+            if (m_pending[frameIndex])
+            {
+                std::array<uint64_t, 2> ticks{};
+
+                // Not ready would mean the frame never ran, it's skipped rather than waited for
+                if (vkGetQueryPoolResults(m_device.device(), m_queryPool, first, 2, sizeof(ticks), ticks.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+                    elapsedMs = static_cast<float>(static_cast<double>(ticks[1] - ticks[0]) * m_nsPerTick * 1e-6);
+
+                m_pending[frameIndex] = false;
+            }
+
+            vkCmdResetQueryPool(commandBuffer, m_queryPool, first, 2);
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_queryPool, first);
+
+            return elapsedMs;
+        }
+
+        // Last thing before the frame's command buffer ends
+        void end(VkCommandBuffer commandBuffer, int frameIndex)
+        {
+            if (!isSupported()) return;
+
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPool, 2 * static_cast<uint32_t>(frameIndex) + 1);
+            m_pending[frameIndex] = true;
+        }
+    };
+
+}
@@ -8,7 +8,11 @@
 
 
 #include "Render.hpp"
+#include "JobSystem.hpp"
+#include "AssetLoader.hpp"
 #include "GameObject.hpp"
+#include "TransformHierarchy.hpp"
+#include "Simulation.hpp"
 #include "Kmb_movement_controller.hpp"
 #include "Descriptors.hpp"
 #include "Render_Systems/RenderSystem.hpp"
@@ -21,6 +25,10 @@
 
 #include <memory>
 #include <chrono>
+#include <random>
 #include <vector>
 #include <stdexcept>
-#include <array>
\ No newline at end of file
+#include <array>
+#include <fstream>
+#include <iostream>
+#include <string>
\ No newline at end of file
@@ -9,6 +9,7 @@
 #include "Pipeline.hpp"
 // #include "Texture.hpp"
 #include "GameObject.hpp"
+#include "DrawSort.hpp"
 
 #include <memory>
 #include <vector>
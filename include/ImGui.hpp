@@ -101,6 +101,17 @@ namespace Orasis {
                 ImGui::Begin("Kappa");
                 ImGui::SetWindowPos(ImVec2(-1, 1));
                 ImGui::Text("%2f ms ", m_info.dt);
+                ImGui::Text("cpu %.2f ms  gpu %.2f ms", m_info.cpuMs, m_info.gpuMs);
+                ImGui::Text("input -> present %.2f ms (%s)", m_info.latencyMs, m_info.presentMode);
+
+                if (m_info.renderScale < 1.f)
+                    ImGui::Text("resolution %.0f%%", m_info.renderScale * 100.f);
+
+                if (m_info.drawCandidates > 0)
+                    ImGui::Text("draws %u + %u of %u, %u tris", m_info.drawsFirstPhase, m_info.drawsSecondPhase, m_info.drawCandidates, m_info.triangles);
+
+                if (m_info.overdraw > 0.f)
+                    ImGui::Text("overdraw %.2fx, depth pre-pass %s", m_info.overdraw, m_info.depthPrepass ? "on" : "off");
                 ImGui::End();
 
                 ImGui::Render();
@@ -5,8 +5,10 @@
 
 
 // std
+#include <algorithm>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 #include "vk_mem_alloc.h"
 
@@ -19,6 +21,10 @@ namespace Orasis {
         VmaAllocation   s_allocation; 
         VmaAllocator    s_allocator;  
         Device&         s_device;
+
+        // Views of single mip levels (storage writes), s_imageView sees all of them. Empty for 1 level
+        uint32_t                    s_mipLevels{1};
+        std::vector<VkImageView>    s_mipViews{};
         
     
         Image(const Image& o_other) = delete;
@@ -30,8 +36,9 @@ namespace Orasis {
             VkExtent2D extent, 
             VkFormat format, 
             VkImageUsageFlags usage, 
-            VkImageAspectFlags imageAspect = VK_IMAGE_ASPECT_COLOR_BIT)
-        : s_device{device}, s_allocator{allocator}
+            VkImageAspectFlags imageAspect = VK_IMAGE_ASPECT_COLOR_BIT,
+            uint32_t mipLevels = 1)
+        : s_device{device}, s_allocator{allocator}, s_mipLevels{mipLevels}
         {
             createAttachment(extent, format, usage, imageAspect);
         }
@@ -49,7 +56,7 @@ namespace Orasis {
             imageInfo.extent.width = extent.width;
             imageInfo.extent.height = extent.height;
             imageInfo.extent.depth = 1;
-            imageInfo.mipLevels = 1;
+            imageInfo.mipLevels = s_mipLevels;
             imageInfo.arrayLayers = 1;
             imageInfo.format = format;
             imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
@@ -75,12 +82,25 @@ namespace Orasis {
             viewInfo.format = format;
             viewInfo.subresourceRange.aspectMask = imageAspect;
             viewInfo.subresourceRange.baseMipLevel = 0;
-            viewInfo.subresourceRange.levelCount = 1;
+            viewInfo.subresourceRange.levelCount = s_mipLevels;
             viewInfo.subresourceRange.baseArrayLayer = 0;
             viewInfo.subresourceRange.layerCount = 1;
 
             if (vkCreateImageView(s_device.device(), &viewInfo, nullptr, &s_imageView) != VK_SUCCESS)
                 throw std::runtime_error("failed to create texture image view!");
+
+            if (s_mipLevels == 1) return;
+
+            s_mipViews.resize(s_mipLevels);
+
+            for (uint32_t level = 0; level < s_mipLevels; level++)
+            {
+                viewInfo.subresourceRange.baseMipLevel = level;
+                viewInfo.subresourceRange.levelCount = 1;
+
+                if (vkCreateImageView(s_device.device(), &viewInfo, nullptr, &s_mipViews[level]) != VK_SUCCESS)
+                    throw std::runtime_error("failed to create mip level image view!");
+            }
                     
 
         }
@@ -135,6 +155,27 @@ namespace Orasis {
             );
         }
 
+        // Color image with a full chain of levels down to 1x1 (e.g. a depth pyramid)
+        static std::shared_ptr<Image> createMipChain(
+            Device& device,
+            VmaAllocator allocator,
+            VkExtent2D extent,
+            VkFormat format,
+            VkImageUsageFlags usage
+        ) {
+            uint32_t mipLevels = 1;
+            for (uint32_t size = std::max(extent.width, extent.height); size > 1; size = (size + 1) / 2)
+                mipLevels++;
+
+            return std::make_shared<Image>(device, allocator, extent, format, usage, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
+        }
+
+        // A single level of the image, a 1 level image has no separate views
+        VkImageView getMipView(uint32_t level) const
+        {
+            return s_mipViews.empty() ? s_imageView : s_mipViews[level];
+        }
+
         static std::shared_ptr<Image> wrapSwapchainImage(
             Device& device,
             VkImage image,
@@ -166,6 +207,9 @@ namespace Orasis {
 
         ~Image()
         {
+            for (VkImageView view : s_mipViews)
+                vkDestroyImageView(s_device.device(), view, nullptr);
+
             vkDestroyImageView(s_device.device(), s_imageView, nullptr);
             if (s_allocator && s_allocation) {
                 vmaDestroyImage(s_allocator, s_image, s_allocation);
@@ -0,0 +1,188 @@
+#pragma once
+
+#include "WorkStealingDeque.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Orasis {
+
+
+    class JobSystem;
+    struct Job;
+
+
+    // Number of jobs still to finish. Waiting on it helps run jobs, continuations
+    // registered with JobSystem::runAfter start once it reaches zero. Only destroy it
+    // after JobSystem::wait returned, isDone alone doesn't mean the last job let go of it.
+    class JobCounter {
+
+        friend class JobSystem;
+
+        std::atomic<uint32_t> m_pending{0};
+
+        std::mutex m_mutex;
+        std::vector<Job*> m_continuations{};
+
+        public:
+
+        JobCounter() = default;
+
+        JobCounter(const JobCounter&) = delete;
+        JobCounter &operator=(const JobCounter&) = delete;
+
+        bool isDone() const { return m_pending.load(std::memory_order_acquire) == 0; }
+    };
+
+
+    struct Job {
+        std::function<void()> function;
+        JobCounter* counter;
+    };
+
+
+    /*
+        The engine's task scheduler. One Chase-Lev deque per worker: a worker pops its own jobs
+        LIFO and steals FIFO from random others when it runs dry. The thread that creates the
+        JobSystem is worker 0, it runs jobs while waiting on a counter. Jobs submitted from any
+        other thread go through a shared injection queue.
+
+        Jobs must not throw, catch inside the job and report through its result.
+    */
+    class JobSystem {
+
+        // -------- MEMBER VARIABLES -------- //
+
+        std::vector<std::unique_ptr<WorkStealingDeque<Job*>>> m_queues{};
+        std::vector<std::thread> m_workers{};
+
+        std::mutex m_injectionMutex;
+        std::deque<Job*> m_injection{};
+
+        // Long jobs (pipeline compiles, asset loads), only idle workers take these
+        std::mutex m_backgroundMutex;
+        std::deque<Job*> m_background{};
+
+        // Sleeping workers wake when the epoch moves, see workerLoop
+        std::mutex m_sleepMutex;
+        std::condition_variable m_wake;
+        std::atomic<uint64_t> m_epoch{0};
+        std::atomic<uint32_t> m_sleepers{0};
+        std::atomic<bool> m_stopping{false};
+
+        // -------- -------- -------- -------- //
+
+        public:
+
+        // workerCount 0 -> one less than the hardware threads (the creating thread is the other one), at least one
+        explicit JobSystem(uint32_t workerCount = 0, bool pinWorkers = true);
+        ~JobSystem();
+
+        JobSystem(const JobSystem&) = delete;
+        JobSystem &operator=(const JobSystem&) = delete;
+
+        // counter (optional) is incremented now and decremented once the job finished
+        void run(std::function<void()> function, JobCounter* counter = nullptr);
+
+        // For jobs that take milliseconds. Never picked up by a thread helping in wait(), so they
+        // can't stall the frame that happens to be waiting on something else.
+        void runBackground(std::function<void()> function, JobCounter* counter = nullptr);
+
+        // Starts function once `after` reached zero, counted on `counter` from now on
+        void runAfter(JobCounter& after, std::function<void()> function, JobCounter* counter = nullptr);
+
+        // Runs other jobs until the counter reaches zero
+        void wait(JobCounter& counter);
+
+        // For work that finishes outside of a job (a suspended coroutine), counts on counter until release()
+        void retain(JobCounter& counter);
+        void release(JobCounter& counter);
+
+        /*
+            body(begin, end) over [begin, end). Ranges are split lazily: a thread only halves its
+            remaining range when its own deque is empty, i.e. when someone could steal the other
+            half. Balanced loops end up with roughly one split per thread, uneven ones keep
+            splitting down to minGrain. Returns once everything ran.
+        */
+        template<typename Body>
+        void parallelFor(size_t begin, size_t end, size_t minGrain, const Body& body);
+
+        // Including the creating thread
+        uint32_t threadCount() const { return static_cast<uint32_t>(m_queues.size()); }
+
+        bool isWorkerThread() const;
+
+        private:
+
+        template<typename Body>
+        struct RangeTask {
+
+            JobSystem& jobs;
+            const Body& body;
+            size_t grain;
+            JobCounter& counter;
+
+            void run(size_t begin, size_t end)
+            {
+                while (begin < end)
+                {
+                    if (end - begin >= 2 * grain && jobs.isLocalQueueEmpty())
+                    {
+                        size_t mid = begin + (end - begin) / 2;
+                        jobs.run([this, mid, end] { run(mid, end); }, &counter);
+                        end = mid;
+                        continue;
+                    }
+
+                    size_t stop = std::min(end, begin + grain);
+                    body(begin, stop);
+                    begin = stop;
+                }
+            }
+        };
+
+        void schedule(Job* job);
+        void execute(Job* job);
+        void finish(JobCounter* counter);
+        Job* findWork(bool includeBackground);
+        bool isLocalQueueEmpty();
+
+        void workerLoop(uint32_t index);
+        void wakeWorkers();
+
+        static void pinThread(std::thread& thread, uint32_t core);
+    };
+
+
+
+    template<typename Body>
+    void JobSystem::parallelFor(size_t begin, size_t end, size_t minGrain, const Body& body)
+    {
+        if (begin >= end) return;
+
+        minGrain = std::max<size_t>(minGrain, 1);
+
+        // Not worth a job
+        if (end - begin <= minGrain || m_queues.size() == 1)
+        {
+            body(begin, end);
+            return;
+        }
+
+        JobCounter counter;
+        RangeTask<Body> task{*this, body, minGrain, counter};
+
+        task.run(begin, end);
+        wait(counter);
+    }
+
+}
@@ -33,41 +33,80 @@ namespace Orasis
 
 
 
-            void moveInPlaneXZ(GLFWwindow* window, GameObject& gameObject, float dt)
+            // Bit per action, so input sampled on the main thread can be handed to the simulation as one word
+            enum Action : uint32_t {
+                MoveLeft     = 1u << 0,
+                MoveRight    = 1u << 1,
+                MoveForward  = 1u << 2,
+                MoveBackward = 1u << 3,
+                MoveUp       = 1u << 4,
+                MoveDown     = 1u << 5,
+                LookLeft     = 1u << 6,
+                LookRight    = 1u << 7,
+                LookUp       = 1u << 8,
+                LookDown     = 1u << 9,
+            };
+
+
+            // Main thread only (GLFW), also handles escape
+            uint32_t sampleActions(GLFWwindow* window) const
             {
-                
                 if (glfwGetKey(window, keys.esc) == GLFW_PRESS) 
                     glfwSetWindowShouldClose(window, GL_TRUE);
-                
+
+                uint32_t actions = 0;
+
+                if (glfwGetKey(window, keys.moveLeft) == GLFW_PRESS) actions |= MoveLeft;
+                if (glfwGetKey(window, keys.moveRight) == GLFW_PRESS) actions |= MoveRight;
+                if (glfwGetKey(window, keys.moveForward) == GLFW_PRESS) actions |= MoveForward;
+                if (glfwGetKey(window, keys.moveBackward) == GLFW_PRESS) actions |= MoveBackward;
+                if (glfwGetKey(window, keys.moveUp) == GLFW_PRESS) actions |= MoveUp;
+                if (glfwGetKey(window, keys.moveDown) == GLFW_PRESS) actions |= MoveDown;
+                if (glfwGetKey(window, keys.lookLeft) == GLFW_PRESS) actions |= LookLeft;
+                if (glfwGetKey(window, keys.lookRight) == GLFW_PRESS) actions |= LookRight;
+                if (glfwGetKey(window, keys.lookUp) == GLFW_PRESS) actions |= LookUp;
+                if (glfwGetKey(window, keys.lookDown) == GLFW_PRESS) actions |= LookDown;
+
+                return actions;
+            }
+
+            void moveInPlaneXZ(GLFWwindow* window, GameObject& gameObject, float dt)
+            {
+                moveInPlaneXZ(sampleActions(window), gameObject.transform, dt);
+            }
+
+            // Doesn't touch GLFW, safe on the simulation thread
+            void moveInPlaneXZ(uint32_t actions, TransformComponent& transform, float dt) const
+            {
                 glm::vec3 rotate{0};
 
-                if (glfwGetKey(window, keys.lookRight) == GLFW_PRESS) rotate.y += 1;
-                if (glfwGetKey(window, keys.lookLeft) == GLFW_PRESS) rotate.y -= 1;
-                if (glfwGetKey(window, keys.lookUp) == GLFW_PRESS) rotate.x += 1;
-                if (glfwGetKey(window, keys.lookDown) == GLFW_PRESS) rotate.x -= 1;
+                if (actions & LookRight) rotate.y += 1;
+                if (actions & LookLeft) rotate.y -= 1;
+                if (actions & LookUp) rotate.x += 1;
+                if (actions & LookDown) rotate.x -= 1;
                 
                 if (glm::dot(rotate, rotate) > std::numeric_limits<float>::epsilon())
-                    gameObject.transform.rotation += glm::normalize(rotate) * lookSpeed * dt;
+                    transform.rotation += glm::normalize(rotate) * lookSpeed * dt;
                     
-                gameObject.transform.rotation.x = glm::clamp(gameObject.transform.rotation.x, -1.5f, 1.5f);
-                gameObject.transform.rotation.y = glm::mod(gameObject.transform.rotation.y, glm::two_pi<float>());
+                transform.rotation.x = glm::clamp(transform.rotation.x, -1.5f, 1.5f);
+                transform.rotation.y = glm::mod(transform.rotation.y, glm::two_pi<float>());
                 
                 glm::vec3 moveDir{0.f};
 
-                float yaw = gameObject.transform.rotation.y;
+                float yaw = transform.rotation.y;
                 const glm::vec3 forwardDir{sin(yaw), 0.f, cos(yaw)};
                 const glm::vec3 rightDir{forwardDir.z, 0.f, -forwardDir.x};
                 const glm::vec3 upDir{0.f, -1.f, 0.f};
                 
-                if (glfwGetKey(window, keys.moveForward) == GLFW_PRESS) moveDir += forwardDir;
-                if (glfwGetKey(window, keys.moveBackward) == GLFW_PRESS) moveDir -= forwardDir;
-                if (glfwGetKey(window, keys.moveRight) == GLFW_PRESS) moveDir += rightDir;
-                if (glfwGetKey(window, keys.moveLeft) == GLFW_PRESS) moveDir -= rightDir;
-                if (glfwGetKey(window, keys.moveUp) == GLFW_PRESS) moveDir += upDir;
-                if (glfwGetKey(window, keys.moveDown) == GLFW_PRESS) moveDir -= upDir;
+                if (actions & MoveForward) moveDir += forwardDir;
+                if (actions & MoveBackward) moveDir -= forwardDir;
+                if (actions & MoveRight) moveDir += rightDir;
+                if (actions & MoveLeft) moveDir -= rightDir;
+                if (actions & MoveUp) moveDir += upDir;
+                if (actions & MoveDown) moveDir -= upDir;
                     
                 if (glm::dot(moveDir, moveDir) > std::numeric_limits<float>::epsilon())
-                    gameObject.transform.translation += glm::normalize(moveDir) * moveSpeed * dt;
+                    transform.translation += glm::normalize(moveDir) * moveSpeed * dt;
             }
 
         
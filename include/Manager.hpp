@@ -2,6 +2,7 @@
 
 #include "Device.hpp"
 #include "RenderPass.hpp"
+#include "RenderGraph.hpp"
 #include "Descriptors.hpp"
 #include <vulkan/vulkan.h>
 
@@ -13,7 +14,10 @@
 
 #include <string>
 #include <array>
+#include <ostream>
 #include <unordered_map>
+#include <algorithm>
+#include <stdexcept>
 
 namespace Orasis {
 
@@ -23,14 +27,21 @@ namespace Orasis {
         private:
 
 
-            //TODO static map_manager["SSAO"]
-
             Device& m_device;
-            VkSwapchainKHR m_swapChain;
+            std::vector<VkImage> m_swapChainImages;
 
             std::unique_ptr<RenderPass> m_renderPass{};
+
+            // Occlusion culling or ambient occlusion only, compatible with m_renderPass (same framebuffers and pipelines)
+            std::unique_ptr<RenderPass> m_geometryOnlyPass{};
+            std::unique_ptr<RenderPass> m_resumePass{};
+            std::unique_ptr<RenderPass> m_resumeGeometryOnlyPass{};     // both of them
             std::unique_ptr<FrameBuffer> m_frameBuffer{};
 
+            // The frame the attachments take part in, their usages and the render pass' dependencies come from it.
+            // It owns the compute passes' images and records their barriers (executePass)
+            std::unique_ptr<RenderGraph> m_frameGraph{};
+
             std::unique_ptr<DescriptorPool> m_managerPool{};
             std::unique_ptr<Orasis::DescriptorSetLayout> m_managerDiscrSetLayout{};
             std::vector<VkDescriptorSet> m_managerDescriptorSets{};
@@ -39,6 +50,11 @@ namespace Orasis {
             VkExtent2D m_extent;
             VkFormat m_swapChainImageFormat;
             VkFormat m_depthFormat;
+            GBufferLayout m_gBufferLayout;
+            LightingPath m_lightingPath;
+            bool m_occlusionCulling;
+            bool m_dynamicResolution;
+            bool m_ambientOcclusion;
 
             std::unordered_map<std::string ,std::vector<std::shared_ptr<Image>>> m_imagesMap;
             std::vector<std::vector<std::shared_ptr<Image>>> m_imagesArray;
@@ -46,20 +62,37 @@ namespace Orasis {
             std::vector<AttachmentInfo> m_attachments;
             std::vector<std::vector<AttachmentInfo>> m_attachmentsPerSubpass;
 
+            // Read by the lighting subpass, binding i of the input attachment set is the i-th one
+            std::vector<AttachmentInfo> m_inputAttachments;
+
 
             uint32_t m_imageCount;
             
         public:
 
+            // Everything that depends on the swap chain size, handed back by resize() so the
+            // caller can keep it alive until the frames still using it are done
+            struct RetiredAttachments {
+                std::unique_ptr<FrameBuffer> frameBuffer{};
+                std::unique_ptr<DescriptorPool> pool{};
+                std::unordered_map<std::string, std::vector<std::shared_ptr<Image>>> imagesMap{};
+                std::vector<std::vector<std::shared_ptr<Image>>> imagesArray{};
+            };
+
             Manager(Device& device, ManagerInfo managerInfo)
             :m_device{device},
-             m_swapChain{managerInfo.swapChain},
+             m_swapChainImages{managerInfo.swapChainImages},
              m_swapChainImageFormat{managerInfo.swapChainFormat},
              m_depthFormat{managerInfo.depthFormat},
+             m_gBufferLayout{managerInfo.gBufferLayout},
+             m_lightingPath{managerInfo.lightingPath},
+             m_occlusionCulling{managerInfo.occlusionCulling},
+             m_dynamicResolution{managerInfo.dynamicResolution},
+             m_ambientOcclusion{managerInfo.ambientOcclusion},
              m_extent{managerInfo.extent}
             {
-                // Gets Vulkan lowest image count that it supports and choose the preffered imageCount
-                aquireImageCount();
+                // One copy of every attachment per swap chain image
+                m_imageCount = static_cast<uint32_t>(m_swapChainImages.size());
                 
                 initilizesAllocator();
 
@@ -70,16 +103,76 @@ namespace Orasis {
             
             void createDeffered()
             {
-                int maxFrameInFlight = 3;
+                setupAttachments();
+
+                createAttachmentImages();
+
+                realizeFrameGraph();
+
+                createRenderPass();
+
+                createFrameBuffer();
+            }
+
+            // Only the images (the frame graph's too), framebuffers and the input attachment sets depend on
+            // the extent, the render pass, set layout and allocator (and so every pipeline) are kept
+            RetiredAttachments resize(const std::vector<VkImage>& swapChainImages, VkExtent2D extent)
+            {
+                RetiredAttachments retired{};
+                retired.frameBuffer = std::move(m_frameBuffer);
+                retired.pool = std::move(m_managerPool);
+                retired.imagesMap = std::move(m_imagesMap);
+                retired.imagesArray = std::move(m_imagesArray);
 
-                // Set deffered Attachments
-                std::array<AttachmentInfo, 5> attachments = {
-                    AttachmentInfo("Positions", VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT),
-                    AttachmentInfo("Normal", VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT),
-                    AttachmentInfo("Albido", VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT),
-                    AttachmentInfo("Depth", m_depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, Attachment::Type::isDepth),
-                    AttachmentInfo("OutColor", m_swapChainImageFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, Attachment::Type::isPresented, 1)
-                };
+                m_imagesMap.clear();
+                m_imagesArray.clear();
+
+                m_swapChainImages = swapChainImages;
+                m_imageCount = static_cast<uint32_t>(m_swapChainImages.size());
+                m_extent = extent;
+
+                createAttachmentImages();
+                realizeFrameGraph();
+                createFrameBuffer();
+                createDescriptorSets();
+
+                return retired;
+            }
+
+            void setupAttachments()
+            {
+                // Set deffered Attachments, the shaders for each layout are picked by DefferedSystem
+                std::vector<AttachmentInfo> attachments;
+
+                switch (m_gBufferLayout)
+                {
+                    case GBufferLayout::Packed:
+                        attachments = {
+                            AttachmentInfo("Normal", VK_FORMAT_R16G16_SNORM, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT),
+                            AttachmentInfo("Albido", VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT),
+                            AttachmentInfo("Depth", m_depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT, Attachment::Type::isDepth),
+                            AttachmentInfo("OutColor", m_swapChainImageFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, Attachment::Type::isPresented, 1)
+                        };
+                        break;
+
+                    case GBufferLayout::Full:
+                        attachments = {
+                            AttachmentInfo("Positions", VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT),
+                            AttachmentInfo("Normal", VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT),
+                            AttachmentInfo("Albido", VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT),
+                            AttachmentInfo("Depth", m_depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, Attachment::Type::isDepth),
+                            AttachmentInfo("OutColor", m_swapChainImageFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, Attachment::Type::isPresented, 1)
+                        };
+                        break;
+                }
+
+                // The lighting subpass can't write the swap chain image when it only covers part of it,
+                // the Upscaler reads its result (LightingPath::Compute already lights into its own image)
+                if (m_dynamicResolution && m_lightingPath == LightingPath::Subpass)
+                    attachments.back() = AttachmentInfo("SceneColor", VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, Attachment::Type::isColor, 1);
+
+                // Usages follow from who reads what
+                describeFrame(attachments);
 
                 int totalSubpasses = attachments.back().s_subpass + 1;
                 m_attachmentsPerSubpass.resize(totalSubpasses);
@@ -91,72 +184,235 @@ namespace Orasis {
                     m_attachmentsPerSubpass[attachments[i].s_subpass].push_back(attachments[i]);
                 }
                 m_attachments.shrink_to_fit();
-                
-                m_imagesArray.resize(attachments.size());
 
-                // create Images
-                for(int attachIndex = 0; attachIndex < attachments.size(); attachIndex++){
+                // Same order RenderPass hands them to the lighting subpass in
+                for (const AttachmentInfo& attachment : m_attachmentsPerSubpass[0])
+                    if (attachment.s_type == Attachment::Type::isColor || (attachment.s_usage & VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT))
+                        m_inputAttachments.push_back(attachment);
+            }
+
+            void createAttachmentImages()
+            {
+                m_imagesArray.resize(m_attachments.size());
+
+                // The swap chain decides the image count, every G-buffer attachment gets one image per swap chain image
+                for (int attachIndex = 0; attachIndex < m_attachments.size(); attachIndex++)
+                    if (m_attachments[attachIndex].s_type == Attachment::Type::isPresented)
+                        createSwapChainImages(m_attachments[attachIndex], attachIndex);
+
+                // Not an attachment then, still kept under the same name for whoever writes it
+                if (m_imagesMap.find("OutColor") == m_imagesMap.end())
+                    createSwapChainImages(AttachmentInfo("OutColor", m_swapChainImageFormat, 0, Attachment::Type::isPresented), -1);
+
+                for (int attachIndex = 0; attachIndex < m_attachments.size(); attachIndex++)
+                {
+                    AttachmentInfo currAttachment = m_attachments[attachIndex];
+
+                    if (currAttachment.s_type == Attachment::Type::isPresented) continue;
+
+                    for (uint32_t i = 0; i < m_imageCount; i++)
+                        m_imagesMap[currAttachment.s_name].push_back(Image::createAttachment(m_device, m_allocator, m_extent, currAttachment));
 
-                    AttachmentInfo currAttachment = attachments[attachIndex];
+                    m_imagesArray[attachIndex] = m_imagesMap[currAttachment.s_name];
+                }
+            }
+
+            // After the attachments, they're imported into it. The graph creates its own images (aliased where
+            // their lifetimes allow), what it replaces on resize goes to the deletion queue
+            void realizeFrameGraph()
+            {
+                for (const auto& [name, images] : m_imagesMap)
+                {
+                    RenderGraph::Resource resource = m_frameGraph->find(name);
+                    if (resource == RenderGraph::invalidResource) continue;
+
+                    std::vector<VkImage> handles;
+                    std::vector<VkImageView> views;
+                    for (const std::shared_ptr<Image>& image : images)
+                    {
+                        handles.push_back(image->s_image);
+                        views.push_back(image->s_imageView);
+                    }
+
+                    m_frameGraph->setImported(resource, std::move(handles), std::move(views));
+                }
+
+                m_frameGraph->realize(m_device, m_allocator, m_extent, m_imageCount);
+            }
+
+            /*
+                The geometry and lighting subpasses, and the compute and transfer passes around them. The
+                deffered render pass is recorded by hand (Render), the others through executePass in the
+                order they're declared. The ones that run between a GeometryOnly and a Resume pass read the
+                same subpass' results with the same dependencies, so they're declared after it. Above, the
+                usage flags only say what the render pass itself does.
+            */
+            void describeFrame(std::vector<AttachmentInfo>& attachments)
+            {
+                m_frameGraph = std::make_unique<RenderGraph>();
 
-                    if(currAttachment.s_type == Attachment::Type::isPresented)
-                        createSwapChainImages(currAttachment, attachIndex);
+                std::vector<RenderGraph::Resource> resources;
+                for (const AttachmentInfo& attachment : attachments)
+                    resources.push_back(m_frameGraph->importImage(attachment.s_name, {attachment.s_format, attachment.s_type}));
 
-                    else{
+                // Not an attachment when the Upscaler writes it
+                RenderGraph::Resource outColor = m_frameGraph->find("OutColor");
+                if (outColor == RenderGraph::invalidResource)
+                    outColor = m_frameGraph->importImage("OutColor", {m_swapChainImageFormat, Attachment::Type::isPresented});
 
-                        for (int i = 0; i < maxFrameInFlight; i++)
-                        {
-                            m_imagesMap[currAttachment.s_name].push_back(Image::createAttachment(m_device, m_allocator, m_extent, currAttachment));
-                        }
+                RenderGraph::Resource depth = RenderGraph::invalidResource;
+                RenderGraph::Resource normal = m_frameGraph->find("Normal");
 
-                        m_imagesArray[attachIndex] = m_imagesMap[currAttachment.s_name];
+                RenderGraph::PassBuilder geometry = m_frameGraph->addPass("Geometry", RenderGraph::PassType::Graphics);
+                RenderGraph::PassBuilder lighting = m_frameGraph->addPass("Lighting", RenderGraph::PassType::Graphics);
+
+                for (size_t i = 0; i < attachments.size(); i++)
+                {
+                    const AttachmentInfo& attachment = attachments[i];
+                    bool isDepth = attachment.s_type == Attachment::Type::isDepth;
+
+                    if (isDepth)
+                        depth = resources[i];
+
+                    if (attachment.s_subpass != 0)
+                    {
+                        lighting.write(resources[i], RenderGraph::Usage::ColorAttachment);
+                        continue;
                     }
+
+                    geometry.write(resources[i], isDepth ? RenderGraph::Usage::DepthAttachment : RenderGraph::Usage::ColorAttachment);
+
+                    // Same order RenderPass hands them to the lighting subpass in
+                    if (!isDepth || (attachment.s_usage & VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT))
+                        lighting.read(resources[i], RenderGraph::Usage::InputAttachment);
                 }
-                
-                RenderPass::Builder builder (m_device);
 
-                for(int i = 0; i < attachments.size(); i++)
-                    builder.addSubpassAttachments(RenderPass::SubpassAttachment(attachments[i]));
-                
-                std::array<VkSubpassDependency, 2> subpassDependancies = {};
+                // The occlusion culling's depth pyramid is built from it between the two geometry passes. The
+                // pyramid is kept across frames and read per mip level, OcclusionCulling synchronizes it itself
+                if (m_occlusionCulling)
+                    m_frameGraph->addPass("DepthPyramid", RenderGraph::PassType::Compute)
+                        .read(depth, RenderGraph::Usage::Sampled)
+                        .keep();
+
+                // So is the ambient occlusion, from depth and normals, at half resolution (AmbientOcclusion::DOWNSCALE).
+                // The lighting subpass reads the blurred result but is declared before it, so it's an output then
+                RenderGraph::Resource ssaoBlurred = RenderGraph::invalidResource;
+
+                if (m_ambientOcclusion)
                 {
-                    // External -> Geometry subpass
-                    subpassDependancies[0].srcSubpass       = VK_SUBPASS_EXTERNAL;
-                    subpassDependancies[0].srcStageMask     = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-                    subpassDependancies[0].srcAccessMask    = VK_ACCESS_MEMORY_READ_BIT;
-                    
-                    // External - > dst -> Geometry Subpass index 0
-                    subpassDependancies[0].dstSubpass       = 0;
-                    subpassDependancies[0].dstStageMask     = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-                    subpassDependancies[0].dstAccessMask    = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-                    subpassDependancies[0].dependencyFlags  = VK_DEPENDENCY_BY_REGION_BIT;
-                    
-                    // Geometry subpass -> Lighting Subpass
-                    subpassDependancies[1].srcSubpass       = 0;
-                    subpassDependancies[1].srcStageMask     = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-                    subpassDependancies[1].srcAccessMask    = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-                    
-                    // Geometry Subpass index 0 -> Lighting Subpass index 1
-                    subpassDependancies[1].dstSubpass       = 1;
-                    subpassDependancies[1].dstStageMask     = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-                    subpassDependancies[1].dstAccessMask    = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
-                    subpassDependancies[1].dependencyFlags  = VK_DEPENDENCY_BY_REGION_BIT;
-                    
+                    RenderGraph::Resource ssao = m_frameGraph->createImage("SSAO", {VK_FORMAT_R16G16_SFLOAT, Attachment::Type::isColor, 2});
+                    ssaoBlurred = m_frameGraph->createImage("SSAOBlurred", {VK_FORMAT_R16G16_SFLOAT, Attachment::Type::isColor, 2});
+
+                    m_frameGraph->addPass("AmbientOcclusion", RenderGraph::PassType::Compute)
+                        .read(depth, RenderGraph::Usage::Sampled)
+                        .read(normal, RenderGraph::Usage::Sampled)
+                        .write(ssao, RenderGraph::Usage::Storage);
+
+                    m_frameGraph->addPass("AmbientOcclusionBlur", RenderGraph::PassType::Compute)
+                        .read(ssao, RenderGraph::Usage::Sampled)
+                        .write(ssaoBlurred, RenderGraph::Usage::Storage);
+
+                    if (m_lightingPath == LightingPath::Subpass)
+                        m_frameGraph->markOutput(ssaoBlurred, RenderGraph::Usage::Sampled);
                 }
+
+                // The compute lighting samples the G-buffer once the render pass is over, into an image cleared
+                // to the background first (only the classified tiles get shaded)
+                RenderGraph::Resource litColor = RenderGraph::invalidResource;
+
+                if (m_lightingPath == LightingPath::Compute)
+                {
+                    litColor = m_frameGraph->createImage("LitColor", {VK_FORMAT_R16G16B16A16_SFLOAT});
+
+                    m_frameGraph->addPass("TiledLightingClear", RenderGraph::PassType::Transfer)
+                        .write(litColor, RenderGraph::Usage::TransferDst);
+
+                    RenderGraph::PassBuilder tiled = m_frameGraph->addPass("TiledLighting", RenderGraph::PassType::Compute);
+
+                    for (size_t i = 0; i < attachments.size(); i++)
+                        if (attachments[i].s_subpass == 0)
+                            tiled.read(resources[i], RenderGraph::Usage::Sampled);
+
+                    if (ssaoBlurred != RenderGraph::invalidResource)
+                        tiled.read(ssaoBlurred, RenderGraph::Usage::Sampled);
+
+                    tiled.write(litColor, RenderGraph::Usage::Storage);
+
+                    if (!m_dynamicResolution)
+                        m_frameGraph->addPass("TiledLightingBlit", RenderGraph::PassType::Transfer)
+                            .read(litColor, RenderGraph::Usage::TransferSrc)
+                            .write(outColor, RenderGraph::Usage::TransferDst);
+                }
+
+                // From the compute lighting's image or the lighting subpass' output
+                if (m_dynamicResolution)
+                {
+                    RenderGraph::Resource upscaled = m_frameGraph->createImage("Upscaled", {VK_FORMAT_R16G16B16A16_SFLOAT});
+                    RenderGraph::Resource source = litColor != RenderGraph::invalidResource ? litColor : m_frameGraph->find("SceneColor");
+
+                    m_frameGraph->addPass("Upscale", RenderGraph::PassType::Compute)
+                        .read(source, RenderGraph::Usage::Sampled)
+                        .write(upscaled, RenderGraph::Usage::Storage);
+
+                    m_frameGraph->addPass("UpscaleBlit", RenderGraph::PassType::Transfer)
+                        .read(upscaled, RenderGraph::Usage::TransferSrc)
+                        .write(outColor, RenderGraph::Usage::TransferDst);
+                }
+
+                m_frameGraph->markOutput(outColor, RenderGraph::Usage::Present);
+                m_frameGraph->compile();
+
+                // The deffered pass is built by hand (RenderPass, for its load modes), it has to be the one the graph made
+                if (m_frameGraph->getSubpass("Lighting") != 1)
+                    throw std::runtime_error("failed to merge the lighting subpass into the geometry render pass");
+
+                for (size_t i = 0; i < attachments.size(); i++)
+                    attachments[i].s_usage = m_frameGraph->getUsage(resources[i]);
+            }
+
+            // Graphviz, see RenderGraph::dump
+            void dumpFrameGraph(std::ostream& out) const
+            {
+                m_frameGraph->dump(out, m_extent);
+            }
+
+            void createRenderPass()
+            {
+                m_renderPass = buildRenderPass(RenderPass::LoadMode::Clear);
+
+                // The ambient occlusion runs between the geometry and the lighting subpass when it's the subpass that lights
+                bool splitForAmbientOcclusion = m_ambientOcclusion && m_lightingPath == LightingPath::Subpass;
+
+                if (m_occlusionCulling || splitForAmbientOcclusion)
+                {
+                    m_geometryOnlyPass = buildRenderPass(RenderPass::LoadMode::GeometryOnly);
+                    m_resumePass = buildRenderPass(RenderPass::LoadMode::Resume);
+                }
+
+                // The occlusion culling's second geometry phase, ahead of the ambient occlusion
+                if (m_occlusionCulling && splitForAmbientOcclusion)
+                    m_resumeGeometryOnlyPass = buildRenderPass(RenderPass::LoadMode::ResumeGeometryOnly);
+            }
+
+            // Every mode gets the same dependencies (the frame graph's), they're part of what keeps the passes compatible
+            std::unique_ptr<RenderPass> buildRenderPass(RenderPass::LoadMode loadMode)
+            {
+                RenderPass::Builder builder (m_device);
+                builder.setLoadMode(loadMode);
+
+                for(int i = 0; i < m_attachments.size(); i++)
+                    builder.addSubpassAttachments(RenderPass::SubpassAttachment(m_attachments[i]));
                 
+                for (const VkSubpassDependency& dependency : m_frameGraph->getSubpassDependencies("Geometry"))
+                    builder.addSubpassDependency(dependency);
                 
-                for (int i = 0; i < subpassDependancies.size(); i++)
-                    builder.addSubpassDependency(subpassDependancies[i]);
-                
-                // create RenderPass
-                m_renderPass = builder.build();
-                
-                
-                // create FrameBuffer 
+                return builder.build();
+            }
+
+            void createFrameBuffer()
+            {
                 m_frameBuffer = std::make_unique<FrameBuffer>(m_device, m_renderPass->renderPass(), m_extent, m_imageCount);
                 m_frameBuffer->create(m_imagesArray);
-
-
             }
 
 
@@ -164,90 +420,99 @@ namespace Orasis {
             {
                 // ------------------- Descriptors ------------------- 
                 
-                m_managerPool = DescriptorPool::Builder(m_device)
-                .setMaxSets(2)
-                .addPoolSize(VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 3 * m_imageCount) 
-                .build();
+                DescriptorSetLayout::Builder builder(m_device);
+
+                for (uint32_t binding = 0; binding < m_inputAttachments.size(); binding++)
+                    builder.addBinding(binding, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT);
+
+                m_managerDiscrSetLayout = builder.build();
+
+                createDescriptorSets();
                 
-                m_managerDiscrSetLayout = DescriptorSetLayout::Builder(m_device)
-                .addBinding(0, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT)
-                .addBinding(1, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT)
-                .addBinding(2, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT)
+                // ------------------- End Descriptors ------------------- 
+            }
+
+            // One set per swap chain image, matching the framebuffer it's used with
+            void createDescriptorSets()
+            {
+                uint32_t inputCount = static_cast<uint32_t>(m_inputAttachments.size());
+
+                m_managerPool = DescriptorPool::Builder(m_device)
+                .setMaxSets(m_imageCount)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, inputCount * m_imageCount) 
                 .build();
                 
                 m_managerDescriptorSets.resize(m_imageCount);
 
+                std::vector<VkDescriptorImageInfo> imageInfos(inputCount);
+
                 for (int i = 0; i < m_imageCount; ++i) {
-                    VkDescriptorImageInfo posInfo{};
-                    posInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-                    posInfo.imageView = m_imagesMap["Positions"][0]->s_imageView;
-                    posInfo.sampler = VK_NULL_HANDLE;
-
-                    VkDescriptorImageInfo normInfo{};
-                    normInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-                    normInfo.imageView = m_imagesMap["Normal"][0]->s_imageView;
-                    normInfo.sampler = VK_NULL_HANDLE;
-
-                    VkDescriptorImageInfo albInfo{};
-                    albInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-                    albInfo.imageView = m_imagesMap["Albido"][0]->s_imageView;
-                    albInfo.sampler = VK_NULL_HANDLE;
-
-                    DescriptorWriter(*m_managerDiscrSetLayout, *m_managerPool)
-                        .writeImage(0, &posInfo)
-                        .writeImage(1, &normInfo)
-                        .writeImage(2, &albInfo)
-                        .build(m_managerDescriptorSets[i]);
-                }
 
+                    DescriptorWriter writer(*m_managerDiscrSetLayout, *m_managerPool);
 
-                
-                // ------------------- End Descriptors ------------------- 
+                    for (uint32_t binding = 0; binding < inputCount; binding++)
+                    {
+                        const AttachmentInfo& attachment = m_inputAttachments[binding];
+
+                        imageInfos[binding].imageLayout = attachment.s_type == Attachment::Type::isDepth ?
+                            VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+                        imageInfos[binding].imageView = m_imagesMap[attachment.s_name][i]->s_imageView;
+                        imageInfos[binding].sampler = VK_NULL_HANDLE;
+
+                        writer.writeImage(binding, &imageInfos[binding]);
+                    }
+
+                    writer.build(m_managerDescriptorSets[i]);
+                }
             }
             
             VkImage getImage(std::string name, int index)                           { return m_imagesMap[name][index]->s_image; }
             VkImageView getImageView(std::string name, int index)                   { return m_imagesMap[name][index]->s_imageView; }
             VkRenderPass getRenderPass()                                            { return m_renderPass->renderPass(); }
+            VkRenderPass getRenderPass(RenderPass::LoadMode loadMode)
+            {
+                switch (loadMode)
+                {
+                    case RenderPass::LoadMode::GeometryOnly:    return m_geometryOnlyPass->renderPass();
+                    case RenderPass::LoadMode::Resume:          return m_resumePass->renderPass();
+                    case RenderPass::LoadMode::ResumeGeometryOnly:  return m_resumeGeometryOnlyPass->renderPass();
+                    default:                                    return m_renderPass->renderPass();
+                }
+            }
             VkFramebuffer getFrameBuffer(int frameIndex)                            { return m_frameBuffer->getFrameBuffer(frameIndex); }
             size_t imageCount()                                                     { return m_imageCount; }
             size_t attachmentCount()                                                { return m_imagesArray.size(); }
             std::vector<AttachmentInfo> getAttachments()                            { return m_attachments; }
             std::vector<std::vector<AttachmentInfo>> getAttachmentsPerSubpass()     { return m_attachmentsPerSubpass; }
             size_t getAttachmentsCountPerSubpass(int frameIndex)                    { return m_attachmentsPerSubpass[frameIndex].size(); }
-            VkDescriptorSet getInputAttachmentDescriptorSet(int frameIndex)         { return m_managerDescriptorSets[frameIndex]; }
+            VkDescriptorSet getInputAttachmentDescriptorSet(int imageIndex)         { return m_managerDescriptorSets[imageIndex]; }
             DescriptorSetLayout& getInputAttachmentSetLayout()                      { return *m_managerDiscrSetLayout; }
-
-            void createSwapChainImages(AttachmentInfo attachment, uint32_t attachIndex)
+            GBufferLayout getGBufferLayout() const                                  { return m_gBufferLayout; }
+            LightingPath getLightingPath() const                                    { return m_lightingPath; }
+            bool usesOcclusionCulling() const                                       { return m_occlusionCulling; }
+            bool usesDynamicResolution() const                                      { return m_dynamicResolution; }
+            bool usesAmbientOcclusion() const                                       { return m_ambientOcclusion; }
+            VmaAllocator getAllocator() const                                       { return m_allocator; }
+            const RenderGraph& getFrameGraph() const                                { return *m_frameGraph; }
+
+            // attachIndex -1 for swap chain images that aren't part of the framebuffer
+            void createSwapChainImages(AttachmentInfo attachment, int attachIndex)
             {
-                std::vector<VkImage> swapchainImages;
-
-                vkGetSwapchainImagesKHR(m_device.device(), m_swapChain, &m_imageCount, nullptr);
-                swapchainImages.resize(m_imageCount);
-                vkGetSwapchainImagesKHR(m_device.device(), m_swapChain, &m_imageCount, swapchainImages.data());
-
-                for (auto& image : swapchainImages)
+                for (VkImage image : m_swapChainImages)
                     m_imagesMap[attachment.s_name].push_back(Image::wrapSwapchainImage(m_device, image, attachment.s_format));
 
-                m_imagesArray[attachIndex] = m_imagesMap[attachment.s_name];
+                if (attachIndex >= 0)
+                    m_imagesArray[attachIndex] = m_imagesMap[attachment.s_name];
 
             }
 
-            void aquireImageCount()
-            {
-
-                SwapChainSupportDetails swapChainSupport = m_device.getSwapChainSupport();
-
-                m_imageCount = swapChainSupport.capabilities.minImageCount + 1;
-
-                if (swapChainSupport.capabilities.maxImageCount > 0 &&
-                    m_imageCount > swapChainSupport.capabilities.maxImageCount) 
-                {
-                    m_imageCount = swapChainSupport.capabilities.maxImageCount;
-                }
-            }
-            
             ~Manager() {
 
+                // The graph retires its images and memory to the deletion queue, they need the allocator
+                m_frameGraph.reset();
+                m_device.deletionQueue().flush();
+
+                m_frameBuffer.reset();
                 m_imagesMap.clear();
                 m_imagesArray.clear();
 
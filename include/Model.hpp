@@ -2,10 +2,12 @@
 
 #include "Device.hpp"
 #include "Buffer.hpp"
+#include "Bounds.hpp"
 // #include "Texture.hpp"
 
 #include <glm/glm.hpp>
 
+#include <atomic>
 #include <memory>
 #include <unordered_map>
 #include <vector>
@@ -52,6 +54,17 @@ namespace Orasis {
                             };
                 }
 
+                // Position only stream (bindPositions), for passes that only write depth
+                static std::vector<VkVertexInputBindingDescription> getPositionBindingDescriptions()
+                {
+                    return {{0, sizeof(glm::vec3), VK_VERTEX_INPUT_RATE_VERTEX}};
+                }
+
+                static std::vector<VkVertexInputAttributeDescription> getPositionAttributeDescriptions()
+                {
+                    return {{0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0}};
+                }
+
                 bool operator==(const Vertex& other) const
                 {
                     return (position == other.position && color == other.color && normal == other.normal && uv == other.uv);
@@ -66,6 +79,9 @@ namespace Orasis {
 
                 void loadModel(const std::string& filepath);      
 
+                // Same as loadModel, for an .obj that was already read (no materials)
+                void loadModelFromMemory(const std::vector<char>& data);
+
             };
 
         private:
@@ -76,11 +92,20 @@ namespace Orasis {
             // Vertex Buffer, memory, count
             std::unique_ptr<Buffer> vertexBuffer;
             uint32_t vertexCount;
+
+            // Just the positions of vertexBuffer, tightly packed (12 instead of 44 bytes a vertex)
+            std::unique_ptr<Buffer> positionBuffer;
             
             // Index Buffer, memory, count
             std::unique_ptr<Buffer> indexBuffer;
             uint32_t indexCount;
 
+            // Object space bounds, used for culling and spatial queries
+            AABB m_bounds{};
+
+            // Small unique id for draw sort keys, lets consecutive draws of the same mesh share a bind
+            uint32_t m_sortId{nextSortId()};
+
             // std::shared_ptr<Texture> m_texture;
         
         public:    
@@ -90,9 +115,22 @@ namespace Orasis {
             : ors_Device{device}
             {
                 createVertexBuffers(builder.vertices);
+                createPositionBuffer(builder.vertices);
                 createIndexBuffers(builder.indices);
+                computeBounds(builder.vertices);
                 // createTexture(texfilepath);
             }
+
+            // Doesn't wait for the copies, the staging buffers end up in upload. Don't draw
+            // before the GPU got past upload.timelineValue.
+            Model(Device& device, const Builder& builder, PendingUpload& upload)
+            : ors_Device{device}
+            {
+                createVertexBuffers(builder.vertices, &upload);
+                createPositionBuffer(builder.vertices, &upload);
+                createIndexBuffers(builder.indices, &upload);
+                computeBounds(builder.vertices);
+            }
             
             ~Model() {}
             
@@ -104,7 +142,7 @@ namespace Orasis {
 
             // -------- FUNCTIONS -------- //
 
-            void createVertexBuffers(const std::vector<Vertex>& vertices)
+            void createVertexBuffers(const std::vector<Vertex>& vertices, PendingUpload* upload = nullptr)
             {
                 
                 vertexCount = static_cast<uint32_t>(vertices.size());
@@ -113,16 +151,16 @@ namespace Orasis {
                 uint32_t vertexSize = sizeof(vertices[0]);
                 VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
                 
-                Buffer stagingBuffer {
+                auto stagingBuffer = std::make_unique<Buffer>(
                     ors_Device,
                     vertexSize,
                     vertexCount,
                     VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                };
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+                );
                 
-                stagingBuffer.map();
-                stagingBuffer.writeToBuffer((void *)vertices.data());
+                stagingBuffer->map();
+                stagingBuffer->writeToBuffer((void *)vertices.data());
                 
                 
                 vertexBuffer = std::make_unique<Buffer>(
@@ -134,11 +172,55 @@ namespace Orasis {
                 );
 
                 // Copying from staging to local device buffer
-                ors_Device.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), bufferSize);
+                if (upload)
+                {
+                    uint64_t value = ors_Device.copyBufferAsync(stagingBuffer->getBuffer(), vertexBuffer->getBuffer(), bufferSize);
+                    upload->add(std::move(stagingBuffer), value);
+                }
+                else
+                    ors_Device.copyBuffer(stagingBuffer->getBuffer(), vertexBuffer->getBuffer(), bufferSize);
 
             }
                 
-            void createIndexBuffers(const std::vector<uint32_t>& indices)
+            void createPositionBuffer(const std::vector<Vertex>& vertices, PendingUpload* upload = nullptr)
+            {
+                std::vector<glm::vec3> positions(vertices.size());
+
+                for (size_t i = 0; i < vertices.size(); i++)
+                    positions[i] = vertices[i].position;
+
+                uint32_t positionSize = sizeof(glm::vec3);
+                VkDeviceSize bufferSize = sizeof(glm::vec3) * positions.size();
+
+                auto stagingBuffer = std::make_unique<Buffer>(
+                    ors_Device,
+                    positionSize,
+                    static_cast<uint32_t>(positions.size()),
+                    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+                );
+
+                stagingBuffer->map();
+                stagingBuffer->writeToBuffer((void *)positions.data());
+
+                positionBuffer = std::make_unique<Buffer>(
+                    ors_Device,
+                    positionSize,
+                    static_cast<uint32_t>(positions.size()),
+                    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+                );
+
+                if (upload)
+                {
+                    uint64_t value = ors_Device.copyBufferAsync(stagingBuffer->getBuffer(), positionBuffer->getBuffer(), bufferSize);
+                    upload->add(std::move(stagingBuffer), value);
+                }
+                else
+                    ors_Device.copyBuffer(stagingBuffer->getBuffer(), positionBuffer->getBuffer(), bufferSize);
+            }
+
+            void createIndexBuffers(const std::vector<uint32_t>& indices, PendingUpload* upload = nullptr)
             {
                 indexCount = static_cast<uint32_t>(indices.size());
                 hasIndexBuffer = indexCount > 0;
@@ -148,16 +230,16 @@ namespace Orasis {
                 uint32_t indexSize = sizeof(indices[0]);
                 VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
 
-                Buffer stagingBuffer {
+                auto stagingBuffer = std::make_unique<Buffer>(
                     ors_Device,
                     indexSize,
                     indexCount,
                     VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                };
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+                );
                 
-                stagingBuffer.map();
-                stagingBuffer.writeToBuffer((void *)indices.data());
+                stagingBuffer->map();
+                stagingBuffer->writeToBuffer((void *)indices.data());
                 
                 
                 indexBuffer = std::make_unique<Buffer>(
@@ -170,8 +252,31 @@ namespace Orasis {
                 
 
                 // Copying from staging to local device buffer
-                ors_Device.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), bufferSize);
+                if (upload)
+                {
+                    uint64_t value = ors_Device.copyBufferAsync(stagingBuffer->getBuffer(), indexBuffer->getBuffer(), bufferSize);
+                    upload->add(std::move(stagingBuffer), value);
+                }
+                else
+                    ors_Device.copyBuffer(stagingBuffer->getBuffer(), indexBuffer->getBuffer(), bufferSize);
+
+            }
+
+            void computeBounds(const std::vector<Vertex>& vertices)
+            {
+                m_bounds = AABB{};
 
+                for (const auto& vertex : vertices)
+                    m_bounds.expand(vertex.position);
+            }
+
+            const AABB& getBoundingBox() const { return m_bounds; }
+            uint32_t getSortId() const { return m_sortId; }
+
+            static uint32_t nextSortId()
+            {
+                static std::atomic<uint32_t> counter{0};
+                return counter++;
             }
 
             static std::unique_ptr<Model> createModelFromFile(Device& device, const std::string& filepath, const std::string& texfilepath = "")
@@ -179,7 +284,7 @@ namespace Orasis {
                 Builder builder;
                 builder.loadModel(filepath);
 
-                if (texfilepath._Equal(""))
+                if (texfilepath.empty())
                     return std::make_unique<Model>(device, builder, texfilepath);
                 
                 return std::make_unique<Model>(device, builder);
@@ -196,6 +301,17 @@ namespace Orasis {
                     vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
 
             }
+
+            // Same draws as after bind, with the pipelines of Vertex::getPositionBindingDescriptions
+            void bindPositions(VkCommandBuffer commandBuffer)
+            {
+                VkBuffer buffers[] = {positionBuffer->getBuffer()};
+                VkDeviceSize offsets[] = {0};
+                vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+
+                if (hasIndexBuffer)
+                    vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+            }
             
 
             void draw(VkCommandBuffer commandBuffer)
@@ -205,6 +321,18 @@ namespace Orasis {
                 else
                     vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
             }
+
+            // Index count, or vertex count without an index buffer
+            uint32_t getDrawCount() const { return hasIndexBuffer ? indexCount : vertexCount; }
+
+            // One command at offset, a VkDrawIndexedIndirectCommand (the first four fields double as the VkDrawIndirectCommand without an index buffer)
+            void drawIndirect(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset)
+            {
+                if (hasIndexBuffer)
+                    vkCmdDrawIndexedIndirect(commandBuffer, buffer, offset, 1, sizeof(VkDrawIndexedIndirectCommand));
+                else
+                    vkCmdDrawIndirect(commandBuffer, buffer, offset, 1, sizeof(VkDrawIndirectCommand));
+            }
                 
     };
             
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "Device.hpp"
+#include "SwapChain.hpp"
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+
+namespace Orasis {
+
+
+    /*
+        Depth test passing samples of the frame's geometry, per pixel of the render area, from
+        precise occlusion queries around the executed geometry secondaries. That is the G-buffer
+        writes of a frame without the depth pre-pass, or the pre-pass' own depth writes with it,
+        the same count either way. A query per geometry pass, occlusion culling has two.
+
+        Needs occlusionQueryPrecise and inheritedQueries, without them isSupported() is false and
+        nothing gets measured. Backend thread only, results are read like GpuTimer's.
+    */
+    class OverdrawCounter {
+
+        public:
+
+            static constexpr uint32_t QUERIES_PER_FRAME = 2;
+
+        private:
+
+            // -------- MEMBER VARIABLES -------- //
+
+            Device& m_device;
+
+            VkQueryPool m_queryPool{VK_NULL_HANDLE};
+
+            std::array<uint32_t, SwapChain::MAX_FRAMES_IN_FLIGHT> m_used{};        // queries ended in the slot's frame
+            std::array<uint64_t, SwapChain::MAX_FRAMES_IN_FLIGHT> m_pixels{};      // its render area
+            bool m_active{false};
+
+            // -------- -------- -------- -------- //
+
+        public:
+
+            // -------- CONSTRUCTOR etc -------- //
+
+            OverdrawCounter(Device& device)
+            :m_device{device}
+            {
+                if (!m_device.enabledFeatures.occlusionQueryPrecise || !m_device.enabledFeatures.inheritedQueries) return;
+
+                VkQueryPoolCreateInfo poolInfo{};
+                poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+                poolInfo.queryType = VK_QUERY_TYPE_OCCLUSION;
+                poolInfo.queryCount = QUERIES_PER_FRAME * SwapChain::MAX_FRAMES_IN_FLIGHT;
+
+                if (vkCreateQueryPool(m_device.device(), &poolInfo, nullptr, &m_queryPool) != VK_SUCCESS)
+                    throw std::runtime_error("failed to create occlusion query pool");
+            }
+
+            ~OverdrawCounter()
+            {
+                if (m_queryPool != VK_NULL_HANDLE)
+                    vkDestroyQueryPool(m_device.device(), m_queryPool, nullptr);
+            }
+
+            OverdrawCounter(const OverdrawCounter&) = delete;
+            OverdrawCounter &operator=(const OverdrawCounter&) = delete;
+
+            // -------- -------- -------- -------- //
+
+
+
+
+            // -------- FUNCTIONS -------- //
+
+            bool isSupported() const { return m_queryPool != VK_NULL_HANDLE; }
+
+            /*
+                Outside of a render pass, before the frame's first geometry pass. Returns the samples
+                per pixel of the previous frame recorded into this slot, or a negative value if there's
+                none to report. renderExtent is this frame's render area.
+            */
+            float reset(VkCommandBuffer commandBuffer, int frameIndex, VkExtent2D renderExtent)
+            {
+                if (!isSupported()) return -1.f;
+
+                float overdraw = -1.f;
+                uint32_t first = QUERIES_PER_FRAME * static_cast<uint32_t>(frameIndex);
+
+                if (m_used[frameIndex] > 0 && m_pixels[frameIndex] > 0)
+                {
+                    std::array<uint64_t, QUERIES_PER_FRAME> samples{};
+
+                    // FrameScheduler::beginFrame waited for that frame, not ready means it never ran
+                    if (vkGetQueryPoolResults(m_device.device(), m_queryPool, first, m_used[frameIndex], sizeof(samples), samples.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+                    {
+                        uint64_t total = 0;
+                        for (uint32_t i = 0; i < m_used[frameIndex]; i++)
+                            total += samples[i];
+
+                        overdraw = static_cast<float>(static_cast<double>(total) / static_cast<double>(m_pixels[frameIndex]));
+                    }
+                }
+
+                vkCmdResetQueryPool(commandBuffer, m_queryPool, first, QUERIES_PER_FRAME);
+                m_used[frameIndex] = 0;
+                m_pixels[frameIndex] = static_cast<uint64_t>(renderExtent.width) * renderExtent.height;
+
+                return overdraw;
+            }
+
+            // Inside the geometry subpass, the secondaries executed until end are counted
+            void begin(VkCommandBuffer commandBuffer, int frameIndex)
+            {
+                if (!isSupported() || m_used[frameIndex] >= QUERIES_PER_FRAME) return;
+
+                vkCmdBeginQuery(commandBuffer, m_queryPool, QUERIES_PER_FRAME * static_cast<uint32_t>(frameIndex) + m_used[frameIndex], VK_QUERY_CONTROL_PRECISE_BIT);
+                m_active = true;
+            }
+
+            void end(VkCommandBuffer commandBuffer, int frameIndex)
+            {
+                if (!m_active) return;
+
+                vkCmdEndQuery(commandBuffer, m_queryPool, QUERIES_PER_FRAME * static_cast<uint32_t>(frameIndex) + m_used[frameIndex]);
+                m_used[frameIndex]++;
+                m_active = false;
+            }
+    };
+
+}
@@ -73,6 +73,8 @@ namespace Orasis {
             else if (configInfo.PipelineCreationFlag == 2)
                 createLightingPipeline(vertFilePath, fragFilePath, configInfo);
 
+            else if (configInfo.PipelineCreationFlag == 3)
+                createDepthOnlyPipeline(vertFilePath, configInfo);
         }
         
         Pipeline(Device& ors_Device , const std::string& computeFilePath, const PipelineConfigInfo& configInfo)
@@ -83,21 +85,14 @@ namespace Orasis {
 
         Pipeline() = default;
 
+        // Shader modules belong to the device's shader cache
         ~Pipeline() 
         {
             if (computeShaderModule == nullptr)
-            {
-                vkDestroyShaderModule(ors_Device.device(), vertShaderModule, nullptr);
-                vkDestroyShaderModule(ors_Device.device(), fragShaderModule, nullptr);
                 vkDestroyPipeline(ors_Device.device(), graphicsPipeline, nullptr);
-            }
             else 
-            {
-                vkDestroyShaderModule(ors_Device.device(), computeShaderModule, nullptr);
                 vkDestroyPipeline(ors_Device.device(), computePipeline, nullptr);
 
-            }
-
         };
 
 
@@ -109,7 +104,10 @@ namespace Orasis {
 
         void bind(VkCommandBuffer commandBuffer)
         {
-            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+            if (computeShaderModule == nullptr)
+                vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+            else
+                vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
         }
 
 
@@ -201,27 +199,36 @@ namespace Orasis {
 
         }
 
-    
-        private:
-
-        static std::vector<char> readFile(const std::string& filePath)
+        // Shadow maps: no color attachments and no fragment stage, depth bias is set per pass (vkCmdSetDepthBias)
+        static void depthOnlyPipelineConfigInfo(PipelineConfigInfo& configInfo)
         {
-            std::ifstream file{filePath, std::ios::ate | std::ios::binary};
+            defaultPipelineConfigInfo(configInfo, 0);
+
+            configInfo.rasterizationInfo.depthBiasEnable = VK_TRUE;
+
+            configInfo.dynamicStateEnables.push_back(VK_DYNAMIC_STATE_DEPTH_BIAS);
+            configInfo.dynamicStateInfo.pDynamicStates = configInfo.dynamicStateEnables.data();
+            configInfo.dynamicStateInfo.dynamicStateCount = static_cast<uint32_t>(configInfo.dynamicStateEnables.size());
 
-            if(!file.is_open())
-                throw std::runtime_error("failed to open file: " + filePath);
+            configInfo.PipelineCreationFlag = 3; // 3 -> DepthOnlyPipeline
+        }
 
-            size_t filesize = static_cast<size_t>(file.tellg());
-            std::vector<char> buffer(filesize);
+        // Depth pre-pass inside the geometry subpass: its color attachments are kept but never written, positions only
+        static void depthPrepassConfigInfo(PipelineConfigInfo& configInfo, uint32_t colorAttachmentCount)
+        {
+            defaultPipelineConfigInfo(configInfo, colorAttachmentCount);
 
-            file.seekg(0);
-            file.read(buffer.data(), filesize);
+            for (auto& colorBlendAttachment : configInfo.colorBlendAttachments)
+                colorBlendAttachment.colorWriteMask = 0;
 
-            file.close();
+            configInfo.bindingDescriptions = Model::Vertex::getPositionBindingDescriptions();
+            configInfo.attributeDescriptions = Model::Vertex::getPositionAttributeDescriptions();
 
-            return buffer;
+            configInfo.PipelineCreationFlag = 3; // 3 -> DepthOnlyPipeline
         }
 
+    
+        private:
 
         void createGraphicsPipeline(const std::string& vertFilePath, const std::string& fragFilePath, const PipelineConfigInfo& configInfo)
         {
@@ -229,11 +236,8 @@ namespace Orasis {
             assert(configInfo.pipelineLayout != VK_NULL_HANDLE && "Cannot create graphics pipeline: no pipeline layout provided");
 
 
-            auto vertCode = readFile(vertFilePath);
-            auto fragCode = readFile(fragFilePath);
-
-            createShaderModule(vertCode, &vertShaderModule);
-            createShaderModule(fragCode, &fragShaderModule);
+            vertShaderModule = ors_Device.getShaderModule(vertFilePath);
+            fragShaderModule = ors_Device.getShaderModule(fragFilePath);
             
             VkPipelineShaderStageCreateInfo shaderStages[2];
 
@@ -284,7 +288,7 @@ namespace Orasis {
             pipelineInfo.basePipelineIndex = -1;
             pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-            if (vkCreateGraphicsPipelines(ors_Device.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
+            if (vkCreateGraphicsPipelines(ors_Device.device(), ors_Device.pipelineCache(), 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
                 throw std::runtime_error("failed to create graphics pipeline");
 
         }
@@ -293,11 +297,8 @@ namespace Orasis {
         {
             assert(configInfo.pipelineLayout != VK_NULL_HANDLE && "Cannot create graphics pipeline: no pipeline layout provided");
 
-            auto vertCode = readFile(vertFilePath);
-            auto fragCode = readFile(fragFilePath);
-
-            createShaderModule(vertCode, &vertShaderModule);
-            createShaderModule(fragCode, &fragShaderModule);
+            vertShaderModule = ors_Device.getShaderModule(vertFilePath);
+            fragShaderModule = ors_Device.getShaderModule(fragFilePath);
             
             VkPipelineShaderStageCreateInfo shaderStages[2];
 
@@ -348,7 +349,7 @@ namespace Orasis {
             pipelineInfo.basePipelineIndex = -1;
             pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-            if (vkCreateGraphicsPipelines(ors_Device.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
+            if (vkCreateGraphicsPipelines(ors_Device.device(), ors_Device.pipelineCache(), 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
                 throw std::runtime_error("failed to create graphics pipeline");
 
         }
@@ -358,11 +359,8 @@ namespace Orasis {
             assert(configInfo.pipelineLayout != VK_NULL_HANDLE && "Cannot create graphics pipeline: no pipeline layout provided");
 
 
-            auto vertCode = readFile(vertFilePath);
-            auto fragCode = readFile(fragFilePath);
-
-            createShaderModule(vertCode, &vertShaderModule);
-            createShaderModule(fragCode, &fragShaderModule);
+            vertShaderModule = ors_Device.getShaderModule(vertFilePath);
+            fragShaderModule = ors_Device.getShaderModule(fragFilePath);
             
             VkPipelineShaderStageCreateInfo shaderStages[2];
 
@@ -411,18 +409,68 @@ namespace Orasis {
             pipelineInfo.basePipelineIndex = -1;
             pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-            if (vkCreateGraphicsPipelines(ors_Device.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
+            if (vkCreateGraphicsPipelines(ors_Device.device(), ors_Device.pipelineCache(), 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
                 throw std::runtime_error("failed to create graphics pipeline");
 
         }
 
-        void createComputePipeline(const std::string& computeFilePath, const PipelineConfigInfo& configInfo)
+        void createDepthOnlyPipeline(const std::string& vertFilePath, const PipelineConfigInfo& configInfo)
         {
             assert(configInfo.pipelineLayout != VK_NULL_HANDLE && "Cannot create graphics pipeline: no pipeline layout provided");
 
-            auto computeCode = readFile(computeFilePath);
+            vertShaderModule = ors_Device.getShaderModule(vertFilePath);
+            fragShaderModule = nullptr;
+
+            // Depth is all it writes, so the vertex stage is the only one
+            VkPipelineShaderStageCreateInfo vertexStage{};
+            vertexStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            vertexStage.stage = VK_SHADER_STAGE_VERTEX_BIT;
+            vertexStage.module = vertShaderModule;
+            vertexStage.pName = "main";
+            vertexStage.flags = 0;
+            vertexStage.pNext = nullptr;
+            vertexStage.pSpecializationInfo = nullptr;
 
-            createShaderModule(computeCode, &computeShaderModule);
+            auto& bindingDescriptions = configInfo.bindingDescriptions;
+            auto& attributeDescriptions = configInfo.attributeDescriptions;
+
+            VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+            vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+            vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
+            vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+            vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
+            vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+
+
+            VkGraphicsPipelineCreateInfo pipelineInfo{};
+            pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+            pipelineInfo.stageCount = 1;
+            pipelineInfo.pStages = &vertexStage;
+            pipelineInfo.pVertexInputState = &vertexInputInfo;
+            pipelineInfo.pInputAssemblyState = &configInfo.inputAssemblyInfo;
+            pipelineInfo.pViewportState = &configInfo.viewportInfo;
+            pipelineInfo.pRasterizationState = &configInfo.rasterizationInfo;
+            pipelineInfo.pMultisampleState = &configInfo.multisampleInfo;
+            pipelineInfo.pColorBlendState = &configInfo.colorBlendInfo;
+            pipelineInfo.pDepthStencilState = &configInfo.depthStencilInfo;
+            pipelineInfo.pDynamicState = &configInfo.dynamicStateInfo;
+
+            pipelineInfo.layout = configInfo.pipelineLayout;
+            pipelineInfo.renderPass = configInfo.renderPass;
+            pipelineInfo.subpass = configInfo.subpass;
+
+            pipelineInfo.basePipelineIndex = -1;
+            pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+            if (vkCreateGraphicsPipelines(ors_Device.device(), ors_Device.pipelineCache(), 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
+                throw std::runtime_error("failed to create depth only pipeline");
+        }
+
+        void createComputePipeline(const std::string& computeFilePath, const PipelineConfigInfo& configInfo)
+        {
+            assert(configInfo.pipelineLayout != VK_NULL_HANDLE && "Cannot create graphics pipeline: no pipeline layout provided");
+
+            computeShaderModule = ors_Device.getShaderModule(computeFilePath);
 
             VkPipelineShaderStageCreateInfo computeStage{};
             computeStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -438,20 +486,8 @@ namespace Orasis {
             computeCreateInfo.stage = computeStage;
             computeCreateInfo.layout = configInfo.pipelineLayout;
 
-            if (vkCreateComputePipelines(ors_Device.device(), VK_NULL_HANDLE, 1, &computeCreateInfo, nullptr, &computePipeline) != VK_SUCCESS)
+            if (vkCreateComputePipelines(ors_Device.device(), ors_Device.pipelineCache(), 1, &computeCreateInfo, nullptr, &computePipeline) != VK_SUCCESS)
                 throw std::runtime_error("failed to create compute pipeline");
-        }   
-
-        void createShaderModule(const std::vector<char>& code,  VkShaderModule* shaderModule)
-        {
-            VkShaderModuleCreateInfo createInfo{};
-            
-            createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-            createInfo.codeSize = code.size();
-            createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-
-            if (vkCreateShaderModule(ors_Device.device(), &createInfo, nullptr, shaderModule))
-                throw std::runtime_error("failed to create shader module");
         }
     };
 
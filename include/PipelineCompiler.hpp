@@ -0,0 +1,103 @@
+#pragma once
+
+#include "Pipeline.hpp"
+#include "JobSystem.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Orasis {
+
+
+    /*
+        Builds Pipelines as background jobs on the engine's JobSystem. request() returns right
+        away with a handle that resolves to a Pipeline once the job is done with it, until then
+        get() returns null and the caller draws with a fallback pipeline instead of waiting.
+
+        request/get/release are meant to be called from the render thread only. vkCreateGraphicsPipelines
+        and the device's pipeline/shader caches are safe to use from several threads at once.
+    */
+    class PipelineCompiler {
+
+        public:
+
+            using Handle = uint32_t;
+            static constexpr Handle invalidHandle = UINT32_MAX;
+
+        private:
+
+            enum class State : uint8_t {
+                Queued,
+                Compiling,
+                Ready,
+                Failed,
+            };
+
+            struct Entry {
+                std::string vertPath{};
+                std::string fragPath{};
+                std::unique_ptr<PipelineConfigInfo> config{};
+
+                std::unique_ptr<Pipeline> pipeline{};
+                std::atomic<State> state{State::Queued};
+                std::string error{};
+
+                JobCounter done{};
+            };
+
+            // -------- MEMBER VARIABLES -------- //
+
+            Device& m_device;
+            JobSystem& m_jobs;
+
+            // Only resized under the mutex, jobs hold on to their Entry itself
+            std::vector<std::unique_ptr<Entry>> m_entries{};
+            std::vector<Handle> m_freeHandles{};
+            std::mutex m_mutex;
+
+            std::atomic<uint64_t> m_completedCount{0};
+
+            // -------- -------- -------- -------- //
+
+        public:
+
+            PipelineCompiler(Device& device, JobSystem& jobs);
+            ~PipelineCompiler();
+
+            PipelineCompiler(const PipelineCompiler&) = delete;
+            PipelineCompiler &operator=(const PipelineCompiler&) = delete;
+
+            // config has to be filled in already (defaultPipelineConfigInfo etc), the compiler keeps it
+            // alive until the pipeline is built since it points into itself
+            Handle request(const std::string& vertFilePath, const std::string& fragFilePath, std::unique_ptr<PipelineConfigInfo> config);
+
+            // nullptr while the pipeline is still compiling (or failed)
+            Pipeline* get(Handle handle) const;
+
+            Pipeline* getOr(Handle handle, Pipeline* fallback) const
+            {
+                Pipeline* pipeline = get(handle);
+                return pipeline != nullptr ? pipeline : fallback;
+            }
+
+            bool isReady(Handle handle) const { return get(handle) != nullptr; }
+
+            // Blocks (running other jobs meanwhile) until the pipeline is built, throws if it failed to compile
+            Pipeline& wait(Handle handle);
+
+            // Waits for an in flight compile, then hands the pipeline to the device's deletion queue
+            void release(Handle handle);
+
+            // Increases whenever a pipeline finishes, lets users notice that variants became available
+            uint64_t completedCount() const { return m_completedCount.load(std::memory_order_acquire); }
+
+        private:
+
+            void compile(Entry& entry);
+    };
+
+}
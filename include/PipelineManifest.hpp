@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace Orasis {
+
+
+    /*
+        Everything a pipeline was requested with besides its fixed function state: the shaders, the
+        config fields that pick its create path and the names of the render pass and layout it was
+        built for (handles change every run). depthEqual and geometryVariant are the G-buffer's.
+    */
+    struct PipelineRecord {
+
+        std::string vertPath{};
+        std::string fragPath{};             // empty for vertex only pipelines
+        uint8_t creationFlag{0};            // PipelineConfigInfo::PipelineCreationFlag
+        uint32_t subpass{0};
+        uint32_t colorAttachmentCount{0};
+        std::string renderPass{};
+        std::string layout{};
+        bool depthEqual{false};             // after the depth pre-pass
+        bool geometryVariant{false};        // from a GeometryVariant, not the default G-buffer shaders
+
+        bool operator==(const PipelineRecord& other) const = default;
+    };
+
+
+    /*
+        The pipelines the engine requested, persisted as one tab separated line per record in
+        PipelineRecord's field order. Whoever owns the render pass and layout of a record replays
+        it through the PipelineCompiler once they exist, so the next launch compiles everything the
+        last one ended up using in the background (the pipeline cache makes that cheap).
+        It only grows, a stale entry costs one extra background compile.
+    */
+    class PipelineManifest {
+
+        std::vector<PipelineRecord> m_records{};
+        bool m_changed{false};
+
+        public:
+
+        // Lines missing a field (older manifests only had the paths) are skipped
+        void load(const std::string& filePath)
+        {
+            std::ifstream file{filePath};
+
+            if (!file.is_open()) return;
+
+            std::string line;
+
+            while (std::getline(file, line))
+            {
+                std::istringstream fields{line};
+                PipelineRecord record{};
+                std::string creationFlag, subpass, colorAttachmentCount, depthEqual, geometryVariant;
+
+                bool complete =
+                    std::getline(fields, record.vertPath, '\t') &&
+                    std::getline(fields, record.fragPath, '\t') &&
+                    std::getline(fields, creationFlag, '\t') &&
+                    std::getline(fields, subpass, '\t') &&
+                    std::getline(fields, colorAttachmentCount, '\t') &&
+                    std::getline(fields, record.renderPass, '\t') &&
+                    std::getline(fields, record.layout, '\t') &&
+                    std::getline(fields, depthEqual, '\t') &&
+                    std::getline(fields, geometryVariant, '\t');
+
+                if (!complete || record.vertPath.empty()) continue;
+
+                try
+                {
+                    record.creationFlag = static_cast<uint8_t>(std::stoul(creationFlag));
+                    record.subpass = static_cast<uint32_t>(std::stoul(subpass));
+                    record.colorAttachmentCount = static_cast<uint32_t>(std::stoul(colorAttachmentCount));
+                }
+                catch (const std::exception&)
+                {
+                    continue;
+                }
+
+                record.depthEqual = depthEqual == "1";
+                record.geometryVariant = geometryVariant == "1";
+
+                m_records.push_back(std::move(record));
+            }
+
+            m_changed = false;
+        }
+
+        void save(const std::string& filePath)
+        {
+            if (!m_changed) return;
+
+            std::ofstream file{filePath, std::ios::trunc};
+
+            if (!file.is_open()) return;
+
+            for (const PipelineRecord& record : m_records)
+                file << record.vertPath << '\t' << record.fragPath << '\t'
+                     << static_cast<uint32_t>(record.creationFlag) << '\t' << record.subpass << '\t' << record.colorAttachmentCount << '\t'
+                     << record.renderPass << '\t' << record.layout << '\t'
+                     << (record.depthEqual ? 1 : 0) << '\t' << (record.geometryVariant ? 1 : 0) << '\n';
+
+            m_changed = false;
+        }
+
+        // Returns true if the record wasn't known yet
+        bool record(const PipelineRecord& record)
+        {
+            for (const PipelineRecord& known : m_records)
+                if (known == record) return false;
+
+            m_records.push_back(record);
+            m_changed = true;
+            return true;
+        }
+
+        const std::vector<PipelineRecord>& records() const { return m_records; }
+    };
+
+}
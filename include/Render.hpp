@@ -2,11 +2,20 @@
 
 #include "Pipeline.hpp"
 #include "SwapChain.hpp"
+#include "FrameScheduler.hpp"
+#include "FramePacer.hpp"
+#include "GpuTimer.hpp"
+#include "FrameDump.hpp"
+#include "DynamicResolution.hpp"
+#include "RenderFrontend.hpp"
 // #include "Frame_Info.hpp"
 
 #include "Render_Systems/DefferedSystem.hpp"
 
+#include <atomic>
+#include <chrono>
 #include <memory>
+#include <thread>
 #include <vector>
 #include <stdexcept>
 #include <array>
@@ -14,6 +23,16 @@
 namespace Orasis {
 
 
+    /*
+        Frontend / backend split. The thread that owns the Render (main) opens a frame, fills
+        in its camera and submits DrawPackets (any thread may, see RenderFrontend), then
+        publishes it. The backend thread acquires, sorts and records it into Vulkan commands,
+        submits and presents, while the frontend already builds the next frame.
+
+        Everything Vulkan after construction happens on the backend thread, it has its own
+        command pool. Setters that change backend state either go through atomics or wait for
+        the backend to go idle first.
+    */
     class Render {
 
         // -------- MEMBER VARIABLES -------- //
@@ -21,9 +40,38 @@ namespace Orasis {
 
         Window& ors_Window;
         Device& ors_Device;
+        JobSystem& ors_Jobs;
         
         std::shared_ptr<SwapChain> ors_SwapChain;
 
+        // Outlives swap chains, paces frames on the device timeline
+        std::unique_ptr<FrameScheduler> frameScheduler;
+
+        // Frame limiter / low latency start, and the latency stats
+        std::unique_ptr<FramePacer> framePacer;
+
+        std::atomic<VkPresentModeKHR> presentMode{VK_PRESENT_MODE_IMMEDIATE_KHR};
+        std::atomic<bool> presentModeChanged{false};
+
+        // What the current swap chain ended up with, for the frontend
+        std::atomic<VkPresentModeKHR> activePresentMode{VK_PRESENT_MODE_FIFO_KHR};
+        std::atomic<float> aspectRatio{1.f};
+
+        // -------- FRONTEND THREAD -------- //
+        RenderFrontend frontend{};
+        std::chrono::steady_clock::time_point nextFrameStart{};
+        bool staticDrawsDirty{false};
+        ShadowPlanner shadowPlanner{};
+
+        // -------- BACKEND THREAD -------- //
+        std::thread backendThread{};
+        VkCommandPool commandPool{VK_NULL_HANDLE};
+
+        // Indexed by DrawPacket::model, filled from RenderFrontend::registerModel
+        std::vector<std::shared_ptr<Model>> models{};
+        DrawList mergedDraws{};
+        bool swapChainDirty{false};
+
         std::vector<std::unique_ptr<Buffer>> uniformBuffers;
         std::unique_ptr<DescriptorPool> globalPool{};
         std::unique_ptr<Orasis::DescriptorSetLayout> globalDiscrSetLayout{};
@@ -32,6 +80,23 @@ namespace Orasis {
 
         std::vector<VkCommandBuffer> commandBuffers;
 
+        // Outlives the DefferedSystem (recreated with the swap chain), variants get re-requested from it
+        std::unique_ptr<PipelineCompiler> pipelineCompiler;
+        std::vector<GeometryVariant> geometryVariants{};
+        GBufferLayout gBufferLayout;
+        LightingPath lightingPath;
+        bool occlusionCulling;
+        bool ambientOcclusion;
+        DepthPrepassSettings depthPrepass;
+
+        // Dynamic resolution, null timer when it's off
+        DynamicResolution dynamicResolution;
+        std::unique_ptr<GpuTimer> gpuTimer{};
+        std::atomic<float> renderScale{1.f};
+
+        // Headless only, null unless frames get written to disk
+        std::unique_ptr<FrameDump> frameDump{};
+
         uint32_t currentImageIndex;
         int currentFrameIndex {0};
         bool isFrameStarted {false};
@@ -46,18 +111,49 @@ namespace Orasis {
 
         // -------- CONSTRUCTOR etc -------- //
 
-        Render(Window& window, Device& device)
-        :ors_Window{window}, ors_Device{device}
+        Render(Window& window, Device& device, JobSystem& jobs, GBufferLayout gBufferLayout = GBufferLayout::Packed, LightingPath lightingPath = LightingPath::Subpass, bool occlusionCulling = false, const DynamicResolutionSettings& resolution = {}, bool ambientOcclusion = false, const DepthPrepassSettings& depthPrepass = {})
+        :ors_Window{window}, ors_Device{device}, ors_Jobs{jobs}, gBufferLayout{gBufferLayout}, lightingPath{lightingPath}, occlusionCulling{occlusionCulling}, ambientOcclusion{ambientOcclusion}, depthPrepass{depthPrepass},
+         dynamicResolution{resolution, SwapChain::MAX_FRAMES_IN_FLIGHT}
         {
+            if (dynamicResolution.isEnabled())
+                gpuTimer = std::make_unique<GpuTimer>(ors_Device);
+
+            frameScheduler = std::make_unique<FrameScheduler>(ors_Device, SwapChain::MAX_FRAMES_IN_FLIGHT, SwapChain::DEFAULT_FRAMES_IN_FLIGHT);
+            framePacer = std::make_unique<FramePacer>(ors_Device);
+
+            pipelineCompiler = std::make_unique<PipelineCompiler>(ors_Device, ors_Jobs);
+
+            createCommandPool();
             createUboDescriptors();
-            recreateSwapChain();
+
+            // Still on the main thread here, so it may wait for the window to get an area
+            while (!recreateSwapChain())
+                glfwWaitEvents();
+
             createCommandBuffers();
 
+            backendThread = std::thread(&Render::backendLoop, this);
         }
 
         ~Render()
         {
+            frontend.stop();
+            if (backendThread.joinable())
+                backendThread.join();
+
+            vkDeviceWaitIdle(ors_Device.device());
+
+            if (frameDump)
+                frameDump->flush();
+
+            // The retired attachments need the Manager's allocator alive, the system's
+            // pipelines and cached secondaries go after that (the latter into our pool)
+            ors_Device.deletionQueue().flush();
+            defferedSys.reset();
+            ors_Device.deletionQueue().flush();
+
             freeCommandBuffers();
+            vkDestroyCommandPool(ors_Device.device(), commandPool, nullptr);
         }
 
         Render(const Render&) = delete;
@@ -73,10 +169,273 @@ namespace Orasis {
 
         public:
 
-        VkCommandBuffer beginFrame()
+        // Call before sampling input, blocks as long as the limiter / low latency mode asks for
+        void waitForNextFrame()
+        {
+            nextFrameStart = framePacer->waitForFrameStart();
+        }
+
+        // Frontend thread. Blocks while the backend is more than one frame behind, fill in the
+        // camera and submit draws, then endFrame()
+        RenderFrame& beginFrame()
+        {
+            RenderFrame& frame = frontend.beginFrame();
+
+            frame.startTime = nextFrameStart;
+            frame.invalidateStaticDraws = staticDrawsDirty;
+            staticDrawsDirty = false;
+
+            return frame;
+        }
+
+        // Any thread, between beginFrame and endFrame
+        void submit(uint32_t model, const glm::mat4& transform, uint64_t sortKey, uint32_t id, uint32_t flags = 0, uint32_t material = 0)
+        {
+            frontend.submit(model, transform, sortKey, id, flags, material);
+        }
+
+        // Any thread, between beginFrame and endFrame. Shaded by the clustered lighting pass, beyond ClusteredLighting::MAX_LIGHTS they are dropped.
+        void submitLight(const PointLight& light)
+        {
+            frontend.submitLight(light);
+        }
+
+        /*
+            Frontend thread, after the frame's camera is set. Fits the sun's cascades and works out
+            which shadow views are stale (frame.shadows.staticDirty / pointDirty), the caller then
+            submits casters for them with submitShadowCaster. points are the shadowed point lights
+            by slot, PointLight::shadow refers to the same slots.
+        */
+        const ShadowFrame& updateShadows(RenderFrame& frame, const DirectionalLight& sun, const std::array<PointShadow, ShadowConfig::POINT_LIGHTS>& points)
+        {
+            frame.shadows.sun = sun;
+            frame.shadows.points = points;
+
+            shadowPlanner.plan(frame.shadows, frame.camera, frame.invalidateStaticDraws, defferedSys->getShadowCacheState());
+
+            return frame.shadows;
+        }
+
+        // Any thread, between beginFrame and endFrame. views are ShadowCaster::cascadeBit / pointBit of the views it was culled into.
+        void submitShadowCaster(uint32_t model, const glm::mat4& transform, uint32_t views, uint32_t flags = 0)
+        {
+            frontend.submitShadowCaster(model, transform, views, flags);
+        }
+
+        // Hands the frame to the backend
+        void endFrame()
+        {
+            frontend.endFrame();
+        }
+
+        // Models have to be registered before packets refer to them
+        void registerModel(std::shared_ptr<Model> model)
+        {
+            frontend.registerModel(std::move(model));
+        }
+
+        // Backend done with everything published and the GPU idle
+        void waitIdle()
+        {
+            frontend.waitForBackend();
+            vkDeviceWaitIdle(ors_Device.device());
+        }
+        
+        // Applied by the backend with the next frame
+        void invalidateStaticDraws()
+        {
+            staticDrawsDirty = true;
+        }
+
+        // Compiles in the background, never stalls a frame (only waits for the backend to be between frames)
+        uint32_t addGeometryVariant(const std::string& vertPath, const std::string& fragPath)
+        {
+            frontend.waitForBackend();
+
+            geometryVariants.push_back({vertPath, fragPath});
+            return defferedSys->addGeometryVariant(geometryVariants.back());
+        }
+
+        // Headless only. Every frame from the next one on is written to directory as PPM, see FrameDump
+        void dumpFrames(const std::string& directory)
+        {
+            frontend.waitForBackend();
+
+            if (!ors_SwapChain->isOffscreen())
+                throw std::runtime_error("failed to dump frames, swap chain images can't be read back (needs --headless)");
+
+            frameDump = std::make_unique<FrameDump>(ors_Device, directory);
+        }
+
+        // Between 1 and SwapChain::MAX_FRAMES_IN_FLIGHT, waits for the GPU to drain
+        void setFramesInFlight(uint32_t count)
+        {
+            frontend.waitForBackend();
+            frameScheduler->setFramesInFlight(count);
+        }
+
+        uint32_t getFramesInFlight() const { return frameScheduler->framesInFlight(); }
+
+        // FIFO for tear free pacing (kiosk), IMMEDIATE/MAILBOX for latency. Applied after the current frame.
+        void setPresentMode(VkPresentModeKHR mode)
+        {
+            if (mode == presentMode.load()) return;
+            presentMode = mode;
+            presentModeChanged = true;
+        }
+
+        VkPresentModeKHR getPresentMode() const { return activePresentMode.load(); }
+
+        // 0 = unlimited
+        void setTargetFps(double fps) { framePacer->setTargetFps(fps); }
+
+        // Delays input sampling to just before the GPU can start on the frame
+        void setLowLatency(bool enabled) { framePacer->setLowLatency(enabled); }
+
+        FrameStats getFrameStats() const { return framePacer->stats(); }
+
+        // Any thread, fraction of the swap chain's width and height the scene renders at
+        float getRenderScale() const { return renderScale.load(); }
+
+        // Any thread, all zero without occlusion culling
+        OcclusionStats getOcclusionStats() const { return defferedSys->getOcclusionStats(); }
+
+        // Graphviz of the deffered pass and what reads its attachments, see RenderGraph::dump
+        void dumpRenderGraph(std::ostream& out) const { defferedSys->dumpFrameGraph(out); }
+
+        // Any thread, smoothed samples per pixel the geometry writes and whether the depth pre-pass is on
+        float getOverdraw() const { return defferedSys->getOverdraw(); }
+        bool usesDepthPrepass() const { return defferedSys->usesDepthPrepass(); }
+
+        // Any subsystem can check if the GPU got past a submission without blocking
+        bool isGpuComplete(uint64_t timelineValue) { return ors_Device.isTimelineComplete(timelineValue); }
+
+        float getAspectRatio() const 
+        {
+            return aspectRatio.load();
+        }
+        
+        VkRenderPass getSwapChainDefferedRenderPass() const 
+        {
+            return defferedSys->def_Manager->getRenderPass(); 
+        }
+
+        private:
+
+        // *************** Backend thread *********************
+
+        void backendLoop()
+        {
+            try
+            {
+                while (const RenderFrame* frame = frontend.acquireFrame())
+                {
+                    frontend.takeNewModels(models);
+                    frontend.gatherDraws(*frame, mergedDraws);
+
+                    renderFrame(*frame);
+
+                    frontend.releaseFrame(*frame);
+                }
+            }
+            catch (...)
+            {
+                // Surfaces on the frontend thread
+                frontend.fail(std::current_exception());
+            }
+        }
+
+        void renderFrame(const RenderFrame& frame)
+        {
+            if (frame.invalidateStaticDraws)
+                defferedSys->invalidateStaticDraws();
+
+            VkCommandBuffer commandBuffer = beginGpuFrame();
+
+            // Minimized or the swap chain was just recreated, the frame is dropped
+            if (commandBuffer == nullptr) return;
+
+            UBO_struct ubo{};
+            ubo.projection = frame.camera.getProjection();
+            ubo.view = frame.camera.getViewMatrix();
+            ubo.cameraPos = frame.camera.getCameraPos();
+            ubo.inverseViewProjection = glm::inverse(ubo.projection * ubo.view);
+            updateBuffer(ubo);
+
+            // Shadow maps and the compute, have to be outside of the render pass
+            defferedSys->renderShadows(commandBuffer, currentFrameIndex, frame.shadows, mergedDraws, models);
+            defferedSys->assignLights(commandBuffer, currentFrameIndex, mergedDraws, frame.camera);
+
+            defferedSys->prepareGeometry(commandBuffer, currentFrameIndex, mergedDraws, models, {globalDescriptorSets[currentFrameIndex]}, ubo.projection * ubo.view);
+
+            // Occlusion culling splits the geometry: what the previous frame's depth let through, this
+            // frame's depth pyramid, then whatever that uncovered and the lighting in the Resume pass.
+            // Ambient occlusion lit by the subpass splits the lighting off the geometry, it runs in between.
+            bool occlusionBeforeLighting = defferedSys->usesAmbientOcclusion() && !defferedSys->usesComputeLighting();
+
+            if (defferedSys->usesOcclusionCulling() || occlusionBeforeLighting)
+            {
+                startSwapChainRenderPass(commandBuffer, RenderPass::LoadMode::GeometryOnly);
+                defferedSys->renderGeometryOnly(commandBuffer, currentFrameIndex);
+                endSwapChainRenderPass(commandBuffer);
+
+                if (defferedSys->usesOcclusionCulling())
+                {
+                    defferedSys->cullDisoccluded(commandBuffer, currentFrameIndex, currentImageIndex);
+
+                    if (occlusionBeforeLighting)
+                    {
+                        startSwapChainRenderPass(commandBuffer, RenderPass::LoadMode::ResumeGeometryOnly);
+                        defferedSys->renderGeometryOnly(commandBuffer, currentFrameIndex);
+                        endSwapChainRenderPass(commandBuffer);
+                    }
+                }
+
+                if (occlusionBeforeLighting)
+                    defferedSys->renderAmbientOcclusion(commandBuffer, currentImageIndex, globalDescriptorSets[currentFrameIndex]);
+
+                startSwapChainRenderPass(commandBuffer, RenderPass::LoadMode::Resume);
+            }
+            else
+                startSwapChainRenderPass(commandBuffer);
+
+            // With the ambient occlusion in between, the geometry is all drawn by now
+            defferedSys->defferedRender(commandBuffer, currentFrameIndex, {globalDescriptorSets[currentFrameIndex]}, currentImageIndex, !occlusionBeforeLighting);
+            endSwapChainRenderPass(commandBuffer);
+
+            if (defferedSys->usesComputeLighting())
+            {
+                if (defferedSys->usesAmbientOcclusion())
+                    defferedSys->renderAmbientOcclusion(commandBuffer, currentImageIndex, globalDescriptorSets[currentFrameIndex]);
+
+                defferedSys->renderTiledLighting(commandBuffer, currentFrameIndex, currentImageIndex, globalDescriptorSets[currentFrameIndex]);
+            }
+
+            if (defferedSys->usesDynamicResolution())
+                defferedSys->upscale(commandBuffer, currentImageIndex);
+
+            endGpuFrame(frame.startTime);
+        }
+
+        VkCommandBuffer beginGpuFrame()
         {
+            if (swapChainDirty && !recreateSwapChain())
+            {
+                // No area to render to, don't spin (the frontend keeps pumping window events)
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                return nullptr;
+            }
 
-            auto result = ors_SwapChain->acquireNextImage(&currentImageIndex);
+            currentFrameIndex = frameScheduler->beginFrame();
+
+            // The slot's previous frame is done, its copy can be written
+            if (frameDump)
+                frameDump->collect(currentFrameIndex);
+
+            // Non-blocking, frees whatever the GPU is done with
+            ors_Device.deletionQueue().collect(ors_Device.completedTimelineValue());
+
+            auto result = ors_SwapChain->acquireNextImage(frameScheduler->imageAvailable(), &currentImageIndex);
 
             if (result == VK_ERROR_OUT_OF_DATE_KHR)
             {
@@ -87,7 +446,10 @@ namespace Orasis {
             if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
                 throw std::runtime_error("failed to aquire swap chain image");
 
+            frameScheduler->waitForImage(currentImageIndex);
+
             isFrameStarted = true;
+            ors_Device.deletionQueue().beginFrame();
 
             VkCommandBuffer commandBuffer = getCurrentCommandBuffer();
             
@@ -96,6 +458,15 @@ namespace Orasis {
             
             if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
                 throw std::runtime_error("failed to begin command buffer");
+
+            if (gpuTimer)
+            {
+                // Without timestamp support the timeline based estimate has to do
+                float gpuMs = gpuTimer->isSupported() ? gpuTimer->begin(commandBuffer, currentFrameIndex) : framePacer->stats().gpuMs;
+
+                if (dynamicResolution.update(gpuMs))
+                    applyRenderScale();
+            }
             
 
             return commandBuffer;
@@ -103,7 +474,7 @@ namespace Orasis {
         }
         
 
-        void startSwapChainRenderPass(VkCommandBuffer commandBuffer)
+        void startSwapChainRenderPass(VkCommandBuffer commandBuffer, RenderPass::LoadMode loadMode = RenderPass::LoadMode::Clear)
         {
             assert(isFrameStarted && "Can't call beginSwapChainRenderPass if frame is not in progress");
             assert(
@@ -113,10 +484,10 @@ namespace Orasis {
 
             VkRenderPassBeginInfo renderPassInfo{};
             renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-            renderPassInfo.renderPass = defferedSys->def_Manager->getRenderPass();
+            renderPassInfo.renderPass = defferedSys->def_Manager->getRenderPass(loadMode);
             renderPassInfo.framebuffer = defferedSys->def_Manager->getFrameBuffer(currentImageIndex);
             renderPassInfo.renderArea.offset = {0, 0};
-            renderPassInfo.renderArea.extent = ors_SwapChain->getSwapChainExtent();
+            renderPassInfo.renderArea.extent = defferedSys->getRenderExtent();
 
             // DEFFERED
             std::vector<VkClearValue> clearValues{};
@@ -132,26 +503,11 @@ namespace Orasis {
             // renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
             // renderPassInfo.pClearValues = clearValues.data();
             
-            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-            VkViewport viewport{};
-            viewport.x = 0.0f;
-            viewport.y = 0.0f;
-            viewport.width = static_cast<float>(ors_SwapChain->getSwapChainExtent().width);
-            viewport.height = static_cast<float>(ors_SwapChain->getSwapChainExtent().height);
-            viewport.minDepth = 0.0f;
-            viewport.maxDepth = 1.0f;
-
-            VkRect2D scissor{{0, 0}, ors_SwapChain->getSwapChainExtent()};
-
-            vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-            vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+            // The geometry subpass only takes secondaries, viewport/scissor are set by DefferedSystem
+            // since executing secondaries leaves the primary's dynamic state undefined
+            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
         }
 
-        void render(FrameInfo& frameInfo)
-        {
-            defferedSys->defferedRender(frameInfo, {globalDescriptorSets[currentFrameIndex]});
-        }
-        
         void endSwapChainRenderPass(VkCommandBuffer commandBuffer)
         {
 
@@ -164,20 +520,34 @@ namespace Orasis {
             
         }
 
-        void endFrame()
+        void endGpuFrame(std::chrono::steady_clock::time_point frameStart)
         {
             assert(isFrameStarted && "Can't call end frame while frame hasn't started");
             VkCommandBuffer commandBuffer = getCurrentCommandBuffer();
 
+            if (gpuTimer)
+                gpuTimer->end(commandBuffer, currentFrameIndex);
+
+            // After the timer, the read back isn't part of the frame's GPU time
+            if (frameDump)
+                frameDump->record(commandBuffer, currentFrameIndex, ors_SwapChain->getImages()[currentImageIndex],
+                    ors_SwapChain->getSwapChainImageFormat(), ors_SwapChain->getSwapChainExtent());
+
             if(vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
                 throw std::runtime_error("failed to record command buffer");
             
             // Submit command buffer for 
-            VkResult result = ors_SwapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex);
+            uint64_t frameValue = frameScheduler->submit(&commandBuffer, 1, currentImageIndex);
+            ors_Device.deletionQueue().endFrame(frameValue);
+            framePacer->frameSubmitted(frameValue, frameStart);
 
-            if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || ors_Window.wasWindowResized())
+            VkResult result = ors_SwapChain->present(frameScheduler->renderFinished(), &currentImageIndex);
+            frameScheduler->advance();
+
+            if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || ors_Window.wasWindowResized() || presentModeChanged)
             {
                 ors_Window.resetWindowResizedFlag();
+                presentModeChanged = false;
                 recreateSwapChain();
             }
             else if (result != VK_SUCCESS)
@@ -185,7 +555,6 @@ namespace Orasis {
                 
 
             isFrameStarted = false;
-            currentFrameIndex = (currentFrameIndex + 1) % SwapChain::MAX_FRAMES_IN_FLIGHT;
             
         }
 
@@ -217,7 +586,7 @@ namespace Orasis {
             // Configuring Descriptor Layout Info
             globalDiscrSetLayout = 
                     DescriptorSetLayout::Builder(ors_Device)
-                        .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
+                        .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT)
                         .build();
             
             globalDescriptorSets.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
@@ -258,10 +627,7 @@ namespace Orasis {
             return ors_SwapChain->getRenderPass(); 
         }
         
-        VkRenderPass getSwapChainDefferedRenderPass() const 
-        {
-            return defferedSys->def_Manager->getRenderPass(); 
-        }
+
 
         size_t getAttachmentCountPerSubpass(int index)
         {
@@ -274,10 +640,7 @@ namespace Orasis {
             return currentFrameIndex;
         }
 
-        float getAspectRatio() const 
-        {
-            return ors_SwapChain->extentAspectRatio();
-        }
+
 
         int getSwapChainImages()
         {   
@@ -292,14 +655,25 @@ namespace Orasis {
             return ors_SwapChain->getInputAttachmentSetLayout();
         }
 
-        VkImageView getPosImageView(int index) { return ors_SwapChain->getPositionImageViews(index); }
         VkImageView getNormalImageView(int index) { return ors_SwapChain->getNormalImageViews(index); }
         VkImageView getAlbidoImageView(int index) { return ors_SwapChain->getAlbedoImageViews(index); }
         
 
-        private:
+        // *************** ----------------- *********************
 
 
+        void createCommandPool()
+        {
+            VkCommandPoolCreateInfo poolInfo{};
+            poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            poolInfo.queueFamilyIndex = ors_Device.findPhysicalQueueFamilies().graphicsFamily;
+            poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+            // The device's pool is used by other threads (uploads), this one only by the backend
+            if (vkCreateCommandPool(ors_Device.device(), &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+                throw std::runtime_error("failed to create command pool");
+        }
+
         void createCommandBuffers()
         {
 
@@ -308,7 +682,7 @@ namespace Orasis {
             VkCommandBufferAllocateInfo commandBufferAllocInfo{};
             commandBufferAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
             commandBufferAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-            commandBufferAllocInfo.commandPool = ors_Device.getCommandPool();
+            commandBufferAllocInfo.commandPool = commandPool;
             commandBufferAllocInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
 
             if (vkAllocateCommandBuffers(ors_Device.device(), &commandBufferAllocInfo, commandBuffers.data()) != VK_SUCCESS)
@@ -317,35 +691,57 @@ namespace Orasis {
     
         }
 
-        void recreateSwapChain()
+        // false (and retried with the next frame) while the window has no area
+        bool recreateSwapChain()
         {
             VkExtent2D extent = ors_Window.getExtent();
 
-            while(extent.width == 0 || extent.height == 0)
+            swapChainDirty = extent.width == 0 || extent.height == 0;
+            if (swapChainDirty) return false;
+
+            // First call, nothing to replace
+            if (ors_SwapChain == nullptr)
             {
-                extent = ors_Window.getExtent();
-                glfwWaitEvents();
+                ors_SwapChain = std::make_shared<SwapChain>(ors_Device, extent, presentMode.load());
+                frameScheduler->resetImages(ors_SwapChain->imageCount());
+                defferedSys = std::make_unique<DefferedSystem>(ors_Device, *pipelineCompiler, commandPool, globalDiscrSetLayout->getDescriptorSetLayout(), ors_SwapChain, geometryVariants, gBufferLayout, lightingPath, occlusionCulling, dynamicResolution.isEnabled(), ambientOcclusion, depthPrepass);
+                applyRenderScale();
+                publishSwapChainInfo();
+                return true;
             }
 
-            vkDeviceWaitIdle(ors_Device.device());
-            ors_SwapChain = nullptr;
-            ors_SwapChain = std::make_unique<SwapChain>(ors_Device, extent);
+            // Frames are paced by the timeline, not the swap chain, so nothing waits on the GPU here.
+            // Pipelines, render pass and layouts survive, only the sized attachments get rebuilt.
+            std::shared_ptr<SwapChain> oldSwapChain = std::move(ors_SwapChain);
+            ors_SwapChain = std::make_shared<SwapChain>(ors_Device, extent, oldSwapChain, presentMode.load());
+            frameScheduler->resetImages(ors_SwapChain->imageCount());
             
-            if (ors_SwapChain == nullptr) {
-                ors_SwapChain = std::make_unique<SwapChain>(ors_Device, extent);
-            }
-            else {
+            if (!oldSwapChain->compareSwapFormats(*ors_SwapChain.get())) 
+                throw std::runtime_error("Swap chain image(or depth) format has changed!");
 
-                std::shared_ptr<SwapChain> oldSwapChain = std::move(ors_SwapChain);
-                ors_SwapChain = std::make_unique<SwapChain>(ors_Device, extent, oldSwapChain);
-                
-                if (!oldSwapChain->compareSwapFormats(*ors_SwapChain.get())) 
-                  throw std::runtime_error("Swap chain image(or depth) format has changed!");
-                
-            }
-            
-            defferedSys = std::make_unique<DefferedSystem>(ors_Device, globalDiscrSetLayout->getDescriptorSetLayout(), ors_SwapChain);
-            
+            auto oldAttachments = std::make_shared<Manager::RetiredAttachments>(defferedSys->resize(ors_SwapChain));
+
+            // Attachments go first, their framebuffers wrap the old swap chain images
+            ors_Device.deletionQueue().retire(std::move(oldAttachments));
+            ors_Device.deletionQueue().retire(std::move(oldSwapChain));
+
+            applyRenderScale();
+            publishSwapChainInfo();
+            return true;
+        }
+
+        void applyRenderScale()
+        {
+            if (!dynamicResolution.isEnabled()) return;
+
+            defferedSys->setRenderExtent(dynamicResolution.renderExtent(ors_SwapChain->getSwapChainExtent()));
+            renderScale = dynamicResolution.getScale();
+        }
+
+        void publishSwapChainInfo()
+        {
+            aspectRatio = ors_SwapChain->extentAspectRatio();
+            activePresentMode = ors_SwapChain->getPresentMode();
         }
 
         void getClearValues(std::vector<VkClearValue>& clearValues)
@@ -369,7 +765,7 @@ namespace Orasis {
       
         void freeCommandBuffers()
         {
-            vkFreeCommandBuffers(ors_Device.device(), ors_Device.getCommandPool(), commandBuffers.size(), commandBuffers.data());
+            vkFreeCommandBuffers(ors_Device.device(), commandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
         }
 
 
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "Camera.hpp"
+#include "DrawPacket.hpp"
+#include "Model.hpp"
+#include "Shadows.hpp"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Orasis {
+
+
+    // Everything one thread submitted for one frame
+    struct DrawList {
+        std::vector<DrawPacket> packets{};
+        std::vector<glm::mat4> transforms{};
+        std::vector<PointLight> lights{};
+        std::vector<ShadowCaster> casters{};
+
+        void clear()
+        {
+            packets.clear();
+            transforms.clear();
+            lights.clear();
+            casters.clear();
+        }
+    };
+
+    // Per frame state that isn't a draw, filled in on the frontend thread between beginFrame and endFrame
+    struct RenderFrame {
+        uint64_t number{0};
+        Camera camera{};
+        float dt{0.f};
+        bool invalidateStaticDraws{false};
+        ShadowFrame shadows{};                                  // see Render::updateShadows
+        std::chrono::steady_clock::time_point startTime{};      // input sampled, see FramePacer
+    };
+
+
+    /*
+        Hand-off between the threads that decide what to draw and the backend thread that talks
+        to Vulkan. The frontend thread opens a frame, any number of threads submit DrawPackets
+        into it, the frontend thread publishes it and the backend records it while the next one
+        is being built. So the backend runs (at most) one frame behind.
+
+        Every submitting thread gets its own DrawList per frame slot, submit() never locks or
+        touches shared state. All submissions of a frame have to be done before endFrame (join
+        the jobs first). Only the once per frame hand-off itself takes a lock.
+    */
+    class RenderFrontend {
+
+        public:
+
+            static constexpr uint32_t MAX_THREADS = 64;
+
+        private:
+
+            // Own cache lines, producers on different threads never share one
+            struct alignas(64) ThreadQueue {
+                std::array<DrawList, 2> lists{};
+            };
+
+            // -------- MEMBER VARIABLES -------- //
+
+            const uint32_t m_instance;
+
+            std::unique_ptr<ThreadQueue[]> m_threads;
+            std::atomic<uint32_t> m_threadCount{0};
+
+            std::array<RenderFrame, 2> m_frames{};
+
+            // Frame the producers are writing, frontend thread moves it in endFrame
+            std::atomic<uint64_t> m_building{1};
+
+            std::mutex m_mutex;
+            std::condition_variable m_changed;
+            uint64_t m_published{0};
+            uint64_t m_consumed{0};
+            bool m_stopping{false};
+            std::exception_ptr m_error{};
+
+            std::mutex m_modelMutex;
+            std::vector<std::shared_ptr<Model>> m_newModels{};
+
+            // -------- -------- -------- -------- //
+
+        public:
+
+            RenderFrontend();
+
+            RenderFrontend(const RenderFrontend&) = delete;
+            RenderFrontend &operator=(const RenderFrontend&) = delete;
+
+            // -------- Frontend thread -------- //
+
+            // Blocks while the backend still works on the frame that used the same slot (two back)
+            RenderFrame& beginFrame();
+            void endFrame();
+
+            // Returns once everything published has been recorded and submitted
+            void waitForBackend();
+
+            // -------- Any thread -------- //
+
+            // Between beginFrame and endFrame
+            void submit(uint32_t model, const glm::mat4& transform, uint64_t sortKey, uint32_t id, uint32_t flags = 0, uint32_t material = 0);
+            void submitLight(const PointLight& light);
+            void submitShadowCaster(uint32_t model, const glm::mat4& transform, uint32_t views, uint32_t flags = 0);
+
+            // Keeps the model alive for the backend, packets refer to it by Model::getSortId()
+            void registerModel(std::shared_ptr<Model> model);
+
+            // -------- Backend thread -------- //
+
+            // Next published frame, nullptr once stopped
+            const RenderFrame* acquireFrame();
+
+            // All threads' packets, lights and casters of the acquired frame in one list, transform indices rebased onto merged.transforms
+            void gatherDraws(const RenderFrame& frame, DrawList& merged);
+
+            // Newly registered models go to models[sortId]
+            void takeNewModels(std::vector<std::shared_ptr<Model>>& models);
+
+            // The frame's slot can be built into again
+            void releaseFrame(const RenderFrame& frame);
+
+            void stop();
+
+            // Rethrown on the frontend thread by the next beginFrame / waitForBackend
+            void fail(std::exception_ptr error);
+
+        private:
+
+            DrawList& threadList();
+            void rethrowError();
+    };
+
+}
@@ -0,0 +1,284 @@
+#pragma once
+
+#include "Device.hpp"
+#include "Frame_Info.hpp"
+#include <vulkan/vulkan.h>
+
+#include "vk_mem_alloc.h"
+
+// std
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Orasis {
+
+
+    /*
+        Declarative description of a frame. Passes say which images they read and write and how,
+        compile() works out the rest:
+          - passes nothing needed depends on are culled, keep() the ones with effects the graph doesn't see
+          - consecutive graphics passes that only read each other's results at the same pixel (input
+            attachments) become subpasses of one render pass, the tile stays on chip on tilers
+          - layouts, load/store ops, subpass dependencies, and the barriers between everything else
+          - images the graph owns are transient: the ones that never leave a render pass get lazily
+            allocated memory, the others share memory with images whose lifetimes don't overlap
+
+        Imported images are owned elsewhere (swap chain, anything kept past the frame), the graph only
+        synchronizes them. Passes run in the order they were added, the frame wraps around: the first
+        use of an image is synchronized against every use of it (or of what it aliases) in the last one.
+
+        realize() creates the Vulkan objects for an extent and a number of copies (one per swap chain
+        image), execute() records one copy. A renderer that records its own render pass (and so its
+        own order around it) runs the compute and transfer passes one at a time with executePass(),
+        each gets the barriers the graph derived for it. dump() writes the graph as Graphviz with
+        each pass' memory.
+    */
+    class RenderGraph {
+
+        public:
+
+            using Resource = uint32_t;
+            static constexpr Resource invalidResource = UINT32_MAX;
+            static constexpr uint32_t none = UINT32_MAX;
+
+            enum class PassType {
+                Graphics,
+                Compute,
+                Transfer
+            };
+
+            enum class Usage {
+                ColorAttachment,
+                DepthAttachment,
+                InputAttachment,    // read at the same pixel by a graphics pass, lets the writer and the reader merge
+                Sampled,
+                Storage,            // GENERAL, may be read and written
+                TransferSrc,
+                TransferDst,
+                Present             // markOutput only
+            };
+
+            struct ImageDesc {
+                VkFormat format{VK_FORMAT_UNDEFINED};
+                Attachment::Type type{Attachment::Type::isColor};
+                uint32_t downscale{1};          // of the extent, rounded up
+            };
+
+            // Layout, and the stages and accesses anything after it has to wait for
+            struct State {
+                VkImageLayout layout{VK_IMAGE_LAYOUT_UNDEFINED};
+                VkPipelineStageFlags stages{0};
+                VkAccessFlags access{0};
+            };
+
+            struct Barrier {
+                Resource resource;
+                State src;
+                State dst;
+            };
+
+            // Records the pass, graphics passes are already in their subpass. copy is execute()'s
+            using ExecuteFn = std::function<void(VkCommandBuffer commandBuffer, uint32_t copy)>;
+
+            class PassBuilder {
+
+                RenderGraph& m_graph;
+                uint32_t m_pass;
+
+                public:
+
+                PassBuilder(RenderGraph& graph, uint32_t pass)
+                :m_graph{graph}, m_pass{pass}
+                {}
+
+                // Input, Sampled, Storage or TransferSrc
+                PassBuilder& read(Resource resource, Usage usage);
+
+                // ColorAttachment, DepthAttachment, Storage or TransferDst
+                PassBuilder& write(Resource resource, Usage usage);
+
+                // Never culled, for passes that write buffers or images the graph doesn't know about
+                PassBuilder& keep();
+
+                PassBuilder& execute(ExecuteFn execute);
+            };
+
+        private:
+
+            struct Access {
+                Resource resource;
+                Usage usage;
+                bool write;
+            };
+
+            struct PassNode {
+                std::string name;
+                PassType type;
+                std::vector<Access> accesses{};
+                ExecuteFn execute{};
+                bool keep{false};
+                bool culled{false};
+                uint32_t group{none};
+                uint32_t subpass{0};
+            };
+
+            struct ResourceNode {
+                std::string name;
+                ImageDesc desc;
+                bool imported;
+
+                bool output{false};
+                Usage outputUsage{Usage::Sampled};
+
+                // Filled by compile()
+                VkImageUsageFlags usage{0};
+                uint32_t firstGroup{none};
+                uint32_t lastGroup{none};
+                bool transient{false};          // lazily allocated, only lives inside one render pass
+                uint32_t aliasSlot{none};       // graph owned and not transient
+            };
+
+            // One render pass, or a single compute / transfer pass
+            struct Group {
+                std::vector<uint32_t> passes{};
+                bool renderPass{false};
+                uint32_t downscale{1};
+
+                std::vector<Resource> attachments{};
+                std::vector<VkAttachmentDescription> descriptions{};
+                std::vector<VkSubpassDependency> dependencies{};
+
+                // Recorded before the group begins
+                std::vector<Barrier> barriers{};
+
+                // Recorded after it, into the output states of the outputs it used last
+                std::vector<Barrier> outputBarriers{};
+            };
+
+            // -------- MEMBER VARIABLES -------- //
+
+            std::vector<PassNode> m_passes{};
+            std::vector<ResourceNode> m_resources{};
+            std::vector<Group> m_groups{};
+            uint32_t m_aliasSlots{0};
+            bool m_compiled{false};
+
+            // realize()
+            Device* m_device{nullptr};
+            VmaAllocator m_allocator{VK_NULL_HANDLE};
+            VkExtent2D m_extent{};
+            uint32_t m_copies{0};
+
+            std::vector<std::vector<VkImage>> m_images{};           // [resource][copy], imported ones too
+            std::vector<std::vector<VkImageView>> m_views{};
+            std::vector<VkRenderPass> m_renderPasses{};             // [group], null for compute / transfer
+            std::vector<std::vector<VkFramebuffer>> m_framebuffers{};  // [group][copy]
+            std::vector<VmaAllocation> m_allocations{};             // alias slots and transient images, every copy
+
+            // -------- -------- -------- -------- //
+
+        public:
+
+            // -------- CONSTRUCTOR etc -------- //
+
+            RenderGraph() = default;
+            ~RenderGraph();
+
+            RenderGraph(const RenderGraph&) = delete;
+            RenderGraph &operator=(const RenderGraph&) = delete;
+
+            // -------- -------- -------- -------- //
+
+
+
+
+            // -------- FUNCTIONS -------- //
+
+            // ---- Declaration, before compile() ----
+
+            Resource createImage(const std::string& name, const ImageDesc& desc);
+            Resource importImage(const std::string& name, const ImageDesc& desc);
+
+            // Needed after the graph, in the state usage leaves it (PRESENT_SRC for Present)
+            void markOutput(Resource resource, Usage usage);
+
+            PassBuilder addPass(const std::string& name, PassType type);
+
+            Resource find(const std::string& name) const;
+
+            void compile();
+
+            // ---- Results of compile() ----
+
+            bool isCulled(const std::string& pass) const                { return m_passes[passIndex(pass)].culled; }
+            uint32_t getSubpass(const std::string& pass) const          { return m_passes[passIndex(pass)].subpass; }
+            VkImageUsageFlags getUsage(Resource resource) const         { return m_resources[resource].usage; }
+            bool isTransient(Resource resource) const                   { return m_resources[resource].transient; }
+            uint32_t getAliasSlot(Resource resource) const              { return m_resources[resource].aliasSlot; }
+
+            // Of the render pass the graphics pass ended up in
+            const std::vector<VkSubpassDependency>& getSubpassDependencies(const std::string& pass) const;
+
+            // The layout that render pass leaves resource in
+            VkImageLayout getFinalLayout(const std::string& pass, Resource resource) const;
+
+            // Recorded before the pass (its render pass for graphics passes), and after it
+            const std::vector<Barrier>& getBarriers(const std::string& pass) const;
+            const std::vector<Barrier>& getOutputBarriers(const std::string& pass) const;
+
+            // Graphviz. extent sizes the images, the memory of each pass is what's alive while it runs
+            void dump(std::ostream& out, VkExtent2D extent) const;
+
+            // ---- Vulkan objects ----
+
+            // One image and view per copy, before realize()
+            void setImported(Resource resource, std::vector<VkImage> images, std::vector<VkImageView> views);
+
+            /*
+                Again on resize, what it replaces is retired to the device's deletion queue. A render
+                pass none of whose passes has an execute function is recorded by hand, it gets no
+                render pass or framebuffers here and execute() only records the barriers around it.
+            */
+            void realize(Device& device, VmaAllocator allocator, VkExtent2D extent, uint32_t copies);
+
+            void execute(VkCommandBuffer commandBuffer, uint32_t copy) const;
+
+            // A compute or transfer pass on its own: its barriers, record (the pass' execute if empty),
+            // then the outputs it was the last to use. Records nothing for a culled pass
+            void executePass(VkCommandBuffer commandBuffer, const std::string& pass, uint32_t copy, const ExecuteFn& record = {}) const;
+
+            VkRenderPass getRenderPass(const std::string& pass) const;
+            VkImage getImage(Resource resource, uint32_t copy) const            { return m_images[resource][copy]; }
+            VkImageView getImageView(Resource resource, uint32_t copy) const    { return m_views[resource][copy]; }
+
+        private:
+
+            uint32_t passIndex(const std::string& pass) const;
+            const Group& compiledGroup(const std::string& pass) const;
+            Resource addResource(const std::string& name, const ImageDesc& desc, bool imported);
+
+            void cullPasses();
+            void mergePasses();
+            bool canMerge(const Group& group, const PassNode& pass) const;
+            void assignLifetimes();
+            void assignAliasSlots();
+            void synchronize();
+
+            State stateOf(Usage usage, PassType type, const ResourceNode& resource) const;
+            State frameEntryState(Resource resource) const;
+            VkDeviceSize estimateSize(const ResourceNode& resource, VkExtent2D extent) const;
+            VkExtent2D extentOf(uint32_t downscale, VkExtent2D extent) const;
+
+            bool recordedByHand(const Group& group) const;
+            void recordBarriers(VkCommandBuffer commandBuffer, uint32_t copy, const std::vector<Barrier>& barriers) const;
+
+            void createImages();
+            void createRenderPasses();
+            void createFramebuffers();
+            void retire();
+    };
+
+}
@@ -19,6 +19,18 @@ namespace Orasis {
         
         public:
 
+            /*
+                Only the load/store ops and layouts differ between the modes, so the render passes
+                they build are compatible: framebuffers, pipelines and secondaries made for one
+                work with the others.
+            */
+            enum class LoadMode {
+                Clear,          // everything starts cleared, the whole frame in one pass
+                GeometryOnly,   // first subpass' attachments are kept for a Resume pass, the presented one isn't touched
+                Resume,         // first subpass' attachments are loaded, continues a GeometryOnly pass
+                ResumeGeometryOnly  // loaded and kept again, more geometry between two GeometryOnly / Resume passes
+            };
+
             struct SubpassAttachment {
 
                 Attachment::Type            s_type{};
@@ -27,6 +39,12 @@ namespace Orasis {
                 uint8_t                     s_subpassToAttach{};
                 uint8_t                     s_attachIndex{};
                 uint8_t                     s_previousSubpass{};
+
+                // Depth only (color attachments always are), read by the next subpass as an input attachment
+                bool                        s_readAsInput{false};
+
+                // Depth only, kept past the render pass and left readable by shaders
+                bool                        s_sampledAfter{false};
             
                 SubpassAttachment() = delete;
 
@@ -45,6 +63,7 @@ namespace Orasis {
                     std::unordered_map<uint8_t, std::vector<std::shared_ptr<SubpassAttachment>>> s_subPassAttachments{};
                     std::vector<std::shared_ptr<SubpassAttachment>> s_renderPassAttachmentsStruct{};
                     std::vector<VkSubpassDependency> s_dependencies{};
+                    LoadMode s_loadMode{LoadMode::Clear};
 
                 public:
                     
@@ -54,6 +73,7 @@ namespace Orasis {
 
                     Builder& addSubpassAttachments(SubpassAttachment subAttachment);
                     Builder& addSubpassDependency(VkSubpassDependency dependency);
+                    Builder& setLoadMode(LoadMode loadMode);
 
                     std::unique_ptr<RenderPass> build() const;
 
@@ -76,7 +96,8 @@ namespace Orasis {
             Device& device,
             std::unordered_map<uint8_t, std::vector<std::shared_ptr<SubpassAttachment>>> subPassAttachments,
             std::vector<std::shared_ptr<SubpassAttachment>> renderPassAttachmentsStruct,
-            std::vector<VkSubpassDependency> subpassDependancies
+            std::vector<VkSubpassDependency> subpassDependancies,
+            LoadMode loadMode = LoadMode::Clear
         );
         
 
@@ -0,0 +1,365 @@
+#pragma once
+
+#include "Header_Includes/Render_Systems_Headers.hpp"
+#include "Descriptors.hpp"
+#include "Manager.hpp"
+#include "PipelineCompiler.hpp"
+
+#include <glm/glm.hpp>
+
+#include <array>
+
+namespace Orasis {
+
+
+    /*
+        Screen space ambient occlusion at half resolution, between the geometry and the lighting.
+        ssao.comp takes 8 hemisphere samples per pixel from depth and normals, rotated by the
+        pixel's place in a 4x4 block so neighbours cover 16 different directions between them.
+        ssao_blur.comp averages each 4x4 block back together, skipping texels across depth edges.
+        The lighting upsamples the result bilaterally (deferred_lighting.glsl, set 4).
+
+        Its two images belong to the Manager's frame graph ("SSAO", "SSAOBlurred"), RG16F with the
+        occlusion in R and the linear view depth it was computed at in G. Both dispatches are passes
+        of it, the graph records their layout transitions and the barrier between them, and SSAO only
+        lives from one to the other (its memory is shared with images used later in the frame).
+        Disabled, the lighting set points at a 1x1 unoccluded image instead and render does nothing.
+    */
+    class AmbientOcclusion {
+
+        public:
+
+            static constexpr uint32_t GROUP_SIZE = 8;
+            static constexpr uint32_t DOWNSCALE = 2;
+
+            static constexpr float RADIUS = 0.5f;          // world units around the pixel that can occlude it
+            static constexpr float INTENSITY = 1.f;
+
+        private:
+
+            struct Push {
+                glm::ivec2 aoSize;          // part of the half resolution images in use
+                glm::ivec2 renderSize;      // part of the G-buffer rendered to
+                float radius;
+                float intensity;
+                uint32_t packedNormals;
+            };
+
+            // One per swap chain image, like the G-buffer it reads
+            struct ImageResources {
+                VkDescriptorSet occlusionSet{VK_NULL_HANDLE};
+                VkDescriptorSet blurSet{VK_NULL_HANDLE};
+                VkDescriptorSet lightingSet{VK_NULL_HANDLE};
+            };
+
+            // -------- MEMBER VARIABLES -------- //
+
+            Device& m_device;
+            PipelineCompiler& m_compiler;
+
+            bool m_enabled;
+            bool m_packedNormals;
+
+            VkSampler m_sampler;
+
+            std::unique_ptr<DescriptorSetLayout> m_setLayout;
+            std::unique_ptr<DescriptorSetLayout> m_lightingSetLayout;
+            std::unique_ptr<DescriptorPool> m_pool;
+            std::vector<ImageResources> m_images{};
+
+            // Disabled only, what the lighting reads instead
+            std::shared_ptr<Image> m_neutral{};
+
+            VkPipelineLayout m_layout{VK_NULL_HANDLE};
+            std::array<PipelineCompiler::Handle, 2> m_handles{PipelineCompiler::invalidHandle, PipelineCompiler::invalidHandle};
+            Pipeline* m_occlusion = nullptr;
+            Pipeline* m_blur = nullptr;
+
+            // -------- -------- -------- -------- //
+
+        public:
+
+            // -------- CONSTRUCTOR etc -------- //
+
+            // The pipelines are only requested, call waitForPipelines before the first frame
+            AmbientOcclusion(Device& device, PipelineCompiler& compiler, Manager& manager, VkDescriptorSetLayout globalSetLayout, bool enabled)
+            :m_device{device}, m_compiler{compiler}, m_enabled{enabled}, m_packedNormals{manager.getGBufferLayout() == GBufferLayout::Packed}
+            {
+                createSampler();
+
+                // Set 4 of both lighting paths
+                m_lightingSetLayout =
+                    DescriptorSetLayout::Builder(m_device)
+                        .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT)
+                        .build();
+
+                if (!m_enabled)
+                {
+                    createNeutralImage(manager);
+                    createImageResources(manager);
+                    return;
+                }
+
+                if (!manager.usesAmbientOcclusion())
+                    throw std::runtime_error("failed to create ambient occlusion, the manager's frame graph has no passes for it");
+
+                // 0 depth, 1 normals, 2 occlusion to blur, 3 written
+                m_setLayout =
+                    DescriptorSetLayout::Builder(m_device)
+                        .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+                        .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+                        .addBinding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+                        .addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT)
+                        .build();
+
+                createLayout({globalSetLayout, m_setLayout->getDescriptorSetLayout()});
+
+                m_handles[0] = requestPipeline("C:/Users/thedarkchoco/Desktop/vs_code/Orasis_Engine/shaders/compiledShaders/ssao.comp.spv");
+                m_handles[1] = requestPipeline("C:/Users/thedarkchoco/Desktop/vs_code/Orasis_Engine/shaders/compiledShaders/ssao_blur.comp.spv");
+
+                createImageResources(manager);
+            }
+
+            ~AmbientOcclusion()
+            {
+                for (PipelineCompiler::Handle handle : m_handles)
+                    m_compiler.release(handle);
+
+                if (m_layout != VK_NULL_HANDLE)
+                    vkDestroyPipelineLayout(m_device.device(), m_layout, nullptr);
+                vkDestroySampler(m_device.device(), m_sampler, nullptr);
+            }
+
+            AmbientOcclusion(const AmbientOcclusion&) = delete;
+            AmbientOcclusion &operator=(const AmbientOcclusion&) = delete;
+
+            // -------- -------- -------- -------- //
+
+
+
+
+            // -------- FUNCTIONS -------- //
+
+            void waitForPipelines()
+            {
+                if (!m_enabled) return;
+
+                m_occlusion = &m_compiler.wait(m_handles[0]);
+                m_blur = &m_compiler.wait(m_handles[1]);
+            }
+
+            bool isEnabled() const { return m_enabled; }
+
+            VkDescriptorSetLayout getSetLayout() const { return m_lightingSetLayout->getDescriptorSetLayout(); }
+
+            // The lighting's set 4 for the framebuffer of imageIndex
+            VkDescriptorSet getDescriptorSet(uint32_t imageIndex) const { return m_images[imageIndex].lightingSet; }
+
+            // After Manager::resize (which realized the frame graph again), frames still in flight keep the old sets until they're done
+            void resize(Manager& manager)
+            {
+                m_device.deletionQueue().retire(std::move(m_pool));
+
+                m_images.clear();
+                createImageResources(manager);
+            }
+
+            /*
+                Outside of a render pass, once depth and normals of imageIndex are written (and in their
+                sampled layouts). renderExtent is the part of them that was rendered to. The graph leaves
+                the result readable by fragment and compute shaders afterwards.
+            */
+            void render(VkCommandBuffer commandBuffer, const RenderGraph& graph, uint32_t imageIndex, VkDescriptorSet globalSet, VkExtent2D renderExtent)
+            {
+                if (!m_enabled) return;
+
+                ImageResources& image = m_images[imageIndex];
+
+                glm::ivec2 aoSize{
+                    static_cast<int>((renderExtent.width + DOWNSCALE - 1) / DOWNSCALE),
+                    static_cast<int>((renderExtent.height + DOWNSCALE - 1) / DOWNSCALE)
+                };
+                uint32_t groupsX = (static_cast<uint32_t>(aoSize.x) + GROUP_SIZE - 1) / GROUP_SIZE;
+                uint32_t groupsY = (static_cast<uint32_t>(aoSize.y) + GROUP_SIZE - 1) / GROUP_SIZE;
+
+                Push push{aoSize, {static_cast<int>(renderExtent.width), static_cast<int>(renderExtent.height)}, RADIUS, INTENSITY, m_packedNormals ? 1u : 0u};
+
+                graph.executePass(commandBuffer, "AmbientOcclusion", imageIndex, [&](VkCommandBuffer, uint32_t) {
+                    std::array<VkDescriptorSet, 2> sets{globalSet, image.occlusionSet};
+
+                    m_occlusion->bind(commandBuffer);
+                    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_layout, 0, static_cast<uint32_t>(sets.size()), sets.data(), 0, nullptr);
+                    vkCmdPushConstants(commandBuffer, m_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Push), &push);
+                    vkCmdDispatch(commandBuffer, groupsX, groupsY, 1);
+                });
+
+                // The layout is shared, the global set and push constants stay, only set 1 changes
+                graph.executePass(commandBuffer, "AmbientOcclusionBlur", imageIndex, [&](VkCommandBuffer, uint32_t) {
+                    m_blur->bind(commandBuffer);
+                    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_layout, 1, 1, &image.blurSet, 0, nullptr);
+                    vkCmdDispatch(commandBuffer, groupsX, groupsY, 1);
+                });
+            }
+
+        private:
+
+            void createImageResources(Manager& manager)
+            {
+                uint32_t imageCount = static_cast<uint32_t>(manager.imageCount());
+
+                DescriptorPool::Builder poolBuilder(m_device);
+                poolBuilder.setMaxSets(3 * imageCount);
+                poolBuilder.addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, (m_enabled ? 7 : 1) * imageCount);
+                if (m_enabled)
+                    poolBuilder.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2 * imageCount);
+
+                m_pool = poolBuilder.build();
+
+                m_images.resize(imageCount);
+
+                const RenderGraph& graph = manager.getFrameGraph();
+
+                for (uint32_t i = 0; i < imageCount; i++)
+                {
+                    ImageResources& image = m_images[i];
+
+                    // The graph transitions the blurred image once the blur is done, the neutral one never leaves GENERAL
+                    VkDescriptorImageInfo lightingInfo = m_enabled ?
+                        VkDescriptorImageInfo{m_sampler, graph.getImageView(graph.find("SSAOBlurred"), i), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL} :
+                        VkDescriptorImageInfo{m_sampler, m_neutral->s_imageView, VK_IMAGE_LAYOUT_GENERAL};
+
+                    DescriptorWriter(*m_lightingSetLayout, *m_pool)
+                        .writeImage(0, &lightingInfo)
+                        .build(image.lightingSet);
+
+                    if (!m_enabled) continue;
+
+                    VkImageView occlusionView = graph.getImageView(graph.find("SSAO"), i);
+                    VkImageView blurredView = lightingInfo.imageView;
+
+                    VkDescriptorImageInfo depthInfo{m_sampler, manager.getImageView("Depth", i), VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
+                    VkDescriptorImageInfo normalInfo{m_sampler, manager.getImageView("Normal", i), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+
+                    // In the layouts the graph gives the passes. ssao.comp doesn't read binding 2, it's written anyway so both sets are complete
+                    VkDescriptorImageInfo occlusionRead{m_sampler, occlusionView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+                    VkDescriptorImageInfo occlusionWrite{VK_NULL_HANDLE, occlusionView, VK_IMAGE_LAYOUT_GENERAL};
+                    VkDescriptorImageInfo blurredRead{m_sampler, blurredView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+                    VkDescriptorImageInfo blurredWrite{VK_NULL_HANDLE, blurredView, VK_IMAGE_LAYOUT_GENERAL};
+
+                    DescriptorWriter(*m_setLayout, *m_pool)
+                        .writeImage(0, &depthInfo)
+                        .writeImage(1, &normalInfo)
+                        .writeImage(2, &blurredRead)
+                        .writeImage(3, &occlusionWrite)
+                        .build(image.occlusionSet);
+
+                    DescriptorWriter(*m_setLayout, *m_pool)
+                        .writeImage(0, &depthInfo)
+                        .writeImage(1, &normalInfo)
+                        .writeImage(2, &occlusionRead)
+                        .writeImage(3, &blurredWrite)
+                        .build(image.blurSet);
+                }
+            }
+
+            // 1x1 and unoccluded, every tap of the lighting's upsample lands on it
+            void createNeutralImage(Manager& manager)
+            {
+                AttachmentInfo neutralInfo("SSAONeutral", VK_FORMAT_R16G16_SFLOAT, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+                m_neutral = Image::createAttachment(m_device, manager.getAllocator(), {1, 1}, neutralInfo);
+
+                VkCommandBuffer commandBuffer = m_device.beginSingleTimeCommands();
+
+                imageBarrier(commandBuffer, m_neutral->s_image,
+                    VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+                    VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,
+                    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+                VkClearColorValue unoccluded{{1.f, 0.f, 0.f, 0.f}};
+                VkImageSubresourceRange range{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+                vkCmdClearColorImage(commandBuffer, m_neutral->s_image, VK_IMAGE_LAYOUT_GENERAL, &unoccluded, 1, &range);
+
+                memoryBarrier(commandBuffer,
+                    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                    VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+                m_device.endSingleTimeCommands(commandBuffer);
+            }
+
+            void createSampler()
+            {
+                // Only ever read with texelFetch
+                VkSamplerCreateInfo samplerInfo{};
+                samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+                samplerInfo.magFilter = VK_FILTER_NEAREST;
+                samplerInfo.minFilter = VK_FILTER_NEAREST;
+                samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+                samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+                samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+                samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+                samplerInfo.unnormalizedCoordinates = VK_FALSE;
+                samplerInfo.compareEnable = VK_FALSE;
+                samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+
+                if (vkCreateSampler(m_device.device(), &samplerInfo, nullptr, &m_sampler) != VK_SUCCESS)
+                    throw std::runtime_error("failed to create ambient occlusion sampler");
+            }
+
+            void createLayout(std::vector<VkDescriptorSetLayout> layoutToSet)
+            {
+                VkPushConstantRange pushConstantRange{};
+                pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+                pushConstantRange.offset = 0;
+                pushConstantRange.size = sizeof(Push);
+
+                VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+                pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+                pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(layoutToSet.size());
+                pipelineLayoutInfo.pSetLayouts = layoutToSet.data();
+                pipelineLayoutInfo.pushConstantRangeCount = 1;
+                pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+                if (vkCreatePipelineLayout(m_device.device(), &pipelineLayoutInfo, nullptr, &m_layout) != VK_SUCCESS)
+                    throw std::runtime_error("failed to create pipeline layout");
+            }
+
+            PipelineCompiler::Handle requestPipeline(const std::string& path)
+            {
+                auto pipelineConfig = std::make_unique<PipelineConfigInfo>();
+                pipelineConfig->pipelineLayout = m_layout;
+
+                return m_compiler.request(path, "", std::move(pipelineConfig));
+            }
+
+            static void memoryBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+            {
+                VkMemoryBarrier barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+                barrier.srcAccessMask = srcAccess;
+                barrier.dstAccessMask = dstAccess;
+
+                vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+            }
+
+            static void imageBarrier(
+                VkCommandBuffer commandBuffer, VkImage image,
+                VkImageLayout oldLayout, VkImageLayout newLayout,
+                VkPipelineStageFlags srcStage, VkAccessFlags srcAccess,
+                VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+            {
+                VkImageMemoryBarrier barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                barrier.oldLayout = oldLayout;
+                barrier.newLayout = newLayout;
+                barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.image = image;
+                barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+                barrier.srcAccessMask = srcAccess;
+                barrier.dstAccessMask = dstAccess;
+
+                vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+            }
+    };
+
+}
@@ -0,0 +1,285 @@
+#pragma once
+
+#include "Header_Includes/Render_Systems_Headers.hpp"
+#include "Buffer.hpp"
+#include "Descriptors.hpp"
+#include "DrawPacket.hpp"
+#include "PipelineCompiler.hpp"
+#include "SwapChain.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Orasis {
+
+
+    // Matches ClusterUbo in cluster_assign.comp and deferred_lighting.glsl (std140)
+    struct ClusterUbo {
+        glm::mat4 view{1.f};
+        glm::vec4 projection{};     // P[0][0], P[1][1], near, far
+        glm::vec4 screen{};         // width, height, tile width, tile height
+        glm::vec4 slicing{};        // scale, bias (slice = log(viewDepth) * scale + bias)
+        glm::uvec4 grid{};          // x, y, z, light count
+    };
+
+
+    /*
+        Clustered shading. The view frustum is cut into a GRID_X * GRID_Y * GRID_Z grid of froxels,
+        screen tiles in x/y and exponentially spaced depth slices in z. Every frame the submitted
+        lights go into a storage buffer, a compute pass (cluster_assign.comp) tests them against
+        every froxel and writes per froxel light lists, and the lighting subpass only loops over
+        the list of the froxel its pixel falls into.
+
+        All buffers are per frame in flight, the compute pass of one frame never touches lists
+        a previous frame is still shading with.
+    */
+    class ClusteredLighting {
+
+        public:
+
+            static constexpr uint32_t GRID_X = 16;
+            static constexpr uint32_t GRID_Y = 9;
+            static constexpr uint32_t GRID_Z = 24;
+            static constexpr uint32_t CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z;
+
+            // Lights beyond these are dropped, the shaders use the same per cluster limit
+            static constexpr uint32_t MAX_LIGHTS = 16384;
+            static constexpr uint32_t MAX_LIGHTS_PER_CLUSTER = 256;
+
+            // local_size_x of cluster_assign.comp
+            static constexpr uint32_t ASSIGN_GROUP_SIZE = 128;
+
+        private:
+
+            struct FrameResources {
+                std::unique_ptr<Buffer> params;
+                std::unique_ptr<Buffer> lights;
+                std::unique_ptr<Buffer> lightCounts;
+                std::unique_ptr<Buffer> lightIndices;
+                VkDescriptorSet descriptorSet{VK_NULL_HANDLE};
+            };
+
+            // -------- MEMBER VARIABLES -------- //
+
+            Device& m_device;
+            PipelineCompiler& m_compiler;
+
+            std::unique_ptr<DescriptorPool> m_pool;
+            std::unique_ptr<DescriptorSetLayout> m_setLayout;
+            std::array<FrameResources, SwapChain::MAX_FRAMES_IN_FLIGHT> m_frames{};
+
+            VkPipelineLayout m_assignLayout;
+            PipelineCompiler::Handle m_assignHandle = PipelineCompiler::invalidHandle;
+            Pipeline* m_assignPipeline = nullptr;
+
+            uint32_t m_lightCount{0};
+
+            // -------- -------- -------- -------- //
+
+        public:
+
+            // -------- CONSTRUCTOR etc -------- //
+
+            // The assign pipeline is only requested, call waitForPipeline before the first frame
+            ClusteredLighting(Device& device, PipelineCompiler& compiler)
+            :m_device{device}, m_compiler{compiler}
+            {
+                createDescriptors();
+                createAssignLayout();
+
+                auto pipelineConfig = std::make_unique<PipelineConfigInfo>();
+                pipelineConfig->pipelineLayout = m_assignLayout;
+
+                m_assignHandle = m_compiler.request(
+                    "C:/Users/thedarkchoco/Desktop/vs_code/Orasis_Engine/shaders/compiledShaders/cluster_assign.comp.spv",
+                    "",
+                    std::move(pipelineConfig)
+                );
+            }
+
+            ~ClusteredLighting()
+            {
+                m_compiler.release(m_assignHandle);
+                vkDestroyPipelineLayout(m_device.device(), m_assignLayout, nullptr);
+            }
+
+            ClusteredLighting(const ClusteredLighting&) = delete;
+            ClusteredLighting &operator=(const ClusteredLighting&) = delete;
+
+            // -------- -------- -------- -------- //
+
+
+
+
+            // -------- FUNCTIONS -------- //
+
+            void waitForPipeline() { m_assignPipeline = &m_compiler.wait(m_assignHandle); }
+
+            // Set 2 of the lighting pipeline layout
+            VkDescriptorSetLayout getSetLayout() const { return m_setLayout->getDescriptorSetLayout(); }
+            VkDescriptorSet getDescriptorSet(int frameIndex) const { return m_frames[frameIndex].descriptorSet; }
+
+            uint32_t getLightCount() const { return m_lightCount; }
+
+            /*
+                Outside of a render pass. Uploads this frame's lights and records the assignment,
+                followed by the barrier that makes the lists visible to the lighting (subpass or compute).
+                The frame's previous use has to be finished (FrameScheduler::beginFrame).
+            */
+            void assignLights(VkCommandBuffer commandBuffer, int frameIndex, const std::vector<PointLight>& lights, const Camera& camera, VkExtent2D extent)
+            {
+                FrameResources& frame = m_frames[frameIndex];
+
+                m_lightCount = static_cast<uint32_t>(std::min<size_t>(lights.size(), MAX_LIGHTS));
+
+                if (m_lightCount > 0)
+                    frame.lights->writeToBuffer((void *)lights.data(), m_lightCount * sizeof(PointLight));
+
+                ClusterUbo params = makeParams(camera, extent, m_lightCount);
+                frame.params->writeToBuffer(&params);
+
+                m_assignPipeline->bind(commandBuffer);
+
+                vkCmdBindDescriptorSets(
+                    commandBuffer,
+                    VK_PIPELINE_BIND_POINT_COMPUTE,
+                    m_assignLayout,
+                    0, 1,
+                    &frame.descriptorSet,
+                    0, nullptr
+                );
+
+                vkCmdDispatch(commandBuffer, (CLUSTER_COUNT + ASSIGN_GROUP_SIZE - 1) / ASSIGN_GROUP_SIZE, 1, 1);
+
+                VkMemoryBarrier barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+                barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+                barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+                vkCmdPipelineBarrier(
+                    commandBuffer,
+                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                    VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                    0,
+                    1, &barrier,
+                    0, nullptr,
+                    0, nullptr
+                );
+            }
+
+        private:
+
+            static ClusterUbo makeParams(const Camera& camera, VkExtent2D extent, uint32_t lightCount)
+            {
+                const glm::mat4& proj = camera.getProjection();
+
+                // Camera::setPrespectiveProjection: P[2][2] = f / (f - n), P[3][2] = -f * n / (f - n)
+                float zNear = -proj[3][2] / proj[2][2];
+                float zFar = proj[2][2] * zNear / (proj[2][2] - 1.f);
+
+                float logRatio = std::log(zFar / zNear);
+
+                ClusterUbo params{};
+                params.view = camera.getViewMatrix();
+                params.projection = {proj[0][0], proj[1][1], zNear, zFar};
+                params.screen = {
+                    static_cast<float>(extent.width),
+                    static_cast<float>(extent.height),
+                    std::ceil(static_cast<float>(extent.width) / GRID_X),
+                    std::ceil(static_cast<float>(extent.height) / GRID_Y)
+                };
+                params.slicing = {GRID_Z / logRatio, -(GRID_Z * std::log(zNear)) / logRatio, 0.f, 0.f};
+                params.grid = {GRID_X, GRID_Y, GRID_Z, lightCount};
+
+                return params;
+            }
+
+            void createDescriptors()
+            {
+                const uint32_t frames = SwapChain::MAX_FRAMES_IN_FLIGHT;
+
+                m_pool =
+                    DescriptorPool::Builder(m_device)
+                        .setMaxSets(frames)
+                        .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frames)
+                        .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3 * frames)
+                        .build();
+
+                // 0 params, 1 lights, 2 per cluster light count, 3 per cluster light indices
+                m_setLayout =
+                    DescriptorSetLayout::Builder(m_device)
+                        .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
+                        .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
+                        .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
+                        .addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
+                        .build();
+
+                for (FrameResources& frame : m_frames)
+                {
+                    frame.params = std::make_unique<Buffer>(
+                        m_device,
+                        sizeof(ClusterUbo),
+                        1,
+                        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                        m_device.properties.limits.minUniformBufferOffsetAlignment
+                    );
+                    frame.params->map();
+
+                    // Written by the CPU every frame
+                    frame.lights = std::make_unique<Buffer>(
+                        m_device,
+                        sizeof(PointLight),
+                        MAX_LIGHTS,
+                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+                    );
+                    frame.lights->map();
+
+                    // Only ever touched by the GPU
+                    frame.lightCounts = std::make_unique<Buffer>(
+                        m_device,
+                        sizeof(uint32_t),
+                        CLUSTER_COUNT,
+                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+                    );
+
+                    frame.lightIndices = std::make_unique<Buffer>(
+                        m_device,
+                        sizeof(uint32_t),
+                        CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER,
+                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+                    );
+
+                    VkDescriptorBufferInfo paramsInfo = frame.params->descriptorInfo();
+                    VkDescriptorBufferInfo lightsInfo = frame.lights->descriptorInfo();
+                    VkDescriptorBufferInfo countsInfo = frame.lightCounts->descriptorInfo();
+                    VkDescriptorBufferInfo indicesInfo = frame.lightIndices->descriptorInfo();
+
+                    DescriptorWriter(*m_setLayout, *m_pool)
+                        .writeBuffer(0, &paramsInfo)
+                        .writeBuffer(1, &lightsInfo)
+                        .writeBuffer(2, &countsInfo)
+                        .writeBuffer(3, &indicesInfo)
+                        .build(frame.descriptorSet);
+                }
+            }
+
+            void createAssignLayout()
+            {
+                VkDescriptorSetLayout setLayout = m_setLayout->getDescriptorSetLayout();
+
+                VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+                pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+                pipelineLayoutInfo.setLayoutCount = 1;
+                pipelineLayoutInfo.pSetLayouts = &setLayout;
+                pipelineLayoutInfo.pushConstantRangeCount = 0;
+
+                if (vkCreatePipelineLayout(m_device.device(), &pipelineLayoutInfo, nullptr, &m_assignLayout) != VK_SUCCESS)
+                    throw std::runtime_error("failed to create pipeline layout");
+            }
+    };
+
+}
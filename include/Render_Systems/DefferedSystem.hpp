@@ -1,6 +1,17 @@
 #pragma once
 
 #include "Header_Includes/Render_Systems_Headers.hpp"
+#include "StaticDrawCache.hpp"
+#include "ClusteredLighting.hpp"
+#include "TiledLighting.hpp"
+#include "ShadowSystem.hpp"
+#include "OcclusionCulling.hpp"
+#include "Upscaler.hpp"
+#include "AmbientOcclusion.hpp"
+#include "DepthPrepass.hpp"
+#include "OverdrawCounter.hpp"
+#include "PipelineCompiler.hpp"
+#include "RenderFrontend.hpp"
 
 namespace Orasis {
 
@@ -9,6 +20,13 @@ namespace Orasis {
         glm::mat4 modelMatrix{1.f};
     };
 
+    // Fragment shaders have to write the G-buffer layout the system was created with
+    struct GeometryVariant
+    {
+        std::string vertPath;
+        std::string fragPath;
+    };
+
 
     class DefferedSystem {
 
@@ -18,14 +36,77 @@ namespace Orasis {
         std::unique_ptr<Manager> def_Manager;
         std::shared_ptr<SwapChain> m_swapChain;
 
-        std::unique_ptr<Pipeline> geoPipeline;
+        PipelineCompiler& m_compiler;
+
+        // [0] is the default G-buffer pipeline and the fallback for variants still compiling
+        std::vector<PipelineCompiler::Handle> m_geoPipelines{};
+        Pipeline* geoPipeline = nullptr;
         VkPipelineLayout geoLayout;
 
-        std::unique_ptr<Pipeline> lightPipeline;
+        // Same order as m_geoPipelines, depth tested with EQUAL and not written, for after the depth pre-pass.
+        // Empty with DepthPrepassMode::Off
+        std::vector<PipelineCompiler::Handle> m_geoEqualPipelines{};
+        Pipeline* geoEqualPipeline = nullptr;
+
+        PipelineCompiler::Handle m_depthPipelineHandle = PipelineCompiler::invalidHandle;
+        Pipeline* depthPipeline = nullptr;
+
+        PipelineCompiler::Handle m_lightPipelineHandle = PipelineCompiler::invalidHandle;
+        Pipeline* lightPipeline = nullptr;
         VkPipelineLayout lightLayout;
 
+        // G-buffer pipelines earlier runs recorded, compiling in the background until a request with the
+        // same record takes one over (variants keep their ids, whenever they're added)
+        struct Prewarmed {
+            PipelineRecord record;
+            PipelineCompiler::Handle handle;
+        };
+        std::vector<Prewarmed> m_prewarmed{};
+
+        uint64_t m_seenCompiledCount{0};
+
         VkDescriptorSetLayout globalSetLayout;
 
+        // Reused every frame so sorting doesn't allocate
+        std::vector<DrawItem> m_staticItems{};
+        std::vector<DrawItem> m_dynamicItems{};
+        std::vector<DrawItem> m_drawItemsScratch{};
+
+        std::unique_ptr<StaticDrawCache> m_staticDraws;
+
+        // The frame's geometry secondaries, prepareGeometry records them and both geometry passes execute them.
+        // With the depth pre-pass its secondaries go first, every object's depth is in before any G-buffer write
+        std::array<VkCommandBuffer, 2> m_secondaries{};
+        uint32_t m_secondaryCount{0};
+        std::array<VkCommandBuffer, 2> m_depthSecondaries{};
+        uint32_t m_depthSecondaryCount{0};
+
+        DepthPrepass m_depthPrepass;
+        bool m_depthPrepassAvailable{false};        // pipelines requested, DepthPrepassMode::Off skips them
+        std::unique_ptr<OverdrawCounter> m_overdraw;
+        std::atomic<float> m_statOverdraw{0.f};
+        std::atomic<bool> m_statDepthPrepass{false};
+
+        std::unique_ptr<ClusteredLighting> m_clusteredLights;
+
+        std::unique_ptr<ShadowSystem> m_shadows;
+
+        // LightingPath::Compute only, the lighting subpass is left empty then
+        std::unique_ptr<TiledLighting> m_tiledLighting;
+
+        // Null without occlusion culling, every geometry draw is then a direct one
+        std::unique_ptr<OcclusionCulling> m_occlusion;
+        glm::mat4 m_cullViewProj{1.f};
+
+        // Null without dynamic resolution, the lighting then writes the swap chain image directly
+        std::unique_ptr<Upscaler> m_upscaler;
+
+        // Always there, disabled it only gives the lighting its neutral set 4
+        std::unique_ptr<AmbientOcclusion> m_ambientOcclusion;
+
+        // Top left part of the attachments that gets rendered to, the whole extent without dynamic resolution
+        VkExtent2D m_renderExtent{};
+
         
         // -------- -------- -------- -------- //
 
@@ -34,29 +115,120 @@ namespace Orasis {
 
         // -------- CONSTRUCTOR etc -------- //
 
-        DefferedSystem(Device& device, VkDescriptorSetLayout globalSetLayout, std::shared_ptr<SwapChain> swapChain)
-        :m_device{device}, globalSetLayout{globalSetLayout}, m_swapChain{swapChain}
+        // commandPool is the render backend's, the cached secondaries are recorded on its thread
+        DefferedSystem(Device& device, PipelineCompiler& compiler, VkCommandPool commandPool, VkDescriptorSetLayout globalSetLayout, std::shared_ptr<SwapChain> swapChain, const std::vector<GeometryVariant>& variants = {}, GBufferLayout gBufferLayout = GBufferLayout::Packed, LightingPath lightingPath = LightingPath::Subpass, bool occlusionCulling = false, bool dynamicResolution = false, bool ambientOcclusion = false, const DepthPrepassSettings& depthPrepass = {})
+        :m_device{device}, m_compiler{compiler}, globalSetLayout{globalSetLayout}, m_swapChain{swapChain}, m_depthPrepass{depthPrepass}
         {
 
             ManagerInfo mngrInfo;
-            mngrInfo.swapChain =        swapChain->getSwapChain();
+            mngrInfo.swapChainImages =  swapChain->getImages();
             mngrInfo.swapChainFormat =  swapChain->getSwapChainImageFormat();
             mngrInfo.depthFormat =      swapChain->findDepthFormat();
             mngrInfo.extent =           swapChain->getSwapChainExtent();
+            mngrInfo.gBufferLayout =    gBufferLayout;
+            mngrInfo.lightingPath =     lightingPath;
+            mngrInfo.occlusionCulling = occlusionCulling;
+            mngrInfo.dynamicResolution = dynamicResolution;
+            mngrInfo.ambientOcclusion = ambientOcclusion;
+
+            m_renderExtent = mngrInfo.extent;
 
             def_Manager = std::make_unique<Manager>(device, mngrInfo);
             
+            m_clusteredLights = std::make_unique<ClusteredLighting>(device, compiler);
+            m_shadows = std::make_unique<ShadowSystem>(device, compiler, def_Manager->getAllocator());
+
+            if (occlusionCulling)
+                m_occlusion = std::make_unique<OcclusionCulling>(device, compiler, *def_Manager, mngrInfo.extent);
+
+            m_ambientOcclusion = std::make_unique<AmbientOcclusion>(device, compiler, *def_Manager, globalSetLayout, ambientOcclusion);
+
             createGeometryLayout({globalSetLayout});
-            createGeometryPipeline(def_Manager->getRenderPass());
-            
-            createLightingLayout({globalSetLayout, def_Manager->getInputAttachmentSetLayout().getDescriptorSetLayout()});
-            createLightingPipeline(def_Manager->getRenderPass());
+            createLightingLayout({globalSetLayout, def_Manager->getInputAttachmentSetLayout().getDescriptorSetLayout(), m_clusteredLights->getSetLayout(), m_shadows->getSetLayout(), m_ambientOcclusion->getSetLayout()});
+
+            m_depthPrepassAvailable = depthPrepass.mode != DepthPrepassMode::Off;
+
+            // The render pass and geometry layout exist now, last run's variants start compiling first
+            replayRecordedPipelines();
+
+            // Everything is queued first so the compiler builds it all in parallel,
+            // only the pipelines every frame needs are waited for
+            bool packed = gBufferLayout == GBufferLayout::Packed;
+
+            std::string geoVert = "C:/Users/thedarkchoco/Desktop/vs_code/Orasis_Engine/shaders/compiledShaders/dG_shader.vert.spv";
+            std::string geoFrag = packed ?
+                "C:/Users/thedarkchoco/Desktop/vs_code/Orasis_Engine/shaders/compiledShaders/dG_shader.frag.spv" :
+                "C:/Users/thedarkchoco/Desktop/vs_code/Orasis_Engine/shaders/compiledShaders/dG_full.frag.spv";
+
+            m_geoPipelines.push_back(requestGeometryPipeline(geoVert, geoFrag));
+
+            if (m_depthPrepassAvailable)
+            {
+                m_geoEqualPipelines.push_back(requestGeometryPipeline(geoVert, geoFrag, true));
+                requestDepthPrepassPipeline();
+            }
+
+            if (lightingPath == LightingPath::Compute)
+                m_tiledLighting = std::make_unique<TiledLighting>(device, compiler, *def_Manager, mngrInfo.extent, globalSetLayout, m_clusteredLights->getSetLayout(), m_shadows->getSetLayout(), m_ambientOcclusion->getSetLayout());
+            else
+                createLightingPipeline(def_Manager->getRenderPass());
+
+            if (dynamicResolution)
+                m_upscaler = std::make_unique<Upscaler>(device, compiler, *def_Manager, mngrInfo.extent, upscaleSources());
+
+            for (const GeometryVariant& variant : variants)
+            {
+                m_geoPipelines.push_back(requestGeometryPipeline(variant.vertPath, variant.fragPath, false, true));
+                if (m_depthPrepassAvailable)
+                    m_geoEqualPipelines.push_back(requestGeometryPipeline(variant.vertPath, variant.fragPath, true, true));
+            }
+
+            geoPipeline = &m_compiler.wait(m_geoPipelines[0]);
+            if (m_depthPrepassAvailable)
+            {
+                geoEqualPipeline = &m_compiler.wait(m_geoEqualPipelines[0]);
+                depthPipeline = &m_compiler.wait(m_depthPipelineHandle);
+            }
+            m_clusteredLights->waitForPipeline();
+            m_shadows->waitForPipeline();
+            m_ambientOcclusion->waitForPipelines();
+
+            if (m_occlusion)
+                m_occlusion->waitForPipelines();
+
+            if (m_upscaler)
+                m_upscaler->waitForPipeline();
+
+            if (m_tiledLighting)
+                m_tiledLighting->waitForPipelines();
+            else
+                lightPipeline = &m_compiler.wait(m_lightPipelineHandle);
+            m_seenCompiledCount = m_compiler.completedCount();
+
+            m_staticDraws = std::make_unique<StaticDrawCache>(device, commandPool);
+            m_overdraw = std::make_unique<OverdrawCounter>(device);
 
 
         }
 
         ~DefferedSystem()
         {
+            for (PipelineCompiler::Handle handle : m_geoPipelines)
+                m_compiler.release(handle);
+            for (PipelineCompiler::Handle handle : m_geoEqualPipelines)
+                m_compiler.release(handle);
+            m_compiler.release(m_depthPipelineHandle);
+            m_compiler.release(m_lightPipelineHandle);
+            for (const Prewarmed& prewarmed : m_prewarmed)
+                m_compiler.release(prewarmed.handle);
+
+            m_upscaler.reset();
+            m_ambientOcclusion.reset();
+            m_tiledLighting.reset();
+            m_occlusion.reset();
+            m_clusteredLights.reset();
+            m_shadows.reset();
+
             vkDestroyPipelineLayout(m_device.device(), geoLayout, nullptr);
             vkDestroyPipelineLayout(m_device.device(), lightLayout, nullptr);
         }
@@ -73,54 +245,255 @@ namespace Orasis {
 
         
 
-        void defferedRender(FrameInfo& frameInfo, std::vector<VkDescriptorSet> descriptors)
+        // Swap chain sized attachments are rebuilt, pipelines and layouts stay. The old attachments
+        // are returned since frames still in flight may reference them. Renders to the whole extent until setRenderExtent.
+        Manager::RetiredAttachments resize(std::shared_ptr<SwapChain> swapChain)
         {
-            // Instansiating camera and cmdBuffer from frame info
-            Camera camera = frameInfo.camera;
-            VkCommandBuffer commandBuffer = frameInfo.cmdBuffer;
+            m_swapChain = swapChain;
+            m_renderExtent = swapChain->getSwapChainExtent();
 
-            geoPipeline->bind(commandBuffer);
+            Manager::RetiredAttachments retired = def_Manager->resize(swapChain->getImages(), swapChain->getSwapChainExtent());
 
-            vkCmdBindDescriptorSets(
-                frameInfo.cmdBuffer,
-                VK_PIPELINE_BIND_POINT_GRAPHICS,
-                geoLayout,
-                0,
-                static_cast<uint32_t>(descriptors.size()),
-                descriptors.data(),
-                0, nullptr
-            );
-            
+            m_ambientOcclusion->resize(*def_Manager);
+
+            if (m_tiledLighting)
+                m_tiledLighting->resize(*def_Manager, swapChain->getSwapChainExtent());
+
+            if (m_occlusion)
+                m_occlusion->resize(*def_Manager, swapChain->getSwapChainExtent());
+
+            // Its sources are the frame graph's, the manager's resize realized them again
+            if (m_upscaler)
+                m_upscaler->resize(*def_Manager, swapChain->getSwapChainExtent(), upscaleSources());
+
+            // The viewport is baked into the recorded secondaries
+            m_staticDraws->invalidate();
+
+            return retired;
+        }
+
+        bool usesDynamicResolution() const { return m_upscaler != nullptr; }
 
-            for (auto& kv: frameInfo.gameObjects)
+        VkExtent2D getRenderExtent() const { return m_renderExtent; }
+
+        // Backend thread, between frames. Dynamic resolution only, extent is at most the swap chain's.
+        // Nothing gets reallocated, only the render area and viewport change
+        void setRenderExtent(VkExtent2D extent)
+        {
+            if (extent.width == m_renderExtent.width && extent.height == m_renderExtent.height) return;
+
+            m_renderExtent = extent;
+
+            // The viewport is baked into the recorded secondaries
+            m_staticDraws->invalidate();
+
+            if (m_occlusion)
+                m_occlusion->setRenderExtent(extent);
+        }
+
+        // Backend thread, dynamic resolution only, after the lighting. Writes the swap chain image.
+        void upscale(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+        {
+            m_upscaler->render(commandBuffer, def_Manager->getFrameGraph(), imageIndex, m_renderExtent, def_Manager->getImage("OutColor", imageIndex));
+        }
+
+        // Backend thread, before the render pass begins. Re-renders the stale shadow views from draws.casters.
+        void renderShadows(VkCommandBuffer commandBuffer, int frameIndex, const ShadowFrame& shadows, const DrawList& draws, const std::vector<std::shared_ptr<Model>>& models)
+        {
+            m_shadows->render(commandBuffer, frameIndex, shadows, draws, models);
+        }
+
+        // Any thread, what the shadow caches hold (ShadowPlanner)
+        const ShadowCacheState& getShadowCacheState() const { return m_shadows->getCacheState(); }
+
+        // Backend thread, before the render pass begins. Builds the per cluster light lists the lighting subpass of this frame reads.
+        void assignLights(VkCommandBuffer commandBuffer, int frameIndex, const DrawList& draws, const Camera& camera)
+        {
+            m_clusteredLights->assignLights(commandBuffer, frameIndex, draws.lights, camera, m_renderExtent);
+        }
+
+        uint32_t getLightCount() const { return m_clusteredLights->getLightCount(); }
+
+        bool usesComputeLighting() const { return m_tiledLighting != nullptr; }
+
+        // Backend thread, LightingPath::Compute only, after the render pass ended. Lights the G-buffer and writes the swap chain image.
+        void renderTiledLighting(VkCommandBuffer commandBuffer, int frameIndex, uint32_t imageIndex, VkDescriptorSet globalSet)
+        {
+            // With dynamic resolution the lit image is left for upscale
+            VkImage target = m_upscaler ? VK_NULL_HANDLE : def_Manager->getImage("OutColor", imageIndex);
+
+            m_tiledLighting->render(commandBuffer, def_Manager->getFrameGraph(), imageIndex, globalSet, m_clusteredLights->getDescriptorSet(frameIndex), m_shadows->getDescriptorSet(frameIndex), m_ambientOcclusion->getDescriptorSet(imageIndex), target, m_renderExtent);
+        }
+
+        bool usesAmbientOcclusion() const { return m_ambientOcclusion->isEnabled(); }
+
+        // Backend thread, ambient occlusion only. Between the geometry and the lighting, outside of a render pass
+        void renderAmbientOcclusion(VkCommandBuffer commandBuffer, uint32_t imageIndex, VkDescriptorSet globalSet)
+        {
+            m_ambientOcclusion->render(commandBuffer, def_Manager->getFrameGraph(), imageIndex, globalSet, m_renderExtent);
+        }
+
+        bool usesOcclusionCulling() const { return m_occlusion != nullptr; }
+
+        // Any thread, a few frames old. All zero without occlusion culling
+        OcclusionStats getOcclusionStats() const { return m_occlusion ? m_occlusion->getStats() : OcclusionStats{}; }
+
+        // The frame the deffered pass' attachments are part of, as Graphviz
+        void dumpFrameGraph(std::ostream& out) const { def_Manager->dumpFrameGraph(out); }
+
+        // Any thread, smoothed G-buffer samples per pixel (0 until measured) and whether the depth pre-pass is on
+        float getOverdraw() const { return m_statOverdraw.load(); }
+        bool usesDepthPrepass() const { return m_statDepthPrepass.load(); }
+
+        /*
+            Backend thread, before the render pass begins. Culling and sort keys were done by the frontend,
+            this only sorts and records the geometry secondaries (models is indexed by DrawPacket::model).
+            With occlusion culling it also runs the first culling phase, viewProj is the frame's camera.
+        */
+        void prepareGeometry(VkCommandBuffer commandBuffer, int frameIndex, const DrawList& draws, const std::vector<std::shared_ptr<Model>>& models, const std::vector<VkDescriptorSet>& descriptors, const glm::mat4& viewProj)
+        {
+            // A variant finished compiling, static draws recorded with the fallback have to pick it up
+            if (m_compiler.completedCount() != m_seenCompiledCount)
             {
-                GameObject& obj = kv.second;
+                m_seenCompiledCount = m_compiler.completedCount();
+                m_staticDraws->invalidate();
+            }
 
-                if (obj.model == nullptr) continue;
+            // The cached static draws were recorded for one or the other
+            if (m_depthPrepass.update(m_overdraw->reset(commandBuffer, frameIndex, m_renderExtent)) && m_depthPrepassAvailable)
+                m_staticDraws->invalidate();
 
-                SimplePushConstantData push{};
+            bool prepass = m_depthPrepassAvailable && m_depthPrepass.isEnabled();
+            m_statOverdraw = m_depthPrepass.getOverdraw();
+            m_statDepthPrepass = prepass;
 
-                glm::mat4 modelMatrix = obj.transform.mat4();
-                push.modelMatrix = modelMatrix;
+            m_staticItems.clear();
+            m_dynamicItems.clear();
 
-                vkCmdPushConstants (
-                    commandBuffer,
-                    geoLayout,
-                    VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                    0,
-                    sizeof(SimplePushConstantData),
-                    &push
-                );
+            for (uint32_t i = 0; i < draws.packets.size(); i++)
+            {
+                const DrawPacket& packet = draws.packets[i];
+
+                // Not registered (yet), nothing to draw it with
+                if (packet.model >= models.size() || models[packet.model] == nullptr) continue;
+
+                if (packet.isStatic())
+                    m_staticItems.push_back({packet.sortKey, i});
+                else
+                    m_dynamicItems.push_back({packet.sortKey, i});
+            }
+
+            // The geometry subpass is recorded into secondaries, static ones are reused across frames
+            VkCommandBufferInheritanceInfo inheritance{};
+            inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+            inheritance.renderPass = def_Manager->getRenderPass();
+            inheritance.subpass = 0;
+            inheritance.framebuffer = VK_NULL_HANDLE;
+
+            // Executed inside OverdrawCounter's queries
+            if (m_overdraw->isSupported())
+            {
+                inheritance.occlusionQueryEnable = VK_TRUE;
+                inheritance.queryFlags = VK_QUERY_CONTROL_PRECISE_BIT;
+            }
+
+            m_secondaryCount = 0;
+            m_depthSecondaryCount = 0;
+
+            // Static draws take the first slots, so the cached secondaries keep theirs
+            uint32_t dynamicSlot = static_cast<uint32_t>(m_staticItems.size());
+
+            if (!m_staticItems.empty())
+            {
+                uint64_t signature = StaticDrawCache::signature(m_staticItems, draws.packets);
+
+                // Sorted only when re-recorded
+                if (m_staticDraws->needsRecording(frameIndex, signature))
+                {
+                    radixSort(m_staticItems, m_drawItemsScratch);
+
+                    VkCommandBuffer staticCmd = m_staticDraws->beginStatic(frameIndex, signature, inheritance);
+                    recordGeometry(staticCmd, frameIndex, 0, draws, models, m_staticItems, descriptors, prepass);
+                    StaticDrawCache::end(staticCmd);
+
+                    if (prepass)
+                    {
+                        VkCommandBuffer depthCmd = m_staticDraws->beginStaticDepth(frameIndex, inheritance);
+                        recordDepthPrepass(depthCmd, frameIndex, 0, draws, models, m_staticItems, descriptors);
+                        StaticDrawCache::end(depthCmd);
+                    }
+
+                    if (m_occlusion)
+                        m_occlusion->writeObjects(frameIndex, 0, m_staticItems, draws, models);
+                }
+
+                m_secondaries[m_secondaryCount++] = m_staticDraws->getStatic(frameIndex);
+                if (prepass)
+                    m_depthSecondaries[m_depthSecondaryCount++] = m_staticDraws->getStaticDepth(frameIndex);
+            }
+
+            if (!m_dynamicItems.empty())
+            {
+                radixSort(m_dynamicItems, m_drawItemsScratch);
+
+                VkCommandBuffer dynamicCmd = m_staticDraws->beginDynamic(frameIndex, inheritance);
+                recordGeometry(dynamicCmd, frameIndex, dynamicSlot, draws, models, m_dynamicItems, descriptors, prepass);
+                StaticDrawCache::end(dynamicCmd);
+
+                if (prepass)
+                {
+                    VkCommandBuffer depthCmd = m_staticDraws->beginDynamicDepth(frameIndex, inheritance);
+                    recordDepthPrepass(depthCmd, frameIndex, dynamicSlot, draws, models, m_dynamicItems, descriptors);
+                    StaticDrawCache::end(depthCmd);
+
+                    m_depthSecondaries[m_depthSecondaryCount++] = depthCmd;
+                }
+
+                if (m_occlusion)
+                    m_occlusion->writeObjects(frameIndex, dynamicSlot, m_dynamicItems, draws, models);
 
-                obj.model->bind(commandBuffer);
-                obj.model->draw(commandBuffer);
+                m_secondaries[m_secondaryCount++] = dynamicCmd;
             }
 
+            if (m_occlusion)
+            {
+                m_cullViewProj = viewProj;
+                m_occlusion->cullVisible(commandBuffer, frameIndex, dynamicSlot + static_cast<uint32_t>(m_dynamicItems.size()), viewProj);
+            }
+        }
+
+        // Backend thread, inside a GeometryOnly or ResumeGeometryOnly pass. Occlusion culling's first phase is what the
+        // previous frame's pyramid let through, the second one whatever cullDisoccluded uncovered
+        void renderGeometryOnly(VkCommandBuffer commandBuffer, int frameIndex)
+        {
+            executeGeometry(commandBuffer, frameIndex);
+            vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+        }
+
+        // Backend thread, occlusion culling only. Between the GeometryOnly and the Resume pass, imageIndex picks the depth attachment
+        void cullDisoccluded(VkCommandBuffer commandBuffer, int frameIndex, uint32_t imageIndex)
+        {
+            m_occlusion->cullDisoccluded(commandBuffer, frameIndex, imageIndex, m_cullViewProj);
+        }
+
+        // Backend thread, inside the Clear (or Resume) pass, after prepareGeometry. imageIndex picks the input
+        // attachments of the framebuffer being rendered to. Without withGeometry a GeometryOnly pass already drew all of it.
+        void defferedRender(VkCommandBuffer commandBuffer, int frameIndex, std::vector<VkDescriptorSet> descriptors, uint32_t imageIndex, bool withGeometry = true)
+        {
+            if (withGeometry)
+                executeGeometry(commandBuffer, frameIndex);
             vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
 
+            // Lit after the pass by renderTiledLighting
+            if (m_tiledLighting) return;
+
+            setViewportAndScissor(commandBuffer);
             lightPipeline->bind(commandBuffer);
 
-            descriptors.push_back(def_Manager->getInputAttachmentDescriptorSet(frameInfo.frameIndex));
+            descriptors.push_back(def_Manager->getInputAttachmentDescriptorSet(imageIndex));
+            descriptors.push_back(m_clusteredLights->getDescriptorSet(frameIndex));
+            descriptors.push_back(m_shadows->getDescriptorSet(frameIndex));
+            descriptors.push_back(m_ambientOcclusion->getDescriptorSet(imageIndex));
             
             vkCmdBindDescriptorSets(
                 commandBuffer,
@@ -136,8 +509,179 @@ namespace Orasis {
 
         }
 
+        // Called by the owner whenever static objects, their models or transforms change
+        void invalidateStaticDraws() { m_staticDraws->invalidate(); }
+
+        // Extra G-buffer pipeline (e.g. a material variant), returns the id to put in
+        // GameObject::pipelineId (it travels in the draw packets' sort key). Objects using it are drawn with the default pipeline until it's compiled.
+        // Its vertex shader has to declare gl_Position invariant and compute it like depth_prepass.vert.
+        uint32_t addGeometryVariant(const GeometryVariant& variant)
+        {
+            m_geoPipelines.push_back(requestGeometryPipeline(variant.vertPath, variant.fragPath, false, true));
+            if (m_depthPrepassAvailable)
+                m_geoEqualPipelines.push_back(requestGeometryPipeline(variant.vertPath, variant.fragPath, true, true));
+            return static_cast<uint32_t>(m_geoPipelines.size() - 1);
+        }
+
         private:
 
+        // The first depth test passing writes of the geometry get counted, the pre-pass' if it's on
+        void executeGeometry(VkCommandBuffer commandBuffer, int frameIndex)
+        {
+            m_overdraw->begin(commandBuffer, frameIndex);
+
+            if (m_depthSecondaryCount > 0)
+            {
+                vkCmdExecuteCommands(commandBuffer, m_depthSecondaryCount, m_depthSecondaries.data());
+                m_overdraw->end(commandBuffer, frameIndex);
+            }
+
+            if (m_secondaryCount > 0)
+                vkCmdExecuteCommands(commandBuffer, m_secondaryCount, m_secondaries.data());
+
+            m_overdraw->end(commandBuffer, frameIndex);
+        }
+
+        // What the Upscaler reads, the compute lighting's lit images or the lighting subpass' output
+        std::vector<VkImageView> upscaleSources()
+        {
+            const RenderGraph& graph = def_Manager->getFrameGraph();
+            RenderGraph::Resource source = graph.find(m_tiledLighting ? "LitColor" : "SceneColor");
+
+            std::vector<VkImageView> sources{};
+
+            for (uint32_t i = 0; i < def_Manager->imageCount(); i++)
+                sources.push_back(graph.getImageView(source, i));
+
+            return sources;
+        }
+
+        void setViewportAndScissor(VkCommandBuffer commandBuffer)
+        {
+            VkExtent2D extent = m_renderExtent;
+
+            VkViewport viewport{0.f, 0.f, static_cast<float>(extent.width), static_cast<float>(extent.height), 0.f, 1.f};
+            VkRect2D scissor{{0, 0}, extent};
+
+            vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+            vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+        }
+
+        // Positions only, one pipeline for everything. Same slots and so the same culling results as recordGeometry
+        void recordDepthPrepass(VkCommandBuffer commandBuffer, int frameIndex, uint32_t firstSlot, const DrawList& draws, const std::vector<std::shared_ptr<Model>>& models, const std::vector<DrawItem>& items, const std::vector<VkDescriptorSet>& descriptors)
+        {
+            setViewportAndScissor(commandBuffer);
+
+            vkCmdBindDescriptorSets(
+                commandBuffer,
+                VK_PIPELINE_BIND_POINT_GRAPHICS,
+                geoLayout,
+                0,
+                static_cast<uint32_t>(descriptors.size()),
+                descriptors.data(),
+                0, nullptr
+            );
+
+            depthPipeline->bind(commandBuffer);
+
+            const Model* boundModel = nullptr;
+            uint32_t slot = firstSlot;
+
+            for (const DrawItem& item : items)
+            {
+                const DrawPacket& packet = draws.packets[item.index];
+                Model* model = models[packet.model].get();
+
+                SimplePushConstantData push{};
+                push.modelMatrix = draws.transforms[packet.transform];
+
+                vkCmdPushConstants(commandBuffer, geoLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(SimplePushConstantData), &push);
+
+                if (model != boundModel)
+                {
+                    model->bindPositions(commandBuffer);
+                    boundModel = model;
+                }
+
+                if (m_occlusion && slot < OcclusionCulling::MAX_DRAWS)
+                    model->drawIndirect(commandBuffer, m_occlusion->getCommandBuffer(frameIndex), OcclusionCulling::commandOffset(slot));
+                else
+                    model->draw(commandBuffer);
+
+                slot++;
+            }
+        }
+
+        // firstSlot is the occlusion culling slot of items[0], the rest follow in order.
+        // afterPrepass picks the EQUAL tested pipelines, depth is already complete then
+        void recordGeometry(VkCommandBuffer commandBuffer, int frameIndex, uint32_t firstSlot, const DrawList& draws, const std::vector<std::shared_ptr<Model>>& models, const std::vector<DrawItem>& items, const std::vector<VkDescriptorSet>& descriptors, bool afterPrepass)
+        {
+            // Secondaries don't inherit dynamic state from the primary
+            setViewportAndScissor(commandBuffer);
+
+            // Every variant shares geoLayout, so the sets stay valid across pipeline switches
+            vkCmdBindDescriptorSets(
+                commandBuffer,
+                VK_PIPELINE_BIND_POINT_GRAPHICS,
+                geoLayout,
+                0,
+                static_cast<uint32_t>(descriptors.size()),
+                descriptors.data(),
+                0, nullptr
+            );
+
+            const Model* boundModel = nullptr;
+            Pipeline* boundPipeline = nullptr;
+
+            uint32_t slot = firstSlot;
+
+            for (const DrawItem& item : items)
+            {
+                const DrawPacket& packet = draws.packets[item.index];
+                Model* model = models[packet.model].get();
+
+                Pipeline* pipeline = afterPrepass ? geoEqualPipeline : geoPipeline;
+                uint32_t pipelineId = SortKey::pipeline(packet.sortKey);
+
+                if (pipelineId != 0 && pipelineId < m_geoPipelines.size())
+                    pipeline = afterPrepass ? m_compiler.getOr(m_geoEqualPipelines[pipelineId], geoEqualPipeline) : m_compiler.getOr(m_geoPipelines[pipelineId], geoPipeline);
+
+                if (pipeline != boundPipeline)
+                {
+                    pipeline->bind(commandBuffer);
+                    boundPipeline = pipeline;
+                }
+
+                SimplePushConstantData push{};
+
+                push.modelMatrix = draws.transforms[packet.transform];
+
+                vkCmdPushConstants (
+                    commandBuffer,
+                    geoLayout,
+                    VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                    0,
+                    sizeof(SimplePushConstantData),
+                    &push
+                );
+
+                // Consecutive draws of the same mesh keep the vertex/index buffers bound
+                if (model != boundModel)
+                {
+                    model->bind(commandBuffer);
+                    boundModel = model;
+                }
+
+                // The culling writes each slot's instance count, slots past MAX_DRAWS are always drawn
+                if (m_occlusion && slot < OcclusionCulling::MAX_DRAWS)
+                    model->drawIndirect(commandBuffer, m_occlusion->getCommandBuffer(frameIndex), OcclusionCulling::commandOffset(slot));
+                else
+                    model->draw(commandBuffer);
+
+                slot++;
+            }
+        }
+
 
         void createGeometryLayout(std::vector<VkDescriptorSetLayout> layoutToSet)
         {
@@ -176,42 +720,106 @@ namespace Orasis {
                 throw std::runtime_error("failed to create pipeline layout");  
         }
 
-        void createGeometryPipeline(VkRenderPass defferedRenderPass)
+        // What the manifest keeps of a G-buffer pipeline of this system
+        PipelineRecord geometryRecord(const std::string& vertPath, const std::string& fragPath, bool depthEqual, bool geometryVariant) const
         {
-            Orasis::PipelineConfigInfo pipelineConfig{};
-            Pipeline::defaultPipelineConfigInfo(pipelineConfig, def_Manager->getAttachmentsCountPerSubpass(0) - 1);
+            PipelineRecord record{};
+            record.vertPath = vertPath;
+            record.fragPath = fragPath;
+            record.creationFlag = 1;
+            record.subpass = 0;
+            record.colorAttachmentCount = static_cast<uint32_t>(def_Manager->getAttachmentsCountPerSubpass(0) - 1);
+            record.renderPass = def_Manager->getGBufferLayout() == GBufferLayout::Packed ? "Deffered/Packed" : "Deffered/Full";
+            record.layout = "Geometry";
+            record.depthEqual = depthEqual;
+            record.geometryVariant = geometryVariant;
+            return record;
+        }
 
-            pipelineConfig.renderPass = defferedRenderPass;
-            pipelineConfig.pipelineLayout = geoLayout;
-            pipelineConfig.subpass = 0;
-            pipelineConfig.PipelineCreationFlag = 1; // 1 -> GeoPipeline
-            
-            geoPipeline = std::make_unique<Pipeline>
-            (
-                m_device,
-                "C:/Users/thedarkchoco/Desktop/vs_code/Orasis_Engine/shaders/compiledShaders/dG_shader.vert.spv",
-                "C:/Users/thedarkchoco/Desktop/vs_code/Orasis_Engine/shaders/compiledShaders/dG_shader.frag.spv",
-                pipelineConfig
-            );
+        // Every recorded G-buffer pipeline this configuration can build, other G-buffer layouts' are skipped
+        void replayRecordedPipelines()
+        {
+            for (const PipelineRecord& record : m_device.recordedPipelines())
+            {
+                if (record != geometryRecord(record.vertPath, record.fragPath, record.depthEqual, record.geometryVariant))
+                    continue;
+
+                if (record.depthEqual && !m_depthPrepassAvailable)
+                    continue;
+
+                m_prewarmed.push_back({record, compileGeometryPipeline(record.vertPath, record.fragPath, record.depthEqual)});
+            }
+        }
+
+        // depthEqual for after the depth pre-pass: only the nearest surface passes, depth is left as it is.
+        // Takes over the replayed pipeline if there is one, and records it for the next run
+        PipelineCompiler::Handle requestGeometryPipeline(const std::string& vertPath, const std::string& fragPath, bool depthEqual = false, bool geometryVariant = false)
+        {
+            PipelineRecord record = geometryRecord(vertPath, fragPath, depthEqual, geometryVariant);
+            m_device.recordPipeline(record);
+
+            for (auto it = m_prewarmed.begin(); it != m_prewarmed.end(); ++it)
+                if (it->record == record)
+                {
+                    PipelineCompiler::Handle handle = it->handle;
+                    m_prewarmed.erase(it);
+                    return handle;
+                }
+
+            return compileGeometryPipeline(vertPath, fragPath, depthEqual);
+        }
+
+        PipelineCompiler::Handle compileGeometryPipeline(const std::string& vertPath, const std::string& fragPath, bool depthEqual)
+        {
+            auto pipelineConfig = std::make_unique<PipelineConfigInfo>();
+            Pipeline::defaultPipelineConfigInfo(*pipelineConfig, def_Manager->getAttachmentsCountPerSubpass(0) - 1);
+
+            if (depthEqual)
+            {
+                pipelineConfig->depthStencilInfo.depthCompareOp = VK_COMPARE_OP_EQUAL;
+                pipelineConfig->depthStencilInfo.depthWriteEnable = VK_FALSE;
+            }
+
+            pipelineConfig->renderPass = def_Manager->getRenderPass();
+            pipelineConfig->pipelineLayout = geoLayout;
+            pipelineConfig->subpass = 0;
+            pipelineConfig->PipelineCreationFlag = 1; // 1 -> GeoPipeline
             
+            return m_compiler.request(vertPath, fragPath, std::move(pipelineConfig));
         }
         
+        // Positions only, writes depth and nothing else
+        void requestDepthPrepassPipeline()
+        {
+            auto pipelineConfig = std::make_unique<PipelineConfigInfo>();
+            Pipeline::depthPrepassConfigInfo(*pipelineConfig, def_Manager->getAttachmentsCountPerSubpass(0) - 1);
+
+            pipelineConfig->renderPass = def_Manager->getRenderPass();
+            pipelineConfig->pipelineLayout = geoLayout;
+            pipelineConfig->subpass = 0;
+
+            m_depthPipelineHandle = m_compiler.request("C:/Users/thedarkchoco/Desktop/vs_code/Orasis_Engine/shaders/compiledShaders/depth_prepass.vert.spv", "", std::move(pipelineConfig));
+        }
+
         void createLightingPipeline(VkRenderPass defferedRenderPass)
         {
-            Orasis::PipelineConfigInfo pipelineConfig{};
-            Pipeline::defaultPipelineConfigInfo (pipelineConfig, def_Manager->getAttachmentsCountPerSubpass(1));
+            bool packed = def_Manager->getGBufferLayout() == GBufferLayout::Packed;
+
+            auto pipelineConfig = std::make_unique<PipelineConfigInfo>();
+            Pipeline::defaultPipelineConfigInfo (*pipelineConfig, def_Manager->getAttachmentsCountPerSubpass(1));
             
-            pipelineConfig.renderPass = defferedRenderPass;
-            pipelineConfig.pipelineLayout = lightLayout;
-            pipelineConfig.subpass = 1;
-            pipelineConfig.PipelineCreationFlag = 2; // 2 -> GeoPipeline
+            pipelineConfig->renderPass = defferedRenderPass;
+            pipelineConfig->pipelineLayout = lightLayout;
+            pipelineConfig->subpass = 1;
+            pipelineConfig->PipelineCreationFlag = 2; // 2 -> LightPipeline
             
-            lightPipeline = std::make_unique<Pipeline>
+            m_lightPipelineHandle = m_compiler.request
             (
-                m_device,
                 "C:/Users/thedarkchoco/Desktop/vs_code/Orasis_Engine/shaders/compiledShaders/dL_shader.vert.spv",
-                "C:/Users/thedarkchoco/Desktop/vs_code/Orasis_Engine/shaders/compiledShaders/dL_shader.frag.spv",
-                pipelineConfig
+                packed ?
+                    "C:/Users/thedarkchoco/Desktop/vs_code/Orasis_Engine/shaders/compiledShaders/dL_shader.frag.spv" :
+                    "C:/Users/thedarkchoco/Desktop/vs_code/Orasis_Engine/shaders/compiledShaders/dL_full.frag.spv",
+                std::move(pipelineConfig)
             );
             
         }
@@ -0,0 +1,573 @@
+#pragma once
+
+#include "Header_Includes/Render_Systems_Headers.hpp"
+#include "Buffer.hpp"
+#include "Descriptors.hpp"
+#include "Image.hpp"
+#include "Manager.hpp"
+#include "PipelineCompiler.hpp"
+#include "RenderFrontend.hpp"
+#include "SwapChain.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+namespace Orasis {
+
+
+    // Matches CullObject in occlusion_cull.comp (std430)
+    struct CullObject {
+        glm::vec4 boundsMin{0.f};       // world space AABB, w unused
+        glm::vec4 boundsMax{0.f};
+        glm::uvec4 draw{0u};            // x index (or vertex) count
+    };
+
+    // Matches CullUbo in occlusion_cull.comp (std140)
+    struct CullUbo {
+        glm::mat4 viewProj{1.f};
+        glm::mat4 previousViewProj{1.f};    // the camera the pyramid was built with
+        glm::vec4 pyramid{0.f};             // rendered depth width, height, mip count, 1 if the pyramid holds a previous frame
+        glm::uvec4 counts{0u};              // x draw slots
+    };
+
+    // What the last finished frame drew, a few frames old
+    struct OcclusionStats {
+        uint32_t candidates{0};             // draws that passed the frontend's frustum culling
+        uint32_t firstPhase{0};             // drawn against the previous frame's pyramid
+        uint32_t secondPhase{0};            // disoccluded, drawn after re-testing against this frame's
+        uint32_t triangles{0};              // by both phases
+    };
+
+
+    /*
+        Two phase occlusion culling of the geometry subpass against a hierarchical depth buffer.
+        Every draw of the geometry secondaries is an indirect draw with its own command slot,
+        occlusion_cull.comp only writes the instance count (0 or 1) of each slot.
+
+            1. cullVisible: every slot's bounds are tested against the previous frame's depth
+               pyramid, projected with the camera that pyramid was built with. The secondaries
+               run in the GeometryOnly pass.
+            2. cullDisoccluded: hiz_reduce.comp builds this frame's pyramid from that depth (each
+               texel the farthest depth under it), the slots phase 1 rejected are re-tested with
+               the current camera and the same secondaries run again in the Resume pass, which
+               then goes on with the lighting. Slots phase 1 drew get 0 instances.
+
+        Whatever phase 1 wrongly culled (disocclusion, camera movement, moving objects) is drawn
+        by phase 2 in the same frame, so nothing pops. The pyramid is shared by the frames in
+        flight, each frame's build is ordered after the previous frame's read by the barriers.
+    */
+    class OcclusionCulling {
+
+        public:
+
+            // Draw slots past it aren't culled, they're drawn in both phases (the second one fails the depth test)
+            static constexpr uint32_t MAX_DRAWS = 1 << 16;
+
+            // local_size_x of occlusion_cull.comp, local_size_x/y of hiz_reduce.comp
+            static constexpr uint32_t CULL_GROUP_SIZE = 64;
+            static constexpr uint32_t REDUCE_GROUP_SIZE = 8;
+
+            static VkDeviceSize commandOffset(uint32_t slot) { return slot * sizeof(VkDrawIndexedIndirectCommand); }
+
+        private:
+
+            enum Phase : uint32_t {
+                Visible = 0,
+                Disoccluded = 1
+            };
+
+            struct Push {
+                uint32_t phase;
+            };
+
+            // Only the rendered part of the source level is read
+            struct ReducePush {
+                glm::ivec2 sourceSize;
+            };
+
+            struct FrameResources {
+                std::unique_ptr<Buffer> params;
+                std::unique_ptr<Buffer> objects;
+                std::unique_ptr<Buffer> commands;
+                std::unique_ptr<Buffer> stats;          // phase 1 draws, phase 2 draws, triangles, pad
+                VkDescriptorSet cullSet{VK_NULL_HANDLE};
+                uint32_t slotCount{0};
+                uint32_t candidates{0};
+            };
+
+            // -------- MEMBER VARIABLES -------- //
+
+            Device& m_device;
+            PipelineCompiler& m_compiler;
+
+            VkSampler m_sampler;
+
+            std::unique_ptr<DescriptorSetLayout> m_cullSetLayout;
+            std::unique_ptr<DescriptorSetLayout> m_reduceSetLayout;
+            std::unique_ptr<DescriptorPool> m_pool;
+            std::array<FrameResources, SwapChain::MAX_FRAMES_IN_FLIGHT> m_frames{};
+
+            // Level 0 of the pyramid is half the depth attachment
+            std::shared_ptr<Image> m_pyramid;
+            std::vector<VkDescriptorSet> m_depthReduceSets{};       // per swap chain image, depth -> level 0
+            std::vector<VkDescriptorSet> m_levelReduceSets{};       // level i -> level i + 1
+
+            VkPipelineLayout m_cullLayout;
+            VkPipelineLayout m_reduceLayout;
+            std::array<PipelineCompiler::Handle, 2> m_handles{};
+            Pipeline* m_cull = nullptr;
+            Pipeline* m_reduce = nullptr;
+
+            VkExtent2D m_extent{};
+            VkExtent2D m_renderExtent{};            // dynamic resolution, the part of depth that gets rendered to
+            bool m_pyramidInitialized{false};
+            bool m_historyValid{false};
+            glm::mat4 m_pyramidViewProj{1.f};
+            VkExtent2D m_pyramidExtent{};           // the render extent the pyramid was built from
+
+            std::atomic<uint32_t> m_statCandidates{0};
+            std::atomic<uint32_t> m_statFirstPhase{0};
+            std::atomic<uint32_t> m_statSecondPhase{0};
+            std::atomic<uint32_t> m_statTriangles{0};
+
+            // -------- -------- -------- -------- //
+
+        public:
+
+            // -------- CONSTRUCTOR etc -------- //
+
+            // Pipelines are only requested, call waitForPipelines before the first frame
+            OcclusionCulling(Device& device, PipelineCompiler& compiler, Manager& manager, VkExtent2D extent)
+            :m_device{device}, m_compiler{compiler}
+            {
+                createSampler();
+
+                // 0 params, 1 objects, 2 draw commands, 3 stats, 4 depth pyramid
+                m_cullSetLayout =
+                    DescriptorSetLayout::Builder(m_device)
+                        .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                        .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                        .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                        .addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                        .addBinding(4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+                        .build();
+
+                // 0 source level (or the depth attachment), 1 destination level
+                m_reduceSetLayout =
+                    DescriptorSetLayout::Builder(m_device)
+                        .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+                        .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT)
+                        .build();
+
+                m_cullLayout = createLayout(m_cullSetLayout->getDescriptorSetLayout(), sizeof(Push));
+                m_reduceLayout = createLayout(m_reduceSetLayout->getDescriptorSetLayout(), sizeof(ReducePush));
+
+                m_handles[0] = requestPipeline("C:/Users/thedarkchoco/Desktop/vs_code/Orasis_Engine/shaders/compiledShaders/occlusion_cull.comp.spv", m_cullLayout);
+                m_handles[1] = requestPipeline("C:/Users/thedarkchoco/Desktop/vs_code/Orasis_Engine/shaders/compiledShaders/hiz_reduce.comp.spv", m_reduceLayout);
+
+                createFrameResources();
+                createPyramid(manager, extent);
+            }
+
+            ~OcclusionCulling()
+            {
+                for (PipelineCompiler::Handle handle : m_handles)
+                    m_compiler.release(handle);
+
+                vkDestroyPipelineLayout(m_device.device(), m_cullLayout, nullptr);
+                vkDestroyPipelineLayout(m_device.device(), m_reduceLayout, nullptr);
+                vkDestroySampler(m_device.device(), m_sampler, nullptr);
+            }
+
+            OcclusionCulling(const OcclusionCulling&) = delete;
+            OcclusionCulling &operator=(const OcclusionCulling&) = delete;
+
+            // -------- -------- -------- -------- //
+
+
+
+
+            // -------- FUNCTIONS -------- //
+
+            void waitForPipelines()
+            {
+                m_cull = &m_compiler.wait(m_handles[0]);
+                m_reduce = &m_compiler.wait(m_handles[1]);
+            }
+
+            VkBuffer getCommandBuffer(int frameIndex) const { return m_frames[frameIndex].commands->getBuffer(); }
+
+            // A different render area than the pyramid's is a frame without history
+            void setRenderExtent(VkExtent2D extent) { m_renderExtent = extent; }
+
+            OcclusionStats getStats() const
+            {
+                return {m_statCandidates.load(), m_statFirstPhase.load(), m_statSecondPhase.load(), m_statTriangles.load()};
+            }
+
+            // After Manager::resize, frames still in flight keep the old pyramid until they're done
+            void resize(Manager& manager, VkExtent2D extent)
+            {
+                m_device.deletionQueue().retire(std::move(m_pyramid));
+                m_device.deletionQueue().retire(std::move(m_pool));
+
+                createPyramid(manager, extent);
+            }
+
+            // Backend thread. Bounds and draw counts of the draws recorded into slots firstSlot.. (in recording order),
+            // the frame's previous use has to be finished. Static slots are only written when their secondary is re-recorded.
+            void writeObjects(int frameIndex, uint32_t firstSlot, const std::vector<DrawItem>& items, const DrawList& draws, const std::vector<std::shared_ptr<Model>>& models)
+            {
+                CullObject* objects = static_cast<CullObject*>(m_frames[frameIndex].objects->getMappedMemory());
+
+                uint32_t end = static_cast<uint32_t>(std::min<size_t>(firstSlot + items.size(), MAX_DRAWS));
+
+                for (uint32_t slot = firstSlot; slot < end; slot++)
+                {
+                    const DrawPacket& packet = draws.packets[items[slot - firstSlot].index];
+                    const Model& model = *models[packet.model];
+
+                    AABB bounds = model.getBoundingBox().transformed(draws.transforms[packet.transform]);
+
+                    objects[slot].boundsMin = glm::vec4{bounds.min, 0.f};
+                    objects[slot].boundsMax = glm::vec4{bounds.max, 0.f};
+                    objects[slot].draw = glm::uvec4{model.getDrawCount(), 0u, 0u, 0u};
+                }
+            }
+
+            /*
+                Outside of a render pass, before the GeometryOnly pass. slotCount are the draw slots
+                the secondaries of this frame use, all of them written by writeObjects by now.
+            */
+            void cullVisible(VkCommandBuffer commandBuffer, int frameIndex, uint32_t slotCount, const glm::mat4& viewProj)
+            {
+                FrameResources& frame = m_frames[frameIndex];
+
+                readStats(frame);
+
+                frame.slotCount = std::min(slotCount, MAX_DRAWS);
+                frame.candidates = slotCount;
+
+                CullUbo params{};
+                params.viewProj = viewProj;
+                params.previousViewProj = m_pyramidViewProj;
+                bool historyValid = m_historyValid && m_pyramidExtent.width == m_renderExtent.width && m_pyramidExtent.height == m_renderExtent.height;
+
+                params.pyramid = {
+                    static_cast<float>(m_renderExtent.width),
+                    static_cast<float>(m_renderExtent.height),
+                    static_cast<float>(m_pyramid->s_mipLevels),
+                    historyValid ? 1.f : 0.f
+                };
+                params.counts = {frame.slotCount, 0u, 0u, 0u};
+                frame.params->writeToBuffer(&params);
+
+                vkCmdFillBuffer(commandBuffer, frame.stats->getBuffer(), 0, VK_WHOLE_SIZE, 0);
+
+                if (!m_pyramidInitialized)
+                {
+                    // Never sampled before a build, m_historyValid is still false
+                    pyramidBarrier(commandBuffer,
+                        VK_IMAGE_LAYOUT_UNDEFINED,
+                        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,
+                        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+                    m_pyramidInitialized = true;
+                }
+
+                // The previous frame's pyramid build and the stats reset
+                memoryBarrier(commandBuffer,
+                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+                dispatchCull(commandBuffer, frame, Visible);
+
+                memoryBarrier(commandBuffer,
+                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                    VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+            }
+
+            /*
+                Between the GeometryOnly and the Resume pass. Builds this frame's pyramid from the depth
+                attachment of imageIndex (left in DEPTH_STENCIL_READ_ONLY by the pass), then re-tests what
+                cullVisible rejected. viewProj has to be the one cullVisible got.
+            */
+            void cullDisoccluded(VkCommandBuffer commandBuffer, int frameIndex, uint32_t imageIndex, const glm::mat4& viewProj)
+            {
+                FrameResources& frame = m_frames[frameIndex];
+
+                // Phase 1 read the pyramid and the indirect draws read the commands, both get rewritten.
+                // Phase 2 also reads which slots phase 1 drew
+                memoryBarrier(commandBuffer,
+                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+                // ---- Depth pyramid ----
+                m_reduce->bind(commandBuffer);
+
+                for (uint32_t level = 0; level < m_pyramid->s_mipLevels; level++)
+                {
+                    VkDescriptorSet set = level == 0 ? m_depthReduceSets[imageIndex] : m_levelReduceSets[level - 1];
+
+                    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_reduceLayout, 0, 1, &set, 0, nullptr);
+
+                    // Texels past the render area would mix in stale depth
+                    VkExtent2D source = level == 0 ? m_renderExtent : levelExtent(m_renderExtent, level - 1);
+                    VkExtent2D size = levelExtent(m_renderExtent, level);
+
+                    ReducePush push{{static_cast<int32_t>(source.width), static_cast<int32_t>(source.height)}};
+                    vkCmdPushConstants(commandBuffer, m_reduceLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ReducePush), &push);
+
+                    vkCmdDispatch(commandBuffer, (size.width + REDUCE_GROUP_SIZE - 1) / REDUCE_GROUP_SIZE, (size.height + REDUCE_GROUP_SIZE - 1) / REDUCE_GROUP_SIZE, 1);
+
+                    memoryBarrier(commandBuffer,
+                        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+                }
+
+                m_pyramidViewProj = viewProj;
+                m_pyramidExtent = m_renderExtent;
+                m_historyValid = true;
+
+                // ---- Re-test against it ----
+                dispatchCull(commandBuffer, frame, Disoccluded);
+
+                memoryBarrier(commandBuffer,
+                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                    VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+            }
+
+        private:
+
+            void dispatchCull(VkCommandBuffer commandBuffer, FrameResources& frame, Phase phase)
+            {
+                // Re-writing the params here would race the GPU, they're uploaded once by cullVisible
+                m_cull->bind(commandBuffer);
+
+                vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullLayout, 0, 1, &frame.cullSet, 0, nullptr);
+
+                Push push{phase};
+                vkCmdPushConstants(commandBuffer, m_cullLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Push), &push);
+
+                if (frame.slotCount > 0)
+                    vkCmdDispatch(commandBuffer, (frame.slotCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+            }
+
+            // The frame's previous submission is done by now (FrameScheduler::beginFrame)
+            void readStats(const FrameResources& frame)
+            {
+                const uint32_t* stats = static_cast<const uint32_t*>(frame.stats->getMappedMemory());
+
+                m_statCandidates = frame.candidates;
+                m_statFirstPhase = stats[0];
+                m_statSecondPhase = stats[1];
+                m_statTriangles = stats[2];
+            }
+
+            static VkExtent2D levelExtent(VkExtent2D size, uint32_t level)
+            {
+                for (uint32_t i = 0; i <= level; i++)
+                    size = {std::max((size.width + 1) / 2, 1u), std::max((size.height + 1) / 2, 1u)};
+
+                return size;
+            }
+
+            void createFrameResources()
+            {
+                for (FrameResources& frame : m_frames)
+                {
+                    frame.params = std::make_unique<Buffer>(
+                        m_device,
+                        sizeof(CullUbo),
+                        1,
+                        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                        m_device.properties.limits.minUniformBufferOffsetAlignment
+                    );
+                    frame.params->map();
+
+                    // Written by the CPU, the static part only when re-recorded
+                    frame.objects = std::make_unique<Buffer>(
+                        m_device,
+                        sizeof(CullObject),
+                        MAX_DRAWS,
+                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+                    );
+                    frame.objects->map();
+
+                    frame.commands = std::make_unique<Buffer>(
+                        m_device,
+                        sizeof(VkDrawIndexedIndirectCommand),
+                        MAX_DRAWS,
+                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+                    );
+
+                    // Read back on the CPU a couple of frames later
+                    frame.stats = std::make_unique<Buffer>(
+                        m_device,
+                        sizeof(uint32_t),
+                        4,
+                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+                    );
+                    frame.stats->map();
+                    std::memset(frame.stats->getMappedMemory(), 0, sizeof(uint32_t) * 4);
+                }
+            }
+
+            // The pyramid and every set that points at it or at the depth attachments
+            void createPyramid(Manager& manager, VkExtent2D extent)
+            {
+                m_extent = extent;
+                m_renderExtent = extent;
+                m_pyramidInitialized = false;
+                m_historyValid = false;
+
+                m_pyramid = Image::createMipChain(m_device, manager.getAllocator(), levelExtent(extent, 0), VK_FORMAT_R32_SFLOAT,
+                    VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+
+                uint32_t imageCount = static_cast<uint32_t>(manager.imageCount());
+                uint32_t levelSets = m_pyramid->s_mipLevels - 1;
+                uint32_t frames = SwapChain::MAX_FRAMES_IN_FLIGHT;
+
+                m_pool =
+                    DescriptorPool::Builder(m_device)
+                        .setMaxSets(frames + imageCount + levelSets)
+                        .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frames)
+                        .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3 * frames)
+                        .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, frames + imageCount + levelSets)
+                        .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, imageCount + levelSets)
+                        .build();
+
+                // The pyramid stays in GENERAL, it's written and sampled by compute only
+                VkDescriptorImageInfo pyramidInfo{m_sampler, m_pyramid->s_imageView, VK_IMAGE_LAYOUT_GENERAL};
+
+                for (FrameResources& frame : m_frames)
+                {
+                    VkDescriptorBufferInfo paramsInfo = frame.params->descriptorInfo();
+                    VkDescriptorBufferInfo objectsInfo = frame.objects->descriptorInfo();
+                    VkDescriptorBufferInfo commandsInfo = frame.commands->descriptorInfo();
+                    VkDescriptorBufferInfo statsInfo = frame.stats->descriptorInfo();
+
+                    DescriptorWriter(*m_cullSetLayout, *m_pool)
+                        .writeBuffer(0, &paramsInfo)
+                        .writeBuffer(1, &objectsInfo)
+                        .writeBuffer(2, &commandsInfo)
+                        .writeBuffer(3, &statsInfo)
+                        .writeImage(4, &pyramidInfo)
+                        .build(frame.cullSet);
+                }
+
+                VkDescriptorImageInfo levelZeroInfo{VK_NULL_HANDLE, m_pyramid->getMipView(0), VK_IMAGE_LAYOUT_GENERAL};
+
+                m_depthReduceSets.resize(imageCount);
+
+                for (uint32_t i = 0; i < imageCount; i++)
+                {
+                    VkDescriptorImageInfo depthInfo{m_sampler, manager.getImageView("Depth", i), VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
+
+                    DescriptorWriter(*m_reduceSetLayout, *m_pool)
+                        .writeImage(0, &depthInfo)
+                        .writeImage(1, &levelZeroInfo)
+                        .build(m_depthReduceSets[i]);
+                }
+
+                m_levelReduceSets.resize(levelSets);
+
+                for (uint32_t level = 0; level < levelSets; level++)
+                {
+                    VkDescriptorImageInfo sourceInfo{m_sampler, m_pyramid->getMipView(level), VK_IMAGE_LAYOUT_GENERAL};
+                    VkDescriptorImageInfo destinationInfo{VK_NULL_HANDLE, m_pyramid->getMipView(level + 1), VK_IMAGE_LAYOUT_GENERAL};
+
+                    DescriptorWriter(*m_reduceSetLayout, *m_pool)
+                        .writeImage(0, &sourceInfo)
+                        .writeImage(1, &destinationInfo)
+                        .build(m_levelReduceSets[level]);
+                }
+            }
+
+            void createSampler()
+            {
+                // Only ever read with texelFetch
+                VkSamplerCreateInfo samplerInfo{};
+                samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+                samplerInfo.magFilter = VK_FILTER_NEAREST;
+                samplerInfo.minFilter = VK_FILTER_NEAREST;
+                samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+                samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+                samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+                samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+                samplerInfo.unnormalizedCoordinates = VK_FALSE;
+                samplerInfo.compareEnable = VK_FALSE;
+                samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+                samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+                if (vkCreateSampler(m_device.device(), &samplerInfo, nullptr, &m_sampler) != VK_SUCCESS)
+                    throw std::runtime_error("failed to create depth pyramid sampler");
+            }
+
+            VkPipelineLayout createLayout(VkDescriptorSetLayout setLayout, uint32_t pushSize)
+            {
+                VkPushConstantRange pushConstantRange{};
+                pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+                pushConstantRange.offset = 0;
+                pushConstantRange.size = pushSize;
+
+                VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+                pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+                pipelineLayoutInfo.setLayoutCount = 1;
+                pipelineLayoutInfo.pSetLayouts = &setLayout;
+                pipelineLayoutInfo.pushConstantRangeCount = pushSize > 0 ? 1 : 0;
+                pipelineLayoutInfo.pPushConstantRanges = pushSize > 0 ? &pushConstantRange : nullptr;
+
+                VkPipelineLayout layout;
+
+                if (vkCreatePipelineLayout(m_device.device(), &pipelineLayoutInfo, nullptr, &layout) != VK_SUCCESS)
+                    throw std::runtime_error("failed to create pipeline layout");
+
+                return layout;
+            }
+
+            PipelineCompiler::Handle requestPipeline(const std::string& computePath, VkPipelineLayout layout)
+            {
+                auto pipelineConfig = std::make_unique<PipelineConfigInfo>();
+                pipelineConfig->pipelineLayout = layout;
+
+                return m_compiler.request(computePath, "", std::move(pipelineConfig));
+            }
+
+            static void memoryBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+            {
+                VkMemoryBarrier barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+                barrier.srcAccessMask = srcAccess;
+                barrier.dstAccessMask = dstAccess;
+
+                vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+            }
+
+            // Every level at once, the pyramid only ever leaves UNDEFINED
+            void pyramidBarrier(
+                VkCommandBuffer commandBuffer, VkImageLayout oldLayout,
+                VkPipelineStageFlags srcStage, VkAccessFlags srcAccess,
+                VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+            {
+                VkImageMemoryBarrier barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                barrier.oldLayout = oldLayout;
+                barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+                barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.image = m_pyramid->s_image;
+                barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, m_pyramid->s_mipLevels, 0, 1};
+                barrier.srcAccessMask = srcAccess;
+                barrier.dstAccessMask = dstAccess;
+
+                vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+            }
+    };
+
+}
@@ -0,0 +1,592 @@
+#pragma once
+
+#include "Header_Includes/Render_Systems_Headers.hpp"
+#include "Buffer.hpp"
+#include "Descriptors.hpp"
+#include "Image.hpp"
+#include "PipelineCompiler.hpp"
+#include "RenderFrontend.hpp"
+#include "SwapChain.hpp"
+
+#include <algorithm>
+
+namespace Orasis {
+
+
+    // Matches ShadowUbo in deferred_lighting.glsl (std140)
+    struct ShadowUbo {
+        std::array<glm::mat4, ShadowConfig::CASCADES> cascadeViewProj{};
+        std::array<glm::mat4, ShadowConfig::POINT_LIGHTS * 6> pointViewProj{};
+        glm::vec4 cascadeSplits{0.f};       // view depth each cascade reaches to
+        glm::vec4 cascadeTexels{0.f};       // world size of a texel per cascade
+        glm::vec4 sunDirection{0.f};        // xyz the way the light travels
+        glm::vec4 sunColor{0.f};            // rgb, w intensity (0 = no sun)
+    };
+
+    static_assert(ShadowConfig::CASCADES == 4, "ShadowUbo packs one float per cascade into a vec4");
+
+
+    /*
+        Shadow maps, rendered on the backend before the cluster assignment. All views go through
+        one depth only pipeline (Pipeline::depthOnlyPipelineConfigInfo) and one render pass that
+        loads and stores, every view clears just its own tile.
+
+        Cascades (directional light): the 2x2 cascade atlas is rebuilt every frame from a cached
+        copy that only holds the static casters. A cascade's static part is re-rendered only
+        when ShadowPlanner says its key changed (the cascade snapped to a new spot, the sun
+        turned or static objects changed), every frame the cache is copied over and just the
+        dynamic casters are drawn on top. Nothing dynamic now or last frame skips even that.
+
+        Point lights: six faces per shadowed light in an 8x8 atlas, re-rendered (static and
+        dynamic casters alike) only when the frontend bumped the light's version, i.e. when
+        something moved inside its range.
+
+        The atlases are shared by the frames in flight, the barriers order every write after
+        the previous frame's lighting read them. Between frames the static cache rests in
+        TRANSFER_SRC, the two atlases in DEPTH_STENCIL_READ_ONLY.
+    */
+    class ShadowSystem {
+
+        public:
+
+            static constexpr VkFormat DEPTH_FORMAT = VK_FORMAT_D32_SFLOAT;
+            static constexpr uint32_t CASCADE_ATLAS_SIZE = ShadowConfig::CASCADE_RESOLUTION * 2;
+            static constexpr uint32_t POINT_ATLAS_SIZE = ShadowConfig::POINT_FACE_RESOLUTION * ShadowConfig::POINT_ATLAS_TILES;
+
+        private:
+
+            struct Push {
+                glm::mat4 viewProj{1.f};
+                glm::mat4 model{1.f};
+            };
+
+            struct Target {
+                std::shared_ptr<Image> image;
+                VkFramebuffer framebuffer{VK_NULL_HANDLE};
+                uint32_t size{0};
+            };
+
+            struct FrameResources {
+                std::unique_ptr<Buffer> params;
+                VkDescriptorSet descriptorSet{VK_NULL_HANDLE};
+            };
+
+            enum class Casters { Static, Dynamic, All };
+
+            // -------- MEMBER VARIABLES -------- //
+
+            Device& m_device;
+            PipelineCompiler& m_compiler;
+            VmaAllocator m_allocator;
+
+            VkRenderPass m_renderPass;
+            VkSampler m_sampler;
+
+            Target m_staticCascades{};
+            Target m_cascades{};
+            Target m_points{};
+
+            std::unique_ptr<DescriptorPool> m_pool;
+            std::unique_ptr<DescriptorSetLayout> m_setLayout;
+            std::array<FrameResources, SwapChain::MAX_FRAMES_IN_FLIGHT> m_frames{};
+
+            VkPipelineLayout m_layout;
+            PipelineCompiler::Handle m_depthHandle = PipelineCompiler::invalidHandle;
+            Pipeline* m_depthPipeline = nullptr;
+
+            ShadowCacheState m_cacheState{};
+
+            bool m_imagesInitialized{false};
+            bool m_cascadesHadDynamic{false};
+
+            // -------- -------- -------- -------- //
+
+        public:
+
+            // -------- CONSTRUCTOR etc -------- //
+
+            // The depth pipeline is only requested, call waitForPipeline before the first frame
+            ShadowSystem(Device& device, PipelineCompiler& compiler, VmaAllocator allocator)
+            :m_device{device}, m_compiler{compiler}, m_allocator{allocator}
+            {
+                createRenderPass();
+                createSampler();
+
+                m_staticCascades = createTarget("ShadowCascadesStatic", CASCADE_ATLAS_SIZE, VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+                m_cascades = createTarget("ShadowCascades", CASCADE_ATLAS_SIZE, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+                m_points = createTarget("ShadowPoints", POINT_ATLAS_SIZE, VK_IMAGE_USAGE_SAMPLED_BIT);
+
+                createDescriptors();
+                createLayout();
+
+                auto pipelineConfig = std::make_unique<PipelineConfigInfo>();
+                Pipeline::depthOnlyPipelineConfigInfo(*pipelineConfig);
+
+                pipelineConfig->renderPass = m_renderPass;
+                pipelineConfig->pipelineLayout = m_layout;
+                pipelineConfig->subpass = 0;
+
+                m_depthHandle = m_compiler.request(
+                    "C:/Users/thedarkchoco/Desktop/vs_code/Orasis_Engine/shaders/compiledShaders/shadow_depth.vert.spv",
+                    "",
+                    std::move(pipelineConfig)
+                );
+            }
+
+            ~ShadowSystem()
+            {
+                m_compiler.release(m_depthHandle);
+
+                for (Target* target : {&m_staticCascades, &m_cascades, &m_points})
+                    vkDestroyFramebuffer(m_device.device(), target->framebuffer, nullptr);
+
+                vkDestroyPipelineLayout(m_device.device(), m_layout, nullptr);
+                vkDestroySampler(m_device.device(), m_sampler, nullptr);
+                vkDestroyRenderPass(m_device.device(), m_renderPass, nullptr);
+            }
+
+            ShadowSystem(const ShadowSystem&) = delete;
+            ShadowSystem &operator=(const ShadowSystem&) = delete;
+
+            // -------- -------- -------- -------- //
+
+
+
+
+            // -------- FUNCTIONS -------- //
+
+            void waitForPipeline() { m_depthPipeline = &m_compiler.wait(m_depthHandle); }
+
+            // Set 3 of the lighting pipeline layouts
+            VkDescriptorSetLayout getSetLayout() const { return m_setLayout->getDescriptorSetLayout(); }
+            VkDescriptorSet getDescriptorSet(int frameIndex) const { return m_frames[frameIndex].descriptorSet; }
+
+            // Read by the frontend's ShadowPlanner
+            const ShadowCacheState& getCacheState() const { return m_cacheState; }
+
+            /*
+                Outside of a render pass, before anything reads the shadows this frame. Re-renders
+                what shadows marks stale from draws.casters and refreshes the frame's parameters.
+            */
+            void render(VkCommandBuffer commandBuffer, int frameIndex, const ShadowFrame& shadows, const DrawList& draws, const std::vector<std::shared_ptr<Model>>& models)
+            {
+                writeParams(frameIndex, shadows);
+
+                if (!m_imagesInitialized)
+                {
+                    // Contents don't matter yet, the first frame that samples a view renders it first
+                    transition(commandBuffer, m_staticCascades.image->s_image,
+                        VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,
+                        VK_PIPELINE_STAGE_TRANSFER_BIT, 0);
+
+                    for (Target* target : {&m_cascades, &m_points})
+                        transition(commandBuffer, target->image->s_image,
+                            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,
+                            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0);
+
+                    m_imagesInitialized = true;
+                }
+
+                if (shadows.hasSun())
+                    renderCascades(commandBuffer, shadows, draws, models);
+
+                if (shadows.pointDirty != 0)
+                    renderPointLights(commandBuffer, shadows, draws, models);
+            }
+
+        private:
+
+            void renderCascades(VkCommandBuffer commandBuffer, const ShadowFrame& shadows, const DrawList& draws, const std::vector<std::shared_ptr<Model>>& models)
+            {
+                uint32_t cascadeBits = (1u << ShadowConfig::CASCADES) - 1;
+
+                bool hasDynamic = std::any_of(draws.casters.begin(), draws.casters.end(), [&](const ShadowCaster& caster) {
+                    return !caster.isStatic() && (caster.views & cascadeBits) != 0;
+                });
+
+                // ---- Static cache, only the stale cascades ----
+                if (shadows.staticDirty != 0)
+                {
+                    transition(commandBuffer, m_staticCascades.image->s_image,
+                        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                        VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                        VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+
+                    beginPass(commandBuffer, m_staticCascades, 1.25f, 1.75f);
+
+                    for (uint32_t c = 0; c < ShadowConfig::CASCADES; c++)
+                    {
+                        if ((shadows.staticDirty & (1u << c)) == 0) continue;
+
+                        setTile(commandBuffer, cascadeTile(c), true);
+                        drawCasters(commandBuffer, draws, models, ShadowCaster::cascadeBit(c), Casters::Static, shadows.cascades[c].viewProj);
+
+                        m_cacheState.cascadeKeys[c].store(shadows.cascades[c].key, std::memory_order_release);
+                    }
+
+                    vkCmdEndRenderPass(commandBuffer);
+
+                    transition(commandBuffer, m_staticCascades.image->s_image,
+                        VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                        VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+                }
+
+                // The atlas still is exactly the static cache
+                if (shadows.staticDirty == 0 && !hasDynamic && !m_cascadesHadDynamic) return;
+
+                m_cascadesHadDynamic = hasDynamic;
+
+                // ---- Composite: static cache, then the dynamic casters on top ----
+                transition(commandBuffer, m_cascades.image->s_image,
+                    VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+                VkImageCopy region{};
+                region.srcSubresource = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, 1};
+                region.dstSubresource = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, 1};
+                region.extent = {CASCADE_ATLAS_SIZE, CASCADE_ATLAS_SIZE, 1};
+
+                vkCmdCopyImage(
+                    commandBuffer,
+                    m_staticCascades.image->s_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                    m_cascades.image->s_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    1, &region
+                );
+
+                if (!hasDynamic)
+                {
+                    transition(commandBuffer, m_cascades.image->s_image,
+                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+                    return;
+                }
+
+                transition(commandBuffer, m_cascades.image->s_image,
+                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                    VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+
+                beginPass(commandBuffer, m_cascades, 1.25f, 1.75f);
+
+                for (uint32_t c = 0; c < ShadowConfig::CASCADES; c++)
+                {
+                    setTile(commandBuffer, cascadeTile(c), false);
+                    drawCasters(commandBuffer, draws, models, ShadowCaster::cascadeBit(c), Casters::Dynamic, shadows.cascades[c].viewProj);
+                }
+
+                vkCmdEndRenderPass(commandBuffer);
+
+                transition(commandBuffer, m_cascades.image->s_image,
+                    VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                    VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                    VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+            }
+
+            void renderPointLights(VkCommandBuffer commandBuffer, const ShadowFrame& shadows, const DrawList& draws, const std::vector<std::shared_ptr<Model>>& models)
+            {
+                transition(commandBuffer, m_points.image->s_image,
+                    VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                    VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                    VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+
+                beginPass(commandBuffer, m_points, 1.f, 1.5f);
+
+                for (uint32_t s = 0; s < ShadowConfig::POINT_LIGHTS; s++)
+                {
+                    if ((shadows.pointDirty & (1u << s)) == 0) continue;
+
+                    const PointShadow& light = shadows.points[s];
+
+                    for (uint32_t face = 0; face < 6; face++)
+                    {
+                        setTile(commandBuffer, pointTile(s * 6 + face), true);
+                        drawCasters(commandBuffer, draws, models, ShadowCaster::pointBit(s), Casters::All, light.faceViewProj(face));
+                    }
+
+                    m_cacheState.pointVersions[s].store(light.version, std::memory_order_release);
+                }
+
+                vkCmdEndRenderPass(commandBuffer);
+
+                transition(commandBuffer, m_points.image->s_image,
+                    VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                    VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                    VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+            }
+
+            void drawCasters(VkCommandBuffer commandBuffer, const DrawList& draws, const std::vector<std::shared_ptr<Model>>& models, uint32_t view, Casters casters, const glm::mat4& viewProj)
+            {
+                const Model* boundModel = nullptr;
+
+                for (const ShadowCaster& caster : draws.casters)
+                {
+                    if ((caster.views & view) == 0) continue;
+                    if (casters == Casters::Static && !caster.isStatic()) continue;
+                    if (casters == Casters::Dynamic && caster.isStatic()) continue;
+
+                    // Not registered (yet), nothing to draw it with
+                    if (caster.model >= models.size() || models[caster.model] == nullptr) continue;
+
+                    Model* model = models[caster.model].get();
+
+                    Push push{viewProj, draws.transforms[caster.transform]};
+                    vkCmdPushConstants(commandBuffer, m_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(Push), &push);
+
+                    if (model != boundModel)
+                    {
+                        model->bind(commandBuffer);
+                        boundModel = model;
+                    }
+
+                    model->draw(commandBuffer);
+                }
+            }
+
+            void beginPass(VkCommandBuffer commandBuffer, const Target& target, float biasConstant, float biasSlope)
+            {
+                VkRenderPassBeginInfo renderPassInfo{};
+                renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+                renderPassInfo.renderPass = m_renderPass;
+                renderPassInfo.framebuffer = target.framebuffer;
+                renderPassInfo.renderArea.offset = {0, 0};
+                renderPassInfo.renderArea.extent = {target.size, target.size};
+
+                // Loads, every view clears its own tile
+                vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+                m_depthPipeline->bind(commandBuffer);
+                vkCmdSetDepthBias(commandBuffer, biasConstant, 0.f, biasSlope);
+            }
+
+            static void setTile(VkCommandBuffer commandBuffer, VkRect2D tile, bool clear)
+            {
+                VkViewport viewport{
+                    static_cast<float>(tile.offset.x), static_cast<float>(tile.offset.y),
+                    static_cast<float>(tile.extent.width), static_cast<float>(tile.extent.height),
+                    0.f, 1.f
+                };
+
+                vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+                vkCmdSetScissor(commandBuffer, 0, 1, &tile);
+
+                if (!clear) return;
+
+                VkClearAttachment clearAttachment{};
+                clearAttachment.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+                clearAttachment.clearValue.depthStencil = {1.f, 0};
+
+                VkClearRect clearRect{tile, 0, 1};
+                vkCmdClearAttachments(commandBuffer, 1, &clearAttachment, 1, &clearRect);
+            }
+
+            // Cascade c sits at (c % 2, c / 2), deferred_lighting.glsl uses the same
+            static VkRect2D cascadeTile(uint32_t cascade)
+            {
+                const int32_t size = static_cast<int32_t>(ShadowConfig::CASCADE_RESOLUTION);
+                return {{static_cast<int32_t>(cascade % 2) * size, static_cast<int32_t>(cascade / 2) * size}, {ShadowConfig::CASCADE_RESOLUTION, ShadowConfig::CASCADE_RESOLUTION}};
+            }
+
+            // Face f of slot s is tile s * 6 + f, row major
+            static VkRect2D pointTile(uint32_t tile)
+            {
+                const int32_t size = static_cast<int32_t>(ShadowConfig::POINT_FACE_RESOLUTION);
+                return {
+                    {static_cast<int32_t>(tile % ShadowConfig::POINT_ATLAS_TILES) * size, static_cast<int32_t>(tile / ShadowConfig::POINT_ATLAS_TILES) * size},
+                    {ShadowConfig::POINT_FACE_RESOLUTION, ShadowConfig::POINT_FACE_RESOLUTION}
+                };
+            }
+
+            void writeParams(int frameIndex, const ShadowFrame& shadows)
+            {
+                ShadowUbo params{};
+
+                for (uint32_t c = 0; c < ShadowConfig::CASCADES; c++)
+                {
+                    params.cascadeViewProj[c] = shadows.cascades[c].viewProj;
+                    params.cascadeSplits[c] = shadows.cascades[c].splitDepth;
+                    params.cascadeTexels[c] = shadows.cascades[c].texelSize;
+                }
+
+                for (uint32_t s = 0; s < ShadowConfig::POINT_LIGHTS; s++)
+                {
+                    if (!shadows.points[s].isActive()) continue;
+
+                    for (uint32_t face = 0; face < 6; face++)
+                        params.pointViewProj[s * 6 + face] = shadows.points[s].faceViewProj(face);
+                }
+
+                if (shadows.hasSun())
+                {
+                    params.sunDirection = glm::vec4{glm::normalize(shadows.sun.direction), 0.f};
+                    params.sunColor = glm::vec4{shadows.sun.color, shadows.sun.intensity};
+                }
+
+                m_frames[frameIndex].params->writeToBuffer(&params);
+            }
+
+            static void transition(
+                VkCommandBuffer commandBuffer, VkImage image,
+                VkImageLayout oldLayout, VkImageLayout newLayout,
+                VkPipelineStageFlags srcStage, VkAccessFlags srcAccess,
+                VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+            {
+                VkImageMemoryBarrier barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                barrier.oldLayout = oldLayout;
+                barrier.newLayout = newLayout;
+                barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.image = image;
+                barrier.subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1};
+                barrier.srcAccessMask = srcAccess;
+                barrier.dstAccessMask = dstAccess;
+
+                vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+            }
+
+            Target createTarget(const std::string& name, uint32_t size, VkImageUsageFlags usage)
+            {
+                Target target{};
+                target.size = size;
+
+                AttachmentInfo info(name, DEPTH_FORMAT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | usage, Attachment::Type::isDepth);
+                target.image = Image::createAttachment(m_device, m_allocator, {size, size}, info);
+
+                VkFramebufferCreateInfo framebufferInfo{};
+                framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+                framebufferInfo.renderPass = m_renderPass;
+                framebufferInfo.attachmentCount = 1;
+                framebufferInfo.pAttachments = &target.image->s_imageView;
+                framebufferInfo.width = size;
+                framebufferInfo.height = size;
+                framebufferInfo.layers = 1;
+
+                if (vkCreateFramebuffer(m_device.device(), &framebufferInfo, nullptr, &target.framebuffer) != VK_SUCCESS)
+                    throw std::runtime_error("failed to create shadow framebuffer");
+
+                return target;
+            }
+
+            void createRenderPass()
+            {
+                // Layout transitions are explicit barriers, the pass itself stays in ATTACHMENT_OPTIMAL
+                VkAttachmentDescription depthAttachment{};
+                depthAttachment.format = DEPTH_FORMAT;
+                depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+                depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+                depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+                depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+                depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+                depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+                depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+                VkAttachmentReference depthRef{0, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+
+                VkSubpassDescription subpass{};
+                subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+                subpass.colorAttachmentCount = 0;
+                subpass.pDepthStencilAttachment = &depthRef;
+
+                VkRenderPassCreateInfo renderPassInfo{};
+                renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+                renderPassInfo.attachmentCount = 1;
+                renderPassInfo.pAttachments = &depthAttachment;
+                renderPassInfo.subpassCount = 1;
+                renderPassInfo.pSubpasses = &subpass;
+
+                if (vkCreateRenderPass(m_device.device(), &renderPassInfo, nullptr, &m_renderPass) != VK_SUCCESS)
+                    throw std::runtime_error("failed to create shadow render pass");
+            }
+
+            void createSampler()
+            {
+                // Hardware comparison, a linear fetch is a 2x2 PCF on its own
+                VkSamplerCreateInfo samplerInfo{};
+                samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+                samplerInfo.magFilter = VK_FILTER_LINEAR;
+                samplerInfo.minFilter = VK_FILTER_LINEAR;
+                samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+                samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+                samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+                samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+                samplerInfo.unnormalizedCoordinates = VK_FALSE;
+                samplerInfo.compareEnable = VK_TRUE;
+                samplerInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+                samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+
+                if (vkCreateSampler(m_device.device(), &samplerInfo, nullptr, &m_sampler) != VK_SUCCESS)
+                    throw std::runtime_error("failed to create shadow sampler");
+            }
+
+            void createDescriptors()
+            {
+                const uint32_t frames = SwapChain::MAX_FRAMES_IN_FLIGHT;
+
+                m_pool =
+                    DescriptorPool::Builder(m_device)
+                        .setMaxSets(frames)
+                        .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frames)
+                        .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2 * frames)
+                        .build();
+
+                // 0 params, 1 cascade atlas, 2 point light atlas
+                m_setLayout =
+                    DescriptorSetLayout::Builder(m_device)
+                        .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
+                        .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
+                        .addBinding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
+                        .build();
+
+                VkDescriptorImageInfo cascadesInfo{m_sampler, m_cascades.image->s_imageView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
+                VkDescriptorImageInfo pointsInfo{m_sampler, m_points.image->s_imageView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
+
+                for (FrameResources& frame : m_frames)
+                {
+                    frame.params = std::make_unique<Buffer>(
+                        m_device,
+                        sizeof(ShadowUbo),
+                        1,
+                        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                        m_device.properties.limits.minUniformBufferOffsetAlignment
+                    );
+                    frame.params->map();
+
+                    VkDescriptorBufferInfo paramsInfo = frame.params->descriptorInfo();
+
+                    DescriptorWriter(*m_setLayout, *m_pool)
+                        .writeBuffer(0, &paramsInfo)
+                        .writeImage(1, &cascadesInfo)
+                        .writeImage(2, &pointsInfo)
+                        .build(frame.descriptorSet);
+                }
+            }
+
+            void createLayout()
+            {
+                VkPushConstantRange pushConstantRange{};
+                pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+                pushConstantRange.offset = 0;
+                pushConstantRange.size = sizeof(Push);
+
+                VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+                pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+                pipelineLayoutInfo.setLayoutCount = 0;
+                pipelineLayoutInfo.pSetLayouts = nullptr;
+                pipelineLayoutInfo.pushConstantRangeCount = 1;
+                pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+                if (vkCreatePipelineLayout(m_device.device(), &pipelineLayoutInfo, nullptr, &m_layout) != VK_SUCCESS)
+                    throw std::runtime_error("failed to create pipeline layout");
+            }
+    };
+
+}
@@ -0,0 +1,178 @@
+#pragma once
+
+#include "Header_Includes/Render_Systems_Headers.hpp"
+#include "SwapChain.hpp"
+#include "DrawPacket.hpp"
+
+namespace Orasis {
+
+
+    /*
+        Secondary command buffers for the geometry subpass, one set per frame in flight (the
+        global descriptor set is per frame, the framebuffer is left to the primary).
+
+        The static buffer is only re-recorded when the cache was invalidated (objects, models or
+        transforms of static objects changed) or when the set of visible static objects changed.
+        The dynamic buffer is re-recorded every frame. Pipelines are owned by DefferedSystem,
+        which rebuilds this cache together with them.
+
+        Each of them has a depth pre-pass twin, recorded along with it when the pre-pass is on.
+    */
+    class StaticDrawCache {
+
+        // -------- MEMBER VARIABLES -------- //
+
+        struct Slot {
+            VkCommandBuffer staticCmd{VK_NULL_HANDLE};
+            VkCommandBuffer dynamicCmd{VK_NULL_HANDLE};
+            VkCommandBuffer staticDepthCmd{VK_NULL_HANDLE};
+            VkCommandBuffer dynamicDepthCmd{VK_NULL_HANDLE};
+            uint64_t version{UINT64_MAX};
+            uint64_t signature{0};
+        };
+
+        Device& m_device;
+        VkCommandPool m_pool;
+        std::array<Slot, SwapChain::MAX_FRAMES_IN_FLIGHT> m_slots{};
+        uint64_t m_version{0};
+        uint32_t m_recordCount{0};
+
+        // -------- -------- -------- -------- //
+
+
+        public:
+
+        // -------- CONSTRUCTOR etc -------- //
+
+        // pool has to be one only the recording thread uses
+        StaticDrawCache(Device& device, VkCommandPool pool)
+        :m_device{device}, m_pool{pool}
+        {
+            std::array<VkCommandBuffer, SwapChain::MAX_FRAMES_IN_FLIGHT * 4> buffers{};
+
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            allocInfo.commandPool = m_pool;
+            allocInfo.commandBufferCount = static_cast<uint32_t>(buffers.size());
+
+            if (vkAllocateCommandBuffers(m_device.device(), &allocInfo, buffers.data()) != VK_SUCCESS)
+                throw std::runtime_error("failed to allocate secondary command buffers");
+
+            for (size_t i = 0; i < m_slots.size(); i++)
+            {
+                m_slots[i].staticCmd = buffers[i * 4];
+                m_slots[i].dynamicCmd = buffers[i * 4 + 1];
+                m_slots[i].staticDepthCmd = buffers[i * 4 + 2];
+                m_slots[i].dynamicDepthCmd = buffers[i * 4 + 3];
+            }
+        }
+
+        ~StaticDrawCache()
+        {
+            for (Slot& slot : m_slots)
+            {
+                VkCommandBuffer buffers[4] = {slot.staticCmd, slot.dynamicCmd, slot.staticDepthCmd, slot.dynamicDepthCmd};
+                vkFreeCommandBuffers(m_device.device(), m_pool, 4, buffers);
+            }
+        }
+
+        StaticDrawCache(const StaticDrawCache&) = delete;
+        StaticDrawCache &operator=(const StaticDrawCache&) = delete;
+
+        // -------- -------- -------- -------- //
+
+
+
+
+        // -------- FUNCTIONS -------- //
+
+        // Every slot gets re-recorded the next time it's used
+        void invalidate() { m_version++; }
+
+        bool needsRecording(int frameIndex, uint64_t signature) const
+        {
+            const Slot& slot = m_slots[frameIndex];
+            return slot.version != m_version || slot.signature != signature;
+        }
+
+        VkCommandBuffer beginStatic(int frameIndex, uint64_t signature, const VkCommandBufferInheritanceInfo& inheritance)
+        {
+            Slot& slot = m_slots[frameIndex];
+            slot.version = m_version;
+            slot.signature = signature;
+            m_recordCount++;
+
+            begin(slot.staticCmd, inheritance);
+            return slot.staticCmd;
+        }
+
+        VkCommandBuffer beginDynamic(int frameIndex, const VkCommandBufferInheritanceInfo& inheritance)
+        {
+            begin(m_slots[frameIndex].dynamicCmd, inheritance);
+            return m_slots[frameIndex].dynamicCmd;
+        }
+
+        // Right after beginStatic, the static buffer's version and signature cover it too
+        VkCommandBuffer beginStaticDepth(int frameIndex, const VkCommandBufferInheritanceInfo& inheritance)
+        {
+            begin(m_slots[frameIndex].staticDepthCmd, inheritance);
+            return m_slots[frameIndex].staticDepthCmd;
+        }
+
+        VkCommandBuffer beginDynamicDepth(int frameIndex, const VkCommandBufferInheritanceInfo& inheritance)
+        {
+            begin(m_slots[frameIndex].dynamicDepthCmd, inheritance);
+            return m_slots[frameIndex].dynamicDepthCmd;
+        }
+
+        static void end(VkCommandBuffer commandBuffer)
+        {
+            if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+                throw std::runtime_error("failed to record secondary command buffer");
+        }
+
+        VkCommandBuffer getStatic(int frameIndex) const { return m_slots[frameIndex].staticCmd; }
+        VkCommandBuffer getStaticDepth(int frameIndex) const { return m_slots[frameIndex].staticDepthCmd; }
+
+        // How many times the static buffers were re-recorded, should stay flat for a static scene
+        uint32_t getRecordCount() const { return m_recordCount; }
+
+        // Order independent hash of the packets' ids, so camera driven re-sorting doesn't count as a change
+        static uint64_t signature(const std::vector<DrawItem>& items, const std::vector<DrawPacket>& packets)
+        {
+            uint64_t sum = 0, mixed = 0;
+
+            for (const DrawItem& item : items)
+            {
+                uint64_t h = packets[item.index].id + 0x9e3779b97f4a7c15ull;
+                h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+                h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+                h ^= h >> 31;
+
+                sum += h;
+                mixed ^= h;
+            }
+
+            return sum ^ (mixed << 1) ^ items.size();
+        }
+
+        private:
+
+        static void begin(VkCommandBuffer commandBuffer, const VkCommandBufferInheritanceInfo& inheritance)
+        {
+            // The pool has RESET_COMMAND_BUFFER set,
+            // vkBeginCommandBuffer resets them implicitly. With occlusion culling they're
+            // executed by both geometry passes of the same primary
+            VkCommandBufferBeginInfo beginInfo{};
+            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+            beginInfo.pInheritanceInfo = &inheritance;
+
+            if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+                throw std::runtime_error("failed to begin secondary command buffer");
+        }
+
+    };
+
+}
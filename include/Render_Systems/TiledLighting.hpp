@@ -0,0 +1,348 @@
+#pragma once
+
+#include "Header_Includes/Render_Systems_Headers.hpp"
+#include "Buffer.hpp"
+#include "Descriptors.hpp"
+#include "Manager.hpp"
+#include "PipelineCompiler.hpp"
+
+#include <glm/glm.hpp>
+
+namespace Orasis {
+
+
+    /*
+        LightingPath::Compute. Runs after the deffered render pass instead of the full screen
+        lighting draw: tile_classify.comp sorts every 16x16 tile into empty, ambient (no point
+        light reaches it, ambient and sun only) or lit, then tile_shade_ambient.comp and
+        tile_shade_lit.comp run as indirect dispatches over just their tiles. Empty tiles cost nothing past classification,
+        the lit image starts out cleared to what the subpass shades background with.
+
+        The result is blitted onto the swap chain image, or left for the Upscaler with dynamic
+        resolution (then only the render area gets classified and lit). Shading goes through the same
+        deferred_lighting.glsl as dL_shader.frag, so both paths give the same picture.
+
+        The lit image is the Manager's frame graph's ("LitColor"). The clear, the lighting and the
+        blit are passes of it, the graph records the image barriers between them, the tile lists
+        (a buffer) are synchronized here.
+
+        Needs GBufferLayout::Packed (position comes from depth), the Manager adds sampled
+        usage to the G-buffer for this path.
+    */
+    class TiledLighting {
+
+        public:
+
+            static constexpr uint32_t TILE_SIZE = 16;
+
+            // Matches tile_common.glsl
+            enum TileClass : uint32_t {
+                Ambient = 0,
+                Lit = 1,
+                ClassCount = 2
+            };
+
+        private:
+
+            struct DispatchArgs {
+                uint32_t x{0};
+                uint32_t y{1};
+                uint32_t z{1};
+                uint32_t pad{0};
+            };
+
+            struct Push {
+                glm::uvec2 tileCount;
+                uint32_t tileCapacity;
+            };
+
+            // One per swap chain image, like the G-buffer it reads
+            struct ImageResources {
+                std::unique_ptr<Buffer> tileLists;
+                VkDescriptorSet descriptorSet{VK_NULL_HANDLE};
+            };
+
+            // -------- MEMBER VARIABLES -------- //
+
+            Device& m_device;
+            PipelineCompiler& m_compiler;
+
+            VkSampler m_sampler;
+
+            std::unique_ptr<DescriptorSetLayout> m_setLayout;
+            std::unique_ptr<DescriptorPool> m_pool;
+            std::vector<ImageResources> m_images{};
+
+            VkPipelineLayout m_layout;
+            std::array<PipelineCompiler::Handle, 3> m_handles{};
+            Pipeline* m_classify = nullptr;
+            Pipeline* m_shadeAmbient = nullptr;
+            Pipeline* m_shadeLit = nullptr;
+
+            VkExtent2D m_extent{};
+            glm::uvec2 m_tileCount{};
+            uint32_t m_tileCapacity{0};
+
+            // -------- -------- -------- -------- //
+
+        public:
+
+            // -------- CONSTRUCTOR etc -------- //
+
+            // Pipelines are only requested, call waitForPipelines before the first frame
+            TiledLighting(Device& device, PipelineCompiler& compiler, Manager& manager, VkExtent2D extent, VkDescriptorSetLayout globalSetLayout, VkDescriptorSetLayout clusterSetLayout, VkDescriptorSetLayout shadowSetLayout, VkDescriptorSetLayout occlusionSetLayout)
+            :m_device{device}, m_compiler{compiler}
+            {
+                if (manager.getGBufferLayout() != GBufferLayout::Packed)
+                    throw std::runtime_error("compute lighting needs the packed G-buffer layout");
+
+                createSampler();
+
+                // 0-2 G-buffer, 3 lit color, 4 indirect arguments and tile lists
+                m_setLayout =
+                    DescriptorSetLayout::Builder(m_device)
+                        .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+                        .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+                        .addBinding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+                        .addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT)
+                        .addBinding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                        .build();
+
+                createLayout({globalSetLayout, m_setLayout->getDescriptorSetLayout(), clusterSetLayout, shadowSetLayout, occlusionSetLayout});
+
+                m_handles[0] = requestPipeline("C:/Users/thedarkchoco/Desktop/vs_code/Orasis_Engine/shaders/compiledShaders/tile_classify.comp.spv");
+                m_handles[1] = requestPipeline("C:/Users/thedarkchoco/Desktop/vs_code/Orasis_Engine/shaders/compiledShaders/tile_shade_ambient.comp.spv");
+                m_handles[2] = requestPipeline("C:/Users/thedarkchoco/Desktop/vs_code/Orasis_Engine/shaders/compiledShaders/tile_shade_lit.comp.spv");
+
+                createImageResources(manager, extent);
+            }
+
+            ~TiledLighting()
+            {
+                for (PipelineCompiler::Handle handle : m_handles)
+                    m_compiler.release(handle);
+
+                vkDestroyPipelineLayout(m_device.device(), m_layout, nullptr);
+                vkDestroySampler(m_device.device(), m_sampler, nullptr);
+            }
+
+            TiledLighting(const TiledLighting&) = delete;
+            TiledLighting &operator=(const TiledLighting&) = delete;
+
+            // -------- -------- -------- -------- //
+
+
+
+
+            // -------- FUNCTIONS -------- //
+
+            void waitForPipelines()
+            {
+                m_classify = &m_compiler.wait(m_handles[0]);
+                m_shadeAmbient = &m_compiler.wait(m_handles[1]);
+                m_shadeLit = &m_compiler.wait(m_handles[2]);
+            }
+
+            // After Manager::resize, frames still in flight keep the old tile lists until they're done
+            void resize(Manager& manager, VkExtent2D extent)
+            {
+                for (ImageResources& image : m_images)
+                    m_device.deletionQueue().retire(std::move(image.tileLists));
+                m_device.deletionQueue().retire(std::move(m_pool));
+
+                m_images.clear();
+                createImageResources(manager, extent);
+            }
+
+            /*
+                After the deffered render pass ended, target is the swap chain image it rendered to.
+                Expects the cluster lists, shadow maps and ambient occlusion of this frame to be built.
+                Without a target the lit image is left for the Upscaler, renderExtent is the part of the
+                G-buffer that was rendered to.
+            */
+            void render(VkCommandBuffer commandBuffer, const RenderGraph& graph, uint32_t imageIndex, VkDescriptorSet globalSet, VkDescriptorSet clusterSet, VkDescriptorSet shadowSet, VkDescriptorSet occlusionSet, VkImage target, VkExtent2D renderExtent)
+            {
+                ImageResources& image = m_images[imageIndex];
+                VkImage litColor = graph.getImage(graph.find("LitColor"), imageIndex);
+
+                // The tile lists are sized for the whole extent, the render area never exceeds it
+                glm::uvec2 tileCount{(renderExtent.width + TILE_SIZE - 1) / TILE_SIZE, (renderExtent.height + TILE_SIZE - 1) / TILE_SIZE};
+
+                // ---- Reset: counts to 0, lit image to the background color ----
+                graph.executePass(commandBuffer, "TiledLightingClear", imageIndex, [&](VkCommandBuffer, uint32_t) {
+                    std::array<DispatchArgs, ClassCount> resetArgs{};
+                    vkCmdUpdateBuffer(commandBuffer, image.tileLists->getBuffer(), 0, sizeof(resetArgs), resetArgs.data());
+
+                    VkClearColorValue background{{0.f, 0.f, 0.f, 1.f}};
+                    VkImageSubresourceRange range{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+                    vkCmdClearColorImage(commandBuffer, litColor, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &background, 1, &range);
+                });
+
+                graph.executePass(commandBuffer, "TiledLighting", imageIndex, [&](VkCommandBuffer, uint32_t) {
+                    // The graph only waited for the clear of the image, the counts are a buffer
+                    memoryBarrier(commandBuffer,
+                        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+                    // ---- Classification ----
+                    std::array<VkDescriptorSet, 5> sets{globalSet, image.descriptorSet, clusterSet, shadowSet, occlusionSet};
+
+                    m_classify->bind(commandBuffer);
+
+                    // Every kernel shares the layout, the sets stay bound across the switches
+                    vkCmdBindDescriptorSets(
+                        commandBuffer,
+                        VK_PIPELINE_BIND_POINT_COMPUTE,
+                        m_layout,
+                        0,
+                        static_cast<uint32_t>(sets.size()),
+                        sets.data(),
+                        0, nullptr
+                    );
+
+                    Push push{tileCount, m_tileCapacity};
+                    vkCmdPushConstants(commandBuffer, m_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Push), &push);
+
+                    vkCmdDispatch(commandBuffer, tileCount.x, tileCount.y, 1);
+
+                    memoryBarrier(commandBuffer,
+                        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT);
+
+                    // ---- Shading, one work group per classified tile ----
+                    m_shadeAmbient->bind(commandBuffer);
+                    vkCmdDispatchIndirect(commandBuffer, image.tileLists->getBuffer(), Ambient * sizeof(DispatchArgs));
+
+                    m_shadeLit->bind(commandBuffer);
+                    vkCmdDispatchIndirect(commandBuffer, image.tileLists->getBuffer(), Lit * sizeof(DispatchArgs));
+                });
+
+                if (target == VK_NULL_HANDLE) return;
+
+                // ---- Onto the swap chain image, whatever the render pass left in it is overwritten ----
+                graph.executePass(commandBuffer, "TiledLightingBlit", imageIndex, [&](VkCommandBuffer, uint32_t) {
+                    // A blit and not a copy, it converts to the swap chain format (sRGB encoding included)
+                    VkImageBlit blit{};
+                    blit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+                    blit.srcOffsets[1] = {static_cast<int32_t>(m_extent.width), static_cast<int32_t>(m_extent.height), 1};
+                    blit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+                    blit.dstOffsets[1] = blit.srcOffsets[1];
+
+                    vkCmdBlitImage(
+                        commandBuffer,
+                        litColor, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                        target, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                        1, &blit,
+                        VK_FILTER_NEAREST
+                    );
+                });
+            }
+
+        private:
+
+            void createImageResources(Manager& manager, VkExtent2D extent)
+            {
+                m_extent = extent;
+                m_tileCount = {(extent.width + TILE_SIZE - 1) / TILE_SIZE, (extent.height + TILE_SIZE - 1) / TILE_SIZE};
+                m_tileCapacity = m_tileCount.x * m_tileCount.y;
+
+                uint32_t imageCount = static_cast<uint32_t>(manager.imageCount());
+
+                m_pool =
+                    DescriptorPool::Builder(m_device)
+                        .setMaxSets(imageCount)
+                        .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 3 * imageCount)
+                        .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, imageCount)
+                        .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, imageCount)
+                        .build();
+
+                const RenderGraph& graph = manager.getFrameGraph();
+                RenderGraph::Resource litColor = graph.find("LitColor");
+
+                m_images.resize(imageCount);
+
+                for (uint32_t i = 0; i < imageCount; i++)
+                {
+                    ImageResources& image = m_images[i];
+
+                    image.tileLists = std::make_unique<Buffer>(
+                        m_device,
+                        sizeof(DispatchArgs) * ClassCount + sizeof(uint32_t) * ClassCount * m_tileCapacity,
+                        1,
+                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+                    );
+
+                    VkDescriptorImageInfo depthInfo{m_sampler, manager.getImageView("Depth", i), VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
+                    VkDescriptorImageInfo normalInfo{m_sampler, manager.getImageView("Normal", i), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+                    VkDescriptorImageInfo albedoInfo{m_sampler, manager.getImageView("Albido", i), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+                    VkDescriptorImageInfo litInfo{VK_NULL_HANDLE, graph.getImageView(litColor, i), VK_IMAGE_LAYOUT_GENERAL};
+                    VkDescriptorBufferInfo tileInfo = image.tileLists->descriptorInfo();
+
+                    DescriptorWriter(*m_setLayout, *m_pool)
+                        .writeImage(0, &depthInfo)
+                        .writeImage(1, &normalInfo)
+                        .writeImage(2, &albedoInfo)
+                        .writeImage(3, &litInfo)
+                        .writeBuffer(4, &tileInfo)
+                        .build(image.descriptorSet);
+                }
+            }
+
+            void createSampler()
+            {
+                // Only ever read with texelFetch
+                VkSamplerCreateInfo samplerInfo{};
+                samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+                samplerInfo.magFilter = VK_FILTER_NEAREST;
+                samplerInfo.minFilter = VK_FILTER_NEAREST;
+                samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+                samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+                samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+                samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+                samplerInfo.unnormalizedCoordinates = VK_FALSE;
+                samplerInfo.compareEnable = VK_FALSE;
+                samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+
+                if (vkCreateSampler(m_device.device(), &samplerInfo, nullptr, &m_sampler) != VK_SUCCESS)
+                    throw std::runtime_error("failed to create G-buffer sampler");
+            }
+
+            void createLayout(std::vector<VkDescriptorSetLayout> layoutToSet)
+            {
+                VkPushConstantRange pushConstantRange{};
+                pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+                pushConstantRange.offset = 0;
+                pushConstantRange.size = sizeof(Push);
+
+                VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+                pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+                pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(layoutToSet.size());
+                pipelineLayoutInfo.pSetLayouts = layoutToSet.data();
+                pipelineLayoutInfo.pushConstantRangeCount = 1;
+                pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+                if (vkCreatePipelineLayout(m_device.device(), &pipelineLayoutInfo, nullptr, &m_layout) != VK_SUCCESS)
+                    throw std::runtime_error("failed to create pipeline layout");
+            }
+
+            PipelineCompiler::Handle requestPipeline(const std::string& computePath)
+            {
+                auto pipelineConfig = std::make_unique<PipelineConfigInfo>();
+                pipelineConfig->pipelineLayout = m_layout;
+
+                return m_compiler.request(computePath, "", std::move(pipelineConfig));
+            }
+
+            static void memoryBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+            {
+                VkMemoryBarrier barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+                barrier.srcAccessMask = srcAccess;
+                barrier.dstAccessMask = dstAccess;
+
+                vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+            }
+    };
+
+}
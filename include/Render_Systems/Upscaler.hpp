@@ -0,0 +1,231 @@
+#pragma once
+
+#include "Header_Includes/Render_Systems_Headers.hpp"
+#include "Descriptors.hpp"
+#include "Manager.hpp"
+#include "PipelineCompiler.hpp"
+
+#include <glm/glm.hpp>
+
+namespace Orasis {
+
+
+    /*
+        Dynamic resolution. The G-buffer and the lighting only cover the top left render area of
+        their (swap chain sized) images, upscale.comp reconstructs the full swap chain image from
+        it with an edge adaptive filter. Its kernel gets stretched along the local luma edge and
+        squeezed across it, so edges stay sharp without showing the lower resolution's stairs.
+
+        The result is blitted onto the swap chain image, which converts it to its format. The
+        upscaled image is the Manager's frame graph's ("Upscaled"), the dispatch and the blit are
+        passes of it and it records the barriers around them.
+    */
+    class Upscaler {
+
+        private:
+
+            struct Push {
+                glm::vec2 renderSize;
+                glm::vec2 outputSize;
+            };
+
+            // One per swap chain image, like the lit images it reads
+            struct ImageResources {
+                VkDescriptorSet descriptorSet{VK_NULL_HANDLE};
+            };
+
+            // -------- MEMBER VARIABLES -------- //
+
+            Device& m_device;
+            PipelineCompiler& m_compiler;
+
+            VkSampler m_sampler;
+
+            std::unique_ptr<DescriptorSetLayout> m_setLayout;
+            std::unique_ptr<DescriptorPool> m_pool;
+            std::vector<ImageResources> m_images{};
+
+            VkPipelineLayout m_layout;
+            PipelineCompiler::Handle m_handle = PipelineCompiler::invalidHandle;
+            Pipeline* m_upscale = nullptr;
+
+            VkExtent2D m_extent{};
+
+            // -------- -------- -------- -------- //
+
+        public:
+
+            static constexpr uint32_t GROUP_SIZE = 8;
+
+            // -------- CONSTRUCTOR etc -------- //
+
+            // sources are the lit images per swap chain image (SHADER_READ_ONLY_OPTIMAL when upscaled).
+            // The pipeline is only requested, call waitForPipeline before the first frame
+            Upscaler(Device& device, PipelineCompiler& compiler, Manager& manager, VkExtent2D extent, const std::vector<VkImageView>& sources)
+            :m_device{device}, m_compiler{compiler}
+            {
+                createSampler();
+
+                // 0 lit image, 1 upscaled
+                m_setLayout =
+                    DescriptorSetLayout::Builder(m_device)
+                        .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+                        .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT)
+                        .build();
+
+                createLayout();
+
+                auto pipelineConfig = std::make_unique<PipelineConfigInfo>();
+                pipelineConfig->pipelineLayout = m_layout;
+
+                m_handle = m_compiler.request("C:/Users/thedarkchoco/Desktop/vs_code/Orasis_Engine/shaders/compiledShaders/upscale.comp.spv", "", std::move(pipelineConfig));
+
+                createImageResources(manager, extent, sources);
+            }
+
+            ~Upscaler()
+            {
+                m_compiler.release(m_handle);
+
+                vkDestroyPipelineLayout(m_device.device(), m_layout, nullptr);
+                vkDestroySampler(m_device.device(), m_sampler, nullptr);
+            }
+
+            Upscaler(const Upscaler&) = delete;
+            Upscaler &operator=(const Upscaler&) = delete;
+
+            // -------- -------- -------- -------- //
+
+
+
+
+            // -------- FUNCTIONS -------- //
+
+            void waitForPipeline() { m_upscale = &m_compiler.wait(m_handle); }
+
+            // After Manager::resize, frames still in flight keep the old sets until they're done
+            void resize(Manager& manager, VkExtent2D extent, const std::vector<VkImageView>& sources)
+            {
+                m_device.deletionQueue().retire(std::move(m_pool));
+
+                m_images.clear();
+                createImageResources(manager, extent, sources);
+            }
+
+            /*
+                Outside of a render pass, after the passes writing the lit image of imageIndex were
+                recorded. renderExtent is the part of it that was rendered to, target the swap chain
+                image (its contents are overwritten, the graph leaves it in PRESENT_SRC).
+            */
+            void render(VkCommandBuffer commandBuffer, const RenderGraph& graph, uint32_t imageIndex, VkExtent2D renderExtent, VkImage target)
+            {
+                ImageResources& image = m_images[imageIndex];
+
+                graph.executePass(commandBuffer, "Upscale", imageIndex, [&](VkCommandBuffer, uint32_t) {
+                    m_upscale->bind(commandBuffer);
+
+                    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_layout, 0, 1, &image.descriptorSet, 0, nullptr);
+
+                    Push push{
+                        {static_cast<float>(renderExtent.width), static_cast<float>(renderExtent.height)},
+                        {static_cast<float>(m_extent.width), static_cast<float>(m_extent.height)}
+                    };
+                    vkCmdPushConstants(commandBuffer, m_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Push), &push);
+
+                    vkCmdDispatch(commandBuffer, (m_extent.width + GROUP_SIZE - 1) / GROUP_SIZE, (m_extent.height + GROUP_SIZE - 1) / GROUP_SIZE, 1);
+                });
+
+                // ---- Onto the swap chain image ----
+                graph.executePass(commandBuffer, "UpscaleBlit", imageIndex, [&](VkCommandBuffer, uint32_t) {
+                    // Same size, the blit only converts to the swap chain format (sRGB encoding included)
+                    VkImageBlit blit{};
+                    blit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+                    blit.srcOffsets[1] = {static_cast<int32_t>(m_extent.width), static_cast<int32_t>(m_extent.height), 1};
+                    blit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+                    blit.dstOffsets[1] = blit.srcOffsets[1];
+
+                    vkCmdBlitImage(
+                        commandBuffer,
+                        graph.getImage(graph.find("Upscaled"), imageIndex), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                        target, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                        1, &blit,
+                        VK_FILTER_NEAREST
+                    );
+                });
+            }
+
+        private:
+
+            void createImageResources(Manager& manager, VkExtent2D extent, const std::vector<VkImageView>& sources)
+            {
+                m_extent = extent;
+
+                uint32_t imageCount = static_cast<uint32_t>(manager.imageCount());
+
+                m_pool =
+                    DescriptorPool::Builder(m_device)
+                        .setMaxSets(imageCount)
+                        .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, imageCount)
+                        .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, imageCount)
+                        .build();
+
+                const RenderGraph& graph = manager.getFrameGraph();
+                RenderGraph::Resource upscaled = graph.find("Upscaled");
+
+                m_images.resize(imageCount);
+
+                for (uint32_t i = 0; i < imageCount; i++)
+                {
+                    ImageResources& image = m_images[i];
+
+                    VkDescriptorImageInfo sourceInfo{m_sampler, sources[i], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+                    VkDescriptorImageInfo upscaledView{VK_NULL_HANDLE, graph.getImageView(upscaled, i), VK_IMAGE_LAYOUT_GENERAL};
+
+                    DescriptorWriter(*m_setLayout, *m_pool)
+                        .writeImage(0, &sourceInfo)
+                        .writeImage(1, &upscaledView)
+                        .build(image.descriptorSet);
+                }
+            }
+
+            void createSampler()
+            {
+                // Only ever read with texelFetch
+                VkSamplerCreateInfo samplerInfo{};
+                samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+                samplerInfo.magFilter = VK_FILTER_NEAREST;
+                samplerInfo.minFilter = VK_FILTER_NEAREST;
+                samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+                samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+                samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+                samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+                samplerInfo.unnormalizedCoordinates = VK_FALSE;
+                samplerInfo.compareEnable = VK_FALSE;
+                samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+
+                if (vkCreateSampler(m_device.device(), &samplerInfo, nullptr, &m_sampler) != VK_SUCCESS)
+                    throw std::runtime_error("failed to create upscale sampler");
+            }
+
+            void createLayout()
+            {
+                VkPushConstantRange pushConstantRange{};
+                pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+                pushConstantRange.offset = 0;
+                pushConstantRange.size = sizeof(Push);
+
+                VkDescriptorSetLayout setLayout = m_setLayout->getDescriptorSetLayout();
+
+                VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+                pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+                pipelineLayoutInfo.setLayoutCount = 1;
+                pipelineLayoutInfo.pSetLayouts = &setLayout;
+                pipelineLayoutInfo.pushConstantRangeCount = 1;
+                pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+                if (vkCreatePipelineLayout(m_device.device(), &pipelineLayoutInfo, nullptr, &m_layout) != VK_SUCCESS)
+                    throw std::runtime_error("failed to create pipeline layout");
+            }
+    };
+
+}
@@ -0,0 +1,285 @@
+#pragma once
+
+#include "Camera.hpp"
+#include "DrawPacket.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace Orasis {
+
+
+    // Sizes the frontend (fitting, culling) and ShadowSystem (atlases, shaders) have to agree on
+    struct ShadowConfig {
+        static constexpr uint32_t CASCADES = 4;
+        static constexpr uint32_t CASCADE_RESOLUTION = 2048;       // per cascade, 2x2 of them share one atlas
+
+        static constexpr uint32_t POINT_LIGHTS = 8;                 // shadowed point lights at the same time
+        static constexpr uint32_t POINT_FACE_RESOLUTION = 512;
+        static constexpr uint32_t POINT_ATLAS_TILES = 8;            // faces per atlas row, 8x8 in total
+        static constexpr float POINT_NEAR = 0.05f;
+    };
+
+    static_assert(ShadowConfig::POINT_LIGHTS * 6 <= ShadowConfig::POINT_ATLAS_TILES * ShadowConfig::POINT_ATLAS_TILES, "Every shadowed point light needs six atlas tiles");
+
+
+    /*
+        A mesh going into shadow maps. The frontend culls every caster against each shadow view up
+        front, views has a bit per cascade and per point light slot it lands in. Static casters
+        are only submitted for views whose cache is being re-rendered this frame.
+    */
+    struct ShadowCaster {
+        uint32_t model;
+        uint32_t transform;
+        uint32_t views;
+        uint32_t flags;             // DrawPacket::Static
+
+        static constexpr uint32_t cascadeBit(uint32_t cascade) { return 1u << cascade; }
+        static constexpr uint32_t pointBit(uint32_t slot) { return 1u << (ShadowConfig::CASCADES + slot); }
+
+        bool isStatic() const { return (flags & DrawPacket::Static) != 0; }
+    };
+
+    static_assert(ShadowConfig::CASCADES + ShadowConfig::POINT_LIGHTS <= 32, "ShadowCaster::views has a bit per view");
+    static_assert(std::is_trivially_copyable_v<ShadowCaster>, "ShadowCaster has to stay plain data");
+
+
+    struct DirectionalLight {
+        glm::vec3 direction{0.f, 1.f, 0.f};        // the way the light travels, world space (y points down)
+        glm::vec3 color{1.f};
+        float intensity{0.f};                       // 0 switches it (and its shadows) off
+    };
+
+    struct ShadowCascade {
+        glm::mat4 viewProj{1.f};
+        float splitDepth{0.f};                      // view depth the cascade reaches to
+        float texelSize{0.f};                       // world size of one shadow map texel
+        uint64_t key{0};                            // changes whenever the cached static casters are invalid
+    };
+
+    struct PointShadow {
+        glm::vec3 position{0.f};
+        float range{0.f};
+        uint64_t version{0};                        // bumped by the owner when something moved in range, 0 = slot unused
+
+        bool isActive() const { return version != 0; }
+
+        // +X -X +Y -Y +Z -Z, the lighting picks the face by the major axis of the light to fragment vector
+        glm::mat4 faceViewProj(uint32_t face) const
+        {
+            static const std::array<glm::vec3, 6> directions{
+                glm::vec3{1.f, 0.f, 0.f}, glm::vec3{-1.f, 0.f, 0.f},
+                glm::vec3{0.f, 1.f, 0.f}, glm::vec3{0.f, -1.f, 0.f},
+                glm::vec3{0.f, 0.f, 1.f}, glm::vec3{0.f, 0.f, -1.f}
+            };
+
+            glm::vec3 up = face == 2 || face == 3 ? glm::vec3{0.f, 0.f, 1.f} : glm::vec3{0.f, -1.f, 0.f};
+
+            Camera camera{};
+            camera.setPrespectiveProjection(glm::radians(90.f), 1.f, ShadowConfig::POINT_NEAR, range);
+            camera.setViewDirection(position, directions[face], up);
+
+            return camera.getProjection() * camera.getViewMatrix();
+        }
+    };
+
+    // Per frame shadow state, part of the RenderFrame
+    struct ShadowFrame {
+        DirectionalLight sun{};
+        std::array<ShadowCascade, ShadowConfig::CASCADES> cascades{};
+        std::array<PointShadow, ShadowConfig::POINT_LIGHTS> points{};
+
+        uint32_t staticDirty{0};                    // cascades whose static cache gets re-rendered (bit per cascade)
+        uint32_t pointDirty{0};                     // point light slots whose faces get re-rendered
+
+        bool hasSun() const { return sun.intensity > 0.f; }
+    };
+
+    // What the backend's shadow caches hold, ShadowSystem stores once recorded and the frontend reads
+    struct ShadowCacheState {
+        std::array<std::atomic<uint64_t>, ShadowConfig::CASCADES> cascadeKeys{};
+        std::array<std::atomic<uint64_t>, ShadowConfig::POINT_LIGHTS> pointVersions{};
+    };
+
+
+    /*
+        Frontend side of the shadows. Fits the cascades around the camera and decides which
+        cached views are stale, the caller then submits casters for exactly those.
+
+        Cascades are bounding spheres of their slice of the view frustum, so they keep their size
+        while the camera turns, and their centers snap to a coarse light space grid (a multiple
+        of the texel size). Texels don't swim and the cascade only actually moves, and its static
+        cache is only re-rendered, when the camera crossed a grid step.
+    */
+    class ShadowPlanner {
+
+        public:
+
+            static constexpr float SHADOW_DISTANCE = 40.f;     // past it the sun lights without shadows
+            static constexpr float SPLIT_LAMBDA = 0.8f;         // 0 uniform splits, 1 logarithmic
+            static constexpr float CASTER_REACH = 30.f;         // casters this far towards the sun still land in a cascade
+
+        private:
+
+            // -------- MEMBER VARIABLES -------- //
+
+            // What the previous frame asked for, it may not have reached the backend yet
+            std::array<uint64_t, ShadowConfig::CASCADES> m_submittedCascades{};
+            std::array<uint64_t, ShadowConfig::POINT_LIGHTS> m_submittedPoints{};
+
+            uint64_t m_staticGeneration{1};
+
+            // -------- -------- -------- -------- //
+
+        public:
+
+            // shadows.sun and shadows.points are filled in by the caller
+            void plan(ShadowFrame& shadows, const Camera& camera, bool staticChanged, const ShadowCacheState& cache)
+            {
+                if (staticChanged)
+                    m_staticGeneration++;
+
+                shadows.staticDirty = 0;
+                shadows.pointDirty = 0;
+
+                if (shadows.hasSun())
+                {
+                    fitCascades(shadows, camera);
+
+                    for (uint32_t c = 0; c < ShadowConfig::CASCADES; c++)
+                        if (isStale(shadows.cascades[c].key, m_submittedCascades[c], cache.cascadeKeys[c]))
+                            shadows.staticDirty |= 1u << c;
+                }
+                else
+                    m_submittedCascades.fill(0);
+
+                for (uint32_t s = 0; s < ShadowConfig::POINT_LIGHTS; s++)
+                {
+                    if (!shadows.points[s].isActive())
+                    {
+                        m_submittedPoints[s] = 0;
+                        continue;
+                    }
+
+                    if (isStale(shadows.points[s].version, m_submittedPoints[s], cache.pointVersions[s]))
+                        shadows.pointDirty |= 1u << s;
+                }
+            }
+
+        private:
+
+            // Clean only if the backend holds key and the frame still in flight asked for the same one,
+            // a frame the backend drops never changes its caches
+            static bool isStale(uint64_t key, uint64_t& submitted, const std::atomic<uint64_t>& cached)
+            {
+                bool stale = cached.load(std::memory_order_acquire) != key || submitted != key;
+                submitted = key;
+                return stale;
+            }
+
+            void fitCascades(ShadowFrame& shadows, const Camera& camera) const
+            {
+                const glm::mat4& proj = camera.getProjection();
+
+                // Camera::setPrespectiveProjection: P[2][2] = f / (f - n), P[3][2] = -f * n / (f - n)
+                float zNear = -proj[3][2] / proj[2][2];
+                float zFar = std::min(proj[2][2] * zNear / (proj[2][2] - 1.f), SHADOW_DISTANCE);
+
+                float tanX = 1.f / proj[0][0];
+                float tanY = 1.f / proj[1][1];
+                glm::mat4 inverseView = glm::inverse(camera.getViewMatrix());
+
+                // Same basis Camera::setViewDirection builds for the light
+                glm::vec3 w = glm::normalize(shadows.sun.direction);
+                glm::vec3 up = std::abs(w.y) > 0.99f ? glm::vec3{0.f, 0.f, 1.f} : glm::vec3{0.f, -1.f, 0.f};
+                glm::vec3 u = glm::normalize(glm::cross(w, up));
+                glm::vec3 v = glm::cross(w, u);
+
+                float splitNear = zNear;
+
+                for (uint32_t c = 0; c < ShadowConfig::CASCADES; c++)
+                {
+                    float p = static_cast<float>(c + 1) / ShadowConfig::CASCADES;
+                    float logSplit = zNear * std::pow(zFar / zNear, p);
+                    float uniformSplit = zNear + (zFar - zNear) * p;
+                    float splitFar = SPLIT_LAMBDA * logSplit + (1.f - SPLIT_LAMBDA) * uniformSplit;
+
+                    // ---- Bounding sphere of the slice ----
+                    std::array<glm::vec3, 8> corners;
+                    glm::vec3 center{0.f};
+
+                    for (uint32_t i = 0; i < 8; i++)
+                    {
+                        float depth = i < 4 ? splitNear : splitFar;
+                        glm::vec4 corner{(i & 1 ? tanX : -tanX) * depth, (i & 2 ? tanY : -tanY) * depth, depth, 1.f};
+
+                        corners[i] = glm::vec3{inverseView * corner};
+                        center += corners[i] / 8.f;
+                    }
+
+                    float radius = 0.f;
+                    for (const glm::vec3& corner : corners)
+                        radius = std::max(radius, glm::length(corner - center));
+
+                    // Float noise must not change the cascade's size
+                    radius = std::ceil(radius * 16.f) / 16.f;
+
+                    // ---- Snapping, the margin lets the center lag a whole step behind ----
+                    float halfExtent = radius * 1.25f;
+                    float texelSize = 2.f * halfExtent / ShadowConfig::CASCADE_RESOLUTION;
+                    float step = texelSize * std::max(1.f, std::floor(0.25f * radius / texelSize));
+
+                    glm::vec3 cell = glm::floor(glm::vec3{glm::dot(u, center), glm::dot(v, center), glm::dot(w, center)} / step + 0.5f);
+                    glm::vec3 snapped = (u * cell.x + v * cell.y + w * cell.z) * step;
+
+                    Camera lightCamera{};
+                    lightCamera.setViewDirection(snapped - w * (halfExtent + CASTER_REACH), w, up);
+                    lightCamera.setOrthographicProjection(-halfExtent, halfExtent, -halfExtent, halfExtent, 0.f, 2.f * halfExtent + CASTER_REACH);
+
+                    ShadowCascade& cascade = shadows.cascades[c];
+                    cascade.viewProj = lightCamera.getProjection() * lightCamera.getViewMatrix();
+                    cascade.splitDepth = splitFar;
+                    cascade.texelSize = texelSize;
+                    cascade.key = cascadeKey(cell, halfExtent, w);
+
+                    splitNear = splitFar;
+                }
+            }
+
+            uint64_t cascadeKey(const glm::vec3& cell, float halfExtent, const glm::vec3& direction) const
+            {
+                uint64_t key = m_staticGeneration;
+
+                auto mix = [&](uint64_t value) {
+                    uint64_t h = (key ^ value) + 0x9e3779b97f4a7c15ull;
+                    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+                    h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+                    key = h ^ (h >> 31);
+                };
+
+                auto bits = [](float value) {
+                    uint32_t result;
+                    std::memcpy(&result, &value, sizeof(result));
+                    return static_cast<uint64_t>(result);
+                };
+
+                // Cells as integers, -0 and 0 are the same cell
+                mix(static_cast<uint64_t>(static_cast<int64_t>(cell.x)));
+                mix(static_cast<uint64_t>(static_cast<int64_t>(cell.y)));
+                mix(static_cast<uint64_t>(static_cast<int64_t>(cell.z)));
+                mix(bits(halfExtent));
+                mix(bits(direction.x)); mix(bits(direction.y)); mix(bits(direction.z));
+
+                // 0 is what an empty cache holds
+                return key | 1;
+            }
+    };
+
+}
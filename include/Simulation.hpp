@@ -0,0 +1,115 @@
+#pragma once
+
+#include "GameObject.hpp"
+#include "TripleBuffer.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Orasis {
+
+
+    // What the simulation owns and the renderer gets to see. Only translation, rotation and
+    // scale are meaningful, world matrices are rebuilt on the render side.
+    struct SimulationState {
+
+        struct Body {
+            GameObject::uint id;
+            TransformComponent transform;
+        };
+
+        TransformComponent camera{};
+        std::vector<Body> bodies{};
+    };
+
+    struct SimulationSnapshot {
+        uint64_t tick{0};
+        std::chrono::steady_clock::time_point time{};
+        SimulationState state{};
+    };
+
+
+    /*
+        Runs game logic on its own thread at a fixed rate and publishes a snapshot after every
+        batch of ticks through a triple buffer. The render thread shows the state one tick in the
+        past, interpolated between the two newest snapshots it has seen, so a slow tick doesn't
+        stall rendering and a slow frame doesn't stall the simulation.
+
+        Input is sampled on the main thread (GLFW) and handed over as a bitmask. Presses shorter
+        than a tick are latched so they still reach the next tick.
+    */
+    class Simulation {
+
+        public:
+
+            using Clock = std::chrono::steady_clock;
+
+            // Runs on the simulation thread, must only touch state (and what it owns itself)
+            using TickFunction = std::function<void(SimulationState& state, uint32_t actions, float dt)>;
+
+            // A stall longer than this many ticks is dropped instead of caught up
+            static constexpr uint32_t MAX_CATCH_UP_TICKS = 8;
+
+        private:
+
+            // -------- MEMBER VARIABLES -------- //
+
+            Clock::duration m_step;
+            float m_stepSeconds;
+
+            TickFunction m_tick{};
+            SimulationState m_state{};             // simulation thread only once started
+
+            TripleBuffer<SimulationSnapshot> m_snapshots{};
+
+            // Render thread side, the older of the two snapshots being interpolated and the result
+            SimulationSnapshot m_previous{};
+            SimulationState m_interpolated{};
+
+            std::atomic<uint32_t> m_heldActions{0};
+            std::atomic<uint32_t> m_latchedActions{0};
+
+            std::thread m_thread{};
+            std::mutex m_stopMutex;
+            std::condition_variable m_stopSignal;
+            bool m_stopping{false};
+
+            // -------- -------- -------- -------- //
+
+        public:
+
+            explicit Simulation(double tickRate = 60.0);
+            ~Simulation();
+
+            Simulation(const Simulation&) = delete;
+            Simulation &operator=(const Simulation&) = delete;
+
+            // Publishes the initial state and starts ticking
+            void start(SimulationState initialState, TickFunction tick);
+            void stop();
+
+            bool isRunning() const { return m_thread.joinable(); }
+
+            // Main thread, once per frame
+            void setInput(uint32_t actions);
+
+            // Render thread. State at (now - one tick), bodies in the order the simulation keeps them.
+            const SimulationState& interpolate(Clock::time_point now = Clock::now());
+
+            float tickSeconds() const { return m_stepSeconds; }
+
+        private:
+
+            void threadLoop(Clock::time_point start);
+            void publish(uint64_t tick, Clock::time_point time);
+
+            static void blend(const TransformComponent& from, const TransformComponent& to, float alpha, TransformComponent& out);
+    };
+
+}
@@ -30,16 +30,18 @@ namespace Orasis {
     std::vector<VkImage> swapChainImages;
     std::vector<VkImageView> swapChainImageViews;
 
+    // Headless: the images are ours, handed out in a ring, see createOffscreenImages
+    bool offscreen{false};
+    std::vector<VkDeviceMemory> offscreenImageMemorys;
+    uint32_t nextOffscreenImage{0};
+
     Device& device;
     std::shared_ptr<SwapChain> oldSwapChain;
     VkExtent2D windowExtent;
+    VkPresentModeKHR preferredPresentMode;
+    VkPresentModeKHR swapChainPresentMode;
 
-    VkSwapchainKHR swapChain;
-    std::vector<VkSemaphore> imageAvailableSemaphores;
-    std::vector<VkSemaphore> renderFinishedSemaphores;
-    std::vector<VkFence> inFlightFences;
-    std::vector<VkFence> imagesInFlight;
-    size_t currentFrame = 0;
+    VkSwapchainKHR swapChain = VK_NULL_HANDLE;
     
     // --------- Deffered Variables ---------
     VkRenderPass defferedRenderPass;
@@ -75,7 +77,6 @@ namespace Orasis {
       
       // Deffered with manager
       VkRenderPass getDefferedRenderPass() { return manager->getRenderPass(); }
-      VkImageView getPositionImageViews(int index) { return manager->getImageView("Positions", index); }
       VkImageView getNormalImageViews(int index) { return manager->getImageView("Normal", index); }
       VkImageView getAlbedoImageViews(int index) { return manager->getImageView("Albido", index); }
       
@@ -104,11 +105,11 @@ namespace Orasis {
     
     void init();
     void createSwapChain();
+    void createOffscreenImages();
     void createImageViews();
     void createDepthResources();
     void createRenderPass();
     void createFramebuffers();
-    void createSyncObjects();
 
     // Helper functions
     VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR> &availableFormats);
@@ -118,10 +119,15 @@ namespace Orasis {
     
     public:
 
-    static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+    // Upper bound, per frame resources are allocated for this many. How many are actually
+    // in flight is up to the FrameScheduler (DEFAULT_FRAMES_IN_FLIGHT unless changed at runtime).
+    static constexpr int MAX_FRAMES_IN_FLIGHT = 3;
+    static constexpr int DEFAULT_FRAMES_IN_FLIGHT = 2;
 
-    SwapChain(Device &deviceRef, VkExtent2D windowExtent);
-    SwapChain(Device &deviceRef, VkExtent2D windowExtent, std::shared_ptr<SwapChain> previous);
+    // The preferred present mode is used when supported, IMMEDIATE falls back to MAILBOX, everything else to FIFO.
+    // On a headless device there's no VkSwapchainKHR, MAX_FRAMES_IN_FLIGHT offscreen images take its place.
+    SwapChain(Device &deviceRef, VkExtent2D windowExtent, VkPresentModeKHR preferredMode = VK_PRESENT_MODE_IMMEDIATE_KHR);
+    SwapChain(Device &deviceRef, VkExtent2D windowExtent, std::shared_ptr<SwapChain> previous, VkPresentModeKHR preferredMode = VK_PRESENT_MODE_IMMEDIATE_KHR);
     ~SwapChain();
 
 
@@ -133,16 +139,21 @@ namespace Orasis {
     VkRenderPass getRenderPass() { return renderPass; }
     VkImageView getImageView(int index) { return swapChainImageViews[index]; }
     VkFormat getSwapChainImageFormat() {return swapChainImageFormat;}
+    VkPresentModeKHR getPresentMode() { return swapChainPresentMode; }
+    static const char *presentModeName(VkPresentModeKHR mode);
 
     size_t imageCount() { return swapChainImages.size(); } //----- If manager doesn't work need to uncomment this
     
     VkExtent2D getSwapChainExtent() { return swapChainExtent; }
     VkSwapchainKHR getSwapChain() { return swapChain; }
+    const std::vector<VkImage>& getImages() const { return swapChainImages; }
+    bool isOffscreen() const { return offscreen; }
     uint32_t width() { return swapChainExtent.width; }
     uint32_t height() { return swapChainExtent.height; }
     VkFormat findDepthFormat();
-    VkResult acquireNextImage(uint32_t *imageIndex);
-    VkResult submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex);
+    // Offscreen the semaphores are neither signaled nor waited on, images are just handed out in order
+    VkResult acquireNextImage(VkSemaphore imageAvailable, uint32_t *imageIndex);
+    VkResult present(VkSemaphore renderFinished, uint32_t *imageIndex);
 
     float extentAspectRatio() {
       return static_cast<float>(swapChainExtent.width) / static_cast<float>(swapChainExtent.height);
@@ -0,0 +1,354 @@
+#pragma once
+
+#include "JobSystem.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Orasis {
+
+
+    template<typename T = void>
+    class Task;
+
+    namespace detail {
+
+        struct TaskPromiseBase {
+
+            // Whoever co_awaits the task, resumed straight from final_suspend (no stack growth)
+            std::coroutine_handle<> continuation{std::noop_coroutine()};
+            std::exception_ptr exception{};
+
+            struct FinalAwaiter {
+                bool await_ready() const noexcept { return false; }
+
+                template<typename Promise>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+                {
+                    return handle.promise().continuation;
+                }
+
+                void await_resume() const noexcept {}
+            };
+
+            // Lazy, nothing runs until someone awaits the task
+            std::suspend_always initial_suspend() const noexcept { return {}; }
+            FinalAwaiter final_suspend() const noexcept { return {}; }
+
+            void unhandled_exception() noexcept { exception = std::current_exception(); }
+
+            void rethrowIfFailed()
+            {
+                if (exception)
+                    std::rethrow_exception(exception);
+            }
+        };
+
+        template<typename T>
+        struct TaskPromise : TaskPromiseBase {
+
+            std::optional<T> value{};
+
+            Task<T> get_return_object() noexcept;
+
+            template<typename U>
+            void return_value(U&& result) { value.emplace(std::forward<U>(result)); }
+
+            T result()
+            {
+                rethrowIfFailed();
+                return std::move(*value);
+            }
+        };
+
+        template<>
+        struct TaskPromise<void> : TaskPromiseBase {
+
+            Task<void> get_return_object() noexcept;
+
+            void return_void() const noexcept {}
+
+            void result() { rethrowIfFailed(); }
+        };
+
+
+        // Starts eagerly and frees itself at the end, the glue for spawn() and syncWait()
+        struct DetachedTask {
+            struct promise_type {
+                DetachedTask get_return_object() const noexcept { return {}; }
+                std::suspend_never initial_suspend() const noexcept { return {}; }
+                std::suspend_never final_suspend() const noexcept { return {}; }
+                void return_void() const noexcept {}
+
+                // Same rule as jobs, catch inside
+                void unhandled_exception() const noexcept { std::terminate(); }
+            };
+        };
+
+    }
+
+
+    /*
+        Lazily started coroutine returning T. co_await it from another coroutine, or run it to
+        completion with syncWait / fire it off with spawn. Awaiting resumes the awaiter on
+        whichever thread finished the task, so hop explicitly (resumeOn) where that matters.
+
+        An exception escaping the body is rethrown from co_await / syncWait.
+    */
+    template<typename T>
+    class [[nodiscard]] Task {
+
+        public:
+
+            using promise_type = detail::TaskPromise<T>;
+
+        private:
+
+            std::coroutine_handle<promise_type> m_handle{};
+
+        public:
+
+            Task() = default;
+            explicit Task(std::coroutine_handle<promise_type> handle) : m_handle{handle} {}
+
+            Task(Task&& other) noexcept : m_handle{std::exchange(other.m_handle, {})} {}
+
+            Task &operator=(Task&& other) noexcept
+            {
+                if (this != &other)
+                {
+                    if (m_handle) m_handle.destroy();
+                    m_handle = std::exchange(other.m_handle, {});
+                }
+                return *this;
+            }
+
+            Task(const Task&) = delete;
+            Task &operator=(const Task&) = delete;
+
+            ~Task()
+            {
+                if (m_handle) m_handle.destroy();
+            }
+
+            bool isValid() const { return static_cast<bool>(m_handle); }
+            bool isDone() const { return m_handle && m_handle.done(); }
+
+            // -------- Awaitable -------- //
+
+            struct Awaiter {
+
+                std::coroutine_handle<promise_type> handle;
+
+                bool await_ready() const noexcept { return handle.done(); }
+
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+                {
+                    handle.promise().continuation = awaiting;
+                    return handle;
+                }
+
+                T await_resume() { return handle.promise().result(); }
+            };
+
+            Awaiter operator co_await() const noexcept
+            {
+                assert(m_handle && "Can't await an empty task");
+                return {m_handle};
+            }
+    };
+
+
+    namespace detail {
+
+        template<typename T>
+        Task<T> TaskPromise<T>::get_return_object() noexcept
+        {
+            return Task<T>{std::coroutine_handle<TaskPromise<T>>::from_promise(*this)};
+        }
+
+        inline Task<void> TaskPromise<void>::get_return_object() noexcept
+        {
+            return Task<void>{std::coroutine_handle<TaskPromise<void>>::from_promise(*this)};
+        }
+
+        // The task is moved into the frame, so it lives exactly as long as it runs
+        inline DetachedTask runDetached(JobSystem& jobs, Task<void> task, JobCounter* counter)
+        {
+            co_await task;
+
+            if (counter)
+                jobs.release(*counter);
+        }
+
+        struct SyncState {
+            std::mutex mutex;
+            std::condition_variable done;
+            bool finished{false};
+            std::exception_ptr exception{};
+        };
+
+        template<typename T, typename Result>
+        DetachedTask runSync(Task<T>& task, Result& result, SyncState& state)
+        {
+            try
+            {
+                if constexpr (std::is_void_v<T>)
+                    co_await task;
+                else
+                    result.emplace(co_await task);
+            }
+            catch (...)
+            {
+                state.exception = std::current_exception();
+            }
+
+            // Notified under the lock, syncWait can't return (and destroy the state) before we let go
+            std::lock_guard<std::mutex> lock{state.mutex};
+            state.finished = true;
+            state.done.notify_one();
+        }
+
+        // Lives in the awaiting frame for the whole co_await, the children only point at it
+        template<typename T>
+        struct WhenAllAwaiter {
+
+            std::vector<Task<T>>& tasks;
+            std::vector<std::optional<T>>& results;
+            std::vector<std::exception_ptr>& errors;
+
+            std::atomic<size_t> remaining{0};
+            std::coroutine_handle<> parent{};
+
+            bool await_ready() const noexcept { return tasks.empty(); }
+
+            bool await_suspend(std::coroutine_handle<> awaiting)
+            {
+                parent = awaiting;
+
+                // One extra for ourselves, no child can resume the parent before it's suspended
+                remaining.store(tasks.size() + 1, std::memory_order_relaxed);
+
+                for (size_t i = 0; i < tasks.size(); i++)
+                    runChild(*this, i);
+
+                // Everything finished inline, carry on without suspending
+                return remaining.fetch_sub(1, std::memory_order_acq_rel) != 1;
+            }
+
+            void await_resume() const noexcept {}
+
+            static DetachedTask runChild(WhenAllAwaiter& awaiter, size_t index)
+            {
+                try
+                {
+                    awaiter.results[index].emplace(co_await awaiter.tasks[index]);
+                }
+                catch (...)
+                {
+                    awaiter.errors[index] = std::current_exception();
+                }
+
+                if (awaiter.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    awaiter.parent.resume();
+            }
+        };
+
+    }
+
+
+    // *************** Awaitables *********************
+
+    // co_await resumeOn(jobs) continues the coroutine as a job. Background for anything that
+    // takes milliseconds (file reads, decoding), see JobSystem::runBackground.
+    struct JobAwaiter {
+
+        JobSystem& jobs;
+        bool background;
+
+        bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> handle) const
+        {
+            if (background)
+                jobs.runBackground([handle] { handle.resume(); });
+            else
+                jobs.run([handle] { handle.resume(); });
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    inline JobAwaiter resumeOn(JobSystem& jobs) { return {jobs, false}; }
+    inline JobAwaiter resumeInBackground(JobSystem& jobs) { return {jobs, true}; }
+
+    // *************** ----------------- *********************
+
+
+
+    // Runs the tasks concurrently, each one starts on the calling thread until it first hops
+    // away. Results in order, the first failure is rethrown once all of them finished.
+    template<typename T>
+    Task<std::vector<T>> whenAll(std::vector<Task<T>> tasks)
+    {
+        std::vector<std::optional<T>> results(tasks.size());
+        std::vector<std::exception_ptr> errors(tasks.size());
+
+        co_await detail::WhenAllAwaiter<T>{tasks, results, errors};
+
+        for (std::exception_ptr& error : errors)
+            if (error)
+                std::rethrow_exception(error);
+
+        std::vector<T> values;
+        values.reserve(results.size());
+
+        for (std::optional<T>& result : results)
+            values.push_back(std::move(*result));
+
+        co_return values;
+    }
+
+    // Starts the task on the calling thread until its first suspension. counter (optional)
+    // counts it until it finished, JobSystem::wait works on it like on jobs. Must not throw.
+    inline void spawn(JobSystem& jobs, Task<void> task, JobCounter* counter = nullptr)
+    {
+        if (counter)
+            jobs.retain(*counter);
+
+        detail::runDetached(jobs, std::move(task), counter);
+    }
+
+    // Blocks the calling thread until the task finished. Not from inside a job, it would sit on
+    // a thread the task might need.
+    template<typename T>
+    T syncWait(Task<T> task)
+    {
+        using Result = std::conditional_t<std::is_void_v<T>, std::optional<bool>, std::optional<T>>;
+
+        Result result{};
+        detail::SyncState state{};
+
+        detail::runSync(task, result, state);
+
+        {
+            std::unique_lock<std::mutex> lock{state.mutex};
+            state.done.wait(lock, [&] { return state.finished; });
+        }
+
+        if (state.exception)
+            std::rethrow_exception(state.exception);
+
+        if constexpr (!std::is_void_v<T>)
+            return std::move(*result);
+    }
+
+}
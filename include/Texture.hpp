@@ -3,9 +3,10 @@
 #include "Device.hpp"
 #include "Frame_Info.hpp"
 #include "Image.hpp"
+#include "Buffer.hpp"
 
 
-#define STB_IMAGE_IMPLEMENTATION
+// STB_IMAGE_IMPLEMENTATION is defined in AssetLoader.cpp
 #include <stb_image.h>
 #include <stdexcept>
 
@@ -13,6 +14,7 @@
 
 #include <string>
 #include <memory>
+#include <vector>
 
 #include "vk_mem_alloc.h"
 
@@ -28,20 +30,67 @@ namespace Orasis {
         VkSampler m_sampler{};
 
         public:
+
+            // Decoded RGBA8
+            struct Pixels {
+                int width{0};
+                int height{0};
+                std::vector<unsigned char> data{};
+            };
             
             Texture(Device& device, VmaAllocator allocator, const std::string& filepath)
             : m_device{device}, m_allocator{allocator}
             {
-                int texWidth, texHeight, texChannels;
-                std::vector<unsigned char> pixels;
-                loadFromFile(filepath, texWidth, texHeight, pixels);
+                Pixels pixels;
+                loadFromFile(filepath, pixels.width, pixels.height, pixels.data);
+
+                create(pixels, nullptr);
+            }
 
+            // Doesn't wait for the copy, see Model's PendingUpload constructor
+            Texture(Device& device, VmaAllocator allocator, const Pixels& pixels, PendingUpload& upload)
+            : m_device{device}, m_allocator{allocator}
+            {
+                create(pixels, &upload);
+            }
+
+
+            ~Texture()
+            {
+                vkDestroySampler(m_device.device(), m_sampler, nullptr);
+            }
 
+            // A file already in memory, throws like the file constructor. Any thread.
+            static Pixels decode(const std::vector<char>& file, const std::string& name)
+            {
+                Pixels pixels;
+                int texChannels;
 
-                uint32_t indexSize = sizeof(pixels[0]);
-                VkDeviceSize bufferSize = sizeof(pixels[0]) * pixels.size();
+                stbi_uc* data = stbi_load_from_memory(
+                    reinterpret_cast<const stbi_uc*>(file.data()), static_cast<int>(file.size()),
+                    &pixels.width, &pixels.height, &texChannels, STBI_rgb_alpha
+                );
+                if (!data) {
+                    throw std::runtime_error("failed to decode texture file: " + name);
+                }
 
-                Buffer stagingBuffer(
+                pixels.data.assign(data, data + pixels.width * pixels.height * 4);
+                stbi_image_free(data);
+
+                return pixels;
+            }
+
+        private:
+
+            void create(const Pixels& pixels, PendingUpload* upload)
+            {
+                int texWidth = pixels.width;
+                int texHeight = pixels.height;
+
+                uint32_t indexSize = sizeof(pixels.data[0]);
+                VkDeviceSize bufferSize = sizeof(pixels.data[0]) * pixels.data.size();
+
+                auto stagingBuffer = std::make_unique<Buffer>(
                     m_device,
                     indexSize,
                     bufferSize,
@@ -49,9 +98,9 @@ namespace Orasis {
                     VMA_MEMORY_USAGE_AUTO_PREFER_HOST
                 );
 
-                stagingBuffer.map();
-                stagingBuffer.writeToBuffer(pixels.data());
-                stagingBuffer.unmap();
+                stagingBuffer->map();
+                stagingBuffer->writeToBuffer((void *)pixels.data.data());
+                stagingBuffer->unmap();
 
                 VkExtent2D texExtent {static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight)};
 
@@ -65,20 +114,18 @@ namespace Orasis {
                     attachInfo
                 );
 
-                m_device.copyBufferToImage(stagingBuffer.getBuffer(), m_image->s_image, texWidth, texHeight, 1);
+                if (upload)
+                {
+                    uint64_t value = m_device.copyBufferToImageAsync(stagingBuffer->getBuffer(), m_image->s_image, texWidth, texHeight, 1);
+                    upload->add(std::move(stagingBuffer), value);
+                }
+                else
+                    m_device.copyBufferToImage(stagingBuffer->getBuffer(), m_image->s_image, texWidth, texHeight, 1);
                 
                 createSampler();
 
             }
 
-
-            ~Texture()
-            {
-                vkDestroySampler(m_device.device(), m_sampler, nullptr);
-            }
-
-        private:
-
             void loadFromFile(const std::string& filepath, int& texWidth, int& texHeight, std::vector<unsigned char>& pixels)
             {
                 int texChannels;
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Device.hpp"
+#include "JobSystem.hpp"
+
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace Orasis {
+
+
+    /*
+        Lets coroutines co_await a value on the device timeline without holding a thread. One
+        watcher thread sleeps in vkWaitSemaphores on the smallest value anyone waits for, when
+        it passes every waiter that's done gets resumed as a job on the JobSystem.
+
+        The JobSystem has to outlive the watcher.
+    */
+    class TimelineWatcher {
+
+        struct Waiter {
+            uint64_t value;
+            std::coroutine_handle<> handle;
+
+            bool operator>(const Waiter& other) const { return value > other.value; }
+        };
+
+        // -------- MEMBER VARIABLES -------- //
+
+        Device& m_device;
+        JobSystem& m_jobs;
+
+        std::mutex m_mutex;
+        std::condition_variable m_changed;
+        std::priority_queue<Waiter, std::vector<Waiter>, std::greater<Waiter>> m_waiters{};
+        bool m_stopping{false};
+
+        std::thread m_thread;
+
+        // -------- -------- -------- -------- //
+
+        public:
+
+        struct Awaiter {
+
+            TimelineWatcher& watcher;
+            uint64_t value;
+
+            bool await_ready() const { return watcher.m_device.isTimelineComplete(value); }
+            void await_suspend(std::coroutine_handle<> handle) const { watcher.enqueue(value, handle); }
+            void await_resume() const noexcept {}
+        };
+
+        TimelineWatcher(Device& device, JobSystem& jobs);
+        ~TimelineWatcher();
+
+        TimelineWatcher(const TimelineWatcher&) = delete;
+        TimelineWatcher &operator=(const TimelineWatcher&) = delete;
+
+        // co_await watcher.wait(value), resumes on a worker once the GPU got past value
+        Awaiter wait(uint64_t value) { return {*this, value}; }
+
+        private:
+
+        void enqueue(uint64_t value, std::coroutine_handle<> handle);
+        void watchLoop();
+
+        // Takes everything at or below completedValue out of the queue
+        std::vector<std::coroutine_handle<>> takeCompleted(uint64_t completedValue);
+    };
+
+}
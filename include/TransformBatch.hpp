@@ -0,0 +1,60 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace Orasis {
+
+
+    // Structure of arrays input for composeTransforms, one entry per object
+    struct TransformSoA {
+
+        std::vector<float> tx{}, ty{}, tz{};
+        std::vector<float> rx{}, ry{}, rz{};
+        std::vector<float> sx{}, sy{}, sz{};
+
+        void clear()
+        {
+            for (auto* v : {&tx, &ty, &tz, &rx, &ry, &rz, &sx, &sy, &sz})
+                v->clear();
+        }
+
+        void push(glm::vec3 translation, glm::vec3 rotation, glm::vec3 scale)
+        {
+            tx.push_back(translation.x); ty.push_back(translation.y); tz.push_back(translation.z);
+            rx.push_back(rotation.x);    ry.push_back(rotation.y);    rz.push_back(rotation.z);
+            sx.push_back(scale.x);       sy.push_back(scale.y);       sz.push_back(scale.z);
+        }
+
+        size_t size() const { return tx.size(); }
+    };
+
+
+    enum class SimdLevel {
+        Scalar,
+        SSE2,
+        AVX2
+    };
+
+
+    // Same math as TransformComponent::mat4() for N objects at once. The SIMD paths use a
+    // polynomial sin/cos that agrees with the scalar path to roughly 1e-6 per element.
+    // normalMatrices may be null, otherwise it receives transpose(inverse(mat3(model))).
+    void composeTransforms(const TransformSoA& transforms, glm::mat4* modelMatrices, glm::mat3* normalMatrices = nullptr);
+
+    void composeTransforms(const TransformSoA& transforms, glm::mat4* modelMatrices, glm::mat3* normalMatrices, SimdLevel level);
+
+    // Only entries [begin, end), written to the same indices of the outputs. Disjoint ranges can run in parallel.
+    void composeTransforms(const TransformSoA& transforms, size_t begin, size_t end, glm::mat4* modelMatrices, glm::mat3* normalMatrices = nullptr);
+
+    void composeTransforms(const TransformSoA& transforms, size_t begin, size_t end, glm::mat4* modelMatrices, glm::mat3* normalMatrices, SimdLevel level);
+
+    // Picked once from cpuid, AVX2 also requires FMA and OS support for the ymm registers
+    SimdLevel detectSimdLevel();
+    const char* simdLevelName(SimdLevel level);
+
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "GameObject.hpp"
+#include "TransformBatch.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace Orasis {
+
+    class JobSystem;
+
+
+    /*
+        Parent/child transforms with cached world matrices.
+
+        Objects are stored in depth first order so a parent always comes before its children
+        and every subtree is a contiguous range of slots. Updating a dirty object then means
+        walking [slot, subtreeEnd) once, the parent world matrix is always already final.
+        Objects that are never marked dirty are never touched.
+    */
+    class TransformHierarchy {
+
+        public:
+
+            static constexpr uint32_t noParent = UINT32_MAX;
+
+            struct Change {
+                GameObject::uint id;
+                glm::vec3 displacement;
+            };
+
+        private:
+
+            // -------- PER OBJECT ID -------- //
+            std::vector<uint32_t> m_slotOf{};
+            std::vector<uint32_t> m_parentOf{};
+
+            // -------- PER SLOT (topological order) -------- //
+            std::vector<GameObject*> m_objects{};
+            std::vector<uint32_t> m_parentSlot{};
+            std::vector<uint32_t> m_subtreeEnd{};
+            std::vector<glm::mat4> m_local{};
+            std::vector<glm::mat4> m_world{};
+
+            std::vector<GameObject::uint> m_dirtyObjects{};
+            std::vector<uint8_t> m_isDirty{};       // per object id, avoids duplicates in m_dirtyObjects
+            std::vector<uint32_t> m_dirtySlots{};
+            std::vector<Change> m_changes{};
+
+            TransformSoA m_batchInput{};
+            std::vector<glm::mat4> m_batchOutput{};
+
+            bool m_orderDirty{false};
+
+            JobSystem* m_jobs{nullptr};
+
+        public:
+
+            TransformHierarchy() = default;
+
+            TransformHierarchy(const TransformHierarchy&) = delete;
+            TransformHierarchy &operator=(const TransformHierarchy&) = delete;
+
+            // Large batches of dirty objects get composed in parallel on it, nullptr keeps everything on the caller
+            void setJobSystem(JobSystem* jobs) { m_jobs = jobs; }
+
+            // The object has to live at its final address (e.g. already emplaced in the uMap)
+            void add(GameObject& object, uint32_t parentId = noParent);
+            void remove(GameObject::uint id);
+            void setParent(GameObject::uint id, uint32_t parentId);
+            uint32_t getParent(GameObject::uint id) const { return m_parentOf[id]; }
+
+            // Call after changing translation/rotation/scale, children get updated with it
+            void markDirty(GameObject::uint id);
+
+            // Recomputes only dirty objects and their descendants and writes the result back into
+            // TransformComponent::worldMatrix. Returns the objects whose world matrix changed.
+            const std::vector<Change>& update();
+
+            const glm::mat4& worldMatrix(GameObject::uint id) const { return m_world[m_slotOf[id]]; }
+            bool contains(GameObject::uint id) const { return id < m_slotOf.size() && m_slotOf[id] != noParent; }
+            size_t size() const { return m_objects.size(); }
+
+        private:
+
+            void rebuildOrder();
+            void computeLocalMatrices();
+    };
+
+}
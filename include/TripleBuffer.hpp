@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace Orasis {
+
+
+    /*
+        Single writer, single reader hand-off without locks. The writer fills back() and
+        publishes it, the reader picks up the newest published value with update(). Neither
+        side ever waits on the other, values published in between two updates are skipped.
+
+        Slots are reused, the writer has to overwrite everything in back() it cares about.
+    */
+    template<typename T>
+    class TripleBuffer {
+
+        static constexpr uint8_t indexMask = 0x3;
+        static constexpr uint8_t freshBit = 0x4;
+
+        // -------- MEMBER VARIABLES -------- //
+
+        std::array<T, 3> m_slots{};
+
+        // Slot in the middle, plus whether the writer put something new in it
+        std::atomic<uint8_t> m_middle{1};
+
+        uint8_t m_back{0};          // writer only
+        uint8_t m_front{2};         // reader only
+
+        // -------- -------- -------- -------- //
+
+        public:
+
+        TripleBuffer() = default;
+
+        TripleBuffer(const TripleBuffer&) = delete;
+        TripleBuffer &operator=(const TripleBuffer&) = delete;
+
+        // Writer
+        T& back() { return m_slots[m_back]; }
+
+        void publish()
+        {
+            uint8_t previous = m_middle.exchange(m_back | freshBit, std::memory_order_acq_rel);
+            m_back = previous & indexMask;
+        }
+
+        // Reader
+        bool hasUpdate() const { return (m_middle.load(std::memory_order_acquire) & freshBit) != 0; }
+
+        // Swaps in the newest published value, false (front unchanged) if nothing new was published
+        bool update()
+        {
+            if (!hasUpdate()) return false;
+
+            uint8_t previous = m_middle.exchange(m_front, std::memory_order_acq_rel);
+            m_front = previous & indexMask;
+            return true;
+        }
+
+        T& front() { return m_slots[m_front]; }
+        const T& front() const { return m_slots[m_front]; }
+    };
+
+}
@@ -4,27 +4,33 @@
 #include <GLFW/glfw3.h>
 #include <string.h>
 #include <stdexcept>
+#include <atomic>
 
 namespace Orasis {
 
 
     class Window {
 
-        GLFWwindow* window;
+        // Null when headless
+        GLFWwindow* window{nullptr};
+        bool headless;
 
-        int WIDTH;
-        int HEIGHT;
-        bool frameBufferResized = false;
+        // Written by the resize callback (main thread), read by the render backend
+        std::atomic<int> WIDTH;
+        std::atomic<int> HEIGHT;
+        std::atomic<bool> frameBufferResized = false;
 
         std::string window_title;
         
 
         public:
 
-        Window(int width, int height, std::string title)
-        : WIDTH(width), HEIGHT(height), window_title(title)
+        // Headless opens no window and never touches GLFW, the Device then renders without a surface
+        Window(int width, int height, std::string title, bool headless = false)
+        : headless(headless), WIDTH(width), HEIGHT(height), window_title(title)
         {
-            initWindow();
+            if (!headless)
+                initWindow();
         }
 
         Window(const Window&) = delete;
@@ -32,13 +38,20 @@ namespace Orasis {
 
         ~Window()
         {
+            if (headless) return;
+
             glfwDestroyWindow(window);
             glfwTerminate();
         }
 
+        bool isHeadless() const
+        {
+            return headless;
+        }
+
         bool shouldClose () 
         {
-            return glfwWindowShouldClose(window);
+            return !headless && glfwWindowShouldClose(window);
         }
 
         bool wasWindowResized()
@@ -63,6 +76,9 @@ namespace Orasis {
 
         void createWindowSurface(VkInstance instance, VkSurfaceKHR* surface)
         {
+            if (headless)
+                throw std::runtime_error("failed to create window surface, the window is headless");
+
             if (glfwCreateWindowSurface(instance, window, nullptr, surface) != VK_SUCCESS)
                 throw std::runtime_error("failed to create window surface");
         }
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace Orasis {
+
+
+    /*
+        Chase-Lev deque (Lê et al., "Correct and Efficient Work-Stealing for Weak Memory Models").
+        The owning thread pushes and pops at the bottom (LIFO, cache warm), any other thread
+        steals from the top (FIFO, oldest and usually largest work first).
+
+        T has to be trivially copyable, the engine only stores pointers. Arrays that were grown
+        out of are kept until destruction since a thief may still be reading from one.
+    */
+    template<typename T>
+    class WorkStealingDeque {
+
+        static_assert(std::is_trivially_copyable_v<T>, "WorkStealingDeque stores T in atomics");
+
+        struct Array {
+
+            int64_t capacity;
+            int64_t mask;
+            std::unique_ptr<std::atomic<T>[]> items;
+
+            explicit Array(int64_t cap) : capacity{cap}, mask{cap - 1}, items{new std::atomic<T>[static_cast<size_t>(cap)]} {}
+
+            T get(int64_t index) const { return items[index & mask].load(std::memory_order_relaxed); }
+            void put(int64_t index, T value) { items[index & mask].store(value, std::memory_order_relaxed); }
+
+            Array* grow(int64_t bottom, int64_t top) const
+            {
+                Array* bigger = new Array{capacity * 2};
+                for (int64_t i = top; i != bottom; i++)
+                    bigger->put(i, get(i));
+                return bigger;
+            }
+        };
+
+        // -------- MEMBER VARIABLES -------- //
+
+        // Apart so the owner's bottom and the thieves' top don't share a cache line
+        alignas(64) std::atomic<int64_t> m_top{0};
+        alignas(64) std::atomic<int64_t> m_bottom{0};
+        alignas(64) std::atomic<Array*> m_array;
+
+        std::vector<std::unique_ptr<Array>> m_retired{};
+
+        // -------- -------- -------- -------- //
+
+        public:
+
+        // capacity has to be a power of two, the deque grows on demand
+        explicit WorkStealingDeque(int64_t capacity = 1024)
+        {
+            m_array.store(new Array{capacity}, std::memory_order_relaxed);
+        }
+
+        ~WorkStealingDeque()
+        {
+            delete m_array.load(std::memory_order_relaxed);
+        }
+
+        WorkStealingDeque(const WorkStealingDeque&) = delete;
+        WorkStealingDeque &operator=(const WorkStealingDeque&) = delete;
+
+        // Owner only
+        void push(T item)
+        {
+            int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+            int64_t top = m_top.load(std::memory_order_acquire);
+            Array* array = m_array.load(std::memory_order_relaxed);
+
+            if (bottom - top > array->capacity - 1)
+            {
+                Array* bigger = array->grow(bottom, top);
+                m_retired.emplace_back(array);
+                m_array.store(bigger, std::memory_order_release);
+                array = bigger;
+            }
+
+            array->put(bottom, item);
+
+            // Release store rather than fence + relaxed, same cost and thread sanitizers understand it
+            m_bottom.store(bottom + 1, std::memory_order_release);
+        }
+
+        // Owner only, false if empty (or the last item was stolen meanwhile)
+        bool pop(T& item)
+        {
+            int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+            Array* array = m_array.load(std::memory_order_relaxed);
+            m_bottom.store(bottom, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t top = m_top.load(std::memory_order_relaxed);
+
+            if (top > bottom)
+            {
+                m_bottom.store(bottom + 1, std::memory_order_relaxed);
+                return false;
+            }
+
+            item = array->get(bottom);
+
+            if (top == bottom)
+            {
+                // Last item, race the thieves for it
+                bool won = m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+                m_bottom.store(bottom + 1, std::memory_order_relaxed);
+                return won;
+            }
+
+            return true;
+        }
+
+        // Any thread
+        bool steal(T& item)
+        {
+            int64_t top = m_top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+            if (top >= bottom) return false;
+
+            Array* array = m_array.load(std::memory_order_acquire);
+            item = array->get(top);
+
+            return m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        }
+
+        // Approximate unless called by the owner
+        bool empty() const
+        {
+            return m_bottom.load(std::memory_order_relaxed) <= m_top.load(std::memory_order_relaxed);
+        }
+    };
+
+}
@@ -4,11 +4,83 @@
 #include "App.hpp"
 #include <stdexcept>
 #include <iostream>
+#include <cstring>
+#include <cstdlib>
 
-int main () 
+int main (int argc, char** argv) 
 {
 
-    Orasis::App app;
+    // See AppOptions
+    Orasis::AppOptions options{};
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--light-benchmark") == 0 && i + 1 < argc)
+            options.benchmarkLights = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+
+        else if (std::strcmp(argv[i], "--compute-lighting") == 0)
+            options.lightingPath = Orasis::LightingPath::Compute;
+
+        else if (std::strcmp(argv[i], "--no-occlusion-culling") == 0)
+            options.occlusionCulling = false;
+
+        else if (std::strcmp(argv[i], "--no-ssao") == 0)
+            options.ambientOcclusion = false;
+
+        else if (std::strcmp(argv[i], "--depth-prepass") == 0 && i + 1 < argc)
+        {
+            const char* mode = argv[++i];
+            if (std::strcmp(mode, "on") == 0)
+                options.depthPrepass.mode = Orasis::DepthPrepassMode::On;
+            else if (std::strcmp(mode, "off") == 0)
+                options.depthPrepass.mode = Orasis::DepthPrepassMode::Off;
+            else
+                options.depthPrepass.mode = Orasis::DepthPrepassMode::Auto;
+        }
+
+        else if (std::strcmp(argv[i], "--dump-render-graph") == 0 && i + 1 < argc)
+            options.renderGraphDump = argv[++i];
+
+        else if (std::strcmp(argv[i], "--present-mode") == 0 && i + 1 < argc)
+        {
+            const char* mode = argv[++i];
+            if (std::strcmp(mode, "fifo") == 0)
+                options.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+            else if (std::strcmp(mode, "mailbox") == 0)
+                options.presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+            else
+                options.presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+        }
+
+        else if (std::strcmp(argv[i], "--fps-limit") == 0 && i + 1 < argc)
+            options.fpsLimit = std::strtod(argv[++i], nullptr);
+
+        else if (std::strcmp(argv[i], "--low-latency") == 0)
+            options.lowLatency = true;
+
+        else if (std::strcmp(argv[i], "--headless") == 0)
+            options.headless = true;
+
+        else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            options.frameLimit = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+
+        else if (std::strcmp(argv[i], "--duration") == 0 && i + 1 < argc)
+            options.durationLimit = std::strtof(argv[++i], nullptr);
+
+        else if (std::strcmp(argv[i], "--dump-frames") == 0 && i + 1 < argc)
+            options.frameDumpDirectory = argv[++i];
+
+        else if (std::strcmp(argv[i], "--dynamic-resolution") == 0 && i + 1 < argc)
+            options.resolution.targetMs = std::strtof(argv[++i], nullptr);
+
+        else if (std::strcmp(argv[i], "--resolution-bounds") == 0 && i + 2 < argc)
+        {
+            options.resolution.minScale = std::strtof(argv[++i], nullptr);
+            options.resolution.maxScale = std::strtof(argv[++i], nullptr);
+        }
+    }
+
+    Orasis::App app{options};
     
 
     try{
@@ -21,4 +93,4 @@ int main ()
     }
 
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
@@ -1,14 +1,15 @@
 #version 450
 
+// GBufferLayout::Packed, no position (the lighting pass rebuilds it from depth)
+
 // ---- IN ATTRIBUTES -----
 layout(location = 0) in vec3 aPos;
 layout(location = 1) in vec3 aNormal;
 layout(location = 2) in vec3 fragColor;
 
 // ---- OUT ATTRIBUTES -----
-layout(location = 0) out vec4 outPos;
-layout(location = 1) out vec4 outNormal;
-layout(location = 2) out vec4 outColor;
+layout(location = 0) out vec2 outNormal;    // octahedral, RG16_SNORM
+layout(location = 1) out vec4 outColor;
 
 layout(set = 0, binding = 0) uniform GlobalUbo {
     mat4 projection;
@@ -26,9 +27,20 @@ layout(push_constant) uniform Push {
 
 // Local variables
 
+vec2 signNotZero(vec2 v)
+{
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// Unit vector onto the octahedron, the lower half folded over the upper one
+vec2 octEncode(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    return n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * signNotZero(n.xy);
+}
+
 void main() {
 
-    outPos = vec4(aPos, 1.0);
-    outNormal = vec4(normalize(aNormal), 1.f);
+    outNormal = octEncode(normalize(aNormal));
     outColor = vec4(clamp(fragColor, vec3(0), vec3(1)), 1.0);
-}
\ No newline at end of file
+}
@@ -11,6 +11,9 @@ layout(location = 0) out vec3 fragPos;
 layout(location = 1) out vec3 normal;
 layout(location = 2) out vec3 fragColor;
 
+// Bit identical to depth_prepass.vert's, the G-buffer draws after it test depth with EQUAL
+invariant gl_Position;
+
 layout(set = 0, binding = 0) uniform GlobalUbo {
     mat4 projection;
     mat4 view;
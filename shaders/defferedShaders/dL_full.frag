@@ -0,0 +1,38 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// Lighting for GBufferLayout::Full, world positions come straight from the G-buffer
+
+// --- G-Buffer attachments as input attachments ---
+layout(set = 1, binding = 0, input_attachment_index = 0) uniform subpassInput gPosition;
+layout(set = 1, binding = 1, input_attachment_index = 1) uniform subpassInput gNormal;
+layout(set = 1, binding = 2, input_attachment_index = 2) uniform subpassInput gAlbedo;
+
+// ---- OUT ATTRIBUTES -----
+layout(location = 0) out vec4 outColor;
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+    mat4 projection;
+    mat4 view;
+    vec3 lightPos;
+    vec3 lightColor;
+    vec3 cameraPos;
+} ubo;
+
+#include "deferred_lighting.glsl"
+
+
+// Push constant struct
+ layout(push_constant) uniform Push {
+    mat4 model;         // transformation matrix from local to world space for model
+} push;
+
+
+void main() {
+
+    vec3 fragPos = subpassLoad(gPosition).xyz;
+    vec3 normal = subpassLoad(gNormal).xyz;
+    vec3 fragColor = subpassLoad(gAlbedo).xyz;
+
+    outColor = vec4(shadeClustered(fragPos, normal, fragColor, ubo.cameraPos, gl_FragCoord.xy), 1);
+}
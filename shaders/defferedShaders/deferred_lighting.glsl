@@ -0,0 +1,248 @@
+// Included by the lighting subpass shaders (dL_shader.frag, dL_full.frag) and the tiled compute
+// lighting (tile_common.glsl), set 2 is ClusteredLighting's, set 3 ShadowSystem's and set 4 AmbientOcclusion's. Not a stage on its own, compileShader.bat skips it.
+// pixel is the pixel center in framebuffer coordinates (gl_FragCoord.xy in a fragment shader)
+
+// ---- Clustered lights, see ClusteredLighting.hpp ----
+struct PointLight {
+    vec4 positionRange;     // world space xyz, w range
+    vec4 colorIntensity;
+    ivec4 shadow;           // x point shadow slot, -1 none
+};
+
+layout(set = 2, binding = 0) uniform ClusterUbo {
+    mat4 view;
+    vec4 projection;        // P[0][0], P[1][1], near, far
+    vec4 screen;            // width, height, tile width, tile height
+    vec4 slicing;           // scale, bias
+    uvec4 grid;             // x, y, z, light count
+} cluster;
+
+layout(set = 2, binding = 1) readonly buffer Lights {
+    PointLight lights[];
+};
+
+layout(set = 2, binding = 2) readonly buffer LightCounts {
+    uint lightCounts[];
+};
+
+layout(set = 2, binding = 3) readonly buffer LightIndices {
+    uint lightIndices[];
+};
+
+const uint MAX_LIGHTS_PER_CLUSTER = 256;
+
+
+// ---- Shadows, see ShadowSystem.hpp (ShadowConfig) ----
+#define SHADOW_CASCADES     4u
+#define SHADOW_POINT_LIGHTS 8u
+#define POINT_ATLAS_TILES   8u
+
+layout(set = 3, binding = 0) uniform ShadowUbo {
+    mat4 cascadeViewProj[SHADOW_CASCADES];
+    mat4 pointViewProj[SHADOW_POINT_LIGHTS * 6u];
+    vec4 cascadeSplits;     // view depth each cascade reaches to
+    vec4 cascadeTexels;     // world size of a texel per cascade
+    vec4 sunDirection;      // xyz the way the light travels
+    vec4 sunColor;          // rgb, w intensity (0 = no sun)
+} shadows;
+
+// 2x2 cascades, cascade c at (c % 2, c / 2)
+layout(set = 3, binding = 1) uniform sampler2DShadow cascadeAtlas;
+
+// 8x8 faces, face f of slot s is tile s * 6 + f
+layout(set = 3, binding = 2) uniform sampler2DShadow pointAtlas;
+
+
+// ---- Ambient occlusion, see AmbientOcclusion.hpp ----
+// Half resolution, r occlusion (1 open), g linear view depth. Texel t was computed at pixel 2t
+layout(set = 4, binding = 0) uniform sampler2D ambientOcclusion;
+
+
+
+// Local variables
+const float ambient = 0.05;
+const float specularStrength  = 0.5;
+const float specularPow  = 64;
+
+
+uint clusterIndex(vec3 fragPos, vec2 pixel)
+{
+    float viewDepth = max((cluster.view * vec4(fragPos, 1.0)).z, cluster.projection.z);
+
+    uvec2 tile = min(uvec2(pixel / cluster.screen.zw), cluster.grid.xy - 1u);
+    uint slice = uint(clamp(log(viewDepth) * cluster.slicing.x + cluster.slicing.y, 0.0, float(cluster.grid.z - 1u)));
+
+    return tile.x + tile.y * cluster.grid.x + slice * cluster.grid.x * cluster.grid.y;
+}
+
+// Inverse square, windowed to reach 0 at the light's range so the cluster cut off is invisible
+float attenuation(float distance, float range)
+{
+    float window = clamp(1.0 - pow(distance / range, 4.0), 0.0, 1.0);
+    return window * window / max(distance * distance, 0.0001);
+}
+
+// 3x3 PCF of the atlas tile at tile (in tiles of tileScale), uv is the 0..1 position inside it.
+// 1 lit, 0 shadowed
+float sampleShadowTile(sampler2DShadow atlas, vec2 tile, float tileScale, vec2 uv, float depth)
+{
+    vec2 texel = 1.0 / vec2(textureSize(atlas, 0));
+
+    // The filter never reaches into the neighbouring tile
+    vec2 margin = 1.5 * texel / tileScale;
+    vec2 atlasUV = (tile + clamp(uv, margin, 1.0 - margin)) * tileScale;
+
+    float lit = 0.0;
+
+    for (int y = -1; y <= 1; y++)
+        for (int x = -1; x <= 1; x++)
+            lit += texture(atlas, vec3(atlasUV + vec2(x, y) * texel, depth));
+
+    return lit / 9.0;
+}
+
+float sunShadow(vec3 fragPos, vec3 normal)
+{
+    float viewDepth = (cluster.view * vec4(fragPos, 1.0)).z;
+
+    uint c = 0;
+    while (c < SHADOW_CASCADES && viewDepth > shadows.cascadeSplits[c])
+        c++;
+
+    // Past the shadow distance
+    if (c == SHADOW_CASCADES) return 1.0;
+
+    // Normal offset against acne on surfaces facing away from the sun at a grazing angle
+    vec3 offsetPos = fragPos + normal * shadows.cascadeTexels[c] * 1.5;
+    vec4 clip = shadows.cascadeViewProj[c] * vec4(offsetPos, 1.0);
+
+    return sampleShadowTile(cascadeAtlas, vec2(c % 2u, c / 2u), 0.5, clip.xy * 0.5 + 0.5, clip.z);
+}
+
+float pointShadow(PointLight light, vec3 fragPos, vec3 normal)
+{
+    vec3 toFrag = fragPos - light.positionRange.xyz;
+    vec3 a = abs(toFrag);
+
+    // Same face order as PointShadow::faceViewProj
+    uint face = a.x >= a.y && a.x >= a.z ? (toFrag.x > 0.0 ? 0u : 1u) :
+                a.y >= a.z ?               (toFrag.y > 0.0 ? 2u : 3u) :
+                                           (toFrag.z > 0.0 ? 4u : 5u);
+
+    uint tile = uint(light.shadow.x) * 6u + face;
+
+    vec4 clip = shadows.pointViewProj[tile] * vec4(fragPos + normal * 0.02, 1.0);
+    vec3 ndc = clip.xyz / clip.w;
+
+    return sampleShadowTile(pointAtlas, vec2(tile % POINT_ATLAS_TILES, tile / POINT_ATLAS_TILES), 1.0 / POINT_ATLAS_TILES, ndc.xy * 0.5 + 0.5, ndc.z);
+}
+
+// Sun diffuse + specular, shadowed through the cascades
+vec3 shadeSun(vec3 fragPos, vec3 normal, vec3 viewDir)
+{
+    if (shadows.sunColor.w <= 0.0) return vec3(0.0);
+
+    vec3 lightDir = -shadows.sunDirection.xyz;
+    float facing = dot(lightDir, normal);
+
+    if (facing <= 0.0) return vec3(0.0);
+
+    vec3 radiance = shadows.sunColor.rgb * shadows.sunColor.w * sunShadow(fragPos, normal);
+
+    float spec = pow(max(dot(-viewDir, reflect(lightDir, normal)) , 0), specularPow);
+
+    return radiance * (facing + specularStrength * spec);
+}
+
+// GBufferLayout::Packed normals, see dG_shader.frag
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+// Bilateral upsample, the 4 closest half resolution texels weighted bilinearly and by how close
+// their depth is to the pixel's, so occlusion doesn't bleed across silhouettes
+float sampleAmbientOcclusion(vec3 fragPos, vec2 pixel)
+{
+    float viewDepth = (cluster.view * vec4(fragPos, 1.0)).z;
+
+    ivec2 last = min(ivec2(ceil(cluster.screen.xy * 0.5)), textureSize(ambientOcclusion, 0)) - 1;
+
+    vec2 position = (pixel - 0.5) * 0.5;
+    ivec2 base = ivec2(floor(position));
+    vec2 f = position - vec2(base);
+
+    float sum = 0.0;
+    float weights = 0.0;
+
+    for (int y = 0; y <= 1; y++)
+        for (int x = 0; x <= 1; x++)
+        {
+            vec2 value = texelFetch(ambientOcclusion, clamp(base + ivec2(x, y), ivec2(0), last), 0).rg;
+
+            float bilinear = (x == 0 ? 1.0 - f.x : f.x) * (y == 0 ? 1.0 - f.y : f.y);
+            float difference = abs(value.g - viewDepth) / max(viewDepth * 0.05, 1e-4);
+
+            float weight = (bilinear + 1e-3) / (1.0 + difference * difference);
+
+            sum += value.r * weight;
+            weights += weight;
+        }
+
+    return sum / weights;
+}
+
+vec3 reconstructPosition(float depth, vec2 pixel, mat4 inverseViewProjection)
+{
+    vec2 ndc = pixel / cluster.screen.xy * 2.0 - 1.0;
+    vec4 world = inverseViewProjection * vec4(ndc, depth, 1.0);
+    return world.xyz / world.w;
+}
+
+// Every light of the pixel's cluster, world space inputs
+vec3 shadeClustered(vec3 fragPos, vec3 normal, vec3 fragColor, vec3 cameraPos, vec2 pixel)
+{
+    vec3 viewDir = normalize(cameraPos - fragPos);
+
+    vec3 diffuse = vec3(0.0);
+    vec3 specular = vec3(0.0);
+
+    uint index = clusterIndex(fragPos, pixel);
+    uint count = lightCounts[index];
+
+    for (uint i = 0; i < count; i++)
+    {
+        PointLight light = lights[lightIndices[index * MAX_LIGHTS_PER_CLUSTER + i]];
+
+        vec3 toLight = light.positionRange.xyz - fragPos;
+        float fragLightDistance = length(toLight);
+
+        if (fragLightDistance >= light.positionRange.w) continue;
+
+        vec3 lightDir = toLight / max(fragLightDistance, 0.0001);
+        vec3 radiance = light.colorIntensity.rgb * light.colorIntensity.w * attenuation(fragLightDistance, light.positionRange.w);
+
+        if (light.shadow.x >= 0)
+            radiance *= pointShadow(light, fragPos, normal);
+
+        diffuse += radiance * max(dot(lightDir, normal), 0);
+
+        float spec = pow(max(dot(-viewDir, reflect(lightDir, normal)) , 0), specularPow);
+        specular += radiance * specularStrength * spec;
+    }
+
+    float occlusion = sampleAmbientOcclusion(fragPos, pixel);
+
+    return (ambient * occlusion + diffuse + specular + shadeSun(fragPos, normal, viewDir)) * fragColor;
+}
+
+// No point light in reach (TiledLighting's ambient tiles), the same as shadeClustered with an empty list
+vec3 shadeAmbient(vec3 fragPos, vec3 normal, vec3 fragColor, vec3 cameraPos, vec2 pixel)
+{
+    float occlusion = sampleAmbientOcclusion(fragPos, pixel);
+
+    return (ambient * occlusion + shadeSun(fragPos, normal, normalize(cameraPos - fragPos))) * fragColor;
+}
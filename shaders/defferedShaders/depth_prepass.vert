@@ -0,0 +1,28 @@
+#version 450
+
+// Depth pre-pass of the geometry subpass (no fragment stage), see DefferedSystem::recordDepthPrepass
+
+// ---- IN ATTRIBUTES -----
+layout(location = 0) in vec3 aPos;      // Model::bindPositions stream
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+    mat4 projection;
+    mat4 view;
+    vec3 lightPos;
+    vec3 lightColor;
+    vec3 cameraPos;
+} ubo;
+
+// Push constant struct
+ layout(push_constant) uniform Push {
+    mat4 model;         // transformation matrix from local to world space for model
+} push;
+
+// Has to match dG_shader.vert exactly, expression included
+invariant gl_Position;
+
+
+void main() {
+
+    gl_Position = ubo.projection * ubo.view * push.model * vec4(aPos, 1.f);
+}
@@ -0,0 +1,18 @@
+#version 450
+
+// Depth only, every shadow view of ShadowSystem.hpp (no fragment stage)
+
+// ---- IN ATTRIBUTES -----
+layout(location = 0) in vec3 aPos;
+
+// Push constant struct
+layout(push_constant) uniform Push {
+    mat4 viewProj;      // the cascade's / point light face's
+    mat4 model;
+} push;
+
+
+void main() {
+
+    gl_Position = push.viewProj * push.model * vec4(aPos, 1.0);
+}
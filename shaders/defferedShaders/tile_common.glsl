@@ -0,0 +1,54 @@
+// Shared by the tiled compute lighting kernels (tile_classify.comp, tile_shade_*.comp), see
+// TiledLighting.hpp. GBufferLayout::Packed only. Not a stage on its own, compileShader.bat skips it.
+
+// One work group per 16x16 screen tile
+#define TILE_SIZE 16
+layout(local_size_x = TILE_SIZE, local_size_y = TILE_SIZE) in;
+
+// Tile classes, each one gets its own indirect dispatch (empty tiles get none)
+#define CLASS_AMBIENT   0       // geometry, but no point light reaches any of its clusters
+#define CLASS_LIT       1
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+    mat4 projection;
+    mat4 view;
+    vec3 lightPos;
+    vec3 lightColor;
+    vec3 cameraPos;
+    mat4 inverseViewProjection;
+} ubo;
+
+// --- G-buffer of the frame, read after the render pass ---
+layout(set = 1, binding = 0) uniform sampler2D gDepth;
+layout(set = 1, binding = 1) uniform sampler2D gNormal;
+layout(set = 1, binding = 2) uniform sampler2D gAlbedo;
+
+layout(set = 1, binding = 3, rgba16f) uniform writeonly image2D litColor;
+
+// Matches VkDispatchIndirectCommand (+ padding)
+struct DispatchArgs {
+    uint x;
+    uint y;
+    uint z;
+    uint pad;
+};
+
+layout(set = 1, binding = 4) buffer TileLists {
+    DispatchArgs dispatches[2];
+    uint tiles[];               // class c's tiles start at c * tileCapacity, x | y << 16
+};
+
+layout(push_constant) uniform Push {
+    uvec2 tileCount;
+    uint tileCapacity;
+} push;
+
+#include "deferred_lighting.glsl"
+
+
+// The tile this work group was dispatched for by class
+ivec2 classifiedTile(uint tileClass)
+{
+    uint packed = tiles[tileClass * push.tileCapacity + gl_WorkGroupID.x];
+    return ivec2(packed & 0xFFFFu, packed >> 16);
+}
@@ -0,0 +1,58 @@
+#define STB_IMAGE_IMPLEMENTATION
+#include "AssetLoader.hpp"
+
+// std
+#include <fstream>
+#include <stdexcept>
+
+namespace Orasis {
+
+    Task<std::vector<char>> AssetLoader::readFile(std::string filepath)
+    {
+        co_await resumeInBackground(m_jobs);
+
+        std::ifstream file{filepath, std::ios::ate | std::ios::binary};
+
+        if (!file.is_open())
+            throw std::runtime_error("failed to open file: " + filepath);
+
+        size_t fileSize = static_cast<size_t>(file.tellg());
+        std::vector<char> buffer(fileSize);
+
+        file.seekg(0);
+        file.read(buffer.data(), fileSize);
+
+        co_return buffer;
+    }
+
+    Task<std::shared_ptr<Model>> AssetLoader::loadModel(std::string filepath)
+    {
+        std::vector<char> file = co_await readFile(filepath);
+
+        Model::Builder builder;
+        builder.loadModelFromMemory(file);
+
+        PendingUpload upload;
+        auto model = std::make_shared<Model>(m_device, builder, upload);
+
+        // The staging buffers stay in this frame until the copies ran
+        co_await m_gpu.wait(upload.timelineValue);
+
+        co_return model;
+    }
+
+    Task<std::shared_ptr<Texture>> AssetLoader::loadTexture(VmaAllocator allocator, std::string filepath)
+    {
+        std::vector<char> file = co_await readFile(filepath);
+
+        Texture::Pixels pixels = Texture::decode(file, filepath);
+
+        PendingUpload upload;
+        auto texture = std::make_shared<Texture>(m_device, allocator, pixels, upload);
+
+        co_await m_gpu.wait(upload.timelineValue);
+
+        co_return texture;
+    }
+
+}
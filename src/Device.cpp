@@ -1,7 +1,9 @@
 #include "Device.hpp"
 
 // std headers
+#include <cstdio>
 #include <cstring>
+#include <fstream>
 #include <iostream>
 #include <set>
 #include <unordered_set>
@@ -54,9 +56,22 @@ Device::Device(Window &window) : window{window} {
   pickPhysicalDevice();
   createLogicalDevice();
   createCommandPool();
+  createTimeline();
+  createPipelineCache();
 }
 
 Device::~Device() {
+  // Anything retired after the renderer's last flush still needs the device
+  deletionQueue_.flush();
+
+  savePipelineCache();
+  vkDestroyPipelineCache(device_, pipelineCache_, nullptr);
+
+  for (auto &kv : shaderModules_) {
+    vkDestroyShaderModule(device_, kv.second, nullptr);
+  }
+
+  vkDestroySemaphore(device_, timeline_, nullptr);
   vkDestroyCommandPool(device_, commandPool, nullptr);
   vkDestroyDevice(device_, nullptr);
 
@@ -64,7 +79,9 @@ Device::~Device() {
     DestroyDebugUtilsMessengerEXT(instance_, debugMessenger, nullptr);
   }
 
-  vkDestroySurfaceKHR(instance_, surface_, nullptr);
+  if (surface_ != VK_NULL_HANDLE) {
+    vkDestroySurfaceKHR(instance_, surface_, nullptr);
+  }
   vkDestroyInstance(instance_, nullptr);
 }
 
@@ -80,7 +97,8 @@ void Device::createInstance() {
   appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
   appInfo.pEngineName = "No Engine";
   appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-  appInfo.apiVersion = VK_API_VERSION_1_0;
+  // 1.2 for timeline semaphores (VK_KHR_timeline_semaphore promoted to core)
+  appInfo.apiVersion = VK_API_VERSION_1_2;
 
   VkInstanceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -156,15 +174,29 @@ void Device::createLogicalDevice() {
     queueCreateInfos.push_back(queueCreateInfo);
   }
 
+  VkPhysicalDeviceFeatures supportedFeatures;
+  vkGetPhysicalDeviceFeatures(physicalDevice_, &supportedFeatures);
+
   VkPhysicalDeviceFeatures deviceFeatures = {};
   deviceFeatures.samplerAnisotropy = VK_TRUE;
 
+  // Exact sample counts around executed secondaries, DefferedSystem's overdraw measurement
+  deviceFeatures.occlusionQueryPrecise = supportedFeatures.occlusionQueryPrecise;
+  deviceFeatures.inheritedQueries = supportedFeatures.inheritedQueries;
+
+  enabledFeatures = deviceFeatures;
+
   VkDeviceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 
   createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
   createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
+  VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures = {};
+  timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+  timelineFeatures.timelineSemaphore = VK_TRUE;
+
+  createInfo.pNext = &timelineFeatures;
   createInfo.pEnabledFeatures = &deviceFeatures;
   createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
   createInfo.ppEnabledExtensionNames = deviceExtensions.data();
@@ -199,8 +231,212 @@ void Device::createCommandPool() {
   }
 }
 
+void Device::createTimeline() {
+  VkSemaphoreTypeCreateInfo typeInfo = {};
+  typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+  typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+  typeInfo.initialValue = 0;
+
+  VkSemaphoreCreateInfo semaphoreInfo = {};
+  semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+  semaphoreInfo.pNext = &typeInfo;
+
+  if (vkCreateSemaphore(device_, &semaphoreInfo, nullptr, &timeline_) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create timeline semaphore!");
+  }
+}
+
+uint64_t Device::submitGraphics(const VkSubmitInfo &submitInfo) {
+  std::lock_guard<std::mutex> lock{submitMutex_};
+
+  // Values have to be signaled in increasing order, so they're handed out in submission order
+  uint64_t value = timelineSubmitted_.load(std::memory_order_relaxed) + 1;
+
+  std::vector<VkSemaphore> signalSemaphores(
+      submitInfo.pSignalSemaphores,
+      submitInfo.pSignalSemaphores + submitInfo.signalSemaphoreCount);
+  signalSemaphores.push_back(timeline_);
+
+  // Binary semaphores ignore their value
+  std::vector<uint64_t> signalValues(signalSemaphores.size(), 0);
+  signalValues.back() = value;
+
+  VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+  timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+  timelineInfo.pNext = submitInfo.pNext;
+  timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+  timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+  VkSubmitInfo info = submitInfo;
+  info.pNext = &timelineInfo;
+  info.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+  info.pSignalSemaphores = signalSemaphores.data();
+
+  if (vkQueueSubmit(graphicsQueue_, 1, &info, VK_NULL_HANDLE) != VK_SUCCESS) {
+    throw std::runtime_error("failed to submit to the graphics queue!");
+  }
+
+  timelineSubmitted_.store(value, std::memory_order_release);
+  deletionQueue_.submitted(value);
+
+  return value;
+}
+
+VkResult Device::queuePresent(const VkPresentInfoKHR &presentInfo) {
+  std::lock_guard<std::mutex> lock{submitMutex_};
+  return vkQueuePresentKHR(presentQueue_, &presentInfo);
+}
+
+uint64_t Device::completedTimelineValue() {
+  uint64_t value = 0;
+  if (vkGetSemaphoreCounterValue(device_, timeline_, &value) != VK_SUCCESS) {
+    throw std::runtime_error("failed to query timeline semaphore!");
+  }
+  return value;
+}
+
+bool Device::waitForTimeline(uint64_t value, uint64_t timeout) {
+  if (value == 0 || isTimelineComplete(value)) return true;
+
+  VkSemaphoreWaitInfo waitInfo = {};
+  waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+  waitInfo.semaphoreCount = 1;
+  waitInfo.pSemaphores = &timeline_;
+  waitInfo.pValues = &value;
+
+  VkResult result = vkWaitSemaphores(device_, &waitInfo, timeout);
+
+  if (result == VK_TIMEOUT) {
+    return false;
+  }
+  if (result != VK_SUCCESS) {
+    throw std::runtime_error("failed to wait on timeline semaphore!");
+  }
+  return true;
+}
+
+void Device::createPipelineCache() {
+  std::vector<char> initialData = readBinaryFile(pipelineCachePath);
+
+  // A cache from another driver or GPU is useless at best, start empty instead
+  if (!initialData.empty() && !isPipelineCacheCompatible(initialData)) {
+    std::cout << "Pipeline cache on disk doesn't match this device, ignoring it" << std::endl;
+    initialData.clear();
+  }
+
+  VkPipelineCacheCreateInfo cacheInfo = {};
+  cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  cacheInfo.initialDataSize = initialData.size();
+  cacheInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+
+  if (vkCreatePipelineCache(device_, &cacheInfo, nullptr, &pipelineCache_) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create pipeline cache!");
+  }
+
+  pipelineManifest_.load(pipelineManifestPath);
+}
+
+bool Device::isPipelineCacheCompatible(const std::vector<char> &data) {
+  VkPipelineCacheHeaderVersionOne header{};
+
+  if (data.size() < sizeof(header)) return false;
+
+  std::memcpy(&header, data.data(), sizeof(header));
+
+  return header.headerSize >= sizeof(header) &&
+         header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+         header.vendorID == properties.vendorID &&
+         header.deviceID == properties.deviceID &&
+         std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+void Device::savePipelineCache() {
+  {
+    std::lock_guard<std::mutex> lock{pipelineManifestMutex_};
+    pipelineManifest_.save(pipelineManifestPath);
+  }
+
+  size_t size = 0;
+  if (vkGetPipelineCacheData(device_, pipelineCache_, &size, nullptr) != VK_SUCCESS || size == 0) return;
+
+  std::vector<char> data(size);
+  if (vkGetPipelineCacheData(device_, pipelineCache_, &size, data.data()) != VK_SUCCESS) return;
+
+  // Write next to the real file and swap, a crash mid write must not leave a truncated cache
+  std::string tempPath = std::string{pipelineCachePath} + ".tmp";
+  {
+    std::ofstream file{tempPath, std::ios::binary | std::ios::trunc};
+    if (!file.is_open()) return;
+    file.write(data.data(), static_cast<std::streamsize>(size));
+  }
+
+  std::remove(pipelineCachePath);
+  std::rename(tempPath.c_str(), pipelineCachePath);
+}
+
+void Device::recordPipeline(const PipelineRecord &record) {
+  std::lock_guard<std::mutex> lock{pipelineManifestMutex_};
+  pipelineManifest_.record(record);
+}
+
+std::vector<PipelineRecord> Device::recordedPipelines() {
+  std::lock_guard<std::mutex> lock{pipelineManifestMutex_};
+  return pipelineManifest_.records();
+}
+
+VkShaderModule Device::getShaderModule(const std::string &filePath) {
+  {
+    std::lock_guard<std::mutex> lock{shaderModulesMutex_};
+
+    auto it = shaderModules_.find(filePath);
+    if (it != shaderModules_.end()) return it->second;
+  }
+
+  // PipelineCompiler jobs get here in parallel, the read and the module creation stay outside the lock
+  std::vector<char> code = readBinaryFile(filePath);
+
+  if (code.empty()) {
+    throw std::runtime_error("failed to open file: " + filePath);
+  }
+
+  VkShaderModuleCreateInfo createInfo = {};
+  createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  createInfo.codeSize = code.size();
+  createInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+
+  VkShaderModule shaderModule;
+  if (vkCreateShaderModule(device_, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create shader module");
+  }
+
+  std::lock_guard<std::mutex> lock{shaderModulesMutex_};
+
+  // Another thread loaded the same file meanwhile, pipelines share the first module
+  auto [it, inserted] = shaderModules_.try_emplace(filePath, shaderModule);
+  if (!inserted) vkDestroyShaderModule(device_, shaderModule, nullptr);
+
+  return it->second;
+}
+
+std::vector<char> Device::readBinaryFile(const std::string &filePath) {
+  std::ifstream file{filePath, std::ios::ate | std::ios::binary};
+
+  if (!file.is_open()) return {};
+
+  size_t fileSize = static_cast<size_t>(file.tellg());
+  std::vector<char> buffer(fileSize);
+
+  file.seekg(0);
+  file.read(buffer.data(), fileSize);
+
+  return buffer;
+}
+
 void Device::createSurface() 
 {
+  // Offscreen only, SwapChain renders into its own images
+  if (window.isHeadless()) return;
+
   window.createWindowSurface(instance_, &surface_); 
 }
 
@@ -210,8 +446,9 @@ bool Device::isDeviceSuitable(VkPhysicalDevice device) {
 
   bool extensionsSupported = checkDeviceExtensionSupport(device);
 
-  bool swapChainAdequate = false;
-  if (extensionsSupported) {
+  // Headless there is no surface to present to, software implementations (lavapipe) qualify too
+  bool swapChainAdequate = window.isHeadless();
+  if (extensionsSupported && !window.isHeadless()) {
     SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
     swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
   }
@@ -219,8 +456,23 @@ bool Device::isDeviceSuitable(VkPhysicalDevice device) {
   VkPhysicalDeviceFeatures supportedFeatures;
   vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
+  VkPhysicalDeviceProperties deviceProperties;
+  vkGetPhysicalDeviceProperties(device, &deviceProperties);
+
+  VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures = {};
+  timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+
+  bool timelineSupported = false;
+  if (deviceProperties.apiVersion >= VK_API_VERSION_1_2) {
+    VkPhysicalDeviceFeatures2 features2 = {};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &timelineFeatures;
+    vkGetPhysicalDeviceFeatures2(device, &features2);
+    timelineSupported = timelineFeatures.timelineSemaphore;
+  }
+
   return indices.isComplete() && extensionsSupported && swapChainAdequate &&
-         supportedFeatures.samplerAnisotropy;
+         supportedFeatures.samplerAnisotropy && timelineSupported;
 }
 
 void Device::populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo) {
@@ -270,11 +522,16 @@ bool Device::checkValidationLayerSupport() {
 }
 
 std::vector<const char *> Device::getRequiredExtensions() {
-  uint32_t glfwExtensionCount = 0;
-  const char **glfwExtensions;
-  glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+  std::vector<const char *> extensions;
 
-  std::vector<const char *> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+  // GLFW was never initialized without a window, and no surface extensions are needed
+  if (!window.isHeadless()) {
+    uint32_t glfwExtensionCount = 0;
+    const char **glfwExtensions;
+    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+
+    extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+  }
 
   if (enableValidationLayers) {
     extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -341,8 +598,12 @@ QueueFamilyIndices Device::findQueueFamilies(VkPhysicalDevice device) {
       indices.graphicsFamily = i;
       indices.graphicsFamilyHasValue = true;
     }
+    // Headless nothing is presented, the graphics queue stands in for the present queue
     VkBool32 presentSupport = false;
-    vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+    if (window.isHeadless())
+      presentSupport = queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT;
+    else
+      vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
     if (queueFamily.queueCount > 0 && presentSupport) {
       indices.presentFamily = i;
       indices.presentFamilyHasValue = true;
@@ -358,7 +619,8 @@ QueueFamilyIndices Device::findQueueFamilies(VkPhysicalDevice device) {
 }
 
 SwapChainSupportDetails Device::querySwapChainSupport(VkPhysicalDevice device) {
-  SwapChainSupportDetails details;
+  SwapChainSupportDetails details{};
+  if (surface_ == VK_NULL_HANDLE) return details;
   vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface_, &details.capabilities);
 
   uint32_t formatCount;
@@ -446,7 +708,9 @@ void Device::createBuffer(
 }
 
 VkCommandBuffer Device::beginSingleTimeCommands() {
-  
+  // Released in submitSingleTimeCommands
+  commandPoolMutex_.lock();
+
   VkCommandBufferAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
   allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
@@ -465,6 +729,11 @@ VkCommandBuffer Device::beginSingleTimeCommands() {
 }
 
 void Device::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
+  // Only this submission is waited for, frames in flight keep running
+  waitForTimeline(submitSingleTimeCommands(commandBuffer));
+}
+
+uint64_t Device::submitSingleTimeCommands(VkCommandBuffer commandBuffer) {
   vkEndCommandBuffer(commandBuffer);
 
   VkSubmitInfo submitInfo{};
@@ -472,13 +741,35 @@ void Device::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
   submitInfo.commandBufferCount = 1;
   submitInfo.pCommandBuffers = &commandBuffer;
 
-  vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
-  vkQueueWaitIdle(graphicsQueue_);
+  uint64_t value;
+  try {
+    value = submitGraphics(submitInfo);
+  } catch (...) {
+    commandPoolMutex_.unlock();
+    throw;
+  }
 
-  vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
+  commandPoolMutex_.unlock();
+
+  // Queued after our submit, so it waits for it. Frees under the pool lock, outside of it here.
+  deletionQueue_.push([this, commandBuffer]() {
+    std::lock_guard<std::mutex> lock{commandPoolMutex_};
+    vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
+  });
+
+  return value;
 }
 
 void Device::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
+  waitForTimeline(copyBufferAsync(srcBuffer, dstBuffer, size));
+}
+
+void Device::copyBufferToImage(
+    VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount) {
+  waitForTimeline(copyBufferToImageAsync(buffer, image, width, height, layerCount));
+}
+
+uint64_t Device::copyBufferAsync(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
   VkCommandBuffer commandBuffer = beginSingleTimeCommands();
 
   VkBufferCopy copyRegion{};
@@ -487,10 +778,10 @@ void Device::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize siz
   copyRegion.size = size;
   vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
-  endSingleTimeCommands(commandBuffer);
+  return submitSingleTimeCommands(commandBuffer);
 }
 
-void Device::copyBufferToImage(
+uint64_t Device::copyBufferToImageAsync(
     VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount) {
   VkCommandBuffer commandBuffer = beginSingleTimeCommands();
 
@@ -516,7 +807,7 @@ void Device::copyBufferToImage(
     &region
   );
 
-  endSingleTimeCommands(commandBuffer);
+  return submitSingleTimeCommands(commandBuffer);
 }
 
 void Device::createImageWithInfo(
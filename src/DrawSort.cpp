@@ -0,0 +1,51 @@
+#include "DrawSort.hpp"
+
+// std
+#include <array>
+
+namespace Orasis {
+
+    void radixSort(std::vector<DrawItem>& items, std::vector<DrawItem>& scratch)
+    {
+        const size_t count = items.size();
+
+        if (count < 2) return;
+
+        scratch.resize(count);
+
+        // All eight histograms in one read of the keys
+        std::array<std::array<uint32_t, 256>, 8> histograms{};
+
+        for (const DrawItem& item : items)
+            for (uint32_t byte = 0; byte < 8; byte++)
+                histograms[byte][(item.key >> (byte * 8)) & 0xff]++;
+
+        DrawItem* src = items.data();
+        DrawItem* dst = scratch.data();
+
+        for (uint32_t byte = 0; byte < 8; byte++)
+        {
+            auto& histogram = histograms[byte];
+
+            // Every key has the same value in this byte, the pass wouldn't move anything
+            if (histogram[(src[0].key >> (byte * 8)) & 0xff] == count) continue;
+
+            uint32_t offset = 0;
+            for (uint32_t& bucket : histogram)
+            {
+                uint32_t bucketCount = bucket;
+                bucket = offset;
+                offset += bucketCount;
+            }
+
+            for (size_t i = 0; i < count; i++)
+                dst[histogram[(src[i].key >> (byte * 8)) & 0xff]++] = src[i];
+
+            std::swap(src, dst);
+        }
+
+        if (src != items.data())
+            items.swap(scratch);
+    }
+
+}
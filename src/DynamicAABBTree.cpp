@@ -0,0 +1,364 @@
+#include "DynamicAABBTree.hpp"
+
+// std
+#include <cmath>
+#include <stdexcept>
+
+namespace Orasis {
+
+    DynamicAABBTree::DynamicAABBTree(float margin, float displacementMultiplier)
+    : m_margin{margin}, m_displacementMultiplier{displacementMultiplier}
+    {
+        m_nodes.reserve(256);
+    }
+
+
+
+    // *************** Proxies *********************
+
+    int32_t DynamicAABBTree::createProxy(const AABB& box, uint32_t userData)
+    {
+        assert(box.isValid() && "Cannot insert an invalid AABB");
+
+        int32_t proxyId = allocateNode();
+        Node& node = m_nodes[proxyId];
+
+        glm::vec3 margin{m_margin};
+        node.box = AABB{box.min - margin, box.max + margin};
+        node.userData = userData;
+        node.height = 0;
+
+        insertLeaf(proxyId);
+        m_proxyCount++;
+
+        return proxyId;
+    }
+
+    void DynamicAABBTree::destroyProxy(int32_t proxyId)
+    {
+        assert(0 <= proxyId && proxyId < static_cast<int32_t>(m_nodes.size()));
+        assert(m_nodes[proxyId].isLeaf());
+
+        removeLeaf(proxyId);
+        freeNode(proxyId);
+        m_proxyCount--;
+    }
+
+    bool DynamicAABBTree::moveProxy(int32_t proxyId, const AABB& box, glm::vec3 displacement)
+    {
+        assert(0 <= proxyId && proxyId < static_cast<int32_t>(m_nodes.size()));
+        assert(m_nodes[proxyId].isLeaf());
+
+        // Still inside the fat box, nothing to do. This is the common case for slow movers
+        if (m_nodes[proxyId].box.contains(box))
+            return false;
+
+        removeLeaf(proxyId);
+
+        // Grow the box in the direction of movement so the next frames are likely free
+        glm::vec3 margin{m_margin};
+        AABB fatBox{box.min - margin, box.max + margin};
+
+        glm::vec3 predicted = displacement * m_displacementMultiplier;
+        fatBox.min += glm::min(predicted, glm::vec3{0.f});
+        fatBox.max += glm::max(predicted, glm::vec3{0.f});
+
+        m_nodes[proxyId].box = fatBox;
+
+        insertLeaf(proxyId);
+
+        return true;
+    }
+
+    // *************** ----------------- *********************
+
+
+
+
+
+    // *************** Node Pool *********************
+
+    int32_t DynamicAABBTree::allocateNode()
+    {
+        if (m_freeList == nullNode)
+        {
+            m_nodes.emplace_back();
+            return static_cast<int32_t>(m_nodes.size() - 1);
+        }
+
+        int32_t nodeId = m_freeList;
+        m_freeList = m_nodes[nodeId].parent;
+        m_nodes[nodeId] = Node{};
+
+        return nodeId;
+    }
+
+    void DynamicAABBTree::freeNode(int32_t nodeId)
+    {
+        m_nodes[nodeId].parent = m_freeList;
+        m_nodes[nodeId].height = -1;
+        m_freeList = nodeId;
+    }
+
+    // *************** ----------------- *********************
+
+
+
+
+
+    // *************** Insertion / Removal *********************
+
+    void DynamicAABBTree::insertLeaf(int32_t leaf)
+    {
+        if (m_root == nullNode)
+        {
+            m_root = leaf;
+            m_nodes[m_root].parent = nullNode;
+            return;
+        }
+
+        // Find the best sibling by walking down with the surface area heuristic
+        AABB leafBox = m_nodes[leaf].box;
+        int32_t index = m_root;
+
+        while (!m_nodes[index].isLeaf())
+        {
+            const Node& node = m_nodes[index];
+            int32_t child1 = node.child1;
+            int32_t child2 = node.child2;
+
+            float area = node.box.perimeter();
+            float combinedArea = AABB::merge(node.box, leafBox).perimeter();
+
+            // Cost of creating a new parent for this node and the new leaf
+            float cost = 2.f * combinedArea;
+
+            // Minimum cost of pushing the leaf further down the tree
+            float inheritanceCost = 2.f * (combinedArea - area);
+
+            auto descendCost = [&](int32_t child) {
+                const AABB& childBox = m_nodes[child].box;
+                float merged = AABB::merge(leafBox, childBox).perimeter();
+
+                if (m_nodes[child].isLeaf())
+                    return merged + inheritanceCost;
+
+                return (merged - childBox.perimeter()) + inheritanceCost;
+            };
+
+            float cost1 = descendCost(child1);
+            float cost2 = descendCost(child2);
+
+            if (cost < cost1 && cost < cost2)
+                break;
+
+            index = cost1 < cost2 ? child1 : child2;
+        }
+
+        int32_t sibling = index;
+
+        // Create a new parent
+        int32_t oldParent = m_nodes[sibling].parent;
+        int32_t newParent = allocateNode();
+
+        m_nodes[newParent].parent = oldParent;
+        m_nodes[newParent].box = AABB::merge(leafBox, m_nodes[sibling].box);
+        m_nodes[newParent].height = m_nodes[sibling].height + 1;
+        m_nodes[newParent].child1 = sibling;
+        m_nodes[newParent].child2 = leaf;
+
+        m_nodes[sibling].parent = newParent;
+        m_nodes[leaf].parent = newParent;
+
+        if (oldParent != nullNode)
+        {
+            if (m_nodes[oldParent].child1 == sibling)
+                m_nodes[oldParent].child1 = newParent;
+            else
+                m_nodes[oldParent].child2 = newParent;
+        }
+        else
+            m_root = newParent;
+
+        refitAncestors(m_nodes[leaf].parent);
+    }
+
+    void DynamicAABBTree::removeLeaf(int32_t leaf)
+    {
+        if (leaf == m_root)
+        {
+            m_root = nullNode;
+            return;
+        }
+
+        int32_t parent = m_nodes[leaf].parent;
+        int32_t grandParent = m_nodes[parent].parent;
+        int32_t sibling = m_nodes[parent].child1 == leaf ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+        if (grandParent != nullNode)
+        {
+            // Destroy the parent and connect the sibling to the grand parent
+            if (m_nodes[grandParent].child1 == parent)
+                m_nodes[grandParent].child1 = sibling;
+            else
+                m_nodes[grandParent].child2 = sibling;
+
+            m_nodes[sibling].parent = grandParent;
+            freeNode(parent);
+
+            refitAncestors(grandParent);
+        }
+        else
+        {
+            m_root = sibling;
+            m_nodes[sibling].parent = nullNode;
+            freeNode(parent);
+        }
+    }
+
+    void DynamicAABBTree::refitAncestors(int32_t index)
+    {
+        while (index != nullNode)
+        {
+            index = balance(index);
+
+            Node& node = m_nodes[index];
+            const Node& child1 = m_nodes[node.child1];
+            const Node& child2 = m_nodes[node.child2];
+
+            node.height = 1 + std::max(child1.height, child2.height);
+            node.box = AABB::merge(child1.box, child2.box);
+
+            index = node.parent;
+        }
+    }
+
+    // *************** ----------------- *********************
+
+
+
+
+
+    // *************** Balancing *********************
+
+    // Rotates A up if one of its children is more than one level taller than the other one.
+    // Returns the index of the node that now sits where A used to be.
+    /*
+              A
+            /   \
+           B     C
+                / \
+               F   G
+    */
+    int32_t DynamicAABBTree::balance(int32_t iA)
+    {
+        Node* A = &m_nodes[iA];
+
+        if (A->isLeaf() || A->height < 2)
+            return iA;
+
+        int32_t iB = A->child1;
+        int32_t iC = A->child2;
+        Node* B = &m_nodes[iB];
+        Node* C = &m_nodes[iC];
+
+        int32_t heightDiff = C->height - B->height;
+
+        auto rotateUp = [&](int32_t iUp, Node* up, Node* other, bool upIsChild2) {
+
+            int32_t iF = up->child1;
+            int32_t iG = up->child2;
+            Node* F = &m_nodes[iF];
+            Node* G = &m_nodes[iG];
+
+            // Swap A and the node that goes up
+            up->child1 = iA;
+            up->parent = A->parent;
+            A->parent = iUp;
+
+            if (up->parent != nullNode)
+            {
+                if (m_nodes[up->parent].child1 == iA)
+                    m_nodes[up->parent].child1 = iUp;
+                else
+                    m_nodes[up->parent].child2 = iUp;
+            }
+            else
+                m_root = iUp;
+
+            // Keep the taller grandchild up, hand the shorter one to A
+            int32_t iKeep = F->height > G->height ? iF : iG;
+            int32_t iGive = iKeep == iF ? iG : iF;
+
+            up->child2 = iKeep;
+
+            if (upIsChild2) A->child2 = iGive;
+            else            A->child1 = iGive;
+
+            m_nodes[iGive].parent = iA;
+
+            A->box = AABB::merge(other->box, m_nodes[iGive].box);
+            up->box = AABB::merge(A->box, m_nodes[iKeep].box);
+
+            A->height = 1 + std::max(other->height, m_nodes[iGive].height);
+            up->height = 1 + std::max(A->height, m_nodes[iKeep].height);
+
+            return iUp;
+        };
+
+        if (heightDiff > 1)
+            return rotateUp(iC, C, B, true);
+
+        if (heightDiff < -1)
+            return rotateUp(iB, B, C, false);
+
+        return iA;
+    }
+
+    // *************** ----------------- *********************
+
+
+
+
+
+    // *************** Validation *********************
+
+    void DynamicAABBTree::validate() const
+    {
+        if (m_root == nullNode) return;
+
+        if (m_nodes[m_root].parent != nullNode)
+            throw std::runtime_error("AABB tree root has a parent");
+
+        validateStructure(m_root);
+    }
+
+    int32_t DynamicAABBTree::validateStructure(int32_t index) const
+    {
+        const Node& node = m_nodes[index];
+
+        if (node.isLeaf())
+        {
+            if (node.height != 0)
+                throw std::runtime_error("AABB tree leaf with non zero height");
+            return 0;
+        }
+
+        if (m_nodes[node.child1].parent != index || m_nodes[node.child2].parent != index)
+            throw std::runtime_error("AABB tree child with wrong parent");
+
+        if (!node.box.contains(m_nodes[node.child1].box) || !node.box.contains(m_nodes[node.child2].box))
+            throw std::runtime_error("AABB tree node doesn't enclose its children");
+
+        int32_t height1 = validateStructure(node.child1);
+        int32_t height2 = validateStructure(node.child2);
+
+        if (node.height != 1 + std::max(height1, height2))
+            throw std::runtime_error("AABB tree node with wrong height");
+
+        return node.height;
+    }
+
+    // *************** ----------------- *********************
+
+}
@@ -0,0 +1,162 @@
+#include "FramePacer.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace Orasis {
+
+    void FramePacer::setTargetFps(double fps)
+    {
+        m_targetFps = std::max(0.0, fps);
+        m_nextDeadline = Clock::now();
+    }
+
+
+
+    // *************** Pacing *********************
+
+    FramePacer::Clock::time_point FramePacer::waitForFrameStart()
+    {
+        pollCompletions();
+
+        Clock::time_point wake = Clock::now();
+
+        if (m_targetFps > 0.0)
+            wake = std::max(wake, m_nextDeadline);
+
+        if (m_lowLatency)
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+
+            // Leave a bit of slack, starting late costs a whole GPU bubble, starting early only a little latency
+            auto cpuTime = std::chrono::duration<float, std::milli>(m_stats.cpuMs * 1.1f + 0.25f);
+            wake = std::max(wake, predictGpuIdle() - std::chrono::duration_cast<Clock::duration>(cpuTime));
+        }
+
+        preciseWaitUntil(wake);
+
+        Clock::time_point now = Clock::now();
+
+        if (m_frameStart != Clock::time_point{})
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            smooth(m_stats.frameMs, toMs(now - m_frameStart));
+        }
+        m_frameStart = now;
+
+        if (m_targetFps > 0.0)
+        {
+            auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / m_targetFps));
+            m_nextDeadline += period;
+
+            // Fell behind by more than a frame (hitch, breakpoint), don't try to catch up with a burst
+            if (m_nextDeadline < now)
+                m_nextDeadline = now + period;
+        }
+
+        return now;
+    }
+
+    void FramePacer::frameSubmitted(uint64_t timelineValue, Clock::time_point frameStart)
+    {
+        Clock::time_point now = Clock::now();
+
+        std::lock_guard<std::mutex> lock{m_mutex};
+
+        smooth(m_stats.cpuMs, toMs(now - frameStart));
+        m_pending.push_back({timelineValue, frameStart, now});
+
+        pollCompletionsLocked();
+    }
+
+    void FramePacer::pollCompletions()
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        pollCompletionsLocked();
+    }
+
+    void FramePacer::pollCompletionsLocked()
+    {
+        if (m_pending.empty()) return;
+
+        uint64_t completed = m_device.completedTimelineValue();
+        Clock::time_point now = Clock::now();
+
+        while (!m_pending.empty() && m_pending.front().value <= completed)
+        {
+            const PendingFrame& frame = m_pending.front();
+
+            // Only observed when polled, so this errs on the long side
+            Clock::time_point gpuStart = std::max(frame.submitTime, m_lastCompletion);
+            smooth(m_stats.gpuMs, toMs(now - gpuStart));
+            smooth(m_stats.latencyMs, toMs(now - frame.inputTime));
+
+            m_lastCompletion = now;
+            m_pending.pop_front();
+        }
+    }
+
+    FramePacer::Clock::time_point FramePacer::predictGpuIdle() const
+    {
+        auto gpuTime = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float, std::milli>(m_stats.gpuMs));
+
+        // Queued frames run back to back once the GPU gets to them
+        Clock::time_point idle = m_lastCompletion;
+
+        for (const PendingFrame& frame : m_pending)
+            idle = std::max(idle, frame.submitTime) + gpuTime;
+
+        return idle;
+    }
+
+    void FramePacer::preciseWaitUntil(Clock::time_point deadline)
+    {
+        using namespace std::chrono;
+
+        while (true)
+        {
+            double remaining = duration<double>(deadline - Clock::now()).count();
+
+            // Stop sleeping once a sleep could overshoot (mean + one deviation)
+            double estimate = m_sleepMean + std::sqrt(m_sleepVariance);
+
+            if (remaining <= estimate) break;
+
+            // Waiting anyway, sharpens the completion times the predictions are built on
+            pollCompletions();
+
+            Clock::time_point start = Clock::now();
+            std::this_thread::sleep_for(milliseconds(1));
+            double observed = duration<double>(Clock::now() - start).count();
+
+            // Exponentially weighted, so the estimate keeps following the OS timer
+            constexpr double alpha = 0.05;
+            double delta = observed - m_sleepMean;
+            m_sleepMean += alpha * delta;
+            m_sleepVariance = (1.0 - alpha) * (m_sleepVariance + alpha * delta * delta);
+        }
+
+        while (Clock::now() < deadline)
+        {
+            pollCompletions();
+            std::this_thread::yield();
+        }
+    }
+
+    // *************** ----------------- *********************
+
+
+
+    float FramePacer::toMs(Clock::duration duration)
+    {
+        return std::chrono::duration<float, std::milli>(duration).count();
+    }
+
+    void FramePacer::smooth(float& average, float sample)
+    {
+        average = average == 0.f ? sample : average + (sample - average) * 0.1f;
+    }
+
+}
@@ -0,0 +1,98 @@
+#include "FrameScheduler.hpp"
+
+// std
+#include <cassert>
+#include <stdexcept>
+
+namespace Orasis {
+
+    FrameScheduler::FrameScheduler(Device& device, uint32_t maxFramesInFlight, uint32_t framesInFlight)
+    : m_device{device}, m_maxFramesInFlight{maxFramesInFlight}, m_framesInFlight{framesInFlight}
+    {
+        assert(framesInFlight > 0 && framesInFlight <= maxFramesInFlight && "Frames in flight out of range");
+
+        m_frameValues.assign(m_maxFramesInFlight, 0);
+
+        // Offscreen images aren't acquired or presented, the timeline alone orders the frames
+        if (m_device.isHeadless()) return;
+
+        m_imageAvailable.resize(m_maxFramesInFlight);
+        m_renderFinished.resize(m_maxFramesInFlight);
+
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+        for (uint32_t i = 0; i < m_maxFramesInFlight; i++)
+        {
+            if (vkCreateSemaphore(m_device.device(), &semaphoreInfo, nullptr, &m_imageAvailable[i]) != VK_SUCCESS ||
+                vkCreateSemaphore(m_device.device(), &semaphoreInfo, nullptr, &m_renderFinished[i]) != VK_SUCCESS)
+                throw std::runtime_error("failed to create synchronization objects for a frame");
+        }
+    }
+
+    FrameScheduler::~FrameScheduler()
+    {
+        for (size_t i = 0; i < m_imageAvailable.size(); i++)
+        {
+            vkDestroySemaphore(m_device.device(), m_imageAvailable[i], nullptr);
+            vkDestroySemaphore(m_device.device(), m_renderFinished[i], nullptr);
+        }
+    }
+
+
+
+    // *************** Frames *********************
+
+    uint32_t FrameScheduler::beginFrame()
+    {
+        m_device.waitForTimeline(m_frameValues[m_currentFrame]);
+        return m_currentFrame;
+    }
+
+    void FrameScheduler::waitForImage(uint32_t imageIndex)
+    {
+        m_device.waitForTimeline(m_imageValues[imageIndex]);
+    }
+
+    uint64_t FrameScheduler::submit(const VkCommandBuffer* commandBuffers, uint32_t count, uint32_t imageIndex)
+    {
+        VkSemaphore waitSemaphores[] = {imageAvailable()};
+        VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+        VkSemaphore signalSemaphores[] = {renderFinished()};
+
+        uint32_t semaphoreCount = m_imageAvailable.empty() ? 0 : 1;
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.waitSemaphoreCount = semaphoreCount;
+        submitInfo.pWaitSemaphores = waitSemaphores;
+        submitInfo.pWaitDstStageMask = waitStages;
+        submitInfo.commandBufferCount = count;
+        submitInfo.pCommandBuffers = commandBuffers;
+        submitInfo.signalSemaphoreCount = semaphoreCount;
+        submitInfo.pSignalSemaphores = signalSemaphores;
+
+        uint64_t value = m_device.submitGraphics(submitInfo);
+
+        m_frameValues[m_currentFrame] = value;
+        m_imageValues[imageIndex] = value;
+
+        return value;
+    }
+
+    void FrameScheduler::setFramesInFlight(uint32_t count)
+    {
+        assert(count > 0 && count <= m_maxFramesInFlight && "Frames in flight out of range");
+
+        if (count == m_framesInFlight) return;
+
+        // Slots get remapped, so nothing may still be using them
+        m_device.waitForTimeline(m_device.lastSubmittedTimelineValue());
+
+        m_framesInFlight = count;
+        m_currentFrame = 0;
+    }
+
+    // *************** ----------------- *********************
+
+}
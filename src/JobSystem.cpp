@@ -0,0 +1,349 @@
+#include "JobSystem.hpp"
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#elif defined(__linux__)
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+
+namespace Orasis {
+
+    namespace {
+
+        // Which JobSystem (if any) the current thread works for, and its deque
+        thread_local JobSystem* t_jobSystem = nullptr;
+        thread_local uint32_t t_workerIndex = 0;
+        thread_local uint32_t t_random = 0x9E3779B9u;
+
+        uint32_t nextRandom()
+        {
+            // xorshift32, only picks steal victims
+            uint32_t x = t_random;
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            return t_random = x;
+        }
+
+    }
+
+    JobSystem::JobSystem(uint32_t workerCount, bool pinWorkers)
+    {
+        // At least one, background jobs only ever run on workers
+        if (workerCount == 0)
+            workerCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+
+        m_queues.reserve(workerCount + 1);
+        for (uint32_t i = 0; i < workerCount + 1; i++)
+            m_queues.push_back(std::make_unique<WorkStealingDeque<Job*>>());
+
+        // The creating thread is worker 0
+        t_jobSystem = this;
+        t_workerIndex = 0;
+
+        m_workers.reserve(workerCount);
+
+        for (uint32_t i = 1; i <= workerCount; i++)
+        {
+            m_workers.emplace_back(&JobSystem::workerLoop, this, i);
+
+            // Core 0 is left to the main thread and the OS
+            if (pinWorkers)
+                pinThread(m_workers.back(), i);
+        }
+    }
+
+    JobSystem::~JobSystem()
+    {
+        m_stopping.store(true, std::memory_order_release);
+        wakeWorkers();
+
+        for (std::thread& worker : m_workers)
+            worker.join();
+
+        // Whatever never ran
+        Job* job = nullptr;
+        for (auto& queue : m_queues)
+            while (queue->pop(job))
+                delete job;
+
+        for (Job* queued : m_injection)
+            delete queued;
+
+        for (Job* queued : m_background)
+            delete queued;
+
+        if (t_jobSystem == this)
+            t_jobSystem = nullptr;
+    }
+
+
+
+    // *************** Submission *********************
+
+    void JobSystem::run(std::function<void()> function, JobCounter* counter)
+    {
+        if (counter)
+            counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+
+        schedule(new Job{std::move(function), counter});
+    }
+
+    void JobSystem::runBackground(std::function<void()> function, JobCounter* counter)
+    {
+        if (counter)
+            counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+
+        {
+            std::lock_guard<std::mutex> lock{m_backgroundMutex};
+            m_background.push_back(new Job{std::move(function), counter});
+        }
+
+        wakeWorkers();
+    }
+
+    void JobSystem::runAfter(JobCounter& after, std::function<void()> function, JobCounter* counter)
+    {
+        if (counter)
+            counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+
+        Job* job = new Job{std::move(function), counter};
+
+        {
+            std::lock_guard<std::mutex> lock{after.m_mutex};
+
+            // finish() takes the list under the same lock after the count hit zero
+            if (!after.isDone())
+            {
+                after.m_continuations.push_back(job);
+                return;
+            }
+        }
+
+        schedule(job);
+    }
+
+    void JobSystem::wait(JobCounter& counter)
+    {
+        uint32_t misses = 0;
+
+        while (!counter.isDone())
+        {
+            if (Job* job = findWork(false))
+            {
+                execute(job);
+                misses = 0;
+                continue;
+            }
+
+            // Whatever we wait on is running elsewhere, back off a little
+            if (++misses < 64)
+                std::this_thread::yield();
+            else
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+
+        // The last finish() may still hold the lock
+        std::lock_guard<std::mutex> lock{counter.m_mutex};
+    }
+
+    void JobSystem::retain(JobCounter& counter)
+    {
+        counter.m_pending.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void JobSystem::release(JobCounter& counter)
+    {
+        finish(&counter);
+    }
+
+    bool JobSystem::isWorkerThread() const
+    {
+        return t_jobSystem == this;
+    }
+
+    // *************** ----------------- *********************
+
+
+
+
+
+    // *************** Execution *********************
+
+    void JobSystem::schedule(Job* job)
+    {
+        if (isWorkerThread())
+            m_queues[t_workerIndex]->push(job);
+        else
+        {
+            std::lock_guard<std::mutex> lock{m_injectionMutex};
+            m_injection.push_back(job);
+        }
+
+        wakeWorkers();
+    }
+
+    void JobSystem::execute(Job* job)
+    {
+        job->function();
+        finish(job->counter);
+        delete job;
+    }
+
+    void JobSystem::finish(JobCounter* counter)
+    {
+        if (counter == nullptr) return;
+
+        // Not the last one, the counter stays alive for whoever finishes last
+        uint32_t pending = counter->m_pending.load(std::memory_order_relaxed);
+
+        while (pending > 1)
+            if (counter->m_pending.compare_exchange_weak(pending, pending - 1, std::memory_order_acq_rel))
+                return;
+
+        // Possibly the last one. Decremented under the lock so wait() can't return (and the
+        // owner destroy the counter) before we're done touching it.
+        std::vector<Job*> ready;
+
+        {
+            std::lock_guard<std::mutex> lock{counter->m_mutex};
+
+            if (counter->m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                ready.swap(counter->m_continuations);
+        }
+
+        for (Job* job : ready)
+            schedule(job);
+    }
+
+    Job* JobSystem::findWork(bool includeBackground)
+    {
+        Job* job = nullptr;
+
+        if (isWorkerThread() && m_queues[t_workerIndex]->pop(job))
+            return job;
+
+        {
+            std::lock_guard<std::mutex> lock{m_injectionMutex};
+
+            if (!m_injection.empty())
+            {
+                job = m_injection.front();
+                m_injection.pop_front();
+                return job;
+            }
+        }
+
+        // Random start, then everyone once
+        uint32_t count = static_cast<uint32_t>(m_queues.size());
+        uint32_t start = nextRandom() % count;
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            uint32_t victim = (start + i) % count;
+
+            if (isWorkerThread() && victim == t_workerIndex) continue;
+
+            if (m_queues[victim]->steal(job))
+                return job;
+        }
+
+        if (includeBackground)
+        {
+            std::lock_guard<std::mutex> lock{m_backgroundMutex};
+
+            if (!m_background.empty())
+            {
+                job = m_background.front();
+                m_background.pop_front();
+                return job;
+            }
+        }
+
+        return nullptr;
+    }
+
+    bool JobSystem::isLocalQueueEmpty()
+    {
+        if (isWorkerThread())
+            return m_queues[t_workerIndex]->empty();
+
+        std::lock_guard<std::mutex> lock{m_injectionMutex};
+        return m_injection.empty();
+    }
+
+    // *************** ----------------- *********************
+
+
+
+
+
+    // *************** Workers *********************
+
+    void JobSystem::workerLoop(uint32_t index)
+    {
+        t_jobSystem = this;
+        t_workerIndex = index;
+        t_random ^= index * 0x85EBCA6Bu;
+
+        while (!m_stopping.load(std::memory_order_acquire))
+        {
+            uint64_t epoch = m_epoch.load(std::memory_order_acquire);
+
+            if (Job* job = findWork(true))
+            {
+                execute(job);
+                continue;
+            }
+
+            // Anything scheduled after we read the epoch moves it, so the wait below can't miss it
+            std::unique_lock<std::mutex> lock{m_sleepMutex};
+            m_sleepers.fetch_add(1, std::memory_order_seq_cst);
+            m_wake.wait(lock, [&] {
+                return m_stopping.load(std::memory_order_acquire) || m_epoch.load(std::memory_order_acquire) != epoch;
+            });
+            m_sleepers.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    void JobSystem::wakeWorkers()
+    {
+        m_epoch.fetch_add(1, std::memory_order_seq_cst);
+
+        if (m_sleepers.load(std::memory_order_seq_cst) == 0 && !m_stopping.load(std::memory_order_relaxed))
+            return;
+
+        std::lock_guard<std::mutex> lock{m_sleepMutex};
+
+        if (m_stopping.load(std::memory_order_relaxed))
+            m_wake.notify_all();
+        else
+            m_wake.notify_one();
+    }
+
+    void JobSystem::pinThread(std::thread& thread, uint32_t core)
+    {
+        uint32_t cores = std::max(1u, std::thread::hardware_concurrency());
+        core %= cores;
+
+#if defined(_WIN32)
+        // A plain affinity mask only covers the first processor group
+        if (core < 64)
+            SetThreadAffinityMask(thread.native_handle(), DWORD_PTR(1) << core);
+#elif defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core, &set);
+        pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &set);
+#else
+        (void)thread;
+        (void)core;
+#endif
+    }
+
+    // *************** ----------------- *********************
+
+}
@@ -31,6 +31,21 @@ namespace std {
 
 }
 
+namespace {
+
+    // Lets tinyobj read a file that's already in memory without copying it into a string
+    struct MemoryBuffer : std::streambuf {
+        MemoryBuffer(const char* data, size_t size)
+        {
+            char* begin = const_cast<char*>(data);
+            setg(begin, begin, begin + size);
+        }
+    };
+
+    void fillBuilder(Orasis::Model::Builder& builder, const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes);
+
+}
+
 void Orasis::Model::Builder::loadModel(const std::string& filepath)
 {
     tinyobj::attrib_t attrib;                       // attrib stores position, color, normal, texture coord data
@@ -41,7 +56,34 @@ void Orasis::Model::Builder::loadModel(const std::string& filepath)
     if ( !tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filepath.c_str()) )
         throw std::runtime_error(warn + err);
         
-    
+    fillBuilder(*this, attrib, shapes);
+}
+
+void Orasis::Model::Builder::loadModelFromMemory(const std::vector<char>& data)
+{
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+
+    MemoryBuffer buffer{data.data(), data.size()};
+    std::istream stream{&buffer};
+
+    if ( !tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, &stream) )
+        throw std::runtime_error(warn + err);
+
+    fillBuilder(*this, attrib, shapes);
+}
+
+namespace {
+
+void fillBuilder(Orasis::Model::Builder& builder, const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes)
+{
+    using Vertex = Orasis::Model::Vertex;
+
+    std::vector<Vertex>& vertices = builder.vertices;
+    std::vector<uint32_t>& indices = builder.indices;
+
     vertices.clear();
     indices.clear();
 
@@ -92,6 +134,6 @@ void Orasis::Model::Builder::loadModel(const std::string& filepath)
 
     printf("Vertex count: %zd \n", vertices.size());
 
-}       
+}
 
-  
\ No newline at end of file
+}
@@ -0,0 +1,141 @@
+#include "PipelineCompiler.hpp"
+
+// std
+#include <cassert>
+#include <stdexcept>
+
+namespace Orasis {
+
+    PipelineCompiler::PipelineCompiler(Device& device, JobSystem& jobs)
+    : m_device{device}, m_jobs{jobs}
+    {}
+
+    PipelineCompiler::~PipelineCompiler()
+    {
+        // Jobs still reference their entries
+        for (auto& entry : m_entries)
+            if (entry)
+                m_jobs.wait(entry->done);
+    }
+
+
+
+    // *************** Requests *********************
+
+    PipelineCompiler::Handle PipelineCompiler::request(const std::string& vertFilePath, const std::string& fragFilePath, std::unique_ptr<PipelineConfigInfo> config)
+    {
+        assert(config != nullptr && "Pipeline request without a config");
+
+        Handle handle;
+        Entry* entry;
+
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+
+            if (m_freeHandles.empty())
+            {
+                handle = static_cast<Handle>(m_entries.size());
+                m_entries.push_back(std::make_unique<Entry>());
+            }
+            else
+            {
+                handle = m_freeHandles.back();
+                m_freeHandles.pop_back();
+                m_entries[handle] = std::make_unique<Entry>();
+            }
+
+            entry = m_entries[handle].get();
+        }
+
+        entry->vertPath = vertFilePath;
+        entry->fragPath = fragFilePath;
+        entry->config = std::move(config);
+
+        // Background, a frame helping out in wait() never picks up a compile that takes milliseconds
+        m_jobs.runBackground([this, entry] { compile(*entry); }, &entry->done);
+
+        return handle;
+    }
+
+    Pipeline* PipelineCompiler::get(Handle handle) const
+    {
+        if (handle == invalidHandle) return nullptr;
+
+        const Entry& entry = *m_entries[handle];
+
+        // Acquire pairs with the job's release, the Pipeline is fully built once we see Ready
+        if (entry.state.load(std::memory_order_acquire) != State::Ready)
+            return nullptr;
+
+        return entry.pipeline.get();
+    }
+
+    Pipeline& PipelineCompiler::wait(Handle handle)
+    {
+        assert(handle != invalidHandle);
+
+        Entry& entry = *m_entries[handle];
+
+        m_jobs.wait(entry.done);
+
+        if (entry.state.load(std::memory_order_acquire) == State::Failed)
+            throw std::runtime_error("failed to compile pipeline (" + entry.vertPath + "): " + entry.error);
+
+        return *entry.pipeline;
+    }
+
+    void PipelineCompiler::release(Handle handle)
+    {
+        if (handle == invalidHandle) return;
+
+        Entry& entry = *m_entries[handle];
+
+        m_jobs.wait(entry.done);
+
+        // Frames in flight may still have it bound
+        m_device.deletionQueue().retire(std::move(entry.pipeline));
+
+        std::lock_guard<std::mutex> lock{m_mutex};
+
+        m_entries[handle].reset();
+        m_freeHandles.push_back(handle);
+    }
+
+    // *************** ----------------- *********************
+
+
+
+
+
+    // *************** Compile *********************
+
+    void PipelineCompiler::compile(Entry& entry)
+    {
+        entry.state.store(State::Compiling, std::memory_order_relaxed);
+
+        State result = State::Ready;
+
+        try
+        {
+            // No fragment shader means compute, except for depth only pipelines (3)
+            if (entry.fragPath.empty() && entry.config->PipelineCreationFlag != 3)
+                entry.pipeline = std::make_unique<Pipeline>(m_device, entry.vertPath, *entry.config);
+            else
+                entry.pipeline = std::make_unique<Pipeline>(m_device, entry.vertPath, entry.fragPath, *entry.config);
+        }
+        catch (const std::exception& e)
+        {
+            entry.error = e.what();
+            result = State::Failed;
+        }
+
+        // The config points into itself and is only needed while compiling
+        entry.config.reset();
+
+        entry.state.store(result, std::memory_order_release);
+        m_completedCount.fetch_add(1, std::memory_order_release);
+    }
+
+    // *************** ----------------- *********************
+
+}
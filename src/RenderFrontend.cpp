@@ -0,0 +1,243 @@
+#include "RenderFrontend.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace Orasis {
+
+    namespace {
+
+        // Which frontend the thread has a queue in, instance ids so a new frontend at an old address doesn't reuse stale slots
+        thread_local uint32_t t_instance = 0;
+        thread_local uint32_t t_slot = 0;
+
+        uint32_t nextInstance()
+        {
+            static std::atomic<uint32_t> counter{1};
+            return counter++;
+        }
+
+    }
+
+    RenderFrontend::RenderFrontend()
+    : m_instance{nextInstance()}, m_threads{new ThreadQueue[MAX_THREADS]}
+    {}
+
+
+
+    // *************** Frontend thread *********************
+
+    RenderFrame& RenderFrontend::beginFrame()
+    {
+        uint64_t number = m_building.load(std::memory_order_relaxed);
+
+        {
+            std::unique_lock<std::mutex> lock{m_mutex};
+            m_changed.wait(lock, [&] { return m_consumed + 2 > number || m_error || m_stopping; });
+        }
+
+        rethrowError();
+
+        RenderFrame& frame = m_frames[number % 2];
+        frame = RenderFrame{};
+        frame.number = number;
+
+        return frame;
+    }
+
+    void RenderFrontend::endFrame()
+    {
+        uint64_t number = m_building.load(std::memory_order_relaxed);
+
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_published = number;
+        }
+
+        m_changed.notify_all();
+        m_building.store(number + 1, std::memory_order_relaxed);
+    }
+
+    void RenderFrontend::waitForBackend()
+    {
+        {
+            std::unique_lock<std::mutex> lock{m_mutex};
+            m_changed.wait(lock, [&] { return m_consumed == m_published || m_error || m_stopping; });
+        }
+
+        rethrowError();
+    }
+
+    void RenderFrontend::rethrowError()
+    {
+        std::exception_ptr error;
+
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            error = m_error;
+        }
+
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    // *************** ----------------- *********************
+
+
+
+
+
+    // *************** Submission *********************
+
+    void RenderFrontend::submit(uint32_t model, const glm::mat4& transform, uint64_t sortKey, uint32_t id, uint32_t flags, uint32_t material)
+    {
+        DrawList& list = threadList();
+
+        uint32_t transformIndex = static_cast<uint32_t>(list.transforms.size());
+        list.transforms.push_back(transform);
+        list.packets.push_back({sortKey, model, transformIndex, material, id, flags});
+    }
+
+    void RenderFrontend::submitLight(const PointLight& light)
+    {
+        threadList().lights.push_back(light);
+    }
+
+    void RenderFrontend::submitShadowCaster(uint32_t model, const glm::mat4& transform, uint32_t views, uint32_t flags)
+    {
+        DrawList& list = threadList();
+
+        uint32_t transformIndex = static_cast<uint32_t>(list.transforms.size());
+        list.transforms.push_back(transform);
+        list.casters.push_back({model, transformIndex, views, flags});
+    }
+
+    void RenderFrontend::registerModel(std::shared_ptr<Model> model)
+    {
+        std::lock_guard<std::mutex> lock{m_modelMutex};
+        m_newModels.push_back(std::move(model));
+    }
+
+    DrawList& RenderFrontend::threadList()
+    {
+        if (t_instance != m_instance)
+        {
+            t_slot = m_threadCount.fetch_add(1, std::memory_order_relaxed);
+
+            if (t_slot >= MAX_THREADS)
+                throw std::runtime_error("failed to register render thread, more than RenderFrontend::MAX_THREADS submit draws");
+
+            t_instance = m_instance;
+        }
+
+        return m_threads[t_slot].lists[m_building.load(std::memory_order_relaxed) % 2];
+    }
+
+    // *************** ----------------- *********************
+
+
+
+
+
+    // *************** Backend thread *********************
+
+    const RenderFrame* RenderFrontend::acquireFrame()
+    {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        m_changed.wait(lock, [&] { return m_published > m_consumed || m_stopping; });
+
+        if (m_stopping) return nullptr;
+
+        return &m_frames[(m_consumed + 1) % 2];
+    }
+
+    void RenderFrontend::gatherDraws(const RenderFrame& frame, DrawList& merged)
+    {
+        merged.clear();
+
+        // Everything the producers wrote happened before endFrame, which we synchronized with in acquireFrame
+        uint32_t threadCount = std::min(m_threadCount.load(std::memory_order_relaxed), MAX_THREADS);
+
+        for (uint32_t t = 0; t < threadCount; t++)
+        {
+            const DrawList& list = m_threads[t].lists[frame.number % 2];
+
+            uint32_t base = static_cast<uint32_t>(merged.transforms.size());
+            merged.transforms.insert(merged.transforms.end(), list.transforms.begin(), list.transforms.end());
+
+            for (DrawPacket packet : list.packets)
+            {
+                packet.transform += base;
+                merged.packets.push_back(packet);
+            }
+
+            for (ShadowCaster caster : list.casters)
+            {
+                caster.transform += base;
+                merged.casters.push_back(caster);
+            }
+
+            merged.lights.insert(merged.lights.end(), list.lights.begin(), list.lights.end());
+        }
+    }
+
+    void RenderFrontend::takeNewModels(std::vector<std::shared_ptr<Model>>& models)
+    {
+        std::lock_guard<std::mutex> lock{m_modelMutex};
+
+        for (std::shared_ptr<Model>& model : m_newModels)
+        {
+            uint32_t handle = model->getSortId();
+
+            if (handle >= models.size())
+                models.resize(handle + 1);
+
+            models[handle] = std::move(model);
+        }
+
+        m_newModels.clear();
+    }
+
+    void RenderFrontend::releaseFrame(const RenderFrame& frame)
+    {
+        uint32_t threadCount = std::min(m_threadCount.load(std::memory_order_relaxed), MAX_THREADS);
+
+        // Keeps the capacity, steady state frames don't allocate
+        for (uint32_t t = 0; t < threadCount; t++)
+            m_threads[t].lists[frame.number % 2].clear();
+
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            assert(frame.number == m_consumed + 1 && "Render frames have to be released in order");
+            m_consumed = frame.number;
+        }
+
+        m_changed.notify_all();
+    }
+
+    void RenderFrontend::stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_stopping = true;
+        }
+
+        m_changed.notify_all();
+    }
+
+    void RenderFrontend::fail(std::exception_ptr error)
+    {
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_error = error;
+            m_stopping = true;
+        }
+
+        m_changed.notify_all();
+    }
+
+    // *************** ----------------- *********************
+
+}
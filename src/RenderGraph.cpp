@@ -0,0 +1,1375 @@
+#include "RenderGraph.hpp"
+
+// std
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+
+namespace Orasis {
+
+    namespace {
+
+        using Usage = RenderGraph::Usage;
+
+        bool isAttachmentUsage(Usage usage)
+        {
+            return usage == Usage::ColorAttachment || usage == Usage::DepthAttachment || usage == Usage::InputAttachment;
+        }
+
+        // Only writes have to be made available, reads just need the execution dependency
+        VkAccessFlags writeAccess(VkAccessFlags access)
+        {
+            return access & (VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+                             VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+        }
+
+        bool hasStencil(VkFormat format)
+        {
+            return format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+        }
+
+        VkImageAspectFlags aspectOf(const RenderGraph::ImageDesc& desc)
+        {
+            if (desc.type != Attachment::Type::isDepth)
+                return VK_IMAGE_ASPECT_COLOR_BIT;
+
+            return hasStencil(desc.format) ? VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT : VK_IMAGE_ASPECT_DEPTH_BIT;
+        }
+
+        // The formats the engine uses, anything else is counted as 4
+        uint32_t bytesPerPixel(VkFormat format)
+        {
+            switch (format)
+            {
+                case VK_FORMAT_R8_UNORM:
+                    return 1;
+                case VK_FORMAT_R8G8_UNORM:
+                case VK_FORMAT_R16_SFLOAT:
+                case VK_FORMAT_D16_UNORM:
+                    return 2;
+                case VK_FORMAT_R16G16B16A16_SFLOAT:
+                case VK_FORMAT_R32G32_SFLOAT:
+                case VK_FORMAT_D32_SFLOAT_S8_UINT:
+                    return 8;
+                case VK_FORMAT_R32G32B32A32_SFLOAT:
+                    return 16;
+                default:
+                    return 4;
+            }
+        }
+
+        VkImageUsageFlags imageUsageOf(Usage usage)
+        {
+            switch (usage)
+            {
+                case Usage::ColorAttachment:    return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+                case Usage::DepthAttachment:    return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+                case Usage::InputAttachment:    return VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+                case Usage::Sampled:            return VK_IMAGE_USAGE_SAMPLED_BIT;
+                case Usage::Storage:            return VK_IMAGE_USAGE_STORAGE_BIT;
+                case Usage::TransferSrc:        return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+                case Usage::TransferDst:        return VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+                default:                        return 0;
+            }
+        }
+
+        const char* usageName(Usage usage)
+        {
+            switch (usage)
+            {
+                case Usage::ColorAttachment:    return "color";
+                case Usage::DepthAttachment:    return "depth";
+                case Usage::InputAttachment:    return "input";
+                case Usage::Sampled:            return "sampled";
+                case Usage::Storage:            return "storage";
+                case Usage::TransferSrc:        return "transfer src";
+                case Usage::TransferDst:        return "transfer dst";
+                default:                        return "present";
+            }
+        }
+
+        double megabytes(VkDeviceSize bytes)
+        {
+            return static_cast<double>(bytes) / (1024.0 * 1024.0);
+        }
+
+        // Same src and dst subpass and flags are folded into one
+        void addDependency(std::vector<VkSubpassDependency>& dependencies, uint32_t srcSubpass, uint32_t dstSubpass,
+                           VkPipelineStageFlags srcStages, VkAccessFlags srcAccess, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess,
+                           VkDependencyFlags flags)
+        {
+            if (srcStages == 0) srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+            if (dstStages == 0) dstStages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+
+            for (VkSubpassDependency& dependency : dependencies)
+                if (dependency.srcSubpass == srcSubpass && dependency.dstSubpass == dstSubpass && dependency.dependencyFlags == flags)
+                {
+                    dependency.srcStageMask |= srcStages;
+                    dependency.srcAccessMask |= srcAccess;
+                    dependency.dstStageMask |= dstStages;
+                    dependency.dstAccessMask |= dstAccess;
+                    return;
+                }
+
+            VkSubpassDependency dependency{};
+            dependency.srcSubpass = srcSubpass;
+            dependency.dstSubpass = dstSubpass;
+            dependency.srcStageMask = srcStages;
+            dependency.srcAccessMask = srcAccess;
+            dependency.dstStageMask = dstStages;
+            dependency.dstAccessMask = dstAccess;
+            dependency.dependencyFlags = flags;
+
+            dependencies.push_back(dependency);
+        }
+
+    }
+
+
+
+    // *************** Declaration *********************
+
+    RenderGraph::PassBuilder& RenderGraph::PassBuilder::read(Resource resource, Usage usage)
+    {
+        if (usage != Usage::InputAttachment && usage != Usage::Sampled && usage != Usage::Storage && usage != Usage::TransferSrc)
+            throw std::runtime_error(std::string("failed to declare render graph read, ") + usageName(usage) + " isn't a read");
+
+        if (resource >= m_graph.m_resources.size())
+            throw std::runtime_error("failed to declare render graph read, unknown resource");
+
+        if (usage == Usage::InputAttachment && m_graph.m_passes[m_pass].type != PassType::Graphics)
+            throw std::runtime_error("failed to declare render graph read, only graphics passes have input attachments");
+
+        m_graph.m_passes[m_pass].accesses.push_back({resource, usage, false});
+        m_graph.m_compiled = false;
+        return *this;
+    }
+
+    RenderGraph::PassBuilder& RenderGraph::PassBuilder::write(Resource resource, Usage usage)
+    {
+        if (usage != Usage::ColorAttachment && usage != Usage::DepthAttachment && usage != Usage::Storage && usage != Usage::TransferDst)
+            throw std::runtime_error(std::string("failed to declare render graph write, ") + usageName(usage) + " isn't a write");
+
+        if (resource >= m_graph.m_resources.size())
+            throw std::runtime_error("failed to declare render graph write, unknown resource");
+
+        if (isAttachmentUsage(usage) && m_graph.m_passes[m_pass].type != PassType::Graphics)
+            throw std::runtime_error("failed to declare render graph write, only graphics passes have attachments");
+
+        m_graph.m_passes[m_pass].accesses.push_back({resource, usage, true});
+        m_graph.m_compiled = false;
+        return *this;
+    }
+
+    RenderGraph::PassBuilder& RenderGraph::PassBuilder::keep()
+    {
+        m_graph.m_passes[m_pass].keep = true;
+        m_graph.m_compiled = false;
+        return *this;
+    }
+
+    RenderGraph::PassBuilder& RenderGraph::PassBuilder::execute(ExecuteFn execute)
+    {
+        m_graph.m_passes[m_pass].execute = std::move(execute);
+        return *this;
+    }
+
+    RenderGraph::Resource RenderGraph::createImage(const std::string& name, const ImageDesc& desc)
+    {
+        return addResource(name, desc, false);
+    }
+
+    RenderGraph::Resource RenderGraph::importImage(const std::string& name, const ImageDesc& desc)
+    {
+        return addResource(name, desc, true);
+    }
+
+    RenderGraph::Resource RenderGraph::addResource(const std::string& name, const ImageDesc& desc, bool imported)
+    {
+        if (find(name) != invalidResource)
+            throw std::runtime_error("failed to add render graph image, the name is already taken");
+
+        ResourceNode resource{name, desc, imported};
+        resource.desc.downscale = std::max(desc.downscale, 1u);
+
+        m_resources.push_back(resource);
+        m_compiled = false;
+
+        return static_cast<Resource>(m_resources.size() - 1);
+    }
+
+    void RenderGraph::markOutput(Resource resource, Usage usage)
+    {
+        m_resources[resource].output = true;
+        m_resources[resource].outputUsage = usage;
+        m_compiled = false;
+    }
+
+    RenderGraph::PassBuilder RenderGraph::addPass(const std::string& name, PassType type)
+    {
+        for (const PassNode& pass : m_passes)
+            if (pass.name == name)
+                throw std::runtime_error("failed to add render graph pass, the name is already taken");
+
+        m_passes.push_back({name, type});
+        m_compiled = false;
+
+        return PassBuilder(*this, static_cast<uint32_t>(m_passes.size() - 1));
+    }
+
+    RenderGraph::Resource RenderGraph::find(const std::string& name) const
+    {
+        for (Resource resource = 0; resource < m_resources.size(); resource++)
+            if (m_resources[resource].name == name)
+                return resource;
+
+        return invalidResource;
+    }
+
+    uint32_t RenderGraph::passIndex(const std::string& pass) const
+    {
+        for (uint32_t index = 0; index < m_passes.size(); index++)
+            if (m_passes[index].name == pass)
+                return index;
+
+        throw std::runtime_error("failed to find render graph pass " + pass);
+    }
+
+
+
+    // *************** Compile *********************
+
+    void RenderGraph::compile()
+    {
+        // Everything read has been written earlier in the frame, or comes from outside of it
+        std::vector<bool> written(m_resources.size(), false);
+
+        for (const PassNode& pass : m_passes)
+        {
+            for (const Access& access : pass.accesses)
+                if (!access.write && !written[access.resource] && !m_resources[access.resource].imported)
+                    throw std::runtime_error("failed to compile render graph, " + pass.name + " reads " + m_resources[access.resource].name + " before anything writes it");
+
+            for (const Access& access : pass.accesses)
+                if (access.write)
+                    written[access.resource] = true;
+        }
+
+        cullPasses();
+        mergePasses();
+        assignLifetimes();
+        assignAliasSlots();
+        synchronize();
+
+        m_compiled = true;
+    }
+
+    // Backwards from the outputs and the kept passes
+    void RenderGraph::cullPasses()
+    {
+        std::vector<bool> needed(m_resources.size(), false);
+
+        for (Resource resource = 0; resource < m_resources.size(); resource++)
+            needed[resource] = m_resources[resource].output;
+
+        for (size_t index = m_passes.size(); index-- > 0;)
+        {
+            PassNode& pass = m_passes[index];
+
+            pass.culled = !pass.keep;
+            for (const Access& access : pass.accesses)
+                if (access.write && needed[access.resource])
+                    pass.culled = false;
+
+            if (pass.culled) continue;
+
+            // Writes count too, attachments that were written before get loaded
+            for (const Access& access : pass.accesses)
+                needed[access.resource] = true;
+        }
+    }
+
+    void RenderGraph::mergePasses()
+    {
+        m_groups.clear();
+
+        for (uint32_t index = 0; index < m_passes.size(); index++)
+        {
+            PassNode& pass = m_passes[index];
+            pass.group = none;
+            pass.subpass = 0;
+
+            if (pass.culled) continue;
+
+            uint32_t downscale = 0;
+            uint32_t depthAttachments = 0;
+
+            for (const Access& access : pass.accesses)
+            {
+                if (!isAttachmentUsage(access.usage)) continue;
+
+                uint32_t resourceDownscale = m_resources[access.resource].desc.downscale;
+                if (downscale != 0 && downscale != resourceDownscale)
+                    throw std::runtime_error("failed to compile render graph, the attachments of " + pass.name + " differ in size");
+
+                downscale = resourceDownscale;
+                depthAttachments += access.usage == Usage::DepthAttachment ? 1 : 0;
+            }
+
+            if (depthAttachments > 1)
+                throw std::runtime_error("failed to compile render graph, " + pass.name + " writes more than one depth attachment");
+
+            bool merge = pass.type == PassType::Graphics && !m_groups.empty() && m_groups.back().renderPass && canMerge(m_groups.back(), pass);
+
+            if (!merge)
+            {
+                Group group{};
+                group.renderPass = pass.type == PassType::Graphics;
+                group.downscale = downscale != 0 ? downscale : 1;
+                m_groups.push_back(group);
+            }
+
+            Group& group = m_groups.back();
+            pass.group = static_cast<uint32_t>(m_groups.size() - 1);
+            pass.subpass = static_cast<uint32_t>(group.passes.size());
+            group.passes.push_back(index);
+
+            if (!group.renderPass) continue;
+
+            for (const Access& access : pass.accesses)
+                if (isAttachmentUsage(access.usage) && std::find(group.attachments.begin(), group.attachments.end(), access.resource) == group.attachments.end())
+                    group.attachments.push_back(access.resource);
+
+            group.descriptions.resize(group.attachments.size());
+        }
+    }
+
+    /*
+        A graphics pass joins the render pass before it if everything they share is an attachment
+        of both: written as color / depth or read at the same pixel. Anything sampled needs the
+        render pass it was written in to be over.
+    */
+    bool RenderGraph::canMerge(const Group& group, const PassNode& pass) const
+    {
+        for (const Access& access : pass.accesses)
+        {
+            bool attachment = isAttachmentUsage(access.usage);
+
+            if (attachment && m_resources[access.resource].desc.downscale != group.downscale)
+                return false;
+
+            for (uint32_t index : group.passes)
+                for (const Access& other : m_passes[index].accesses)
+                    if (other.resource == access.resource && !(attachment && isAttachmentUsage(other.usage)))
+                        return false;
+        }
+
+        return true;
+    }
+
+    void RenderGraph::assignLifetimes()
+    {
+        std::vector<bool> onlyAttachments(m_resources.size(), true);
+
+        for (ResourceNode& resource : m_resources)
+        {
+            resource.usage = 0;
+            resource.firstGroup = none;
+            resource.lastGroup = none;
+            resource.transient = false;
+            resource.aliasSlot = none;
+        }
+
+        for (const PassNode& pass : m_passes)
+        {
+            if (pass.culled) continue;
+
+            for (const Access& access : pass.accesses)
+            {
+                ResourceNode& resource = m_resources[access.resource];
+
+                resource.usage |= imageUsageOf(access.usage);
+                resource.firstGroup = resource.firstGroup == none ? pass.group : std::min(resource.firstGroup, pass.group);
+                resource.lastGroup = resource.lastGroup == none ? pass.group : std::max(resource.lastGroup, pass.group);
+
+                if (!isAttachmentUsage(access.usage))
+                    onlyAttachments[access.resource] = false;
+            }
+        }
+
+        for (Resource index = 0; index < m_resources.size(); index++)
+        {
+            ResourceNode& resource = m_resources[index];
+
+            if (resource.output)
+            {
+                resource.usage |= imageUsageOf(resource.outputUsage);
+
+                // Lives until whatever reads it after the graph
+                if (resource.firstGroup != none)
+                    resource.lastGroup = static_cast<uint32_t>(m_groups.size());
+            }
+
+            // Never leaves the tile memory of its render pass, nothing has to back it on tilers
+            resource.transient = !resource.imported && !resource.output && resource.firstGroup != none &&
+                                 resource.firstGroup == resource.lastGroup && m_groups[resource.firstGroup].renderPass && onlyAttachments[index];
+
+            if (resource.transient)
+                resource.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+        }
+    }
+
+    /*
+        Interval coloring over the groups. Slots are sized at realize(), here they're weighed in
+        bytes per pixel of the full extent: the one the image fits best, or the biggest free one.
+    */
+    void RenderGraph::assignAliasSlots()
+    {
+        std::vector<Resource> order;
+
+        for (Resource resource = 0; resource < m_resources.size(); resource++)
+            if (!m_resources[resource].imported && !m_resources[resource].transient && m_resources[resource].firstGroup != none)
+                order.push_back(resource);
+
+        std::stable_sort(order.begin(), order.end(), [&](Resource a, Resource b) {
+            return m_resources[a].firstGroup < m_resources[b].firstGroup;
+        });
+
+        struct Slot {
+            uint32_t lastGroup;
+            double weight;
+        };
+        std::vector<Slot> slots;
+
+        for (Resource index : order)
+        {
+            ResourceNode& resource = m_resources[index];
+            double downscale = static_cast<double>(resource.desc.downscale);
+            double weight = bytesPerPixel(resource.desc.format) / (downscale * downscale);
+
+            uint32_t best = none;
+
+            for (uint32_t slot = 0; slot < slots.size(); slot++)
+            {
+                if (slots[slot].lastGroup >= resource.firstGroup) continue;
+
+                if (best == none)
+                {
+                    best = slot;
+                    continue;
+                }
+
+                bool fits = slots[slot].weight >= weight;
+                bool bestFits = slots[best].weight >= weight;
+
+                if ((fits && (!bestFits || slots[slot].weight < slots[best].weight)) || (!fits && !bestFits && slots[slot].weight > slots[best].weight))
+                    best = slot;
+            }
+
+            if (best == none)
+            {
+                slots.push_back({resource.lastGroup, weight});
+                best = static_cast<uint32_t>(slots.size() - 1);
+            }
+
+            slots[best].lastGroup = resource.lastGroup;
+            slots[best].weight = std::max(slots[best].weight, weight);
+            resource.aliasSlot = best;
+        }
+
+        m_aliasSlots = static_cast<uint32_t>(slots.size());
+    }
+
+    RenderGraph::State RenderGraph::stateOf(Usage usage, PassType type, const ResourceNode& resource) const
+    {
+        bool depth = resource.desc.type == Attachment::Type::isDepth;
+
+        VkImageLayout readLayout = depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        VkPipelineStageFlags shaderStage = type == PassType::Graphics ? VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT : VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+        switch (usage)
+        {
+            case Usage::ColorAttachment:
+                return {VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                        VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT};
+
+            case Usage::DepthAttachment:
+                return {VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT};
+
+            case Usage::InputAttachment:
+                return {readLayout, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_INPUT_ATTACHMENT_READ_BIT};
+
+            case Usage::Sampled:
+                return {readLayout, shaderStage, VK_ACCESS_SHADER_READ_BIT};
+
+            case Usage::Storage:
+                return {VK_IMAGE_LAYOUT_GENERAL, shaderStage, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT};
+
+            case Usage::TransferSrc:
+                return {VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT};
+
+            case Usage::TransferDst:
+                return {VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT};
+
+            case Usage::Present:
+                // The stage the acquire semaphore is waited on, the next frame's first use chains to it
+                return {VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0};
+        }
+
+        return {};
+    }
+
+    /*
+        Where the previous frame left the image: everything that touched it (or the images sharing
+        its memory) is waited for. The layout only matters if this frame starts by reading it.
+    */
+    RenderGraph::State RenderGraph::frameEntryState(Resource index) const
+    {
+        const ResourceNode& resource = m_resources[index];
+        State entry{};
+
+        auto sharesMemory = [&](Resource other) {
+            return other == index || (resource.aliasSlot != none && m_resources[other].aliasSlot == resource.aliasSlot);
+        };
+
+        bool firstUse = true;
+        bool readsFirst = false;
+        VkImageLayout lastLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        for (const PassNode& pass : m_passes)
+        {
+            if (pass.culled) continue;
+
+            for (const Access& access : pass.accesses)
+            {
+                if (!sharesMemory(access.resource)) continue;
+
+                State state = stateOf(access.usage, pass.type, m_resources[access.resource]);
+                entry.stages |= state.stages;
+                entry.access |= writeAccess(state.access);
+
+                if (access.resource != index) continue;
+
+                if (firstUse)
+                    readsFirst = !access.write || access.usage == Usage::Storage;
+
+                firstUse = false;
+                lastLayout = state.layout;
+            }
+        }
+
+        for (Resource other = 0; other < m_resources.size(); other++)
+            if (sharesMemory(other) && m_resources[other].output)
+            {
+                State state = stateOf(m_resources[other].outputUsage, PassType::Graphics, m_resources[other]);
+                entry.stages |= state.stages | stateOf(m_resources[other].outputUsage, PassType::Compute, m_resources[other]).stages;
+
+                if (other == index)
+                    lastLayout = state.layout;
+            }
+
+        if (readsFirst && resource.imported)
+            entry.layout = lastLayout;
+
+        if (entry.stages == 0)
+            entry.stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+
+        return entry;
+    }
+
+    /*
+        Walks each image through the groups. Inside a render pass the attachment description and
+        the subpass dependencies do the work and the final layout is the one the next use wants,
+        the dependency to EXTERNAL already waits for it. Everything else gets a barrier when the
+        layout changes or there's a write on either side.
+    */
+    void RenderGraph::synchronize()
+    {
+        struct Use {
+            uint32_t group;
+            uint32_t subpass;
+            State state;
+            bool write;
+        };
+
+        std::vector<std::vector<Use>> uses(m_resources.size());
+
+        for (const PassNode& pass : m_passes)
+        {
+            if (pass.culled) continue;
+
+            for (const Access& access : pass.accesses)
+            {
+                State state = stateOf(access.usage, pass.type, m_resources[access.resource]);
+                std::vector<Use>& list = uses[access.resource];
+
+                // Twice by the same pass (read and written), it's one use
+                if (!list.empty() && list.back().group == pass.group && list.back().subpass == pass.subpass)
+                {
+                    if (list.back().state.layout != state.layout)
+                        throw std::runtime_error("failed to compile render graph, " + pass.name + " uses " + m_resources[access.resource].name + " in two layouts");
+
+                    list.back().state.stages |= state.stages;
+                    list.back().state.access |= state.access;
+                    list.back().write |= access.write;
+                    continue;
+                }
+
+                list.push_back({pass.group, pass.subpass, state, access.write});
+            }
+        }
+
+        for (Resource index = 0; index < m_resources.size(); index++)
+        {
+            const ResourceNode& resource = m_resources[index];
+            const std::vector<Use>& list = uses[index];
+
+            if (list.empty()) continue;
+
+            State output{};
+            if (resource.output)
+            {
+                output = stateOf(resource.outputUsage, PassType::Graphics, resource);
+                output.stages |= stateOf(resource.outputUsage, PassType::Compute, resource).stages;
+            }
+
+            State previous = frameEntryState(index);
+            bool keptAcrossFrames = previous.layout != VK_IMAGE_LAYOUT_UNDEFINED;
+            bool covered = false;
+
+            size_t begin = 0;
+            while (begin < list.size())
+            {
+                uint32_t groupIndex = list[begin].group;
+                size_t end = begin;
+                while (end < list.size() && list[end].group == groupIndex)
+                    end++;
+
+                Group& group = m_groups[groupIndex];
+
+                // Every use of the group, one layout for all of them
+                State current{list[begin].state.layout, 0, 0};
+                bool writes = false;
+
+                for (size_t i = begin; i < end; i++)
+                {
+                    current.stages |= list[i].state.stages;
+                    current.access |= list[i].state.access;
+                    writes |= list[i].write;
+                }
+
+                // What the group hands it to
+                bool hasNext = end < list.size();
+                State next = output;
+
+                if (hasNext)
+                {
+                    next = {list[end].state.layout, 0, 0};
+                    for (size_t i = end; i < list.size() && list[i].group == list[end].group; i++)
+                    {
+                        next.stages |= list[i].state.stages;
+                        next.access |= list[i].state.access;
+                    }
+                }
+
+                auto attachment = std::find(group.attachments.begin(), group.attachments.end(), index);
+
+                if (group.renderPass && attachment != group.attachments.end())
+                {
+                    VkAttachmentDescription& description = group.descriptions[attachment - group.attachments.begin()];
+                    const Use& first = list[begin];
+                    const Use& last = list[end - 1];
+
+                    bool fresh = first.write && previous.layout == VK_IMAGE_LAYOUT_UNDEFINED;
+                    bool stored = hasNext || resource.output || keptAcrossFrames;
+
+                    description.format = resource.desc.format;
+                    description.samples = VK_SAMPLE_COUNT_1_BIT;
+                    description.loadOp = fresh ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+                    description.storeOp = stored ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+                    description.stencilLoadOp = hasStencil(resource.desc.format) ? description.loadOp : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+                    description.stencilStoreOp = hasStencil(resource.desc.format) ? description.storeOp : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+                    description.initialLayout = fresh ? VK_IMAGE_LAYOUT_UNDEFINED : previous.layout;
+                    description.finalLayout = (hasNext || resource.output) ? next.layout : last.state.layout;
+
+                    // Presented, it leaves ready to present like RenderPass builds it. A later write transitions it from there
+                    if (resource.output && resource.outputUsage == Usage::Present)
+                        description.finalLayout = output.layout;
+
+                    // External -> the first subpass using it
+                    addDependency(group.dependencies, VK_SUBPASS_EXTERNAL, first.subpass,
+                        previous.stages, writeAccess(previous.access), first.state.stages, first.state.access, 0);
+
+                    // Between subpasses, always at the same pixel
+                    for (size_t i = begin + 1; i < end; i++)
+                        if (list[i].subpass != list[i - 1].subpass)
+                            addDependency(group.dependencies, list[i - 1].subpass, list[i].subpass,
+                                list[i - 1].state.stages, writeAccess(list[i - 1].state.access), list[i].state.stages, list[i].state.access,
+                                VK_DEPENDENCY_BY_REGION_BIT);
+
+                    // The last subpass using it and the last one writing it -> whatever is next
+                    if (hasNext || resource.output)
+                    {
+                        addDependency(group.dependencies, last.subpass, VK_SUBPASS_EXTERNAL,
+                            last.state.stages, writeAccess(last.state.access), next.stages, next.access, 0);
+
+                        for (size_t i = end; i-- > begin;)
+                            if (list[i].write)
+                            {
+                                if (list[i].subpass != last.subpass)
+                                    addDependency(group.dependencies, list[i].subpass, VK_SUBPASS_EXTERNAL,
+                                        list[i].state.stages, writeAccess(list[i].state.access), next.stages, next.access, 0);
+                                break;
+                            }
+                    }
+
+                    previous = {description.finalLayout, current.stages, current.access};
+                    covered = (hasNext || resource.output) && description.finalLayout == next.layout;
+                }
+                else
+                {
+                    for (size_t i = begin; i < end; i++)
+                        if (list[i].state.layout != current.layout)
+                            throw std::runtime_error("failed to compile render graph, " + resource.name + " is used in two layouts by one render pass");
+
+                    bool layoutChange = previous.layout != current.layout;
+                    bool hazard = layoutChange || writeAccess(previous.access) != 0 || writes;
+
+                    if (hazard && !(covered && !layoutChange))
+                        group.barriers.push_back({index, previous, current});
+
+                    previous = current;
+                    covered = false;
+                }
+
+                begin = end;
+            }
+
+            // A render pass already left it in its output state, otherwise the last group using it does
+            if (resource.output && !covered && (previous.layout != output.layout || writeAccess(previous.access) != 0))
+                m_groups[list.back().group].outputBarriers.push_back({index, previous, output});
+        }
+    }
+
+    const std::vector<VkSubpassDependency>& RenderGraph::getSubpassDependencies(const std::string& pass) const
+    {
+        const PassNode& node = m_passes[passIndex(pass)];
+
+        if (!m_compiled || node.group == none || !m_groups[node.group].renderPass)
+            throw std::runtime_error("failed to get subpass dependencies, " + pass + " isn't a compiled graphics pass");
+
+        return m_groups[node.group].dependencies;
+    }
+
+    VkImageLayout RenderGraph::getFinalLayout(const std::string& pass, Resource resource) const
+    {
+        const Group& group = compiledGroup(pass);
+
+        for (size_t i = 0; i < group.attachments.size(); i++)
+            if (group.attachments[i] == resource)
+                return group.descriptions[i].finalLayout;
+
+        throw std::runtime_error("failed to get final layout, " + m_resources[resource].name + " isn't an attachment of " + pass);
+    }
+
+    const std::vector<RenderGraph::Barrier>& RenderGraph::getBarriers(const std::string& pass) const
+    {
+        return compiledGroup(pass).barriers;
+    }
+
+    const std::vector<RenderGraph::Barrier>& RenderGraph::getOutputBarriers(const std::string& pass) const
+    {
+        return compiledGroup(pass).outputBarriers;
+    }
+
+    const RenderGraph::Group& RenderGraph::compiledGroup(const std::string& pass) const
+    {
+        const PassNode& node = m_passes[passIndex(pass)];
+
+        if (!m_compiled || node.group == none)
+            throw std::runtime_error("failed to find the group of " + pass + ", it's culled or the graph isn't compiled");
+
+        return m_groups[node.group];
+    }
+
+
+
+    // *************** Dump *********************
+
+    VkExtent2D RenderGraph::extentOf(uint32_t downscale, VkExtent2D extent) const
+    {
+        return {(extent.width + downscale - 1) / downscale, (extent.height + downscale - 1) / downscale};
+    }
+
+    VkDeviceSize RenderGraph::estimateSize(const ResourceNode& resource, VkExtent2D extent) const
+    {
+        VkExtent2D size = extentOf(resource.desc.downscale, extent);
+        return static_cast<VkDeviceSize>(size.width) * size.height * bytesPerPixel(resource.desc.format);
+    }
+
+    void RenderGraph::dump(std::ostream& out, VkExtent2D extent) const
+    {
+        std::vector<VkDeviceSize> slotSizes(m_aliasSlots, 0);
+        VkDeviceSize owned = 0, transient = 0, imported = 0;
+        uint32_t culled = 0, renderPasses = 0;
+
+        for (const ResourceNode& resource : m_resources)
+        {
+            if (resource.firstGroup == none) continue;
+
+            VkDeviceSize size = estimateSize(resource, extent);
+
+            if (resource.imported)              imported += size;
+            else if (resource.transient)        transient += size;
+            else
+            {
+                owned += size;
+                slotSizes[resource.aliasSlot] = std::max(slotSizes[resource.aliasSlot], size);
+            }
+        }
+
+        VkDeviceSize aliased = 0;
+        for (VkDeviceSize size : slotSizes)
+            aliased += size;
+
+        for (const PassNode& pass : m_passes)
+            culled += pass.culled ? 1 : 0;
+
+        for (const Group& group : m_groups)
+            renderPasses += group.renderPass ? 1 : 0;
+
+        out << std::fixed << std::setprecision(2);
+        out << "digraph RenderGraph {\n";
+        out << "    // " << m_passes.size() << " passes (" << culled << " culled) in " << m_groups.size() << " groups, " << renderPasses << " render passes\n";
+        out << "    // " << extent.width << "x" << extent.height << ": graph images " << megabytes(owned) << " MB, " << megabytes(aliased) << " MB aliased, "
+            << megabytes(transient) << " MB lazily allocated, imported " << megabytes(imported) << " MB\n";
+        out << "    rankdir=LR;\n";
+        out << "    node [fontname=\"Consolas\", fontsize=10];\n\n";
+
+        // What's alive while the group runs, a slot counts once
+        auto liveMemory = [&](uint32_t group) {
+            VkDeviceSize live = 0;
+            std::vector<bool> slotCounted(m_aliasSlots, false);
+
+            for (const ResourceNode& resource : m_resources)
+            {
+                if (resource.firstGroup == none || group < resource.firstGroup || group > resource.lastGroup) continue;
+
+                if (resource.aliasSlot == none)
+                    live += estimateSize(resource, extent);
+                else if (!slotCounted[resource.aliasSlot])
+                {
+                    live += slotSizes[resource.aliasSlot];
+                    slotCounted[resource.aliasSlot] = true;
+                }
+            }
+
+            return live;
+        };
+
+        for (uint32_t groupIndex = 0; groupIndex < m_groups.size(); groupIndex++)
+        {
+            const Group& group = m_groups[groupIndex];
+
+            out << "    subgraph cluster_" << groupIndex << " {\n";
+            out << "        label=\"" << (group.renderPass ? "render pass " : "group ") << groupIndex << "\";\n";
+
+            for (uint32_t index : group.passes)
+            {
+                const PassNode& pass = m_passes[index];
+                out << "        \"pass:" << pass.name << "\" [shape=box, label=\"" << pass.name;
+
+                if (group.renderPass)
+                    out << "\\nsubpass " << pass.subpass;
+
+                out << "\\n" << megabytes(liveMemory(groupIndex)) << " MB live\"];\n";
+            }
+
+            out << "    }\n";
+        }
+
+        for (const PassNode& pass : m_passes)
+            if (pass.culled)
+                out << "    \"pass:" << pass.name << "\" [shape=box, style=dashed, color=gray, label=\"" << pass.name << "\\nculled\"];\n";
+
+        out << "\n";
+
+        for (const ResourceNode& resource : m_resources)
+        {
+            VkExtent2D size = extentOf(resource.desc.downscale, extent);
+
+            out << "    \"image:" << resource.name << "\" [shape=ellipse, label=\"" << resource.name << "\\n"
+                << size.width << "x" << size.height << ", " << megabytes(estimateSize(resource, extent)) << " MB\\n";
+
+            if (resource.firstGroup == none)        out << "unused";
+            else if (resource.imported)             out << "imported";
+            else if (resource.transient)            out << "transient";
+            else                                    out << "alias slot " << resource.aliasSlot;
+
+            out << (resource.output ? ", output" : "") << "\"];\n";
+        }
+
+        out << "\n";
+
+        for (const PassNode& pass : m_passes)
+            for (const Access& access : pass.accesses)
+            {
+                if (access.write)
+                    out << "    \"pass:" << pass.name << "\" -> \"image:" << m_resources[access.resource].name << "\"";
+                else
+                    out << "    \"image:" << m_resources[access.resource].name << "\" -> \"pass:" << pass.name << "\"";
+
+                out << " [label=\"" << usageName(access.usage) << "\"" << (pass.culled ? ", style=dashed" : "") << "];\n";
+            }
+
+        out << "}\n";
+    }
+
+
+
+    // *************** Vulkan objects *********************
+
+    RenderGraph::~RenderGraph()
+    {
+        retire();
+    }
+
+    void RenderGraph::setImported(Resource resource, std::vector<VkImage> images, std::vector<VkImageView> views)
+    {
+        if (!m_resources[resource].imported)
+            throw std::runtime_error("failed to set imported image, " + m_resources[resource].name + " is owned by the graph");
+
+        m_images.resize(m_resources.size());
+        m_views.resize(m_resources.size());
+
+        m_images[resource] = std::move(images);
+        m_views[resource] = std::move(views);
+    }
+
+    void RenderGraph::realize(Device& device, VmaAllocator allocator, VkExtent2D extent, uint32_t copies)
+    {
+        if (!m_compiled)
+            compile();
+
+        retire();
+
+        m_device = &device;
+        m_allocator = allocator;
+        m_extent = extent;
+        m_copies = copies;
+
+        m_images.resize(m_resources.size());
+        m_views.resize(m_resources.size());
+
+        for (Resource resource = 0; resource < m_resources.size(); resource++)
+            if (m_resources[resource].imported && m_resources[resource].firstGroup != none &&
+                (m_images[resource].size() < copies || m_views[resource].size() < copies))
+                throw std::runtime_error("failed to realize render graph, " + m_resources[resource].name + " has no imported image for every copy");
+
+        createImages();
+        createRenderPasses();
+        createFramebuffers();
+    }
+
+    void RenderGraph::createImages()
+    {
+        for (uint32_t copy = 0; copy < m_copies; copy++)
+        {
+            std::vector<VkMemoryRequirements> slotRequirements(m_aliasSlots, VkMemoryRequirements{0, 1, ~0u});
+            std::vector<Resource> aliased;
+
+            for (Resource index = 0; index < m_resources.size(); index++)
+            {
+                const ResourceNode& resource = m_resources[index];
+                if (resource.imported || resource.firstGroup == none) continue;
+
+                VkExtent2D size = extentOf(resource.desc.downscale, m_extent);
+
+                VkImageCreateInfo imageInfo{};
+                imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+                imageInfo.imageType = VK_IMAGE_TYPE_2D;
+                imageInfo.extent = {size.width, size.height, 1};
+                imageInfo.mipLevels = 1;
+                imageInfo.arrayLayers = 1;
+                imageInfo.format = resource.desc.format;
+                imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+                imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                imageInfo.usage = resource.usage;
+                imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+                imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+                VkImage image = VK_NULL_HANDLE;
+
+                if (resource.transient)
+                {
+                    VmaAllocationCreateInfo allocInfo{};
+                    allocInfo.usage = VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED;
+
+                    VmaAllocation allocation = VK_NULL_HANDLE;
+
+                    // Desktop GPUs have no lazily allocated memory, it's ordinary device memory there
+                    if (vmaCreateImage(m_allocator, &imageInfo, &allocInfo, &image, &allocation, nullptr) != VK_SUCCESS)
+                    {
+                        allocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+
+                        if (vmaCreateImage(m_allocator, &imageInfo, &allocInfo, &image, &allocation, nullptr) != VK_SUCCESS)
+                            throw std::runtime_error("failed to create transient render graph image");
+                    }
+
+                    m_allocations.push_back(allocation);
+                }
+                else
+                {
+                    if (vkCreateImage(m_device->device(), &imageInfo, nullptr, &image) != VK_SUCCESS)
+                        throw std::runtime_error("failed to create render graph image");
+
+                    VkMemoryRequirements requirements;
+                    vkGetImageMemoryRequirements(m_device->device(), image, &requirements);
+
+                    VkMemoryRequirements& slot = slotRequirements[resource.aliasSlot];
+
+                    // No memory type in common with the rest of the slot, it gets memory of its own
+                    if ((slot.memoryTypeBits & requirements.memoryTypeBits) == 0)
+                    {
+                        VmaAllocationCreateInfo allocInfo{};
+                        allocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+
+                        VmaAllocation allocation = VK_NULL_HANDLE;
+                        if (vmaAllocateMemoryForImage(m_allocator, image, &allocInfo, &allocation, nullptr) != VK_SUCCESS ||
+                            vmaBindImageMemory(m_allocator, allocation, image) != VK_SUCCESS)
+                            throw std::runtime_error("failed to allocate render graph image memory");
+
+                        m_allocations.push_back(allocation);
+                    }
+                    else
+                    {
+                        slot.size = std::max(slot.size, requirements.size);
+                        slot.alignment = std::max(slot.alignment, requirements.alignment);
+                        slot.memoryTypeBits &= requirements.memoryTypeBits;
+                        aliased.push_back(index);
+                    }
+                }
+
+                m_images[index].push_back(image);
+            }
+
+            // ---- One allocation per slot, its images bound at offset 0 ----
+            std::vector<VmaAllocation> slotAllocations(m_aliasSlots, VK_NULL_HANDLE);
+
+            for (uint32_t slot = 0; slot < m_aliasSlots; slot++)
+            {
+                if (slotRequirements[slot].size == 0) continue;
+
+                VmaAllocationCreateInfo allocInfo{};
+                allocInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+                if (vmaAllocateMemory(m_allocator, &slotRequirements[slot], &allocInfo, &slotAllocations[slot], nullptr) != VK_SUCCESS)
+                    throw std::runtime_error("failed to allocate render graph alias memory");
+
+                m_allocations.push_back(slotAllocations[slot]);
+            }
+
+            for (Resource index : aliased)
+                if (vmaBindImageMemory(m_allocator, slotAllocations[m_resources[index].aliasSlot], m_images[index][copy]) != VK_SUCCESS)
+                    throw std::runtime_error("failed to bind render graph image memory");
+
+            // ---- Views ----
+            for (Resource index = 0; index < m_resources.size(); index++)
+            {
+                const ResourceNode& resource = m_resources[index];
+                if (resource.imported || resource.firstGroup == none) continue;
+
+                VkImageViewCreateInfo viewInfo{};
+                viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+                viewInfo.image = m_images[index][copy];
+                viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+                viewInfo.format = resource.desc.format;
+                viewInfo.subresourceRange = {aspectOf(resource.desc), 0, 1, 0, 1};
+
+                VkImageView view = VK_NULL_HANDLE;
+                if (vkCreateImageView(m_device->device(), &viewInfo, nullptr, &view) != VK_SUCCESS)
+                    throw std::runtime_error("failed to create render graph image view");
+
+                m_views[index].push_back(view);
+            }
+        }
+    }
+
+    void RenderGraph::createRenderPasses()
+    {
+        m_renderPasses.assign(m_groups.size(), VK_NULL_HANDLE);
+
+        for (uint32_t groupIndex = 0; groupIndex < m_groups.size(); groupIndex++)
+        {
+            const Group& group = m_groups[groupIndex];
+            if (!group.renderPass || recordedByHand(group)) continue;
+
+            size_t subpassCount = group.passes.size();
+
+            std::vector<std::vector<VkAttachmentReference>> colors(subpassCount);
+            std::vector<std::vector<VkAttachmentReference>> inputs(subpassCount);
+            std::vector<std::vector<uint32_t>> preserves(subpassCount);
+            std::vector<VkAttachmentReference> depths(subpassCount, {VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED});
+
+            // First and last subpass of each attachment, the ones in between that don't use it preserve it
+            std::vector<uint32_t> firstSubpass(group.attachments.size(), none);
+            std::vector<uint32_t> lastSubpass(group.attachments.size(), 0);
+            std::vector<std::vector<bool>> used(subpassCount, std::vector<bool>(group.attachments.size(), false));
+
+            for (uint32_t subpass = 0; subpass < subpassCount; subpass++)
+            {
+                const PassNode& pass = m_passes[group.passes[subpass]];
+
+                for (const Access& access : pass.accesses)
+                {
+                    if (!isAttachmentUsage(access.usage)) continue;
+
+                    uint32_t attachment = static_cast<uint32_t>(std::find(group.attachments.begin(), group.attachments.end(), access.resource) - group.attachments.begin());
+                    VkAttachmentReference reference{attachment, stateOf(access.usage, pass.type, m_resources[access.resource]).layout};
+
+                    if (access.usage == Usage::ColorAttachment)         colors[subpass].push_back(reference);
+                    else if (access.usage == Usage::DepthAttachment)    depths[subpass] = reference;
+                    else                                                inputs[subpass].push_back(reference);
+
+                    firstSubpass[attachment] = std::min(firstSubpass[attachment], subpass);
+                    lastSubpass[attachment] = std::max(lastSubpass[attachment], subpass);
+                    used[subpass][attachment] = true;
+                }
+            }
+
+            std::vector<VkSubpassDescription> subpasses(subpassCount);
+
+            for (uint32_t subpass = 0; subpass < subpassCount; subpass++)
+            {
+                for (uint32_t attachment = 0; attachment < group.attachments.size(); attachment++)
+                    if (!used[subpass][attachment] && firstSubpass[attachment] < subpass && subpass < lastSubpass[attachment])
+                        preserves[subpass].push_back(attachment);
+
+                VkSubpassDescription& description = subpasses[subpass];
+                description.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+                description.colorAttachmentCount = static_cast<uint32_t>(colors[subpass].size());
+                description.pColorAttachments = colors[subpass].data();
+                description.inputAttachmentCount = static_cast<uint32_t>(inputs[subpass].size());
+                description.pInputAttachments = inputs[subpass].data();
+                description.preserveAttachmentCount = static_cast<uint32_t>(preserves[subpass].size());
+                description.pPreserveAttachments = preserves[subpass].data();
+                description.pDepthStencilAttachment = depths[subpass].attachment != VK_ATTACHMENT_UNUSED ? &depths[subpass] : nullptr;
+            }
+
+            VkRenderPassCreateInfo renderPassInfo{};
+            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+            renderPassInfo.attachmentCount = static_cast<uint32_t>(group.descriptions.size());
+            renderPassInfo.pAttachments = group.descriptions.data();
+            renderPassInfo.subpassCount = static_cast<uint32_t>(subpasses.size());
+            renderPassInfo.pSubpasses = subpasses.data();
+            renderPassInfo.dependencyCount = static_cast<uint32_t>(group.dependencies.size());
+            renderPassInfo.pDependencies = group.dependencies.data();
+
+            if (vkCreateRenderPass(m_device->device(), &renderPassInfo, nullptr, &m_renderPasses[groupIndex]) != VK_SUCCESS)
+                throw std::runtime_error("failed to create render graph render pass");
+        }
+    }
+
+    void RenderGraph::createFramebuffers()
+    {
+        m_framebuffers.assign(m_groups.size(), {});
+
+        for (uint32_t groupIndex = 0; groupIndex < m_groups.size(); groupIndex++)
+        {
+            const Group& group = m_groups[groupIndex];
+            if (!group.renderPass || recordedByHand(group)) continue;
+
+            VkExtent2D size = extentOf(group.downscale, m_extent);
+
+            for (uint32_t copy = 0; copy < m_copies; copy++)
+            {
+                std::vector<VkImageView> views;
+                for (Resource resource : group.attachments)
+                    views.push_back(m_views[resource][copy]);
+
+                VkFramebufferCreateInfo framebufferInfo{};
+                framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+                framebufferInfo.renderPass = m_renderPasses[groupIndex];
+                framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+                framebufferInfo.pAttachments = views.data();
+                framebufferInfo.width = size.width;
+                framebufferInfo.height = size.height;
+                framebufferInfo.layers = 1;
+
+                VkFramebuffer framebuffer = VK_NULL_HANDLE;
+                if (vkCreateFramebuffer(m_device->device(), &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS)
+                    throw std::runtime_error("failed to create render graph framebuffer");
+
+                m_framebuffers[groupIndex].push_back(framebuffer);
+            }
+        }
+    }
+
+    // Whatever a frame in flight may still use waits in the deletion queue, imported images aren't ours
+    void RenderGraph::retire()
+    {
+        if (m_device == nullptr) return;
+
+        std::vector<VkImage> images;
+        std::vector<VkImageView> views;
+
+        for (Resource resource = 0; resource < m_resources.size() && resource < m_images.size(); resource++)
+        {
+            if (m_resources[resource].imported) continue;
+
+            images.insert(images.end(), m_images[resource].begin(), m_images[resource].end());
+            views.insert(views.end(), m_views[resource].begin(), m_views[resource].end());
+            m_images[resource].clear();
+            m_views[resource].clear();
+        }
+
+        std::vector<VkFramebuffer> framebuffers;
+        for (std::vector<VkFramebuffer>& groupFramebuffers : m_framebuffers)
+            framebuffers.insert(framebuffers.end(), groupFramebuffers.begin(), groupFramebuffers.end());
+
+        VkDevice device = m_device->device();
+        VmaAllocator allocator = m_allocator;
+
+        m_device->deletionQueue().push([device, allocator, images, views, framebuffers, renderPasses = m_renderPasses, allocations = m_allocations]() {
+            for (VkFramebuffer framebuffer : framebuffers)
+                vkDestroyFramebuffer(device, framebuffer, nullptr);
+            for (VkRenderPass renderPass : renderPasses)
+                if (renderPass != VK_NULL_HANDLE)
+                    vkDestroyRenderPass(device, renderPass, nullptr);
+            for (VkImageView view : views)
+                vkDestroyImageView(device, view, nullptr);
+            for (VkImage image : images)
+                vkDestroyImage(device, image, nullptr);
+            for (VmaAllocation allocation : allocations)
+                vmaFreeMemory(allocator, allocation);
+        });
+
+        m_framebuffers.clear();
+        m_renderPasses.clear();
+        m_allocations.clear();
+    }
+
+    VkRenderPass RenderGraph::getRenderPass(const std::string& pass) const
+    {
+        const PassNode& node = m_passes[passIndex(pass)];
+
+        if (node.group == none || node.group >= m_renderPasses.size() || m_renderPasses[node.group] == VK_NULL_HANDLE)
+            throw std::runtime_error("failed to get render pass, " + pass + " isn't a realized graphics pass");
+
+        return m_renderPasses[node.group];
+    }
+
+    bool RenderGraph::recordedByHand(const Group& group) const
+    {
+        for (uint32_t index : group.passes)
+            if (m_passes[index].execute)
+                return false;
+
+        return true;
+    }
+
+    void RenderGraph::recordBarriers(VkCommandBuffer commandBuffer, uint32_t copy, const std::vector<Barrier>& groupBarriers) const
+    {
+        if (groupBarriers.empty()) return;
+
+        std::vector<VkImageMemoryBarrier> barriers;
+        VkPipelineStageFlags srcStages = 0;
+        VkPipelineStageFlags dstStages = 0;
+
+        for (const Barrier& barrier : groupBarriers)
+        {
+            VkImageMemoryBarrier imageBarrier{};
+            imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            imageBarrier.oldLayout = barrier.src.layout;
+            imageBarrier.newLayout = barrier.dst.layout;
+            imageBarrier.srcAccessMask = writeAccess(barrier.src.access);
+            imageBarrier.dstAccessMask = barrier.dst.access;
+            imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.image = m_images[barrier.resource][copy];
+            imageBarrier.subresourceRange = {aspectOf(m_resources[barrier.resource].desc), 0, 1, 0, 1};
+
+            barriers.push_back(imageBarrier);
+            srcStages |= barrier.src.stages;
+            dstStages |= barrier.dst.stages;
+        }
+
+        vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 0, nullptr, 0, nullptr,
+            static_cast<uint32_t>(barriers.size()), barriers.data());
+    }
+
+    void RenderGraph::execute(VkCommandBuffer commandBuffer, uint32_t copy) const
+    {
+        for (uint32_t groupIndex = 0; groupIndex < m_groups.size(); groupIndex++)
+        {
+            const Group& group = m_groups[groupIndex];
+
+            recordBarriers(commandBuffer, copy, group.barriers);
+
+            if (!group.renderPass || recordedByHand(group))
+            {
+                const PassNode& pass = m_passes[group.passes[0]];
+                if (!group.renderPass && pass.execute) pass.execute(commandBuffer, copy);
+
+                recordBarriers(commandBuffer, copy, group.outputBarriers);
+                continue;
+            }
+
+            // ---- Render pass, a subpass per merged pass ----
+            std::vector<VkClearValue> clearValues(group.attachments.size());
+            for (size_t i = 0; i < group.attachments.size(); i++)
+            {
+                if (m_resources[group.attachments[i]].desc.type == Attachment::Type::isDepth)
+                    clearValues[i].depthStencil = {1.0f, 0};
+                else
+                    clearValues[i].color = {{0.0f, 0.0f, 0.0f, 0.0f}};
+            }
+
+            VkRenderPassBeginInfo beginInfo{};
+            beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            beginInfo.renderPass = m_renderPasses[groupIndex];
+            beginInfo.framebuffer = m_framebuffers[groupIndex][copy];
+            beginInfo.renderArea = {{0, 0}, extentOf(group.downscale, m_extent)};
+            beginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+            beginInfo.pClearValues = clearValues.data();
+
+            vkCmdBeginRenderPass(commandBuffer, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+            for (size_t subpass = 0; subpass < group.passes.size(); subpass++)
+            {
+                if (subpass > 0)
+                    vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+
+                const PassNode& pass = m_passes[group.passes[subpass]];
+                if (pass.execute) pass.execute(commandBuffer, copy);
+            }
+
+            vkCmdEndRenderPass(commandBuffer);
+
+            recordBarriers(commandBuffer, copy, group.outputBarriers);
+        }
+    }
+
+    void RenderGraph::executePass(VkCommandBuffer commandBuffer, const std::string& pass, uint32_t copy, const ExecuteFn& record) const
+    {
+        const PassNode& node = m_passes[passIndex(pass)];
+
+        if (!m_compiled || copy >= m_copies)
+            throw std::runtime_error("failed to execute render graph pass " + pass + ", the graph isn't realized for that copy");
+
+        if (node.culled) return;
+
+        const Group& group = m_groups[node.group];
+        if (group.renderPass)
+            throw std::runtime_error("failed to execute render graph pass " + pass + ", graphics passes are recorded in their render pass");
+
+        recordBarriers(commandBuffer, copy, group.barriers);
+
+        if (record)                 record(commandBuffer, copy);
+        else if (node.execute)      node.execute(commandBuffer, copy);
+
+        recordBarriers(commandBuffer, copy, group.outputBarriers);
+    }
+
+}
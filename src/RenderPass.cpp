@@ -31,7 +31,9 @@ namespace Orasis {
     (
         AttachmentInfo attachment
     )
-    :s_attachFormat{attachment.s_format}, s_subpassToAttach{attachment.s_subpass}, s_type{attachment.s_type}
+    :s_attachFormat{attachment.s_format}, s_subpassToAttach{attachment.s_subpass}, s_type{attachment.s_type},
+     s_readAsInput{(attachment.s_usage & VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT) != 0},
+     s_sampledAfter{(attachment.s_usage & VK_IMAGE_USAGE_SAMPLED_BIT) != 0}
     {
         // Trying to catch a misconfiguration
         if(s_previousSubpass > s_subpassToAttach && s_previousSubpass + 1 != s_subpassToAttach)
@@ -60,12 +62,18 @@ namespace Orasis {
         return *this;
     }
 
+    RenderPass::Builder& RenderPass::Builder::setLoadMode(LoadMode loadMode)
+    {
+        s_loadMode = loadMode;
+        return *this;
+    }
+
     std::unique_ptr<RenderPass> RenderPass::Builder::build() const
     {
         if(s_renderPassAttachmentsStruct.size() == 0)
             throw std::runtime_error("You need to attachments to create a Render Pass!");
 
-        return std::make_unique<RenderPass>(s_device, s_subPassAttachments, s_renderPassAttachmentsStruct, s_dependencies);
+        return std::make_unique<RenderPass>(s_device, s_subPassAttachments, s_renderPassAttachmentsStruct, s_dependencies, s_loadMode);
     }
 
 
@@ -74,7 +82,8 @@ namespace Orasis {
         Device& device,
         std::unordered_map<uint8_t, std::vector<std::shared_ptr<SubpassAttachment>>> subPassAttachments,
         std::vector<std::shared_ptr<SubpassAttachment>> renderPassAttachmentsStruct,
-        std::vector<VkSubpassDependency> subpassDependancies
+        std::vector<VkSubpassDependency> subpassDependancies,
+        LoadMode loadMode
     )
     : m_device{device}
     {
@@ -105,8 +114,8 @@ namespace Orasis {
                     desc.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
                     break;
                 case Attachment::Type::isDepth:
-                    desc.storeOp     = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-                    desc.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+                    desc.storeOp     = currAttachment->s_sampledAfter ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+                    desc.finalLayout = currAttachment->s_sampledAfter ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
                     break;
                 case Attachment::Type::isPresented:
                     desc = {};
@@ -121,6 +130,29 @@ namespace Orasis {
                     throw std::runtime_error("Unknown attachment type!");
             }
 
+            // A GeometryOnly pass hands the first subpass' attachments to a Resume pass in the layouts it ends with
+            bool geometryAttachment = currAttachment->s_subpassToAttach == 0 && currAttachment->s_type != Attachment::Type::isPresented;
+            bool geometryOnly = loadMode == LoadMode::GeometryOnly || loadMode == LoadMode::ResumeGeometryOnly;
+            bool loadsGeometry = loadMode == LoadMode::Resume || loadMode == LoadMode::ResumeGeometryOnly;
+
+            if (geometryOnly)
+            {
+                if (geometryAttachment)
+                    desc.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+                else
+                {
+                    // Rendered by the Resume pass, its initial layout is UNDEFINED anyway
+                    desc.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+                    desc.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+                }
+            }
+
+            if (loadsGeometry && geometryAttachment)
+            {
+                desc.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+                desc.initialLayout = desc.finalLayout;
+            }
+
             renderPassAttachments.push_back(desc);
         }
 
@@ -210,6 +242,15 @@ namespace Orasis {
 
                         inputSubpassRefs[currSubpass].push_back(ref);
                     }
+                    else if(prevSubPassAttachment->s_type == Attachment::Type::isDepth && prevSubPassAttachment->s_readAsInput)
+                    {
+                        // Positions get reconstructed from it instead of being stored
+                        VkAttachmentReference ref{};
+                        ref.attachment = prevSubPassAttachment->s_attachIndex;
+                        ref.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+                        inputSubpassRefs[currSubpass].push_back(ref);
+                    }
 
                 }
                 
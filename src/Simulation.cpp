@@ -0,0 +1,174 @@
+#include "Simulation.hpp"
+
+#include <glm/gtc/constants.hpp>
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+namespace Orasis {
+
+    Simulation::Simulation(double tickRate)
+    {
+        assert(tickRate > 0.0 && "Simulation tick rate has to be positive");
+
+        m_step = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / tickRate));
+        m_stepSeconds = std::chrono::duration<float>(m_step).count();
+    }
+
+    Simulation::~Simulation()
+    {
+        stop();
+    }
+
+    void Simulation::start(SimulationState initialState, TickFunction tick)
+    {
+        assert(!isRunning() && "Simulation already started");
+
+        m_state = std::move(initialState);
+        m_tick = std::move(tick);
+        m_stopping = false;
+
+        // Tick 0 is the initial state, so the renderer has something before the first tick ran
+        Clock::time_point start = Clock::now();
+        publish(0, start);
+
+        m_thread = std::thread(&Simulation::threadLoop, this, start);
+    }
+
+    void Simulation::stop()
+    {
+        if (!m_thread.joinable()) return;
+
+        {
+            std::lock_guard<std::mutex> lock{m_stopMutex};
+            m_stopping = true;
+        }
+
+        m_stopSignal.notify_all();
+        m_thread.join();
+    }
+
+    void Simulation::setInput(uint32_t actions)
+    {
+        m_heldActions.store(actions, std::memory_order_relaxed);
+        m_latchedActions.fetch_or(actions, std::memory_order_relaxed);
+    }
+
+
+
+    // *************** Simulation thread *********************
+
+    void Simulation::threadLoop(Clock::time_point start)
+    {
+        uint64_t tick = 0;
+        Clock::time_point nextTime = start + m_step;
+
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock{m_stopMutex};
+                if (m_stopSignal.wait_until(lock, nextTime, [this] { return m_stopping; }))
+                    return;
+            }
+
+            Clock::time_point now = Clock::now();
+
+            // Way behind (breakpoint, hitch), skip ahead instead of spiraling into ever longer catch ups
+            if (now - nextTime > m_step * MAX_CATCH_UP_TICKS)
+                nextTime = now;
+
+            uint32_t ticks = 0;
+
+            while (nextTime <= now && ticks < MAX_CATCH_UP_TICKS)
+            {
+                uint32_t actions = m_heldActions.load(std::memory_order_relaxed) | m_latchedActions.exchange(0, std::memory_order_relaxed);
+
+                m_tick(m_state, actions, m_stepSeconds);
+
+                tick++;
+                ticks++;
+                nextTime += m_step;
+            }
+
+            // One snapshot per batch, the renderer would skip the ones in between anyway
+            publish(tick, nextTime - m_step);
+        }
+    }
+
+    void Simulation::publish(uint64_t tick, Clock::time_point time)
+    {
+        SimulationSnapshot& snapshot = m_snapshots.back();
+
+        snapshot.tick = tick;
+        snapshot.time = time;
+        snapshot.state = m_state;           // reuses the slot's capacity
+
+        m_snapshots.publish();
+    }
+
+    // *************** ----------------- *********************
+
+
+
+
+
+    // *************** Render thread *********************
+
+    const SimulationState& Simulation::interpolate(Clock::time_point now)
+    {
+        // Keep the snapshot we're leaving, its slot goes back to the writer
+        if (m_snapshots.hasUpdate())
+        {
+            std::swap(m_previous, m_snapshots.front());
+            m_snapshots.update();
+        }
+
+        const SimulationSnapshot& current = m_snapshots.front();
+        const SimulationState& from = m_previous.state;
+        const SimulationState& to = current.state;
+
+        // One tick behind, so there is (usually) a newer snapshot to blend towards
+        float alpha = 1.f;
+
+        if (current.time > m_previous.time && m_previous.time != Clock::time_point{})
+        {
+            auto renderTime = now - m_step;
+            alpha = std::chrono::duration<float>(renderTime - m_previous.time).count() / std::chrono::duration<float>(current.time - m_previous.time).count();
+            alpha = std::clamp(alpha, 0.f, 1.f);
+        }
+
+        m_interpolated.bodies.resize(to.bodies.size());
+
+        blend(from.camera, to.camera, alpha, m_interpolated.camera);
+
+        for (size_t i = 0; i < to.bodies.size(); i++)
+        {
+            const SimulationState::Body& body = to.bodies[i];
+            m_interpolated.bodies[i].id = body.id;
+
+            // Bodies added since the older snapshot just snap to their state
+            if (i < from.bodies.size() && from.bodies[i].id == body.id)
+                blend(from.bodies[i].transform, body.transform, alpha, m_interpolated.bodies[i].transform);
+            else
+                m_interpolated.bodies[i].transform = body.transform;
+        }
+
+        return m_interpolated;
+    }
+
+    void Simulation::blend(const TransformComponent& from, const TransformComponent& to, float alpha, TransformComponent& out)
+    {
+        out.translation = glm::mix(from.translation, to.translation, alpha);
+        out.scale = glm::mix(from.scale, to.scale, alpha);
+
+        // Shortest way around, yaw wraps at 2pi
+        glm::vec3 delta = to.rotation - from.rotation;
+        delta -= glm::two_pi<float>() * glm::floor((delta + glm::pi<float>()) / glm::two_pi<float>());
+        out.rotation = from.rotation + delta * alpha;
+    }
+
+    // *************** ----------------- *********************
+
+}
@@ -1,6 +1,7 @@
 #include "SwapChain.hpp"
 
 // std
+#include <algorithm>
 #include <array>
 #include <cstdlib>
 #include <cstring>
@@ -11,15 +12,15 @@
 
 namespace Orasis {
 
-SwapChain::SwapChain(Device& deviceRef, VkExtent2D extent)
-    : device{deviceRef}, windowExtent{extent} {
+SwapChain::SwapChain(Device& deviceRef, VkExtent2D extent, VkPresentModeKHR preferredMode)
+    : device{deviceRef}, windowExtent{extent}, preferredPresentMode{preferredMode} {
     // init();
     // initDeffered();
     initManager();
   }
   
-  SwapChain::SwapChain(Device& deviceRef, VkExtent2D extent, std::shared_ptr<SwapChain> previous)
-  : device{deviceRef}, windowExtent{extent}, oldSwapChain{previous} {
+  SwapChain::SwapChain(Device& deviceRef, VkExtent2D extent, std::shared_ptr<SwapChain> previous, VkPresentModeKHR preferredMode)
+  : device{deviceRef}, windowExtent{extent}, oldSwapChain{previous}, preferredPresentMode{preferredMode} {
     
     // init();
     // initDeffered();
@@ -33,14 +34,14 @@ void SwapChain::init() {
   createRenderPass();
   createDepthResources();
   createFramebuffers();
-  createSyncObjects();
 }
 
 void SwapChain::initManager() {
   
-  createSwapChain();
-
-  createSyncObjects();
+  if (device.isHeadless())
+    createOffscreenImages();
+  else
+    createSwapChain();
 
 }
 
@@ -52,7 +53,6 @@ void SwapChain::initDeffered() {
   createRenderPass();
   createDepthResources();
   createDefferedFramebuffers();
-  createSyncObjects();
 }
 
 SwapChain::~SwapChain() {
@@ -66,6 +66,11 @@ SwapChain::~SwapChain() {
     swapChain = nullptr;
   }
 
+  for (size_t i = 0; i < offscreenImageMemorys.size(); i++) {
+    vkDestroyImage(device.device(), swapChainImages[i], nullptr);
+    vkFreeMemory(device.device(), offscreenImageMemorys[i], nullptr);
+  }
+
   for (int i = 0; i < depthImages.size(); i++) {
     vkDestroyImageView(device.device(), depthImageViews[i], nullptr);
     vkDestroyImage(device.device(), depthImages[i], nullptr);
@@ -98,29 +103,23 @@ SwapChain::~SwapChain() {
   // }
   // --------------- Deffered ---------------
 
-  // cleanup synchronization objects
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    vkDestroySemaphore(device.device(), renderFinishedSemaphores[i], nullptr);
-    vkDestroySemaphore(device.device(), imageAvailableSemaphores[i], nullptr);
-    vkDestroyFence(device.device(), inFlightFences[i], nullptr);
-  }
 }
 
-VkResult SwapChain::acquireNextImage(uint32_t *imageIndex) {
-  
-  vkWaitForFences(
-      device.device(),
-      1,
-      &inFlightFences[currentFrame],
-      VK_TRUE,
-      std::numeric_limits<uint64_t>::max()
-    );
+VkResult SwapChain::acquireNextImage(VkSemaphore imageAvailable, uint32_t *imageIndex) {
 
+  // FrameScheduler::waitForImage keeps the ring from overtaking the GPU
+  if (offscreen) {
+    *imageIndex = nextOffscreenImage;
+    nextOffscreenImage = (nextOffscreenImage + 1) % static_cast<uint32_t>(swapChainImages.size());
+    return VK_SUCCESS;
+  }
+
+  // Frame pacing happens on the device timeline (FrameScheduler), nothing to wait for here
   VkResult result = vkAcquireNextImageKHR(
       device.device(),
       swapChain,
       std::numeric_limits<uint64_t>::max(),
-      imageAvailableSemaphores[currentFrame],  // must be a not signaled semaphore
+      imageAvailable,  // must be a not signaled semaphore
       VK_NULL_HANDLE,
       imageIndex
     );
@@ -128,40 +127,15 @@ VkResult SwapChain::acquireNextImage(uint32_t *imageIndex) {
   return result;
 }
 
-VkResult SwapChain::submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex) {
-
-  if (imagesInFlight[*imageIndex] != VK_NULL_HANDLE) {
-    vkWaitForFences(device.device(), 1, &imagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
-  }
-  imagesInFlight[*imageIndex] = inFlightFences[currentFrame];
-
-  VkSubmitInfo submitInfo = {};
-  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-
-  VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
-  VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-  submitInfo.waitSemaphoreCount = 1;
-  submitInfo.pWaitSemaphores = waitSemaphores;
-  submitInfo.pWaitDstStageMask = waitStages;
-
-  submitInfo.commandBufferCount = 1;
-  submitInfo.pCommandBuffers = buffers;
+VkResult SwapChain::present(VkSemaphore renderFinished, uint32_t *imageIndex) {
 
-  VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
-  submitInfo.signalSemaphoreCount = 1;
-  submitInfo.pSignalSemaphores = signalSemaphores;
-
-  vkResetFences(device.device(), 1, &inFlightFences[currentFrame]);
-  if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) !=
-      VK_SUCCESS) {
-    throw std::runtime_error("failed to submit draw command buffer!");
-  }
+  if (offscreen) return VK_SUCCESS;
 
   VkPresentInfoKHR presentInfo = {};
   presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
   presentInfo.waitSemaphoreCount = 1;
-  presentInfo.pWaitSemaphores = signalSemaphores;
+  presentInfo.pWaitSemaphores = &renderFinished;
 
   VkSwapchainKHR swapChains[] = {swapChain};
   presentInfo.swapchainCount = 1;
@@ -169,11 +143,7 @@ VkResult SwapChain::submitCommandBuffers(const VkCommandBuffer *buffers, uint32_
 
   presentInfo.pImageIndices = imageIndex;
 
-  auto result = vkQueuePresentKHR(device.presentQueue(), &presentInfo);
-
-  currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
-
-  return result;
+  return device.queuePresent(presentInfo);
 }
 
 void SwapChain::createSwapChain() {
@@ -200,7 +170,8 @@ void SwapChain::createSwapChain() {
   createInfo.imageColorSpace = surfaceFormat.colorSpace;
   createInfo.imageExtent = extent;
   createInfo.imageArrayLayers = 1;
-  createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+  // Transfer dst for LightingPath::Compute, it blits its result in
+  createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 
   QueueFamilyIndices indices = device.findPhysicalQueueFamilies();
   uint32_t queueFamilyIndices[] = {indices.graphicsFamily, indices.presentFamily};
@@ -219,9 +190,9 @@ void SwapChain::createSwapChain() {
   createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 
   createInfo.presentMode = presentMode;
+  swapChainPresentMode = presentMode;
   createInfo.clipped = VK_TRUE;
 
-  vkDeviceWaitIdle(device.device());
   createInfo.oldSwapchain = oldSwapChain == nullptr ? VK_NULL_HANDLE : oldSwapChain->swapChain;
 
   if (vkCreateSwapchainKHR(device.device(), &createInfo, nullptr, &swapChain) != VK_SUCCESS) {
@@ -234,12 +205,49 @@ void SwapChain::createSwapChain() {
   // retrieve the handles.
   vkGetSwapchainImagesKHR(device.device(), swapChain, &imageCount, nullptr);
   swapChainImages.resize(imageCount);
-  // vkGetSwapchainImagesKHR(device.device(), swapChain, &imageCount, swapChainImages.data());
+  vkGetSwapchainImagesKHR(device.device(), swapChain, &imageCount, swapChainImages.data());
 
   swapChainImageFormat = surfaceFormat.format;
   swapChainExtent = extent;
 }
 
+void SwapChain::createOffscreenImages() {
+  offscreen = true;
+
+  // Same formats a surface would usually offer. Blitted into by the compute lighting and the
+  // upscaler, copied out of for frame dumps.
+  swapChainImageFormat = device.findSupportedFormat(
+      {VK_FORMAT_B8G8R8A8_SRGB, VK_FORMAT_R8G8B8A8_SRGB},
+      VK_IMAGE_TILING_OPTIMAL,
+      VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_TRANSFER_SRC_BIT);
+  swapChainExtent = windowExtent;
+
+  // Nothing waits on a display
+  swapChainPresentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+
+  swapChainImages.resize(MAX_FRAMES_IN_FLIGHT);
+  offscreenImageMemorys.resize(MAX_FRAMES_IN_FLIGHT);
+
+  for (size_t i = 0; i < swapChainImages.size(); i++) {
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent.width = swapChainExtent.width;
+    imageInfo.extent.height = swapChainExtent.height;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = swapChainImageFormat;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, swapChainImages[i], offscreenImageMemorys[i]);
+  }
+}
+
 void SwapChain::createImageViews() {
 
   swapChainImageViews.resize(swapChainImages.size());
@@ -698,30 +706,6 @@ void SwapChain::createDefferedFramebuffers() {
 }
 
 
-void SwapChain::createSyncObjects() {
-  imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-  renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-  inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-  imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
-
-  VkSemaphoreCreateInfo semaphoreInfo = {};
-  semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-
-  VkFenceCreateInfo fenceInfo = {};
-  fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-  fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) !=
-            VK_SUCCESS ||
-        vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) !=
-            VK_SUCCESS ||
-        vkCreateFence(device.device(), &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
-      throw std::runtime_error("failed to create synchronization objects for a frame!");
-    }
-  }
-}
-
 VkSurfaceFormatKHR SwapChain::chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR> &availableFormats) {
 
   for (const auto &availableFormat : availableFormats) {
@@ -736,24 +720,33 @@ VkSurfaceFormatKHR SwapChain::chooseSwapSurfaceFormat(const std::vector<VkSurfac
 
 VkPresentModeKHR SwapChain::chooseSwapPresentMode(const std::vector<VkPresentModeKHR> &availablePresentModes) {
 
-  // for (const auto &availablePresentMode : availablePresentModes) {
+  auto isAvailable = [&](VkPresentModeKHR mode) {
+    return std::find(availablePresentModes.begin(), availablePresentModes.end(), mode) != availablePresentModes.end();
+  };
 
-  //   if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-  //     std::cout << "Present mode: Mailbox" << std::endl;
-  //     return availablePresentMode;
-  //   }
+  VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
 
-  // }
-
-  for (const auto &availablePresentMode : availablePresentModes) {
-    if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-      std::cout << "Present mode: Immediate" << std::endl;
-      return availablePresentMode;
-    }
+  if (isAvailable(preferredPresentMode)) {
+    presentMode = preferredPresentMode;
+  }
+  // Asked for the lowest latency, mailbox is the closest without tearing
+  else if (preferredPresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR && isAvailable(VK_PRESENT_MODE_MAILBOX_KHR)) {
+    presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
   }
+  // Anything else falls back to FIFO, always supported and never tears
 
-  std::cout << "Present mode: V-Sync" << std::endl;
-  return VK_PRESENT_MODE_FIFO_KHR;
+  std::cout << "Present mode: " << presentModeName(presentMode) << std::endl;
+  return presentMode;
+}
+
+const char *SwapChain::presentModeName(VkPresentModeKHR mode) {
+  switch (mode) {
+    case VK_PRESENT_MODE_IMMEDIATE_KHR: return "Immediate";
+    case VK_PRESENT_MODE_MAILBOX_KHR: return "Mailbox";
+    case VK_PRESENT_MODE_FIFO_KHR: return "V-Sync";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "V-Sync (relaxed)";
+    default: return "Unknown";
+  }
 }
 
 VkExtent2D SwapChain::chooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities) {
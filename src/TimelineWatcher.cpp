@@ -0,0 +1,87 @@
+#include "TimelineWatcher.hpp"
+
+namespace Orasis {
+
+    namespace {
+
+        // Bounds how late a waiter for a smaller value than the one being waited on is noticed
+        constexpr uint64_t WAIT_SLICE_NS = 2'000'000;
+
+    }
+
+    TimelineWatcher::TimelineWatcher(Device& device, JobSystem& jobs)
+    : m_device{device}, m_jobs{jobs}
+    {
+        m_thread = std::thread(&TimelineWatcher::watchLoop, this);
+    }
+
+    TimelineWatcher::~TimelineWatcher()
+    {
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_stopping = true;
+        }
+
+        m_changed.notify_all();
+        m_thread.join();
+
+        // Whatever is still suspended on us gets finished, leaking the frames would be worse
+        while (!m_waiters.empty())
+        {
+            Waiter waiter = m_waiters.top();
+            m_waiters.pop();
+
+            m_device.waitForTimeline(waiter.value);
+            m_jobs.run([handle = waiter.handle] { handle.resume(); });
+        }
+    }
+
+    void TimelineWatcher::enqueue(uint64_t value, std::coroutine_handle<> handle)
+    {
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_waiters.push({value, handle});
+        }
+
+        m_changed.notify_one();
+    }
+
+    void TimelineWatcher::watchLoop()
+    {
+        while (true)
+        {
+            uint64_t target;
+
+            {
+                std::unique_lock<std::mutex> lock{m_mutex};
+                m_changed.wait(lock, [&] { return m_stopping || !m_waiters.empty(); });
+
+                if (m_stopping) return;
+
+                target = m_waiters.top().value;
+            }
+
+            // Timeline values complete in order, everything below target is done by then too
+            m_device.waitForTimeline(target, WAIT_SLICE_NS);
+
+            for (std::coroutine_handle<> handle : takeCompleted(m_device.completedTimelineValue()))
+                m_jobs.run([handle] { handle.resume(); });
+        }
+    }
+
+    std::vector<std::coroutine_handle<>> TimelineWatcher::takeCompleted(uint64_t completedValue)
+    {
+        std::vector<std::coroutine_handle<>> ready;
+
+        std::lock_guard<std::mutex> lock{m_mutex};
+
+        while (!m_waiters.empty() && m_waiters.top().value <= completedValue)
+        {
+            ready.push_back(m_waiters.top().handle);
+            m_waiters.pop();
+        }
+
+        return ready;
+    }
+
+}
@@ -0,0 +1,241 @@
+#include "TransformBatch.hpp"
+
+// std
+#include <cmath>
+#include <stdexcept>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+    #define ORASIS_X86 1
+    #include <emmintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+        #include <immintrin.h>
+    #endif
+#endif
+
+namespace Orasis {
+
+    // Lives in TransformBatchAVX2.cpp, the only file built with AVX2 flags.
+    // Returns how many objects it handled (always a multiple of 8).
+    size_t composeTransformsAVX2(const float* const in[9], size_t count, float* model, float* normal);
+
+}
+
+namespace {
+
+    void composeScalar(const float* const in[9], size_t begin, size_t end, float* model, float* normal)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            const float c3 = std::cos(in[5][i]);
+            const float s3 = std::sin(in[5][i]);
+            const float c2 = std::cos(in[3][i]);
+            const float s2 = std::sin(in[3][i]);
+            const float c1 = std::cos(in[4][i]);
+            const float s1 = std::sin(in[4][i]);
+
+            const float r[9] = {
+                c1 * c3 + s1 * s2 * s3, c2 * s3, c1 * s2 * s3 - c3 * s1,
+                c3 * s1 * s2 - c1 * s3, c2 * c3, c1 * c3 * s2 + s1 * s3,
+                c2 * s1,                -s2,     c1 * c2,
+            };
+
+            const float scale[3] = {in[6][i], in[7][i], in[8][i]};
+
+            float* dst = model + i * 16;
+
+            for (int col = 0; col < 3; col++)
+            {
+                dst[col * 4 + 0] = scale[col] * r[col * 3 + 0];
+                dst[col * 4 + 1] = scale[col] * r[col * 3 + 1];
+                dst[col * 4 + 2] = scale[col] * r[col * 3 + 2];
+                dst[col * 4 + 3] = 0.f;
+            }
+
+            dst[12] = in[0][i];
+            dst[13] = in[1][i];
+            dst[14] = in[2][i];
+            dst[15] = 1.f;
+
+            if (normal == nullptr) continue;
+
+            float* ndst = normal + i * 9;
+
+            for (int col = 0; col < 3; col++)
+            {
+                const float inverseScale = 1.f / scale[col];
+                ndst[col * 3 + 0] = inverseScale * r[col * 3 + 0];
+                ndst[col * 3 + 1] = inverseScale * r[col * 3 + 1];
+                ndst[col * 3 + 2] = inverseScale * r[col * 3 + 2];
+            }
+        }
+    }
+
+}
+
+#ifdef ORASIS_X86
+
+#include "TransformBatchKernel.inl"
+
+namespace {
+
+    struct OpsSSE2 {
+
+        using V = __m128;
+        using I = __m128i;
+        static constexpr size_t width = 4;
+
+        static V load(const float* p) { return _mm_loadu_ps(p); }
+        static V set1(float f) { return _mm_set1_ps(f); }
+        static I set1I(int32_t i) { return _mm_set1_epi32(i); }
+
+        static V add(V a, V b) { return _mm_add_ps(a, b); }
+        static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+        static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+        static V div(V a, V b) { return _mm_div_ps(a, b); }
+        static V fmadd(V a, V b, V c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+
+        static V andV(V a, V b) { return _mm_and_ps(a, b); }
+        static V andNotV(V a, V b) { return _mm_andnot_ps(a, b); }
+        static V orV(V a, V b) { return _mm_or_ps(a, b); }
+        static V xorV(V a, V b) { return _mm_xor_ps(a, b); }
+
+        static I cvtt(V a) { return _mm_cvttps_epi32(a); }
+        static V cvt(I a) { return _mm_cvtepi32_ps(a); }
+        static V castI(I a) { return _mm_castsi128_ps(a); }
+        static I addI(I a, I b) { return _mm_add_epi32(a, b); }
+        static I subI(I a, I b) { return _mm_sub_epi32(a, b); }
+        static I andI(I a, I b) { return _mm_and_si128(a, b); }
+        static I andNotI(I a, I b) { return _mm_andnot_si128(a, b); }
+        static I cmpEqI(I a, I b) { return _mm_cmpeq_epi32(a, b); }
+        static I shiftLeft29(I a) { return _mm_slli_epi32(a, 29); }
+
+        // c0..c3 hold one column element for 4 objects, writes that column for each of them
+        static void storeColumns(float* dst, V c0, V c1, V c2, V c3)
+        {
+            _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+            _mm_storeu_ps(dst + 0,  c0);
+            _mm_storeu_ps(dst + 16, c1);
+            _mm_storeu_ps(dst + 32, c2);
+            _mm_storeu_ps(dst + 48, c3);
+        }
+
+        static void storeTriples(float* dst, V c0, V c1, V c2)
+        {
+            alignas(16) float lanes[3][4];
+            _mm_store_ps(lanes[0], c0);
+            _mm_store_ps(lanes[1], c1);
+            _mm_store_ps(lanes[2], c2);
+
+            for (size_t lane = 0; lane < width; lane++)
+            {
+                dst[lane * 9 + 0] = lanes[0][lane];
+                dst[lane * 9 + 1] = lanes[1][lane];
+                dst[lane * 9 + 2] = lanes[2][lane];
+            }
+        }
+    };
+
+}
+
+#endif
+
+namespace Orasis {
+
+    void composeTransforms(const TransformSoA& transforms, glm::mat4* modelMatrices, glm::mat3* normalMatrices)
+    {
+        static const SimdLevel level = detectSimdLevel();
+        composeTransforms(transforms, modelMatrices, normalMatrices, level);
+    }
+
+    void composeTransforms(const TransformSoA& transforms, glm::mat4* modelMatrices, glm::mat3* normalMatrices, SimdLevel level)
+    {
+        composeTransforms(transforms, 0, transforms.size(), modelMatrices, normalMatrices, level);
+    }
+
+    void composeTransforms(const TransformSoA& transforms, size_t begin, size_t end, glm::mat4* modelMatrices, glm::mat3* normalMatrices)
+    {
+        static const SimdLevel level = detectSimdLevel();
+        composeTransforms(transforms, begin, end, modelMatrices, normalMatrices, level);
+    }
+
+    void composeTransforms(const TransformSoA& transforms, size_t begin, size_t end, glm::mat4* modelMatrices, glm::mat3* normalMatrices, SimdLevel level)
+    {
+        const size_t count = end - begin;
+
+        const float* const in[9] = {
+            transforms.tx.data() + begin, transforms.ty.data() + begin, transforms.tz.data() + begin,
+            transforms.rx.data() + begin, transforms.ry.data() + begin, transforms.rz.data() + begin,
+            transforms.sx.data() + begin, transforms.sy.data() + begin, transforms.sz.data() + begin,
+        };
+
+        float* model = &modelMatrices[begin][0][0];
+        float* normal = normalMatrices ? &normalMatrices[begin][0][0] : nullptr;
+
+        size_t done = 0;
+
+#ifdef ORASIS_X86
+        if (level == SimdLevel::AVX2)
+            done = composeTransformsAVX2(in, count, model, normal);
+
+        if (level != SimdLevel::Scalar)
+        {
+            size_t stop = done + (count - done) / OpsSSE2::width * OpsSSE2::width;
+            composeKernel<OpsSSE2>(in, done, stop, model, normal);
+            done = stop;
+        }
+#else
+        (void)level;
+#endif
+
+        composeScalar(in, done, count, model, normal);
+    }
+
+
+
+    SimdLevel detectSimdLevel()
+    {
+#ifdef ORASIS_X86
+    #if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 1);
+
+        const bool fma     = (info[2] & (1 << 12)) != 0;
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const bool avx     = (info[2] & (1 << 28)) != 0;
+
+        // The OS has to save the ymm registers on context switches
+        const bool ymmEnabled = osxsave && avx && (_xgetbv(0) & 0x6) == 0x6;
+
+        __cpuidex(info, 7, 0);
+        const bool avx2 = (info[1] & (1 << 5)) != 0;
+
+        if (ymmEnabled && avx2 && fma)
+            return SimdLevel::AVX2;
+    #else
+        __builtin_cpu_init();
+
+        // __builtin_cpu_supports already checks the OS support for ymm state
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+            return SimdLevel::AVX2;
+    #endif
+        // SSE2 is part of the x86-64 baseline
+        return SimdLevel::SSE2;
+#else
+        return SimdLevel::Scalar;
+#endif
+    }
+
+    const char* simdLevelName(SimdLevel level)
+    {
+        switch (level)
+        {
+            case SimdLevel::Scalar: return "Scalar";
+            case SimdLevel::SSE2:   return "SSE2";
+            case SimdLevel::AVX2:   return "AVX2";
+        }
+
+        throw std::runtime_error("Unknown SimdLevel");
+    }
+
+}
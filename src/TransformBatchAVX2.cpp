@@ -0,0 +1,103 @@
+// Built with /arch:AVX2 (MSVC) or -mavx2 -mfma, see CMakelists.txt.
+// Only called after detectSimdLevel() reported AVX2 + FMA, nothing else may live in this file.
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+#include "TransformBatchKernel.inl"
+
+namespace {
+
+    struct OpsAVX2 {
+
+        using V = __m256;
+        using I = __m256i;
+        static constexpr size_t width = 8;
+
+        static V load(const float* p) { return _mm256_loadu_ps(p); }
+        static V set1(float f) { return _mm256_set1_ps(f); }
+        static I set1I(int32_t i) { return _mm256_set1_epi32(i); }
+
+        static V add(V a, V b) { return _mm256_add_ps(a, b); }
+        static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+        static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+        static V div(V a, V b) { return _mm256_div_ps(a, b); }
+        static V fmadd(V a, V b, V c) { return _mm256_fmadd_ps(a, b, c); }
+
+        static V andV(V a, V b) { return _mm256_and_ps(a, b); }
+        static V andNotV(V a, V b) { return _mm256_andnot_ps(a, b); }
+        static V orV(V a, V b) { return _mm256_or_ps(a, b); }
+        static V xorV(V a, V b) { return _mm256_xor_ps(a, b); }
+
+        static I cvtt(V a) { return _mm256_cvttps_epi32(a); }
+        static V cvt(I a) { return _mm256_cvtepi32_ps(a); }
+        static V castI(I a) { return _mm256_castsi256_ps(a); }
+        static I addI(I a, I b) { return _mm256_add_epi32(a, b); }
+        static I subI(I a, I b) { return _mm256_sub_epi32(a, b); }
+        static I andI(I a, I b) { return _mm256_and_si256(a, b); }
+        static I andNotI(I a, I b) { return _mm256_andnot_si256(a, b); }
+        static I cmpEqI(I a, I b) { return _mm256_cmpeq_epi32(a, b); }
+        static I shiftLeft29(I a) { return _mm256_slli_epi32(a, 29); }
+
+        // Transposes each 128 bit half on its own, lanes 0-3 and 4-7 are separate objects
+        static void storeColumns(float* dst, V c0, V c1, V c2, V c3)
+        {
+            __m128 lo0 = _mm256_castps256_ps128(c0), hi0 = _mm256_extractf128_ps(c0, 1);
+            __m128 lo1 = _mm256_castps256_ps128(c1), hi1 = _mm256_extractf128_ps(c1, 1);
+            __m128 lo2 = _mm256_castps256_ps128(c2), hi2 = _mm256_extractf128_ps(c2, 1);
+            __m128 lo3 = _mm256_castps256_ps128(c3), hi3 = _mm256_extractf128_ps(c3, 1);
+
+            _MM_TRANSPOSE4_PS(lo0, lo1, lo2, lo3);
+            _MM_TRANSPOSE4_PS(hi0, hi1, hi2, hi3);
+
+            _mm_storeu_ps(dst + 0,   lo0);
+            _mm_storeu_ps(dst + 16,  lo1);
+            _mm_storeu_ps(dst + 32,  lo2);
+            _mm_storeu_ps(dst + 48,  lo3);
+            _mm_storeu_ps(dst + 64,  hi0);
+            _mm_storeu_ps(dst + 80,  hi1);
+            _mm_storeu_ps(dst + 96,  hi2);
+            _mm_storeu_ps(dst + 112, hi3);
+        }
+
+        static void storeTriples(float* dst, V c0, V c1, V c2)
+        {
+            alignas(32) float lanes[3][8];
+            _mm256_store_ps(lanes[0], c0);
+            _mm256_store_ps(lanes[1], c1);
+            _mm256_store_ps(lanes[2], c2);
+
+            for (size_t lane = 0; lane < width; lane++)
+            {
+                dst[lane * 9 + 0] = lanes[0][lane];
+                dst[lane * 9 + 1] = lanes[1][lane];
+                dst[lane * 9 + 2] = lanes[2][lane];
+            }
+        }
+    };
+
+}
+
+namespace Orasis {
+
+    size_t composeTransformsAVX2(const float* const in[9], size_t count, float* model, float* normal)
+    {
+        size_t end = count / OpsAVX2::width * OpsAVX2::width;
+        composeKernel<OpsAVX2>(in, 0, end, model, normal);
+        return end;
+    }
+
+}
+
+#else
+
+#include <cstddef>
+
+namespace Orasis {
+
+    size_t composeTransformsAVX2(const float* const[9], size_t, float*, float*) { return 0; }
+
+}
+
+#endif
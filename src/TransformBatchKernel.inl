@@ -0,0 +1,118 @@
+// Shared body of the SIMD transform kernels.
+//
+// Included by TransformBatch.cpp (SSE2) and TransformBatchAVX2.cpp (built with AVX2/FMA flags).
+// Everything in here has internal linkage and only touches intrinsics and raw floats, so the
+// AVX2 translation unit can never hand an AVX2 encoded inline function to the rest of the engine.
+
+#include <cstddef>
+#include <cstdint>
+
+namespace {
+
+    // Cephes style single precision sin/cos, good to about 1e-7 for |x| < 8192
+    template<typename Ops>
+    inline void sinCos(typename Ops::V x, typename Ops::V& outSin, typename Ops::V& outCos)
+    {
+        using V = typename Ops::V;
+        using I = typename Ops::I;
+
+        V signBitSin = Ops::andV(x, Ops::castI(Ops::set1I(static_cast<int32_t>(0x80000000))));
+        x = Ops::andV(x, Ops::castI(Ops::set1I(0x7fffffff)));
+
+        // Scale by 4/pi and round to an even octant
+        V y = Ops::mul(x, Ops::set1(1.27323954473516f));
+        I octant = Ops::cvtt(y);
+        octant = Ops::addI(octant, Ops::set1I(1));
+        octant = Ops::andI(octant, Ops::set1I(~1));
+        y = Ops::cvt(octant);
+
+        V swapSignSin = Ops::castI(Ops::shiftLeft29(Ops::andI(octant, Ops::set1I(4))));
+        V polyMask = Ops::castI(Ops::cmpEqI(Ops::andI(octant, Ops::set1I(2)), Ops::set1I(0)));
+        V signBitCos = Ops::castI(Ops::shiftLeft29(Ops::andNotI(Ops::subI(octant, Ops::set1I(2)), Ops::set1I(4))));
+
+        // Extended precision modular arithmetic, x - y * pi/4
+        x = Ops::fmadd(y, Ops::set1(-0.78515625f), x);
+        x = Ops::fmadd(y, Ops::set1(-2.4187564849853515625e-4f), x);
+        x = Ops::fmadd(y, Ops::set1(-3.77489497744594108e-8f), x);
+
+        signBitSin = Ops::xorV(signBitSin, swapSignSin);
+
+        V z = Ops::mul(x, x);
+
+        V cosPoly = Ops::set1(2.443315711809948e-5f);
+        cosPoly = Ops::fmadd(cosPoly, z, Ops::set1(-1.388731625493765e-3f));
+        cosPoly = Ops::fmadd(cosPoly, z, Ops::set1(4.166664568298827e-2f));
+        cosPoly = Ops::mul(Ops::mul(cosPoly, z), z);
+        cosPoly = Ops::fmadd(z, Ops::set1(-0.5f), cosPoly);
+        cosPoly = Ops::add(cosPoly, Ops::set1(1.f));
+
+        V sinPoly = Ops::set1(-1.9515295891e-4f);
+        sinPoly = Ops::fmadd(sinPoly, z, Ops::set1(8.3321608736e-3f));
+        sinPoly = Ops::fmadd(sinPoly, z, Ops::set1(-1.6666654611e-1f));
+        sinPoly = Ops::fmadd(Ops::mul(sinPoly, z), x, x);
+
+        // Pick the right polynomial for each lane
+        V sinResult = Ops::orV(Ops::andV(polyMask, sinPoly), Ops::andNotV(polyMask, cosPoly));
+        V cosResult = Ops::orV(Ops::andV(polyMask, cosPoly), Ops::andNotV(polyMask, sinPoly));
+
+        outSin = Ops::xorV(sinResult, signBitSin);
+        outCos = Ops::xorV(cosResult, signBitCos);
+    }
+
+
+    // in -> tx, ty, tz, rx, ry, rz, sx, sy, sz. Processes [begin, end) where the range is a
+    // multiple of Ops::width, the caller finishes the tail with the scalar path.
+    template<typename Ops>
+    void composeKernel(const float* const in[9], size_t begin, size_t end, float* model, float* normal)
+    {
+        using V = typename Ops::V;
+
+        const V zero = Ops::set1(0.f);
+        const V one = Ops::set1(1.f);
+
+        for (size_t i = begin; i < end; i += Ops::width)
+        {
+            V tx = Ops::load(in[0] + i), ty = Ops::load(in[1] + i), tz = Ops::load(in[2] + i);
+            V sx = Ops::load(in[6] + i), sy = Ops::load(in[7] + i), sz = Ops::load(in[8] + i);
+
+            // Same naming as TransformComponent::mat4(): 1 -> y, 2 -> x, 3 -> z
+            V s1, c1, s2, c2, s3, c3;
+            sinCos<Ops>(Ops::load(in[4] + i), s1, c1);
+            sinCos<Ops>(Ops::load(in[3] + i), s2, c2);
+            sinCos<Ops>(Ops::load(in[5] + i), s3, c3);
+
+            V s1s2 = Ops::mul(s1, s2);
+            V c1s2 = Ops::mul(c1, s2);
+
+            // Rotation columns before scaling
+            V r00 = Ops::fmadd(s1s2, s3, Ops::mul(c1, c3));
+            V r01 = Ops::mul(c2, s3);
+            V r02 = Ops::sub(Ops::mul(c1s2, s3), Ops::mul(c3, s1));
+
+            V r10 = Ops::sub(Ops::mul(c3, s1s2), Ops::mul(c1, s3));
+            V r11 = Ops::mul(c2, c3);
+            V r12 = Ops::fmadd(c1s2, c3, Ops::mul(s1, s3));
+
+            V r20 = Ops::mul(c2, s1);
+            V r21 = Ops::sub(zero, s2);
+            V r22 = Ops::mul(c1, c2);
+
+            float* dst = model + i * 16;
+            Ops::storeColumns(dst + 0,  Ops::mul(sx, r00), Ops::mul(sx, r01), Ops::mul(sx, r02), zero);
+            Ops::storeColumns(dst + 4,  Ops::mul(sy, r10), Ops::mul(sy, r11), Ops::mul(sy, r12), zero);
+            Ops::storeColumns(dst + 8,  Ops::mul(sz, r20), Ops::mul(sz, r21), Ops::mul(sz, r22), zero);
+            Ops::storeColumns(dst + 12, tx, ty, tz, one);
+
+            if (normal == nullptr) continue;
+
+            // inverse transpose of R * S is R * S^-1
+            V isx = Ops::div(one, sx), isy = Ops::div(one, sy), isz = Ops::div(one, sz);
+
+            float* ndst = normal + i * 9;
+            Ops::storeTriples(ndst + 0, Ops::mul(isx, r00), Ops::mul(isx, r01), Ops::mul(isx, r02));
+            Ops::storeTriples(ndst + 3, Ops::mul(isy, r10), Ops::mul(isy, r11), Ops::mul(isy, r12));
+            Ops::storeTriples(ndst + 6, Ops::mul(isz, r20), Ops::mul(isz, r21), Ops::mul(isz, r22));
+        }
+    }
+
+}
@@ -0,0 +1,255 @@
+#include "TransformHierarchy.hpp"
+#include "JobSystem.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace Orasis {
+
+    void TransformHierarchy::add(GameObject& object, uint32_t parentId)
+    {
+        GameObject::uint id = object.getID();
+
+        if (id >= m_slotOf.size())
+        {
+            m_slotOf.resize(id + 1, noParent);
+            m_parentOf.resize(id + 1, noParent);
+            m_isDirty.resize(id + 1, 0);
+        }
+
+        assert(m_slotOf[id] == noParent && "Object already in the transform hierarchy");
+
+        // Appending keeps the order valid for roots, children get sorted on the next update
+        uint32_t slot = static_cast<uint32_t>(m_objects.size());
+
+        m_slotOf[id] = slot;
+        m_parentOf[id] = parentId;
+
+        m_objects.push_back(&object);
+        m_parentSlot.push_back(parentId == noParent ? noParent : m_slotOf[parentId]);
+        m_subtreeEnd.push_back(slot + 1);
+        m_local.emplace_back(1.f);
+        m_world.emplace_back(1.f);
+
+        if (parentId != noParent)
+            m_orderDirty = true;
+
+        markDirty(id);
+    }
+
+    void TransformHierarchy::remove(GameObject::uint id)
+    {
+        assert(contains(id));
+
+        // Children become roots and keep their local transform
+        for (uint32_t childId = 0; childId < m_parentOf.size(); childId++)
+            if (m_parentOf[childId] == id && contains(childId))
+            {
+                m_parentOf[childId] = noParent;
+                markDirty(childId);
+            }
+
+        uint32_t slot = m_slotOf[id];
+
+        m_objects.erase(m_objects.begin() + slot);
+        m_parentSlot.erase(m_parentSlot.begin() + slot);
+        m_subtreeEnd.erase(m_subtreeEnd.begin() + slot);
+        m_local.erase(m_local.begin() + slot);
+        m_world.erase(m_world.begin() + slot);
+
+        m_slotOf[id] = noParent;
+        m_parentOf[id] = noParent;
+
+        for (uint32_t s = slot; s < m_objects.size(); s++)
+            m_slotOf[m_objects[s]->getID()] = s;
+
+        m_orderDirty = true;
+    }
+
+    void TransformHierarchy::setParent(GameObject::uint id, uint32_t parentId)
+    {
+        assert(contains(id));
+        assert(parentId == noParent || contains(parentId));
+
+        if (m_parentOf[id] == parentId) return;
+
+        // Refuse cycles, the new parent can't be a descendant of the object
+        for (uint32_t ancestor = parentId; ancestor != noParent; ancestor = m_parentOf[ancestor])
+            if (ancestor == id)
+                throw std::runtime_error("setParent would create a cycle in the transform hierarchy");
+
+        m_parentOf[id] = parentId;
+        m_orderDirty = true;
+        markDirty(id);
+    }
+
+    void TransformHierarchy::markDirty(GameObject::uint id)
+    {
+        if (m_isDirty[id]) return;
+
+        m_isDirty[id] = 1;
+        m_dirtyObjects.push_back(id);
+    }
+
+    const std::vector<TransformHierarchy::Change>& TransformHierarchy::update()
+    {
+        m_changes.clear();
+
+        if (m_orderDirty)
+            rebuildOrder();
+
+        if (m_dirtyObjects.empty())
+            return m_changes;
+
+        computeLocalMatrices();
+
+        // Walk every dirty subtree once, in slot order so nested dirty objects are skipped
+        std::sort(m_dirtySlots.begin(), m_dirtySlots.end());
+
+        uint32_t coveredUntil = 0;
+
+        for (uint32_t dirtySlot : m_dirtySlots)
+        {
+            if (dirtySlot < coveredUntil) continue;
+
+            for (uint32_t slot = dirtySlot; slot < m_subtreeEnd[dirtySlot]; slot++)
+            {
+                uint32_t parent = m_parentSlot[slot];
+                glm::vec3 previousPosition{m_world[slot][3]};
+
+                m_world[slot] = parent == noParent ? m_local[slot] : m_world[parent] * m_local[slot];
+
+                GameObject* object = m_objects[slot];
+                object->transform.worldMatrix = m_world[slot];
+
+                m_changes.push_back({object->getID(), glm::vec3{m_world[slot][3]} - previousPosition});
+            }
+
+            coveredUntil = m_subtreeEnd[dirtySlot];
+        }
+
+        m_dirtySlots.clear();
+
+        return m_changes;
+    }
+
+    void TransformHierarchy::computeLocalMatrices()
+    {
+        // Gather the dirty TRS into SoA form so the batch kernel can do them N at a time
+        m_batchInput.clear();
+
+        for (GameObject::uint id : m_dirtyObjects)
+        {
+            m_isDirty[id] = 0;
+
+            if (!contains(id)) continue;
+
+            uint32_t slot = m_slotOf[id];
+            const TransformComponent& transform = m_objects[slot]->transform;
+
+            m_batchInput.push(transform.translation, transform.rotation, transform.scale);
+            m_dirtySlots.push_back(slot);
+        }
+
+        m_dirtyObjects.clear();
+
+        const size_t count = m_dirtySlots.size();
+        m_batchOutput.resize(count);
+
+        // Below a few thousand objects the kernel is done before a job would even be stolen
+        constexpr size_t parallelThreshold = 4096;
+        constexpr size_t grain = 1024;
+
+        auto compose = [this](size_t begin, size_t end) {
+            composeTransforms(m_batchInput, begin, end, m_batchOutput.data());
+
+            for (size_t i = begin; i < end; i++)
+                m_local[m_dirtySlots[i]] = m_batchOutput[i];
+        };
+
+        if (m_jobs && count >= parallelThreshold)
+            m_jobs->parallelFor(0, count, grain, compose);
+        else
+            compose(0, count);
+    }
+
+    void TransformHierarchy::rebuildOrder()
+    {
+        m_orderDirty = false;
+
+        size_t count = m_objects.size();
+
+        // Children lists in the current slot order, keeps the rebuild stable
+        std::vector<std::vector<uint32_t>> children(count);
+        std::vector<uint32_t> roots;
+
+        for (uint32_t slot = 0; slot < count; slot++)
+        {
+            uint32_t parentId = m_parentOf[m_objects[slot]->getID()];
+
+            if (parentId == noParent)
+                roots.push_back(slot);
+            else
+                children[m_slotOf[parentId]].push_back(slot);
+        }
+
+        // Depth first so every subtree ends up contiguous
+        std::vector<uint32_t> order;
+        order.reserve(count);
+
+        std::vector<uint32_t> stack;
+
+        for (auto it = roots.rbegin(); it != roots.rend(); ++it)
+            stack.push_back(*it);
+
+        while (!stack.empty())
+        {
+            uint32_t slot = stack.back();
+            stack.pop_back();
+            order.push_back(slot);
+
+            for (auto it = children[slot].rbegin(); it != children[slot].rend(); ++it)
+                stack.push_back(*it);
+        }
+
+        assert(order.size() == count);
+
+        std::vector<GameObject*> objects(count);
+        std::vector<glm::mat4> local(count), world(count);
+
+        for (uint32_t newSlot = 0; newSlot < count; newSlot++)
+        {
+            uint32_t oldSlot = order[newSlot];
+            objects[newSlot] = m_objects[oldSlot];
+            local[newSlot] = m_local[oldSlot];
+            world[newSlot] = m_world[oldSlot];
+        }
+
+        m_objects = std::move(objects);
+        m_local = std::move(local);
+        m_world = std::move(world);
+
+        for (uint32_t slot = 0; slot < count; slot++)
+            m_slotOf[m_objects[slot]->getID()] = slot;
+
+        for (uint32_t slot = 0; slot < count; slot++)
+        {
+            uint32_t parentId = m_parentOf[m_objects[slot]->getID()];
+            m_parentSlot[slot] = parentId == noParent ? noParent : m_slotOf[parentId];
+        }
+
+        // Subtree ends, children always sit after their parent so one backwards pass is enough
+        for (uint32_t slot = 0; slot < count; slot++)
+            m_subtreeEnd[slot] = slot + 1;
+
+        for (uint32_t slot = static_cast<uint32_t>(count); slot-- > 0;)
+        {
+            uint32_t parent = m_parentSlot[slot];
+            if (parent != noParent)
+                m_subtreeEnd[parent] = std::max(m_subtreeEnd[parent], m_subtreeEnd[slot]);
+        }
+    }
+
+}
@@ -0,0 +1,251 @@
+#include "TestCommon.hpp"
+
+#include "JobSystem.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using Orasis::JobCounter;
+using Orasis::JobSystem;
+
+namespace {
+
+    void runAndWait()
+    {
+        JobSystem jobs{3, false};
+        JobCounter counter;
+        std::atomic<uint32_t> ran{0};
+
+        for (int i = 0; i < 1000; i++)
+            jobs.run([&] { ran.fetch_add(1, std::memory_order_relaxed); }, &counter);
+
+        jobs.wait(counter);
+
+        ORASIS_CHECK(counter.isDone());
+        ORASIS_CHECK(ran.load() == 1000);
+
+        // Jobs spawning jobs on the same counter
+        for (int i = 0; i < 10; i++)
+            jobs.run([&] {
+                for (int j = 0; j < 10; j++)
+                    jobs.run([&] { ran.fetch_add(1, std::memory_order_relaxed); }, &counter);
+            }, &counter);
+
+        jobs.wait(counter);
+
+        ORASIS_CHECK(ran.load() == 1100);
+    }
+
+    void continuations()
+    {
+        JobSystem jobs{3, false};
+
+        for (int round = 0; round < 200; round++)
+        {
+            JobCounter first;
+            JobCounter second;
+            JobCounter all;
+
+            std::atomic<uint32_t> firstDone{0};
+            std::atomic<bool> orderKept{true};
+            std::atomic<uint32_t> continued{0};
+
+            for (int i = 0; i < 16; i++)
+                jobs.run([&] { firstDone.fetch_add(1, std::memory_order_relaxed); }, &first);
+
+            // Several continuations on one counter, one of them chaining a second stage
+            for (int i = 0; i < 4; i++)
+                jobs.runAfter(first, [&] {
+                    if (firstDone.load(std::memory_order_relaxed) != 16)
+                        orderKept.store(false);
+                    continued.fetch_add(1, std::memory_order_relaxed);
+                }, &second);
+
+            jobs.runAfter(second, [&] {
+                if (continued.load(std::memory_order_relaxed) != 4)
+                    orderKept.store(false);
+            }, &all);
+
+            jobs.wait(all);
+
+            ORASIS_CHECK(orderKept.load());
+            ORASIS_CHECK(first.isDone() && second.isDone());
+        }
+
+        // A counter that's already done runs the continuation right away
+        JobCounter idle;
+        JobCounter after;
+        bool ran = false;
+
+        jobs.runAfter(idle, [&] { ran = true; }, &after);
+        jobs.wait(after);
+
+        ORASIS_CHECK(ran);
+    }
+
+    /*
+        The counter is destroyed the moment wait() returns, while the thread that finished the
+        last job may still be inside finish(). Run under ORASIS_TEST_SANITIZER=thread or address
+        a use after free shows up here.
+    */
+    void counterLifetime()
+    {
+        JobSystem jobs{3, false};
+
+        for (int round = 0; round < 20000; round++)
+        {
+            auto counter = std::make_unique<JobCounter>();
+            std::atomic<uint32_t> ran{0};
+
+            jobs.run([&] { ran.fetch_add(1, std::memory_order_relaxed); }, counter.get());
+            jobs.run([&] { ran.fetch_add(1, std::memory_order_relaxed); }, counter.get());
+            jobs.wait(*counter);
+
+            counter.reset();
+
+            if (ran.load() != 2)
+            {
+                ORASIS_CHECK(ran.load() == 2);
+                return;
+            }
+        }
+
+        // retain from the owner, release from a thread that isn't a worker
+        for (int round = 0; round < 2000; round++)
+        {
+            auto counter = std::make_unique<JobCounter>();
+
+            jobs.retain(*counter);
+            std::thread releaser([&] { jobs.release(*counter); });
+
+            jobs.wait(*counter);
+            counter.reset();
+
+            releaser.join();
+        }
+    }
+
+    // Every index in [begin, end) exactly once and nothing outside, whatever the split
+    void parallelForRanges(JobSystem& jobs)
+    {
+        struct Range { size_t begin, end, grain; };
+
+        const Range ranges[] = {
+            {0, 0, 16},
+            {5, 5, 1},
+            {7, 3, 1},
+            {0, 1, 1},
+            {0, 1000, 1},
+            {3, 1000, 7},
+            {17, 10007, 64},
+            {1, 100003, 1000},
+            {0, 12, 100},
+            {0, 129, 0},
+        };
+
+        const size_t size = 100003;
+        std::unique_ptr<std::atomic<uint32_t>[]> visits{new std::atomic<uint32_t>[size]};
+
+        for (const Range& range : ranges)
+        {
+            for (size_t i = 0; i < size; i++)
+                visits[i].store(0, std::memory_order_relaxed);
+
+            std::atomic<uint64_t> sum{0};
+            std::atomic<bool> grainKept{true};
+
+            jobs.parallelFor(range.begin, range.end, range.grain, [&](size_t begin, size_t end) {
+                if (begin >= end)
+                    grainKept.store(false);
+
+                uint64_t local = 0;
+                for (size_t i = begin; i < end; i++)
+                {
+                    visits[i].fetch_add(1, std::memory_order_relaxed);
+                    local += i;
+                }
+
+                sum.fetch_add(local, std::memory_order_relaxed);
+            });
+
+            bool exactlyOnce = true;
+            for (size_t i = 0; i < size; i++)
+            {
+                uint32_t expected = i >= range.begin && i < range.end ? 1 : 0;
+                exactlyOnce &= visits[i].load(std::memory_order_relaxed) == expected;
+            }
+
+            uint64_t expectedSum = 0;
+            if (range.end > range.begin)
+                expectedSum = (uint64_t(range.begin) + range.end - 1) * (range.end - range.begin) / 2;
+
+            ORASIS_CHECK(exactlyOnce);
+            ORASIS_CHECK(sum.load() == expectedSum);
+            ORASIS_CHECK(grainKept.load());
+        }
+    }
+
+    void parallelForCoverage()
+    {
+        JobSystem jobs{3, false};
+        parallelForRanges(jobs);
+    }
+
+    void parallelForSingleThread()
+    {
+        JobSystem jobs{1, false};
+        parallelForRanges(jobs);
+    }
+
+    // Submitted from a thread that isn't worker 0, goes through the injection queue
+    void parallelForFromOtherThread()
+    {
+        JobSystem jobs{3, false};
+        bool notWorker = true;
+
+        std::thread caller([&] {
+            notWorker = !jobs.isWorkerThread();
+            parallelForRanges(jobs);
+        });
+        caller.join();
+
+        ORASIS_CHECK(notWorker);
+    }
+
+    // Nested parallelFor from inside jobs, the inner waits help run the outer's work
+    void parallelForNested()
+    {
+        JobSystem jobs{3, false};
+        std::atomic<uint64_t> sum{0};
+
+        jobs.parallelFor(0, 64, 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+                jobs.parallelFor(0, 1000, 50, [&](size_t b, size_t e) {
+                    uint64_t local = 0;
+                    for (size_t j = b; j < e; j++)
+                        local += j;
+                    sum.fetch_add(local, std::memory_order_relaxed);
+                });
+        });
+
+        ORASIS_CHECK(sum.load() == 64ull * (999ull * 1000ull / 2));
+    }
+
+}
+
+int main()
+{
+    OrasisTest::run("run and wait", runAndWait);
+    OrasisTest::run("runAfter continuations", continuations);
+    OrasisTest::run("counter destroyed right after wait", counterLifetime);
+    OrasisTest::run("parallelFor uneven ranges", parallelForCoverage);
+    OrasisTest::run("parallelFor with one worker", parallelForSingleThread);
+    OrasisTest::run("parallelFor from a non-worker thread", parallelForFromOtherThread);
+    OrasisTest::run("nested parallelFor", parallelForNested);
+
+    return OrasisTest::finish();
+}
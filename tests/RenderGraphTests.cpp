@@ -0,0 +1,410 @@
+#include "TestCommon.hpp"
+
+#include "RenderGraph.hpp"
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace Orasis;
+
+/*
+    What compile() derives, no device needed. realize() and the recording aren't run, the entry
+    points RenderGraph.cpp calls are defined at the bottom so it links without a Vulkan loader.
+*/
+
+namespace {
+
+    using Usage = RenderGraph::Usage;
+    using PassType = RenderGraph::PassType;
+
+    struct FrameOptions {
+        bool computeLighting{false};
+        bool ambientOcclusion{false};
+        bool dynamicResolution{false};
+        bool occlusionCulling{false};
+    };
+
+    // Manager::describeFrame for the packed G-buffer
+    void describeFrame(RenderGraph& graph, const FrameOptions& options)
+    {
+        bool sceneColor = options.dynamicResolution && !options.computeLighting;
+
+        RenderGraph::Resource normal = graph.importImage("Normal", {VK_FORMAT_R16G16_SNORM});
+        RenderGraph::Resource albido = graph.importImage("Albido", {VK_FORMAT_R8G8B8A8_UNORM});
+        RenderGraph::Resource depth = graph.importImage("Depth", {VK_FORMAT_D32_SFLOAT, Attachment::Type::isDepth});
+        RenderGraph::Resource lit = sceneColor ? graph.importImage("SceneColor", {VK_FORMAT_R16G16B16A16_SFLOAT})
+                                               : graph.importImage("OutColor", {VK_FORMAT_B8G8R8A8_SRGB, Attachment::Type::isPresented});
+        RenderGraph::Resource outColor = sceneColor ? graph.importImage("OutColor", {VK_FORMAT_B8G8R8A8_SRGB, Attachment::Type::isPresented}) : lit;
+
+        graph.addPass("Geometry", PassType::Graphics)
+            .write(normal, Usage::ColorAttachment)
+            .write(albido, Usage::ColorAttachment)
+            .write(depth, Usage::DepthAttachment);
+
+        graph.addPass("Lighting", PassType::Graphics)
+            .read(normal, Usage::InputAttachment)
+            .read(albido, Usage::InputAttachment)
+            .read(depth, Usage::InputAttachment)
+            .write(lit, Usage::ColorAttachment);
+
+        if (options.occlusionCulling)
+            graph.addPass("DepthPyramid", PassType::Compute).read(depth, Usage::Sampled).keep();
+
+        RenderGraph::Resource ssaoBlurred = RenderGraph::invalidResource;
+
+        if (options.ambientOcclusion)
+        {
+            RenderGraph::Resource ssao = graph.createImage("SSAO", {VK_FORMAT_R16G16_SFLOAT, Attachment::Type::isColor, 2});
+            ssaoBlurred = graph.createImage("SSAOBlurred", {VK_FORMAT_R16G16_SFLOAT, Attachment::Type::isColor, 2});
+
+            graph.addPass("AmbientOcclusion", PassType::Compute)
+                .read(depth, Usage::Sampled)
+                .read(normal, Usage::Sampled)
+                .write(ssao, Usage::Storage);
+
+            graph.addPass("AmbientOcclusionBlur", PassType::Compute)
+                .read(ssao, Usage::Sampled)
+                .write(ssaoBlurred, Usage::Storage);
+
+            if (!options.computeLighting)
+                graph.markOutput(ssaoBlurred, Usage::Sampled);
+        }
+
+        RenderGraph::Resource litColor = RenderGraph::invalidResource;
+
+        if (options.computeLighting)
+        {
+            litColor = graph.createImage("LitColor", {VK_FORMAT_R16G16B16A16_SFLOAT});
+
+            graph.addPass("TiledLightingClear", PassType::Transfer).write(litColor, Usage::TransferDst);
+
+            RenderGraph::PassBuilder tiled = graph.addPass("TiledLighting", PassType::Compute);
+            tiled.read(normal, Usage::Sampled).read(albido, Usage::Sampled).read(depth, Usage::Sampled);
+
+            if (ssaoBlurred != RenderGraph::invalidResource)
+                tiled.read(ssaoBlurred, Usage::Sampled);
+
+            tiled.write(litColor, Usage::Storage);
+
+            if (!options.dynamicResolution)
+                graph.addPass("TiledLightingBlit", PassType::Transfer)
+                    .read(litColor, Usage::TransferSrc)
+                    .write(outColor, Usage::TransferDst);
+        }
+
+        if (options.dynamicResolution)
+        {
+            RenderGraph::Resource upscaled = graph.createImage("Upscaled", {VK_FORMAT_R16G16B16A16_SFLOAT});
+
+            graph.addPass("Upscale", PassType::Compute)
+                .read(litColor != RenderGraph::invalidResource ? litColor : lit, Usage::Sampled)
+                .write(upscaled, Usage::Storage);
+
+            graph.addPass("UpscaleBlit", PassType::Transfer)
+                .read(upscaled, Usage::TransferSrc)
+                .write(outColor, Usage::TransferDst);
+        }
+
+        graph.markOutput(outColor, Usage::Present);
+        graph.compile();
+    }
+
+    // The barrier for resource in barriers, null if there's none
+    const RenderGraph::Barrier* barrierOf(const std::vector<RenderGraph::Barrier>& barriers, RenderGraph::Resource resource)
+    {
+        for (const RenderGraph::Barrier& barrier : barriers)
+            if (barrier.resource == resource)
+                return &barrier;
+
+        return nullptr;
+    }
+
+    bool transitions(const RenderGraph::Barrier* barrier, VkImageLayout from, VkImageLayout to)
+    {
+        return barrier != nullptr && barrier->src.layout == from && barrier->dst.layout == to;
+    }
+
+    template<typename Fn>
+    bool throws(const Fn& fn)
+    {
+        try { fn(); }
+        catch (const std::runtime_error&) { return true; }
+        return false;
+    }
+
+    void cullAndMerge()
+    {
+        RenderGraph graph;
+
+        RenderGraph::Resource color = graph.importImage("OutColor", {VK_FORMAT_B8G8R8A8_SRGB, Attachment::Type::isPresented});
+        RenderGraph::Resource debug = graph.createImage("Debug", {VK_FORMAT_R8G8B8A8_UNORM});
+        RenderGraph::Resource scratch = graph.createImage("Scratch", {VK_FORMAT_R8G8B8A8_UNORM});
+
+        graph.addPass("Scene", PassType::Graphics).write(color, Usage::ColorAttachment);
+        graph.addPass("DebugView", PassType::Graphics).write(debug, Usage::ColorAttachment);
+        graph.addPass("SideEffect", PassType::Compute).write(scratch, Usage::Storage).keep();
+
+        graph.markOutput(color, Usage::Present);
+        graph.compile();
+
+        ORASIS_CHECK(!graph.isCulled("Scene"));
+        ORASIS_CHECK(graph.isCulled("DebugView"));
+        ORASIS_CHECK(!graph.isCulled("SideEffect"));
+
+        // Nothing reads the culled pass' image, it gets no usage and no memory
+        ORASIS_CHECK(graph.getUsage(debug) == 0);
+        ORASIS_CHECK(graph.getAliasSlot(debug) == RenderGraph::none);
+
+        RenderGraph frame;
+        describeFrame(frame, {});
+
+        ORASIS_CHECK(frame.getSubpass("Geometry") == 0);
+        ORASIS_CHECK(frame.getSubpass("Lighting") == 1);
+        ORASIS_CHECK(frame.getUsage(frame.find("Normal")) == (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT));
+    }
+
+    void subpassDependencies()
+    {
+        RenderGraph graph;
+        describeFrame(graph, {});
+
+        bool byRegion = false;
+
+        for (const VkSubpassDependency& dependency : graph.getSubpassDependencies("Lighting"))
+            if (dependency.srcSubpass == 0 && dependency.dstSubpass == 1)
+                byRegion = (dependency.dependencyFlags & VK_DEPENDENCY_BY_REGION_BIT) &&
+                           (dependency.srcAccessMask & VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT) &&
+                           (dependency.dstAccessMask & VK_ACCESS_INPUT_ATTACHMENT_READ_BIT);
+
+        ORASIS_CHECK(byRegion);
+
+        // One render pass, both passes see the same dependencies
+        ORASIS_CHECK(&graph.getSubpassDependencies("Geometry") == &graph.getSubpassDependencies("Lighting"));
+    }
+
+    // Render passes leave a presented image ready to present (RenderPass builds it that way)
+    void presentFinalLayout()
+    {
+        RenderGraph subpass;
+        describeFrame(subpass, {});
+
+        ORASIS_CHECK(subpass.getFinalLayout("Lighting", subpass.find("OutColor")) == VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+        ORASIS_CHECK(subpass.getOutputBarriers("Lighting").empty());
+
+        // Still the case when a blit overwrites it later, the blit transitions it from there
+        RenderGraph compute;
+        describeFrame(compute, {true, false, false, false});
+
+        RenderGraph::Resource outColor = compute.find("OutColor");
+
+        ORASIS_CHECK(compute.getFinalLayout("Lighting", outColor) == VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+        ORASIS_CHECK(transitions(barrierOf(compute.getBarriers("TiledLightingBlit"), outColor), VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL));
+        ORASIS_CHECK(transitions(barrierOf(compute.getOutputBarriers("TiledLightingBlit"), outColor), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR));
+
+        // The G-buffer leaves the render pass the way the compute lighting samples it
+        ORASIS_CHECK(compute.getFinalLayout("Geometry", compute.find("Normal")) == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        ORASIS_CHECK(compute.getFinalLayout("Geometry", compute.find("Depth")) == VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+    }
+
+    void ambientOcclusionBarriers()
+    {
+        RenderGraph graph;
+        describeFrame(graph, {false, true, false, false});
+
+        RenderGraph::Resource ssao = graph.find("SSAO");
+        RenderGraph::Resource blurred = graph.find("SSAOBlurred");
+
+        // Graph owned, every frame starts from nothing
+        const RenderGraph::Barrier* write = barrierOf(graph.getBarriers("AmbientOcclusion"), ssao);
+        ORASIS_CHECK(transitions(write, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL));
+        ORASIS_CHECK(write && write->dst.stages == VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+        // Written by one dispatch, sampled by the next
+        const RenderGraph::Barrier* read = barrierOf(graph.getBarriers("AmbientOcclusionBlur"), ssao);
+        ORASIS_CHECK(transitions(read, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+        ORASIS_CHECK(read && (read->src.access & VK_ACCESS_SHADER_WRITE_BIT) && read->dst.access == VK_ACCESS_SHADER_READ_BIT);
+        ORASIS_CHECK(read && read->src.stages == VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT && read->dst.stages == VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        ORASIS_CHECK(transitions(barrierOf(graph.getBarriers("AmbientOcclusionBlur"), blurred), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL));
+
+        // The lighting subpass samples the result after the graph
+        const RenderGraph::Barrier* output = barrierOf(graph.getOutputBarriers("AmbientOcclusionBlur"), blurred);
+        ORASIS_CHECK(transitions(output, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+        ORASIS_CHECK(output && (output->dst.stages & VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT));
+        ORASIS_CHECK(barrierOf(graph.getOutputBarriers("AmbientOcclusionBlur"), ssao) == nullptr);
+
+        ORASIS_CHECK(graph.getUsage(ssao) == (VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT));
+    }
+
+    void computeLightingBarriers()
+    {
+        RenderGraph graph;
+        describeFrame(graph, {true, true, false, false});
+
+        RenderGraph::Resource litColor = graph.find("LitColor");
+        RenderGraph::Resource blurred = graph.find("SSAOBlurred");
+
+        ORASIS_CHECK(transitions(barrierOf(graph.getBarriers("TiledLightingClear"), litColor), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL));
+
+        const RenderGraph::Barrier* cleared = barrierOf(graph.getBarriers("TiledLighting"), litColor);
+        ORASIS_CHECK(transitions(cleared, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL));
+        ORASIS_CHECK(cleared && cleared->src.stages == VK_PIPELINE_STAGE_TRANSFER_BIT && cleared->src.access == VK_ACCESS_TRANSFER_WRITE_BIT);
+
+        // Not an output any more, the compute lighting reads it in its own pass
+        ORASIS_CHECK(transitions(barrierOf(graph.getBarriers("TiledLighting"), blurred), VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+        ORASIS_CHECK(graph.getOutputBarriers("AmbientOcclusionBlur").empty());
+
+        ORASIS_CHECK(transitions(barrierOf(graph.getBarriers("TiledLightingBlit"), litColor), VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL));
+        ORASIS_CHECK(graph.getUsage(litColor) == (VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT));
+    }
+
+    void upscaleBarriers()
+    {
+        RenderGraph graph;
+        describeFrame(graph, {false, false, true, false});
+
+        RenderGraph::Resource sceneColor = graph.find("SceneColor");
+        RenderGraph::Resource upscaled = graph.find("Upscaled");
+        RenderGraph::Resource outColor = graph.find("OutColor");
+
+        // The render pass leaves the lit image sampled, nothing to transition before the upscale
+        ORASIS_CHECK(graph.getFinalLayout("Lighting", sceneColor) == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        ORASIS_CHECK(transitions(barrierOf(graph.getBarriers("Upscale"), upscaled), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL));
+
+        ORASIS_CHECK(transitions(barrierOf(graph.getBarriers("UpscaleBlit"), upscaled), VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL));
+        ORASIS_CHECK(barrierOf(graph.getBarriers("UpscaleBlit"), outColor) != nullptr);
+        ORASIS_CHECK(transitions(barrierOf(graph.getOutputBarriers("UpscaleBlit"), outColor), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR));
+    }
+
+    void aliasing()
+    {
+        RenderGraph graph;
+        describeFrame(graph, {true, true, true, false});
+
+        uint32_t ssao = graph.getAliasSlot(graph.find("SSAO"));
+        uint32_t blurred = graph.getAliasSlot(graph.find("SSAOBlurred"));
+        uint32_t litColor = graph.getAliasSlot(graph.find("LitColor"));
+        uint32_t upscaled = graph.getAliasSlot(graph.find("Upscaled"));
+
+        ORASIS_CHECK(ssao != RenderGraph::none && blurred != RenderGraph::none);
+
+        // The blur input is dead once the blur ran, the lit image takes its memory
+        ORASIS_CHECK(litColor == ssao);
+        ORASIS_CHECK(blurred != ssao && blurred != litColor);
+
+        // The lit image is read by the upscale that writes this one
+        ORASIS_CHECK(upscaled != litColor);
+
+        // Imported ones are owned elsewhere
+        ORASIS_CHECK(graph.getAliasSlot(graph.find("Depth")) == RenderGraph::none);
+
+        // Only ever an attachment of one render pass: lazily allocated, no slot
+        RenderGraph transient;
+
+        RenderGraph::Resource color = transient.importImage("OutColor", {VK_FORMAT_B8G8R8A8_SRGB, Attachment::Type::isPresented});
+        RenderGraph::Resource gBuffer = transient.createImage("GBuffer", {VK_FORMAT_R8G8B8A8_UNORM});
+
+        transient.addPass("Geometry", PassType::Graphics).write(gBuffer, Usage::ColorAttachment);
+        transient.addPass("Lighting", PassType::Graphics).read(gBuffer, Usage::InputAttachment).write(color, Usage::ColorAttachment);
+        transient.markOutput(color, Usage::Present);
+        transient.compile();
+
+        ORASIS_CHECK(transient.isTransient(gBuffer));
+        ORASIS_CHECK(transient.getAliasSlot(gBuffer) == RenderGraph::none);
+        ORASIS_CHECK(transient.getUsage(gBuffer) & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT);
+    }
+
+    // The occlusion culling's pass reads depth without writing anything, it's only there through keep()
+    void keptPass()
+    {
+        RenderGraph graph;
+        describeFrame(graph, {false, false, false, true});
+
+        ORASIS_CHECK(!graph.isCulled("DepthPyramid"));
+        ORASIS_CHECK(graph.getFinalLayout("Geometry", graph.find("Depth")) == VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+        ORASIS_CHECK(graph.getUsage(graph.find("Depth")) & VK_IMAGE_USAGE_SAMPLED_BIT);
+    }
+
+    void dump()
+    {
+        RenderGraph graph;
+        describeFrame(graph, {true, true, false, false});
+
+        std::ostringstream out;
+        graph.dump(out, {1920, 1080});
+
+        std::string text = out.str();
+
+        ORASIS_CHECK(text.rfind("digraph", 0) == 0);
+        ORASIS_CHECK(text.find("AmbientOcclusionBlur") != std::string::npos);
+        ORASIS_CHECK(text.find("LitColor") != std::string::npos);
+    }
+
+    void errors()
+    {
+        RenderGraph graph;
+        RenderGraph::Resource image = graph.createImage("Image", {VK_FORMAT_R8G8B8A8_UNORM});
+
+        // Nothing wrote it earlier in the frame
+        graph.addPass("Reader", PassType::Compute).read(image, Usage::Sampled).keep();
+        ORASIS_CHECK(throws([&] { graph.compile(); }));
+
+        RenderGraph frame;
+        describeFrame(frame, {false, true, false, false});
+
+        ORASIS_CHECK(throws([&] { frame.isCulled("Missing"); }));
+        ORASIS_CHECK(throws([&] { frame.getSubpassDependencies("AmbientOcclusion"); }));
+        ORASIS_CHECK(throws([&] { frame.getFinalLayout("Geometry", frame.find("SSAO")); }));
+
+        // Not realized yet, nothing is recorded
+        ORASIS_CHECK(throws([&] { frame.executePass(VK_NULL_HANDLE, "AmbientOcclusion", 0); }));
+    }
+
+}
+
+int main()
+{
+    OrasisTest::run("culling and merging", cullAndMerge);
+    OrasisTest::run("subpass dependencies", subpassDependencies);
+    OrasisTest::run("presented final layout", presentFinalLayout);
+    OrasisTest::run("ambient occlusion barriers", ambientOcclusionBarriers);
+    OrasisTest::run("compute lighting barriers", computeLightingBarriers);
+    OrasisTest::run("upscale barriers", upscaleBarriers);
+    OrasisTest::run("alias slots", aliasing);
+    OrasisTest::run("kept pass", keptPass);
+    OrasisTest::run("dump", dump);
+    OrasisTest::run("errors", errors);
+
+    return OrasisTest::finish();
+}
+
+
+
+// ---- Entry points of realize() and the recording, never called here ----
+
+extern "C" {
+
+    VKAPI_ATTR VkResult VKAPI_CALL vkCreateImage(VkDevice, const VkImageCreateInfo*, const VkAllocationCallbacks*, VkImage*) { return VK_ERROR_INITIALIZATION_FAILED; }
+    VKAPI_ATTR void VKAPI_CALL vkDestroyImage(VkDevice, VkImage, const VkAllocationCallbacks*) {}
+    VKAPI_ATTR void VKAPI_CALL vkGetImageMemoryRequirements(VkDevice, VkImage, VkMemoryRequirements*) {}
+    VKAPI_ATTR VkResult VKAPI_CALL vkCreateImageView(VkDevice, const VkImageViewCreateInfo*, const VkAllocationCallbacks*, VkImageView*) { return VK_ERROR_INITIALIZATION_FAILED; }
+    VKAPI_ATTR void VKAPI_CALL vkDestroyImageView(VkDevice, VkImageView, const VkAllocationCallbacks*) {}
+    VKAPI_ATTR VkResult VKAPI_CALL vkCreateRenderPass(VkDevice, const VkRenderPassCreateInfo*, const VkAllocationCallbacks*, VkRenderPass*) { return VK_ERROR_INITIALIZATION_FAILED; }
+    VKAPI_ATTR void VKAPI_CALL vkDestroyRenderPass(VkDevice, VkRenderPass, const VkAllocationCallbacks*) {}
+    VKAPI_ATTR VkResult VKAPI_CALL vkCreateFramebuffer(VkDevice, const VkFramebufferCreateInfo*, const VkAllocationCallbacks*, VkFramebuffer*) { return VK_ERROR_INITIALIZATION_FAILED; }
+    VKAPI_ATTR void VKAPI_CALL vkDestroyFramebuffer(VkDevice, VkFramebuffer, const VkAllocationCallbacks*) {}
+
+    VKAPI_ATTR void VKAPI_CALL vkCmdBeginRenderPass(VkCommandBuffer, const VkRenderPassBeginInfo*, VkSubpassContents) {}
+    VKAPI_ATTR void VKAPI_CALL vkCmdNextSubpass(VkCommandBuffer, VkSubpassContents) {}
+    VKAPI_ATTR void VKAPI_CALL vkCmdEndRenderPass(VkCommandBuffer) {}
+    VKAPI_ATTR void VKAPI_CALL vkCmdPipelineBarrier(VkCommandBuffer, VkPipelineStageFlags, VkPipelineStageFlags, VkDependencyFlags,
+                                                    uint32_t, const VkMemoryBarrier*, uint32_t, const VkBufferMemoryBarrier*, uint32_t, const VkImageMemoryBarrier*) {}
+
+    VkResult vmaCreateImage(VmaAllocator, const VkImageCreateInfo*, const VmaAllocationCreateInfo*, VkImage*, VmaAllocation*, VmaAllocationInfo*) { return VK_ERROR_INITIALIZATION_FAILED; }
+    VkResult vmaAllocateMemory(VmaAllocator, const VkMemoryRequirements*, const VmaAllocationCreateInfo*, VmaAllocation*, VmaAllocationInfo*) { return VK_ERROR_INITIALIZATION_FAILED; }
+    VkResult vmaAllocateMemoryForImage(VmaAllocator, VkImage, const VmaAllocationCreateInfo*, VmaAllocation*, VmaAllocationInfo*) { return VK_ERROR_INITIALIZATION_FAILED; }
+    VkResult vmaBindImageMemory(VmaAllocator, VmaAllocation, VkImage) { return VK_ERROR_INITIALIZATION_FAILED; }
+    void vmaFreeMemory(VmaAllocator, VmaAllocation) {}
+
+}
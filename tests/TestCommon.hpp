@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdio>
+
+namespace OrasisTest {
+
+
+    // Failed checks so far, the test executable's exit code
+    inline int& failures()
+    {
+        static int count = 0;
+        return count;
+    }
+
+    inline void check(bool passed, const char* expression, const char* file, int line)
+    {
+        if (passed) return;
+
+        std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+        failures()++;
+    }
+
+    // Runs one test function and reports it by name
+    template<typename Test>
+    void run(const char* name, Test test)
+    {
+        int before = failures();
+        test();
+        std::printf("%s %s\n", failures() == before ? "[pass]" : "[FAIL]", name);
+    }
+
+    inline int finish()
+    {
+        if (failures() > 0)
+            std::fprintf(stderr, "%d check(s) failed\n", failures());
+
+        return failures() == 0 ? 0 : 1;
+    }
+
+}
+
+// Keeps going after a failure so one run reports every broken check
+#define ORASIS_CHECK(expression) OrasisTest::check(static_cast<bool>(expression), #expression, __FILE__, __LINE__)
@@ -0,0 +1,246 @@
+#include "TestCommon.hpp"
+
+#include "TransformBatch.hpp"
+#include "GameObject.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace Orasis;
+
+namespace {
+
+    // Counts around both SIMD widths so every path ends in a scalar remainder at some point
+    const size_t counts[] = {0, 1, 3, 4, 5, 7, 8, 9, 12, 15, 16, 17, 31, 33, 1005};
+
+    // Written to every output first, entries nobody should touch have to keep it
+    const float sentinel = -12345.f;
+
+    std::vector<SimdLevel> supportedLevels()
+    {
+        std::vector<SimdLevel> levels{SimdLevel::Scalar};
+        SimdLevel best = detectSimdLevel();
+
+        if (best >= SimdLevel::SSE2) levels.push_back(SimdLevel::SSE2);
+        if (best >= SimdLevel::AVX2) levels.push_back(SimdLevel::AVX2);
+
+        return levels;
+    }
+
+    std::vector<TransformComponent> randomTransforms(std::mt19937& rng, size_t count)
+    {
+        std::uniform_real_distribution<float> position{-100.f, 100.f};
+        std::uniform_real_distribution<float> angle{-8.f, 8.f};
+        std::uniform_real_distribution<float> magnitude{0.1f, 4.f};
+        std::bernoulli_distribution flip{0.25};
+
+        std::vector<TransformComponent> transforms(count);
+
+        for (TransformComponent& t : transforms)
+        {
+            t.translation = {position(rng), position(rng), position(rng)};
+            t.rotation = {angle(rng), angle(rng), angle(rng)};
+
+            // Some mirrored axes, the normal matrix has to keep the sign
+            t.scale = {magnitude(rng), magnitude(rng), magnitude(rng)};
+            if (flip(rng)) t.scale.y = -t.scale.y;
+        }
+
+        return transforms;
+    }
+
+    TransformSoA toSoA(const std::vector<TransformComponent>& transforms)
+    {
+        TransformSoA soa;
+        for (const TransformComponent& t : transforms)
+            soa.push(t.translation, t.rotation, t.scale);
+        return soa;
+    }
+
+    bool near(float value, float expected, float tolerance)
+    {
+        return std::abs(value - expected) <= tolerance * std::max(1.f, std::abs(expected));
+    }
+
+    bool isSentinel(const glm::mat4& m)
+    {
+        for (int c = 0; c < 4; c++)
+            for (int r = 0; r < 4; r++)
+                if (m[c][r] != sentinel) return false;
+        return true;
+    }
+
+    bool isSentinel(const glm::mat3& m)
+    {
+        for (int c = 0; c < 3; c++)
+            for (int r = 0; r < 3; r++)
+                if (m[c][r] != sentinel) return false;
+        return true;
+    }
+
+    // Checks [begin, end) against mat4() and everything else (one past the end included) is untouched
+    bool matchesReference(const std::vector<TransformComponent>& transforms, size_t begin, size_t end,
+                          const std::vector<glm::mat4>& models, const std::vector<glm::mat3>& normals, SimdLevel level)
+    {
+        float worstModel = 0.f;
+        float worstNormal = 0.f;
+        bool untouched = true;
+
+        for (size_t i = 0; i < models.size(); i++)
+        {
+            if (i < begin || i >= end)
+            {
+                untouched &= isSentinel(models[i]) && isSentinel(normals[i]);
+                continue;
+            }
+
+            const glm::mat4 reference = transforms[i].mat4();
+            const glm::mat3 referenceNormal = glm::transpose(glm::inverse(glm::mat3{reference}));
+
+            for (int c = 0; c < 4; c++)
+                for (int r = 0; r < 4; r++)
+                    if (!near(models[i][c][r], reference[c][r], 1e-5f))
+                        worstModel = std::max(worstModel, std::abs(models[i][c][r] - reference[c][r]));
+
+            // Scales down to 0.1 put entries up to 10 into the inverse, hence the looser bound
+            for (int c = 0; c < 3; c++)
+                for (int r = 0; r < 3; r++)
+                    if (!near(normals[i][c][r], referenceNormal[c][r], 1e-4f))
+                        worstNormal = std::max(worstNormal, std::abs(normals[i][c][r] - referenceNormal[c][r]));
+        }
+
+        if (worstModel > 0.f || worstNormal > 0.f || !untouched)
+            std::fprintf(stderr, "  %s [%zu, %zu): model off by %g, normal off by %g, %s\n",
+                simdLevelName(level), begin, end, worstModel, worstNormal, untouched ? "outside untouched" : "wrote outside the range");
+
+        return worstModel == 0.f && worstNormal == 0.f && untouched;
+    }
+
+    void everyLevelMatchesMat4()
+    {
+        std::mt19937 rng{1234};
+
+        for (SimdLevel level : supportedLevels())
+            for (size_t count : counts)
+            {
+                std::vector<TransformComponent> transforms = randomTransforms(rng, count);
+                TransformSoA soa = toSoA(transforms);
+
+                // One extra entry catches a SIMD store running past the end
+                std::vector<glm::mat4> models(count + 1, glm::mat4{0.f} + sentinel);
+                std::vector<glm::mat3> normals(count + 1, glm::mat3{0.f} + sentinel);
+
+                composeTransforms(soa, models.data(), normals.data(), level);
+
+                ORASIS_CHECK(matchesReference(transforms, 0, count, models, normals, level));
+            }
+    }
+
+    // Unaligned begin and end, so every path starts and finishes mid-vector
+    void rangedOverload()
+    {
+        std::mt19937 rng{99};
+
+        const size_t count = 77;
+        std::vector<TransformComponent> transforms = randomTransforms(rng, count);
+        TransformSoA soa = toSoA(transforms);
+
+        const size_t ranges[][2] = {{0, 77}, {1, 76}, {3, 20}, {5, 13}, {9, 10}, {30, 30}, {70, 77}, {13, 64}};
+
+        for (SimdLevel level : supportedLevels())
+            for (const auto& range : ranges)
+            {
+                std::vector<glm::mat4> models(count + 1, glm::mat4{0.f} + sentinel);
+                std::vector<glm::mat3> normals(count + 1, glm::mat3{0.f} + sentinel);
+
+                composeTransforms(soa, range[0], range[1], models.data(), normals.data(), level);
+
+                ORASIS_CHECK(matchesReference(transforms, range[0], range[1], models, normals, level));
+            }
+    }
+
+    // Model matrices only, nothing may be written through the null normal pointer
+    void withoutNormals()
+    {
+        std::mt19937 rng{7};
+
+        std::vector<TransformComponent> transforms = randomTransforms(rng, 41);
+        TransformSoA soa = toSoA(transforms);
+
+        for (SimdLevel level : supportedLevels())
+        {
+            std::vector<glm::mat4> models(transforms.size());
+            composeTransforms(soa, models.data(), nullptr, level);
+
+            bool matches = true;
+            for (size_t i = 0; i < transforms.size(); i++)
+            {
+                const glm::mat4 reference = transforms[i].mat4();
+                for (int c = 0; c < 4; c++)
+                    for (int r = 0; r < 4; r++)
+                        matches &= near(models[i][c][r], reference[c][r], 1e-5f);
+            }
+
+            ORASIS_CHECK(matches);
+        }
+    }
+
+    /*
+        The polynomial sin/cos on its own: a z-only rotation with unit scale puts (cos z, sin z)
+        in the first column. Compared in double over the documented range, |x| < 8192, where
+        it's good to about 1e-7.
+    */
+    void sinCosAccuracy()
+    {
+        std::mt19937 rng{2024};
+
+        std::vector<float> angles;
+        for (float x : {0.f, -0.f, 1e-6f, -1e-6f, 0.785398f, 1.570796f, 3.141593f, -3.141593f, 6.283185f, 100.f, -1000.f, 8191.f, -8191.f})
+            angles.push_back(x);
+
+        std::uniform_real_distribution<float> small{-10.f, 10.f};
+        std::uniform_real_distribution<float> large{-8191.f, 8191.f};
+        for (int i = 0; i < 4000; i++) angles.push_back(small(rng));
+        for (int i = 0; i < 4000; i++) angles.push_back(large(rng));
+
+        TransformSoA soa;
+        for (float x : angles)
+            soa.push(glm::vec3{0.f}, glm::vec3{0.f, 0.f, x}, glm::vec3{1.f});
+
+        for (SimdLevel level : supportedLevels())
+        {
+            std::vector<glm::mat4> models(angles.size());
+            composeTransforms(soa, models.data(), nullptr, level);
+
+            double worst = 0.0;
+            for (size_t i = 0; i < angles.size(); i++)
+            {
+                const double x = angles[i];
+                worst = std::max(worst, std::abs(models[i][0][0] - std::cos(x)));
+                worst = std::max(worst, std::abs(models[i][0][1] - std::sin(x)));
+            }
+
+            if (worst > 2.5e-7)
+                std::fprintf(stderr, "  %s sin/cos off by %g\n", simdLevelName(level), worst);
+
+            ORASIS_CHECK(worst <= 2.5e-7);
+        }
+    }
+
+}
+
+int main()
+{
+    std::printf("detected %s\n", simdLevelName(detectSimdLevel()));
+
+    OrasisTest::run("every level matches TransformComponent::mat4", everyLevelMatchesMat4);
+    OrasisTest::run("ranged overload with unaligned bounds", rangedOverload);
+    OrasisTest::run("null normal matrices", withoutNormals);
+    OrasisTest::run("polynomial sin/cos", sinCosAccuracy);
+
+    return OrasisTest::finish();
+}
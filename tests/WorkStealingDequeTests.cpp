@@ -0,0 +1,173 @@
+#include "TestCommon.hpp"
+
+#include "WorkStealingDeque.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using Orasis::WorkStealingDeque;
+
+namespace {
+
+    void ownerOrder()
+    {
+        WorkStealingDeque<uint64_t> deque{4};
+        uint64_t item = 0;
+
+        ORASIS_CHECK(deque.empty());
+        ORASIS_CHECK(!deque.pop(item));
+        ORASIS_CHECK(!deque.steal(item));
+
+        for (uint64_t i = 1; i <= 3; i++)
+            deque.push(i);
+
+        // Thieves take the oldest, the owner the newest
+        ORASIS_CHECK(deque.steal(item) && item == 1);
+        ORASIS_CHECK(deque.pop(item) && item == 3);
+        ORASIS_CHECK(deque.pop(item) && item == 2);
+        ORASIS_CHECK(!deque.pop(item));
+        ORASIS_CHECK(deque.empty());
+    }
+
+    void growthKeepsItems()
+    {
+        WorkStealingDeque<uint64_t> deque{2};
+        const uint64_t count = 10000;
+
+        for (uint64_t i = 0; i < count; i++)
+            deque.push(i);
+
+        // Half from the top, the rest from the bottom, both across every grown array
+        uint64_t item = 0;
+        bool inOrder = true;
+
+        for (uint64_t i = 0; i < count / 2; i++)
+            inOrder &= deque.steal(item) && item == i;
+
+        for (uint64_t i = count; i-- > count / 2;)
+            inOrder &= deque.pop(item) && item == i;
+
+        ORASIS_CHECK(inOrder);
+        ORASIS_CHECK(deque.empty());
+    }
+
+    /*
+        The owner pushes in bursts (growing the array while thieves are stealing from the one it
+        replaces) and pops in between, thieves steal the whole time. Every item has to come out
+        exactly once, whoever got it.
+    */
+    void ownerAndThievesRace()
+    {
+        const uint32_t thieves = std::max(2u, std::thread::hardware_concurrency()) - 1;
+        const uint64_t count = 200000;
+
+        for (int round = 0; round < 4; round++)
+        {
+            WorkStealingDeque<uint64_t> deque{2};
+            std::unique_ptr<std::atomic<uint32_t>[]> seen{new std::atomic<uint32_t>[count]};
+            for (uint64_t i = 0; i < count; i++)
+                seen[i].store(0, std::memory_order_relaxed);
+
+            std::atomic<bool> done{false};
+
+            std::vector<std::thread> threads;
+            for (uint32_t t = 0; t < thieves; t++)
+                threads.emplace_back([&] {
+                    uint64_t item = 0;
+                    while (!done.load(std::memory_order_acquire))
+                        if (deque.steal(item))
+                            seen[item].fetch_add(1, std::memory_order_relaxed);
+                });
+
+            uint64_t next = 0;
+            uint64_t burst = 1;
+            uint64_t item = 0;
+
+            while (next < count)
+            {
+                for (uint64_t i = 0; i < burst && next < count; i++)
+                    deque.push(next++);
+
+                // Doubling bursts up to a few thousand, every power of two gets grown through
+                burst = burst < 4096 ? burst * 2 : 1;
+
+                for (int i = 0; i < 3; i++)
+                    if (deque.pop(item))
+                        seen[item].fetch_add(1, std::memory_order_relaxed);
+            }
+
+            while (!deque.empty())
+                if (deque.pop(item))
+                    seen[item].fetch_add(1, std::memory_order_relaxed);
+
+            done.store(true, std::memory_order_release);
+            for (std::thread& thread : threads)
+                thread.join();
+
+            bool exactlyOnce = true;
+            for (uint64_t i = 0; i < count; i++)
+                exactlyOnce &= seen[i].load(std::memory_order_relaxed) == 1;
+
+            ORASIS_CHECK(exactlyOnce);
+            ORASIS_CHECK(deque.empty());
+        }
+    }
+
+    // Only the last item is contended between pop and steal, the classic Chase-Lev corner
+    void lastItemRace()
+    {
+        WorkStealingDeque<uint64_t> deque{2};
+        std::atomic<int> phase{0};
+        std::atomic<uint32_t> taken{0};
+        bool singleWinner = true;
+
+        std::thread thief([&] {
+            uint64_t item = 0;
+            for (int round = 1; round <= 20000; round++)
+            {
+                while (phase.load(std::memory_order_acquire) != 2 * round - 1)
+                    std::this_thread::yield();
+
+                if (deque.steal(item))
+                    taken.fetch_add(1, std::memory_order_relaxed);
+                phase.store(2 * round, std::memory_order_release);
+            }
+        });
+
+        uint64_t item = 0;
+        for (int round = 1; round <= 20000; round++)
+        {
+            taken.store(0, std::memory_order_relaxed);
+            deque.push(static_cast<uint64_t>(round));
+            phase.store(2 * round - 1, std::memory_order_release);
+
+            if (deque.pop(item))
+                taken.fetch_add(1, std::memory_order_relaxed);
+
+            while (phase.load(std::memory_order_acquire) != 2 * round)
+                std::this_thread::yield();
+
+            singleWinner &= taken.load(std::memory_order_relaxed) == 1;
+        }
+
+        thief.join();
+
+        ORASIS_CHECK(singleWinner);
+        ORASIS_CHECK(deque.empty());
+    }
+
+}
+
+int main()
+{
+    OrasisTest::run("owner pops newest, thieves steal oldest", ownerOrder);
+    OrasisTest::run("growth keeps every item", growthKeepsItems);
+    OrasisTest::run("owner and thieves race, growth while stealing", ownerAndThievesRace);
+    OrasisTest::run("pop and steal race for the last item", lastItemRace);
+
+    return OrasisTest::finish();
+}